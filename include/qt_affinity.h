@@ -80,5 +80,17 @@ void INTERNAL *qt_affinity_alloc(size_t bytes);
 void INTERNAL *qt_affinity_alloc_onnode(size_t bytes, int node);
 void INTERNAL qt_affinity_mem_tonode(void *addr, size_t bytes, int node);
 void INTERNAL qt_affinity_free(void *ptr, size_t bytes);
+
+/* NUMA nodes are numbered by hwloc logical index, from 0 to
+ * qt_affinity_mem_nodes() - 1. qt_affinity_mem_node_here() is the node
+ * closest to the calling worker's shepherd (or, for other threads, to the CPU
+ * the caller is running on), and qt_affinity_mem_bind() makes the pages of a
+ * page-aligned region that have not been touched yet come from the given node.
+ */
+unsigned int INTERNAL qt_affinity_mem_nodes(void);
+unsigned int INTERNAL qt_affinity_mem_node_here(void);
+void INTERNAL qt_affinity_mem_bind(void *addr,
+                                   size_t bytes,
+                                   unsigned int mem_node);
 #endif
 /* vim:set expandtab: */
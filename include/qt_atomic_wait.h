@@ -2,6 +2,7 @@
 #define QT_ATOMIC_WAIT_H
 
 #include <assert.h>
+#include <limits.h>
 #include <stdatomic.h>
 #include <stdint.h>
 
@@ -31,6 +32,8 @@
 // the appropriate OS thread pausing functionality (e.g. futex).
 // Due to constraints between the various operating systems,
 // only 32-bit integers are supported.
+// qt_wait_on_address_for() also gives up after about ns nanoseconds; like
+// qt_wait_on_address(), it may return early, so callers must recheck.
 
 #ifdef QTHREADS_LINUX
 
@@ -39,6 +42,7 @@
 #include <errno.h>
 #include <linux/futex.h>
 #include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
 
 #ifndef NDEBUG
@@ -67,12 +71,13 @@
   } while (0)
 #endif
 
+// The wake count is an int: UINT32_MAX would be -1, which wakes only one.
 #define qt_wake_all(a)                                                         \
   do {                                                                         \
     syscall(SYS_futex,                                                         \
             (a),                                                               \
             FUTEX_WAKE | FUTEX_PRIVATE_FLAG,                                   \
-            UINT32_MAX,                                                        \
+            INT_MAX,                                                           \
             NULL,                                                              \
             NULL,                                                              \
             0u);                                                               \
@@ -84,6 +89,19 @@
       SYS_futex, (a), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1u, NULL, NULL, 0u);    \
   } while (0)
 
+#define qt_wait_on_address_for(a, expected, ns)                                \
+  do {                                                                         \
+    struct timespec qt_wait_ts_ = {(time_t)((ns) / 1000000000u),               \
+                                   (long)((ns) % 1000000000u)};                \
+    syscall(SYS_futex,                                                         \
+            (a),                                                               \
+            FUTEX_WAIT | FUTEX_PRIVATE_FLAG,                                   \
+            (expected),                                                        \
+            &qt_wait_ts_,                                                      \
+            NULL,                                                              \
+            0u);                                                               \
+  } while (0)
+
 #elif defined(QTHREADS_APPLE)
 // use __ulock_wait and __ulock_wake
 // NOTE! This isn't technically a stable API even though they export the
@@ -131,6 +149,18 @@ extern int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
 #define qt_wake_one(a)                                                         \
   do { __ulock_wake(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO, (a), 0ull); } while (0)
 
+// The timeout is in microseconds, and 0 means none.
+#define qt_wait_on_address_for(a, expected, ns)                                \
+  do {                                                                         \
+    uint64_t qt_wait_us_ = ((ns) + 999u) / 1000u;                              \
+    __ulock_wait(UL_COMPARE_AND_WAIT | ULF_NO_ERRNO,                           \
+                 (a),                                                          \
+                 (expected),                                                   \
+                 qt_wait_us_ == 0             ? 1u                             \
+                 : qt_wait_us_ > UINT32_MAX ? UINT32_MAX                       \
+                                            : (uint32_t)qt_wait_us_);          \
+  } while (0)
+
 #elif defined(QTHREADS_FREEBSD)
 // use _umtx_op
 #include <sys/types.h>
@@ -156,6 +186,18 @@ extern int __ulock_wake(uint32_t operation, void *addr, uint64_t wake_value);
     qassert(_umtx_op((a), UMTX_OP_WAKE_PRIVATE, 1ul, NULL, NULL), 0);          \
   } while (0)
 
+// A relative timeout goes in uaddr2, with its size in uaddr.
+#define qt_wait_on_address_for(a, expected, ns)                                \
+  do {                                                                         \
+    struct timespec qt_wait_ts_ = {(time_t)((ns) / 1000000000u),               \
+                                   (long)((ns) % 1000000000u)};                \
+    _umtx_op((a),                                                              \
+             UMTX_OP_WAIT_UINT_PRIVATE,                                        \
+             (expected),                                                       \
+             (void *)sizeof(qt_wait_ts_),                                      \
+             &qt_wait_ts_);                                                    \
+  } while (0)
+
 #elif defined(QTHREADS_OPENBSD)
 // use futex syscall wrapper they provide: https://man.openbsd.org/futex
 #include <errno.h>
@@ -187,6 +229,17 @@ while (0)
 #define qt_wake_one(a)                                                         \
   do { futex((a), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, NULL, NULL); } while (0)
 
+#define qt_wait_on_address_for(a, expected, ns)                                \
+  do {                                                                         \
+    struct timespec qt_wait_ts_ = {(time_t)((ns) / 1000000000u),               \
+                                   (long)((ns) % 1000000000u)};                \
+    futex((a),                                                                 \
+          FUTEX_WAIT | FUTEX_PRIVATE_FLAG,                                     \
+          (expected),                                                          \
+          &qt_wait_ts_,                                                        \
+          NULL);                                                               \
+  } while (0)
+
 #elif defined(QTHREADS_NETBSD)
 // use SYS___futex syscall
 #include <errno.h>
@@ -222,7 +275,7 @@ while (0)
     syscall(SYS___futex,                                                       \
             (a),                                                               \
             FUTEX_WAKE | FUTEX_PRIVATE_FLAG,                                   \
-            UINT32_MAX,                                                        \
+            INT_MAX,                                                           \
             NULL,                                                              \
             NULL);                                                             \
   } while (0)
@@ -233,6 +286,18 @@ while (0)
       SYS___futex, (a), FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1u, NULL, NULL);      \
   } while (0)
 
+#define qt_wait_on_address_for(a, expected, ns)                                \
+  do {                                                                         \
+    struct timespec qt_wait_ts_ = {(time_t)((ns) / 1000000000u),               \
+                                   (long)((ns) % 1000000000u)};                \
+    syscall(SYS___futex,                                                       \
+            (a),                                                               \
+            FUTEX_WAIT | FUTEX_PRIVATE_FLAG,                                   \
+            (expected),                                                        \
+            &qt_wait_ts_,                                                      \
+            NULL);                                                             \
+  } while (0)
+
 #elif defined(QTHREADS_DRAGONFLYBSD)
 // use umtx_sleep and umtx_wakeup
 #include <errno.h>
@@ -257,6 +322,17 @@ while (0)
 #define qt_wake_one(a)                                                         \
   do { qassert(umtx_wakeup((a), 1), 0); } while (0)
 
+// The timeout is in microseconds, and 0 means none; waking up early is fine.
+#define qt_wait_on_address_for(a, expected, ns)                                \
+  do {                                                                         \
+    uint64_t qt_wait_us_ = ((ns) + 999u) / 1000u;                              \
+    umtx_sleep((a),                                                            \
+               (expected),                                                     \
+               qt_wait_us_ == 0        ? 1                                     \
+               : qt_wait_us_ > 999999u ? 999999                                \
+                                       : (int)qt_wait_us_);                    \
+  } while (0)
+
 #elif defined(QTHREADS_WINDOWS)
 // use WaitOnAddress/WakeByAddressSingle/WakeByAddressAll
 #include <synchapi.h>
@@ -269,6 +345,18 @@ while (0)
 #define qt_wake_one(a)                                                         \
   do { WakeByAddressSingle(a); } while (0)
 
+#define qt_wait_on_address_for(a, expected, ns)                                \
+  do {                                                                         \
+    uint32_t qt_wait_v_ = (expected);                                          \
+    uint64_t qt_wait_ms_ = ((ns) + 999999u) / 1000000u;                        \
+    WaitOnAddress((a),                                                         \
+                  &qt_wait_v_,                                                 \
+                  4,                                                           \
+                  qt_wait_ms_ == 0          ? 1                                \
+                  : qt_wait_ms_ >= INFINITE ? INFINITE - 1                     \
+                                            : (DWORD)qt_wait_ms_);             \
+  } while (0)
+
 #elif defined(__sun)
 // Solaris supposedly provides something futex-like via "user-level adaptive
 // spin mutexes".
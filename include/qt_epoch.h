@@ -0,0 +1,32 @@
+#ifndef QT_EPOCH_H
+#define QT_EPOCH_H
+
+#include "qt_visibility.h"
+
+/* Epoch-based reclamation (Fraser, "Practical lock-freedom", 2004), an
+ * alternative to hazard pointers (qt_hazardptrs.h) for lock-free structures.
+ * Instead of publishing every pointer it is about to dereference, a reader
+ * brackets each operation with qt_epoch_enter() and qt_epoch_exit(), which
+ * only announce the global epoch it started in. A node unlinked from the
+ * structure is handed to qt_epoch_retire(), which puts it on a limbo list of
+ * the calling worker tagged with the epoch; once the epoch has advanced twice
+ * more, nobody can still hold a pointer to it and it is freed. The epoch is
+ * advanced (when no one is still in an older one) by a worker every
+ * QT_EPOCH_BATCH retirements, so nothing ever scans the limbo lists of other
+ * workers, and freeing a node costs O(1) on average.
+ *
+ * Each worker has its own record, and a qthread uses that of the worker it
+ * runs on, so a qthread must not block or yield between qt_epoch_enter() and
+ * qt_epoch_exit(); such sections may nest. Threads that are not workers get a
+ * record of their own the first time they enter. */
+
+typedef void (*qt_epoch_free_f)(void *ptr);
+
+void INTERNAL qt_epoch_subsystem_init(void);
+void INTERNAL qt_epoch_enter(void);
+void INTERNAL qt_epoch_exit(void);
+/* ptr must already be unreachable for anyone who enters after this */
+void INTERNAL qt_epoch_retire(qt_epoch_free_f freefunc, void *ptr);
+
+#endif // ifndef QT_EPOCH_H
+/* vim:set expandtab: */
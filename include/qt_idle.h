@@ -0,0 +1,90 @@
+#ifndef QT_IDLE_H
+#define QT_IDLE_H
+
+/* System Headers */
+#include <stdatomic.h>
+#include <stdint.h>
+
+/* Internal Headers */
+#include "qt_atomic_wait.h"
+#include "qt_branching.h"
+#include "qt_threadqueues.h"
+#include "qt_visibility.h"
+
+/* Spin-then-park idling for workers whose scheduler has run dry.
+ *
+ * Every ready queue embeds a qt_idle_t. A worker that has found nothing to
+ * run for its spin budget counts itself in the queue's parked count and
+ * sleeps on the epoch futex. Enqueuers check that count after publishing a
+ * task, so they only pay for a wake-up syscall when somebody is parked. The
+ * spin budget adapts per worker: it doubles when a park turns out to be
+ * shorter than the spin would have been, and halves when parks are long. */
+typedef struct {
+  qt_atomic_wait_t epoch;
+  _Atomic uint32_t parked;
+} qt_idle_t;
+
+/* returns nonzero if the parking worker may have something to do after all;
+ * called after it has counted itself as parked */
+typedef int (*qt_idle_check_f)(void *arg);
+
+extern int qt_idle_parking;
+extern _Atomic uint32_t qt_idle_nparked;
+
+/* implemented by each scheduler */
+qt_idle_t INTERNAL *qt_threadqueue_idle(qt_threadqueue_t *q);
+
+void INTERNAL qt_idle_subsystem_init(void);
+void INTERNAL qt_idle_init(qt_idle_t *idle);
+void INTERNAL qt_idle_wake(qt_idle_t *idle);
+void INTERNAL qt_idle_wake_thief(qt_idle_t *idle);
+void INTERNAL qt_idle_wake_all(void);
+
+/* Called each time a full scheduling round finds nothing; *since must start
+ * at zero for each idle stretch. Returns nonzero once the worker has spun
+ * for its whole budget and should park. */
+int INTERNAL qt_idle_due(uint64_t *since);
+/* Sleeps until a task is published on idle's queue (or, for stealing
+ * schedulers, anywhere), unless check says there is work already. */
+void INTERNAL qt_idle_park(qt_idle_t *idle,
+                           uint64_t *since,
+                           qt_idle_check_f check,
+                           void *arg);
+/* qt_idle_due(), then qt_idle_park() if due; returns nonzero if it parked */
+int INTERNAL qt_idle_round(qt_idle_t *idle,
+                           uint64_t *since,
+                           qt_idle_check_f check,
+                           void *arg);
+
+/* after publishing a task on idle's queue that only its own workers run */
+static inline void qt_idle_notify(qt_idle_t *idle) {
+  if (qt_idle_parking) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (unlikely(atomic_load_explicit(&idle->parked, memory_order_relaxed))) {
+      qt_idle_wake(idle);
+    }
+  }
+}
+
+/* after publishing a task on idle's queue that any worker may steal */
+static inline void qt_idle_notify_stealable(qt_idle_t *idle) {
+  if (qt_idle_parking) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (unlikely(
+          atomic_load_explicit(&qt_idle_nparked, memory_order_relaxed))) {
+      qt_idle_wake_thief(idle);
+    }
+  }
+}
+
+/* after publishing n tasks at once that any worker may steal */
+static inline void qt_idle_notify_stealable_many(qt_idle_t *idle, size_t n) {
+  if (n > 1) {
+    if (qt_idle_parking) { qt_idle_wake_all(); }
+  } else if (n == 1) {
+    qt_idle_notify_stealable(idle);
+  }
+}
+
+#endif // ifndef QT_IDLE_H
+/* vim:set expandtab: */
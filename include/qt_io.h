@@ -9,6 +9,7 @@
 
 /* Internal Headers */
 #include "qt_blocking_structs.h"
+#include "qt_macros.h"
 #include "qt_qthread_mgmt.h"
 #include "qt_qthread_struct.h"
 
@@ -21,6 +22,28 @@ void qt_blocking_subsystem_init(void);
 int qt_process_blocking_call(void);
 void qt_blocking_subsystem_enqueue(qt_blocking_queue_node_t *job);
 
+#ifdef QTHREAD_USE_IO_URING
+extern int qt_io_uring_active;
+
+/* Reap io_uring completions for the given shepherd, re-enqueueing the
+ * qthreads they belong to. Returns the number of qthreads woken. Called from
+ * the scheduler loops, so it must be cheap when nothing is outstanding. */
+int qt_blocking_subsystem_poll(qthread_shepherd_t *shep);
+/* Nonzero if the shepherd has io_uring operations in flight; schedulers that
+ * can sleep on a condition variable must keep polling instead. */
+int qt_blocking_subsystem_pending(qthread_shepherd_t *shep);
+#else
+static inline int
+qt_blocking_subsystem_poll(qthread_shepherd_t *Q_UNUSED(shep)) {
+  return 0;
+}
+
+static inline int
+qt_blocking_subsystem_pending(qthread_shepherd_t *Q_UNUSED(shep)) {
+  return 0;
+}
+#endif
+
 static inline int qt_blockable(void) {
   qthread_t *t = qthread_internal_self();
 
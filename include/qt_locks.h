@@ -1,9 +1,14 @@
 #ifndef _QT_LOCKS_H_
 #define _QT_LOCKS_H_
+#include "qt_qthread_t.h" /* for qthread_t */
 #include "qt_visibility.h"
 
 int INTERNAL spinlocks_finalize(void);
 int INTERNAL spinlocks_initialize(void);
 
+/* called by the worker that t, waiting for a qthread_qlock_t, switched out
+ * from: parks t, unless the lock was handed to it in the meantime */
+void INTERNAL qthread_qlock_internal_park(qthread_t *t);
+
 #endif // _QT_LOCKS_H_
 
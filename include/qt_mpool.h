@@ -6,6 +6,7 @@
 typedef struct qt_mpool_s *qt_mpool;
 
 void *qt_mpool_alloc(qt_mpool pool);
+void qt_mpool_alloc_many(qt_mpool pool, void **items, size_t n);
 
 void qt_mpool_free(qt_mpool pool, void *mem);
 
@@ -6,6 +6,7 @@
 
 void INTERNAL qthread_thread_free(qthread_t *t);
 qthread_t INTERNAL *qthread_internal_self(void);
+int INTERNAL qthread_internal_work_wanted(void);
 
 #endif
 /* vim:set expandtab: */
@@ -17,6 +17,8 @@
 #include "qt_shepherd_innards.h"
 #include "qt_teams.h"
 #include "qt_threadstate.h"
+#include "qt_timers.h"
+#include "qt_tls.h"
 
 #define ARGCOPY_DEFAULT 1024
 #define TASKLOCAL_DEFAULT 8
@@ -29,10 +31,8 @@
 #define QTHREAD_RET_IS_VOID_SINC ((1 << 3) | (1 << 2))
 #define QTHREAD_UNSTEALABLE (1 << 4)
 #define QTHREAD_SIMPLE (1 << 5)
-#define QTHREAD_HAS_ARGCOPY (1 << 6)
 #define QTHREAD_TEAM_LEADER (1 << 7)
 #define QTHREAD_TEAM_WATCHER (1 << 8)
-#define QTHREAD_BIG_STRUCT (1 << 9)
 #define QTHREAD_NETWORK (1 << 12)
 #define QTHREAD_RESERVED_FLAG3 (1 << 13)
 #define QTHREAD_RESERVED_FLAG2 (1 << 14)
@@ -52,6 +52,7 @@ struct qthread_runtime_data_s {
     qt_blocking_queue_node_t *io;
     qthread_t *thread;
     qthread_queue_t queue;
+    struct qthread_qlock_waiter_s *qlock;
   } blockedon;
 
   qthread_shepherd_t *shepherd_ptr; /* the shepherd we run on */
@@ -59,6 +60,13 @@ struct qthread_runtime_data_s {
   int criticalsect;      /* critical section depth */
   qt_barrier_t *barrier; /* add to allow barriers to be stacked/nested
                             parallelism - akp 10/16/12 */
+  qt_timer_t timer;      /* for sleeps and timed waits */
+  uintptr_t stack_low;   /* deepest stack address seen (see STACK_PEAK) */
+
+  /* task-specific data (see tls.c): NULL until the task sets a key */
+  qt_tls_slot_t *tls;
+  unsigned tls_size;
+  qt_tls_slot_t tls_inline[QT_TLS_INLINE_SLOTS];
 
 #ifdef QTHREAD_USE_VALGRIND
   unsigned int valgrind_stack_id;
@@ -93,9 +101,10 @@ struct qthread_s {
                              desire for this thread to be somewhere) */
   _Atomic uint16_t flags; /* may not need all bits */
   _Atomic uint8_t thread_state;
+  uint8_t size_class; /* which pool the struct came from (see qthread.c) */
 
-  alignas(
-    8) uint8_t data[]; /* this is where we stick argcopy and tasklocal data */
+  /* this is where we stick tasklocal data, followed by the argcopy */
+  alignas(8) uint8_t data[];
 };
 
 #endif // ifndef QT_QTHREAD_STRUCT_H
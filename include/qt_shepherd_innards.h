@@ -26,12 +26,26 @@ typedef struct qthread_shepherd_s qthread_shepherd_t;
 
 #define STEAL_BUFFER_LENGTH 128
 
+/* Values of shep_dists[] for topology layers that can tell how shepherds share
+ * the machine (by the closest level they share). Layers that cannot tell use
+ * QTHREAD_DIST_UNKNOWN for everything. Stealing schedulers treat every victim
+ * closer than QTHREAD_DIST_REMOTE as local, and try those first. */
+#define QTHREAD_DIST_UNKNOWN 10
+#define QTHREAD_DIST_SIBLING 11 /* same core, or a shared L1/L2 */
+#define QTHREAD_DIST_LLC 12     /* a shared L3 (or L4) */
+#define QTHREAD_DIST_SOCKET 15  /* the same package */
+#define QTHREAD_DIST_REMOTE 20  /* another package */
+
+/* cap on qthread_worker_t.steal_backoff */
+#define QTHREAD_STEAL_MAX_BACKOFF 6
+
 struct qthread_worker_s {
   uintptr_t hazard_ptrs
     [HAZARD_PTRS_PER_SHEP]; /* hazard pointers (see
                                http://portal.acm.org/citation.cfm?id=987524.987595)
                              */
   hazard_freelist_t hazard_free_list;
+  struct qt_epoch_record_s *epoch; /* see qt_epoch.h */
   pthread_t worker;
   qthread_shepherd_t *shepherd;
   struct qthread_s **nostealbuffer;
@@ -40,6 +54,16 @@ struct qthread_worker_s {
   qthread_worker_id_t unique_id;
   qthread_worker_id_t worker_id;
   qthread_worker_id_t packed_worker_id;
+  uint64_t idle_spin; /* ns to spin before parking (see qt_idle.h) */
+  /* tiered stealing: failed rounds over the local victims so far, and how
+   * many times the wait for remote victims has doubled since a remote steal
+   * last succeeded */
+  unsigned int steal_rounds;
+  unsigned int steal_backoff;
+  /* the stack of the last task this worker ran to completion, which the next
+   * new task starts on (see QT_SCRATCH_STACK) */
+  void *scratch_stack;
+  struct qt_timer_wheel_s *timers; /* see qt_timers.h */
   _Atomic alignas(8) uint_fast8_t active;
 };
 typedef struct qthread_worker_s qthread_worker_t;
@@ -58,6 +82,9 @@ struct qthread_shepherd_s {
   unsigned int node; /* whereami */
   unsigned int *shep_dists;
   qthread_shepherd_id_t *sorted_sheplist;
+  /* the first steal_local entries of sorted_sheplist are closer than
+   * QTHREAD_DIST_REMOTE */
+  qthread_shepherd_id_t steal_local;
   _Atomic unsigned int stealing; /* True when a worker is in the steal (attempt)
                                     process OR if stealing disabled*/
 #ifdef QTHREAD_OMP_AFFINITY
@@ -0,0 +1,56 @@
+#ifndef QT_THREADQUEUE_OPS_H
+#define QT_THREADQUEUE_OPS_H
+
+#include "qt_idle.h"
+#include "qt_threadqueue_scheduler.h"
+#include "qt_threadqueues.h"
+
+/* One scheduler's implementation of the qt_threadqueue interface, for
+ * libraries with several schedulers built in (see qt_threadqueues.h). */
+typedef struct qt_threadqueue_ops_s {
+  char const *name;
+
+  void (*subsystem_init)(void);
+  qt_threadqueue_t *(*new)(void);
+  void (*free)(qt_threadqueue_t *q);
+  void (*enqueue)(qt_threadqueue_t *restrict q, qthread_t *restrict t);
+  void (*enqueue_yielded)(qt_threadqueue_t *restrict q, qthread_t *restrict t);
+  void (*enqueue_many)(qt_threadqueue_t *restrict q,
+                       qthread_t *const *restrict t,
+                       size_t n);
+  ssize_t (*advisory_queuelen)(qt_threadqueue_t *q);
+  qthread_t *(*get_thread)(qt_threadqueue_t *q, uint_fast8_t active);
+  qthread_t *(*dequeue_specific)(qt_threadqueue_t *q, void *value);
+  void (*steal_enable)(void);
+  void (*steal_disable)(void);
+  size_t (*policy)(const enum threadqueue_policy policy);
+  qt_idle_t *(*idle)(qt_threadqueue_t *q);
+  qthread_shepherd_id_t (*choose_dest)(qthread_shepherd_t *curr_shep);
+} qt_threadqueue_ops_t;
+
+/* Defines <prefix>_qt_threadqueue_ops; used once, at the end of each
+ * scheduler's source file. */
+#ifdef QT_THREADQUEUE_PREFIX
+#define QT_THREADQUEUE_OPS_DEFINE()                                            \
+  qt_threadqueue_ops_t const QT_TQ_NAME(qt_threadqueue_ops) = {                \
+    .name = QT_TQ_STR(QT_THREADQUEUE_PREFIX),                                  \
+    .subsystem_init = qt_threadqueue_subsystem_init,                           \
+    .new = qt_threadqueue_new,                                                 \
+    .free = qt_threadqueue_free,                                               \
+    .enqueue = qt_threadqueue_enqueue,                                         \
+    .enqueue_yielded = qt_threadqueue_enqueue_yielded,                         \
+    .enqueue_many = qt_threadqueue_enqueue_many,                               \
+    .advisory_queuelen = qt_threadqueue_advisory_queuelen,                     \
+    .get_thread = qt_scheduler_get_thread,                                     \
+    .dequeue_specific = qt_threadqueue_dequeue_specific,                       \
+    .steal_enable = qthread_steal_enable,                                      \
+    .steal_disable = qthread_steal_disable,                                    \
+    .policy = qt_threadqueue_policy,                                           \
+    .idle = qt_threadqueue_idle,                                               \
+    .choose_dest = qt_threadqueue_choose_dest}
+#define QT_TQ_STR2(n) #n
+#define QT_TQ_STR(n) QT_TQ_STR2(n)
+#endif
+
+#endif // ifndef QT_THREADQUEUE_OPS_H
+/* vim:set expandtab: */
@@ -9,6 +9,41 @@
 #include "qt_qthread_t.h" /* for qthread_t */
 #include "qt_visibility.h"
 
+/* When several schedulers are built into the library
+ * (QTHREAD_MULTI_SCHEDULER), each scheduler's source file is compiled with
+ * QT_THREADQUEUE_PREFIX set to its name, which gives its implementation of the
+ * interface below prefixed names (e.g. nemesis_qt_threadqueue_enqueue). It
+ * exports them through a qt_threadqueue_ops_t (see qt_threadqueue_ops.h), and
+ * threadqueues/dispatch.c implements the unprefixed names by calling through
+ * the scheduler picked at initialization. With a single scheduler, nothing is
+ * renamed and every call is direct. */
+#ifdef QT_THREADQUEUE_PREFIX
+#define QT_TQ_PASTE2(a, b) a##_##b
+#define QT_TQ_PASTE(a, b) QT_TQ_PASTE2(a, b)
+#define QT_TQ_NAME(n) QT_TQ_PASTE(QT_THREADQUEUE_PREFIX, n)
+
+#define qt_threadqueue_subsystem_init QT_TQ_NAME(qt_threadqueue_subsystem_init)
+#define qt_threadqueue_new QT_TQ_NAME(qt_threadqueue_new)
+#define qt_threadqueue_free QT_TQ_NAME(qt_threadqueue_free)
+#define qt_threadqueue_filter QT_TQ_NAME(qt_threadqueue_filter)
+#define qt_threadqueue_enqueue QT_TQ_NAME(qt_threadqueue_enqueue)
+#define qt_threadqueue_enqueue_yielded                                         \
+  QT_TQ_NAME(qt_threadqueue_enqueue_yielded)
+#define qt_threadqueue_enqueue_many QT_TQ_NAME(qt_threadqueue_enqueue_many)
+#define qt_threadqueue_advisory_queuelen                                       \
+  QT_TQ_NAME(qt_threadqueue_advisory_queuelen)
+#define qt_scheduler_get_thread QT_TQ_NAME(qt_scheduler_get_thread)
+#define qthread_steal_stat QT_TQ_NAME(qthread_steal_stat)
+#define qthread_steal_enable QT_TQ_NAME(qthread_steal_enable)
+#define qthread_steal_disable QT_TQ_NAME(qthread_steal_disable)
+#define qthread_cas_steal_stat QT_TQ_NAME(qthread_cas_steal_stat)
+#define qt_threadqueue_dequeue_specific                                        \
+  QT_TQ_NAME(qt_threadqueue_dequeue_specific)
+#define qt_threadqueue_policy QT_TQ_NAME(qt_threadqueue_policy)
+#define qt_threadqueue_idle QT_TQ_NAME(qt_threadqueue_idle)
+#define qt_threadqueue_choose_dest QT_TQ_NAME(qt_threadqueue_choose_dest)
+#endif
+
 typedef filter_code (*qt_threadqueue_filter_f)(qthread_t *);
 
 typedef struct _qt_threadqueue qt_threadqueue_t;
@@ -29,6 +64,10 @@ void INTERNAL qt_threadqueue_enqueue(qt_threadqueue_t *restrict q,
                                      qthread_t *restrict t);
 void INTERNAL qt_threadqueue_enqueue_yielded(qt_threadqueue_t *restrict q,
                                              qthread_t *restrict t);
+/* enqueues n new tasks (in order) with a single queue operation */
+void INTERNAL qt_threadqueue_enqueue_many(qt_threadqueue_t *restrict q,
+                                          qthread_t *const *restrict t,
+                                          size_t n);
 
 ssize_t INTERNAL qt_threadqueue_advisory_queuelen(qt_threadqueue_t *q);
 
@@ -52,5 +91,11 @@ enum threadqueue_policy {
 
 size_t qt_threadqueue_policy(const enum threadqueue_policy policy);
 
+#ifdef QTHREAD_MULTI_SCHEDULER
+/* picks the scheduler named by QT_SCHEDULER; called before anything else
+ * touches the scheduler, and returns the name of the one it picked */
+char const INTERNAL *qt_threadqueue_select(void);
+#endif
+
 #endif // ifndef QT_THREADQUEUES_H
 /* vim:set expandtab: */
@@ -18,6 +18,8 @@ typedef enum threadstate {
   QTHREAD_STATE_MIGRATING, /* thread needs to be moved, otherwise ready-to-run
                             */
   QTHREAD_STATE_SYSCALL,   /* thread performing external blocking operation */
+  QTHREAD_STATE_SLEEPING,  /* waiting for its timer (see qt_timers.h) */
+  QTHREAD_STATE_PARKED,    /* waiting for a qthread_qlock_t (locks.c) */
   QTHREAD_STATE_ILLEGAL,   /* illegal state */
   QTHREAD_STATE_TERM_SHEP, /* special flag to terminate the shepherd */
   QTHREAD_STATE_NUM_STATES /* tell performance data how many states there are */
@@ -0,0 +1,112 @@
+#ifndef QT_TIMERS_H
+#define QT_TIMERS_H
+
+/* System Headers */
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h> /* for clock_gettime() */
+
+/* Internal Headers */
+#include "qt_atomics.h"
+#include "qt_branching.h"
+#include "qt_qthread_t.h" /* for qthread_t */
+#include "qt_shepherd_innards.h"
+#include "qt_visibility.h"
+
+/* Timers for qthreads that sleep, or that wait on a FEB or syncvar with a
+ * timeout. Each worker has a hierarchical timing wheel (Varghese and Lauck,
+ * SOSP 1987) of QT_TIMER_LEVELS levels of 64 slots: level l holds timers due
+ * within 64^(l+1) ticks, and they move down a level each time the wheel's
+ * clock reaches their slot, so arming, cancelling and firing a timer are all
+ * O(1). A qthread arms its timer on the worker it runs on just before it
+ * blocks, and is then off every ready queue; that worker fires the timer from
+ * its scheduling loop, and parks for no longer than its next timer is due.
+ *
+ * A timer that fires while its qthread waits on a FEB or syncvar takes the
+ * qthread off that FEB's waiter list with its unlink function, unless
+ * whoever filled or emptied the FEB got there first. Either way, the qthread
+ * disarms the timer once it runs again, which also tells it which one won. */
+
+#define QT_TIMER_NEVER UINT64_MAX
+#define QT_TIMER_LEVELS 6
+#define QT_TIMER_SLOT_BITS 6
+#define QT_TIMER_SLOTS (1 << QT_TIMER_SLOT_BITS)
+#define QT_TIMER_TICK_SHIFT 10 /* a tick is 1024 ns */
+
+/* timer states */
+#define QT_TIMER_IDLE 0
+#define QT_TIMER_ARMED 1  /* in a wheel */
+#define QT_TIMER_FIRING 2 /* taken out of its wheel to be fired */
+#define QT_TIMER_FIRED 3  /* its qthread timed out */
+
+/* Takes t off whatever addr is, if it is still waiting there; returns
+ * nonzero if it was. */
+typedef int (*qt_timer_unlink_f)(void *addr, qthread_t *t);
+
+typedef struct qt_timer_s {
+  struct qt_timer_s *next;
+  struct qt_timer_s *prev;
+  uint64_t deadline; /* ns, on the CLOCK_MONOTONIC clock */
+  struct qt_timer_wheel_s *wheel;
+  qt_timer_unlink_f unlink; /* NULL for a sleep */
+  void *addr;
+  qthread_t *waiter;
+  uint8_t level; /* QT_TIMER_LEVELS for the far list */
+  uint8_t slot;
+  _Atomic uint8_t state;
+} qt_timer_t;
+
+typedef struct qt_timer_wheel_s {
+  QTHREAD_FASTLOCK_TYPE lock;
+  _Atomic size_t armed; /* how many timers are in the wheel */
+  /* only the worker that owns the wheel moves its clock */
+  uint64_t tick;      /* the wheel has been run up to here */
+  uint64_t next_tick; /* when something next needs doing, at the earliest */
+  uint64_t occupied[QT_TIMER_LEVELS]; /* which slots have timers */
+  qt_timer_t *slots[QT_TIMER_LEVELS][QT_TIMER_SLOTS];
+  qt_timer_t *far; /* timers due too late for the top level */
+} qt_timer_wheel_t;
+
+static inline uint64_t qt_timer_now(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+/* the deadline for something that should take ns from now */
+static inline uint64_t qt_timer_deadline(uint64_t ns) {
+  uint64_t const now = qt_timer_now();
+
+  return (ns >= QT_TIMER_NEVER - now) ? QT_TIMER_NEVER - 1 : now + ns;
+}
+
+void INTERNAL qt_timer_subsystem_init(void);
+
+/* Arms the calling qthread's timer on the current worker, for a qthread about
+ * to block; unlink (with addr) takes it off what it blocks on. */
+void INTERNAL qt_timer_arm(qthread_t *me,
+                           uint64_t deadline,
+                           qt_timer_unlink_f unlink,
+                           void *addr);
+/* Called by a qthread that armed its timer once it runs again: returns
+ * nonzero if the timer is what woke it. */
+int INTERNAL qt_timer_disarm(qthread_t *me);
+
+/* Fires w's timers that are due; returns how many qthreads that woke */
+int INTERNAL qt_timer_expire(qthread_worker_t *w);
+/* How long w may park for without missing a timer: 0 if one is due already,
+ * QT_TIMER_NEVER if none are armed. */
+uint64_t INTERNAL qt_timer_park_ns(qthread_worker_t *w);
+
+/* for the scheduling loops; cheap while w has no timers */
+static inline int qt_timer_poll(qthread_worker_t *w) {
+  if (likely(atomic_load_explicit(&w->timers->armed, memory_order_relaxed) ==
+             0)) {
+    return 0;
+  }
+  return qt_timer_expire(w);
+}
+
+#endif // ifndef QT_TIMERS_H
+/* vim:set expandtab: */
@@ -0,0 +1,25 @@
+#ifndef QT_TLS_H
+#define QT_TLS_H
+
+#include <stdint.h>
+
+#include "qt_visibility.h"
+
+/* Tasks keep the values of the first few keys in their runtime data, so that
+ * most of them never allocate a slot array */
+#define QT_TLS_INLINE_SLOTS 4
+
+typedef struct qt_tls_slot_s {
+  uintptr_t seq; /* the key's sequence number when the value was set */
+  void *value;
+} qt_tls_slot_t;
+
+struct qthread_runtime_data_s;
+
+/* runs the destructors of a finished task's values, and frees its slots */
+void INTERNAL qt_tls_destroy(struct qthread_runtime_data_s *rdata);
+/* frees a task's slots without running any destructors */
+void INTERNAL qt_tls_free(struct qthread_runtime_data_s *rdata);
+
+#endif // ifndef QT_TLS_H
+/* vim:set expandtab: */
@@ -0,0 +1,77 @@
+#ifndef QT_TRACE_H
+#define QT_TRACE_H
+
+/* System Headers */
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h> /* for clock_gettime() */
+
+/* Internal Headers */
+#include "qt_branching.h"
+#include "qt_shepherd_innards.h"
+#include "qt_visibility.h"
+
+/* Scheduler events. The RUN event opens a task's run on a worker; the
+ * events up to and including TERMINATE close it, saying why it stopped. */
+typedef enum {
+  QT_TRACE_RUN,          /* arg: task */
+  QT_TRACE_YIELD,        /* arg: task */
+  QT_TRACE_FEB_BLOCK,    /* arg: task */
+  QT_TRACE_QUEUE_BLOCK,  /* arg: task */
+  QT_TRACE_PARENT_BLOCK, /* arg: task, waiting on its team */
+  QT_TRACE_SYSCALL,      /* arg: task, parked on a blocking syscall */
+  QT_TRACE_MIGRATE,      /* arg: task, aux: destination shepherd */
+  QT_TRACE_TERMINATE,    /* arg: task */
+  QT_TRACE_STEAL         /* arg: tasks taken, aux: victim shepherd */
+} qt_trace_event_type_t;
+
+typedef struct {
+  uint64_t ts; /* CLOCK_MONOTONIC, in ns */
+  uintptr_t arg;
+  uint32_t type;
+  uint32_t aux;
+} qt_trace_event_t;
+
+/* One per worker, indexed by packed_worker_id, written only by its worker.
+ * head counts every event ever recorded; old events are overwritten. */
+typedef struct {
+  alignas(CACHELINE_WIDTH) qt_trace_event_t *events;
+  size_t mask;
+  size_t _Atomic head;
+} qt_trace_ring_t;
+
+extern int qt_trace_enabled;
+extern qt_trace_ring_t *qt_trace_rings;
+
+void INTERNAL qt_trace_subsystem_init(void);
+
+static inline void qt_trace_record(qthread_worker_t *w,
+                                   qt_trace_event_type_t type,
+                                   uintptr_t arg,
+                                   uint32_t aux) {
+  qt_trace_ring_t *r = &qt_trace_rings[w->packed_worker_id];
+  size_t const head = atomic_load_explicit(&r->head, memory_order_relaxed);
+  qt_trace_event_t *e = &r->events[head & r->mask];
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  e->ts = (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+  e->arg = arg;
+  e->type = type;
+  e->aux = aux;
+  atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+/* for use where the worker isn't at hand; events from non-workers are
+ * dropped */
+static inline void
+qt_trace(qt_trace_event_type_t type, uintptr_t arg, uint32_t aux) {
+  if (unlikely(qt_trace_enabled)) {
+    qthread_worker_t *w = qthread_internal_getworker();
+    if (w) { qt_trace_record(w, type, arg, aux); }
+  }
+}
+
+#endif // ifndef QT_TRACE_H
+/* vim:set expandtab: */
@@ -35,6 +35,7 @@ typedef struct qarray_s {
     segment_bytes; /* bytes per segment (sometimes > unit_size*segment_size) */
   char *base_ptr;
   distribution_t dist_type;
+  unsigned char hugepages; /* how base_ptr was allocated (internal) */
 
   union {
     qthread_shepherd_id_t dist_shep; /* for ALL_SAME dist type */
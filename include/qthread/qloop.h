@@ -78,6 +78,20 @@ void qt_loopaccum_balance_dc(size_t const start,
                              qt_loopr_f const func,
                              void *restrict argptr,
                              qt_accum_f const acc);
+/* Like qt_loop_balance() and qt_loopaccum_balance(), but the iterations are
+ * split up as the loop runs, wherever there are idle workers to take them
+ * (lazy binary splitting), which suits loops whose iterations vary in cost */
+void qt_loop_adaptive(size_t const start,
+                      size_t const stop,
+                      qt_loop_f const func,
+                      void *argptr);
+void qt_loopaccum_adaptive(size_t const start,
+                           size_t const stop,
+                           size_t const size,
+                           void *restrict out,
+                           qt_loopr_f const func,
+                           void *restrict argptr,
+                           qt_accum_f const acc);
 
 typedef enum { CHUNK, GUIDED, FACTORED, TIMED } qt_loop_queue_type;
 
@@ -1,6 +1,10 @@
 #ifndef QLOOP_HPP
 #define QLOOP_HPP
 
+#include <stddef.h>
+
+#include <type_traits>
+
 #include "qloop.h"
 
 template <typename T>
@@ -37,6 +41,11 @@ void qt_loop_balance_future(size_t start, size_t stop, T const &obj) {
     start, stop, qloop_cpp_wrapper<T>, &(const_cast<T &>(obj)));
 }
 
+template <typename T>
+void qt_loop_adaptive(size_t start, size_t stop, T const &obj) {
+  qt_loop_adaptive(start, stop, qloop_cpp_wrapper<T>, &(const_cast<T &>(obj)));
+}
+
 template <typename T>
 void qloop_accum_cpp_wrapper(size_t startat,
                              size_t stopat,
@@ -61,5 +70,136 @@ qt_loopaccum_balance(size_t start, size_t stop, T const &obj) {
                        (qt_accum_f)(T::accumulate));
   return accumulate;
 }
+
+template <typename T>
+typename T::acctype
+qt_loopaccum_adaptive(size_t start, size_t stop, T const &obj) {
+  typename T::acctype accumulate(T::identity);
+  qt_loopaccum_adaptive(start,
+                        stop,
+                        sizeof(typename T::acctype),
+                        &accumulate,
+                        qloop_accum_cpp_wrapper<T>,
+                        &(const_cast<T &>(obj)),
+                        (qt_accum_f)(T::accumulate));
+  return accumulate;
+}
+/* qthread::parallel_for(first, last, f) calls f(x) for each element x of the
+ * range [first, last) of random-access iterators, or for each index x if
+ * first and last are integers. qthread::parallel_reduce(first, last, init,
+ * reduce, transform) returns init combined with reduce() over transform(x) for
+ * the same x (just x, without transform), in no particular order, so reduce
+ * must be associative and commutative, and T must be trivially copyable. Both
+ * run on qt_loop_adaptive(), without copying f, reduce or transform, and
+ * return when every call has. */
+namespace qthread {
+namespace detail {
+
+template <typename It>
+It loop_element(It first, size_t i, std::true_type) {
+  return first + i;
+}
+
+template <typename It>
+auto loop_element(It first, size_t i, std::false_type) -> decltype(first[i]) {
+  return first[i];
+}
+
+template <typename It, typename F>
+struct for_loop {
+  It first;
+  F *f;
+
+  static void run(size_t startat, size_t stopat, void *arg) {
+    for_loop *const l = static_cast<for_loop *>(arg);
+
+    for (size_t i = startat; i < stopat; ++i) {
+      (*l->f)(loop_element(l->first, i, std::is_integral<It>()));
+    }
+  }
+};
+
+template <typename T, typename R>
+struct reduce_value {
+  T value;
+  R const *reduce;
+
+  static void accumulate(void *a, void const *b) {
+    reduce_value *const x = static_cast<reduce_value *>(a);
+
+    x->value =
+      (*x->reduce)(x->value, static_cast<reduce_value const *>(b)->value);
+  }
+};
+
+template <typename It, typename T, typename R, typename M>
+struct reduce_loop {
+  It first;
+  R const *reduce;
+  M const *transform;
+
+  static void run(size_t startat, size_t stopat, void *arg, void *ret) {
+    reduce_loop *const l = static_cast<reduce_loop *>(arg);
+    reduce_value<T, R> *const out = static_cast<reduce_value<T, R> *>(ret);
+    T value((*l->transform)(
+      loop_element(l->first, startat, std::is_integral<It>())));
+
+    for (size_t i = startat + 1; i < stopat; ++i) {
+      value = (*l->reduce)(
+        value,
+        (*l->transform)(loop_element(l->first, i, std::is_integral<It>())));
+    }
+    out->value = value;
+    out->reduce = l->reduce;
+  }
+};
+
+struct identity {
+  template <typename X>
+  X &&operator()(X &&x) const {
+    return static_cast<X &&>(x);
+  }
+};
+
+} // namespace detail
+
+template <typename It, typename F>
+void parallel_for(It first, It last, F &&f) {
+  typedef typename std::remove_reference<F>::type fn_type;
+  detail::for_loop<It, fn_type> l = {first, &f};
+
+  if (first < last) {
+    qt_loop_adaptive(
+      0, (size_t)(last - first), detail::for_loop<It, fn_type>::run, &l);
+  }
+}
+
+template <typename It, typename T, typename R, typename M>
+T parallel_reduce(
+  It first, It last, T init, R const &reduce, M const &transform) {
+  typedef detail::reduce_value<T, R> value_type;
+  typedef detail::reduce_loop<It, T, R, M> loop_type;
+  loop_type l = {first, &reduce, &transform};
+  value_type out;
+
+  static_assert(std::is_trivially_copyable<T>::value,
+                "partial results are copied bitwise between workers");
+  if (!(first < last)) { return init; }
+  qt_loopaccum_adaptive(0,
+                        (size_t)(last - first),
+                        sizeof(value_type),
+                        &out,
+                        loop_type::run,
+                        &l,
+                        value_type::accumulate);
+  return reduce(init, out.value);
+}
+
+template <typename It, typename T, typename R>
+T parallel_reduce(It first, It last, T init, R const &reduce) {
+  return parallel_reduce(first, last, init, reduce, detail::identity());
+}
+
+} // namespace qthread
 #endif // ifndef QLOOP_HPP
 /* vim:set expandtab: */
@@ -219,6 +219,12 @@ void qthread_enable_worker(qthread_worker_id_t worker);
   do { qthread_yield_(1); } while (0)
 void qthread_yield_(int);
 
+/* this function blocks the calling qthread for at least ns nanoseconds,
+ * without keeping it in any ready queue in the meantime, so that the worker
+ * it ran on is free to run other qthreads (or to go idle). When not called
+ * from a qthread, it just sleeps. */
+int qthread_sleep_ns(uint64_t ns);
+
 /* this function flushes the spawncache */
 void qthread_flushsc(void);
 
@@ -279,6 +285,21 @@ int qthread_fork_copyargs_precond(qthread_f f,
 int qthread_fork_precond_simple(
   qthread_f f, void const *arg, aligned_t *ret, int npreconds, ...);
 
+/* Continuations: f(arg) is spawned, returning into result (which may be
+ * NULL), once ret (or every one of the n locations in rets) is full, as with
+ * qthread_fork_precond(). Until then it is only queued on those FEBs, without
+ * a stack, so chains and graphs of tasks linked this way do not leave tasks
+ * blocked in qthread_readFF(). */
+int qthread_then(aligned_t *ret,
+                 qthread_f f,
+                 void const *arg,
+                 aligned_t *result);
+int qthread_when_all(aligned_t *const *rets,
+                     size_t n,
+                     qthread_f f,
+                     void const *arg,
+                     aligned_t *result);
+
 enum _qthread_features {
   SPAWN_PARENT,
   SPAWN_SIMPLE,
@@ -290,7 +311,8 @@ enum _qthread_features {
   SPAWN_PC_SYNCVAR_T,
   SPAWN_COUNT,
   SPAWN_LOCAL_PRIORITY,
-  SPAWN_NETWORK
+  SPAWN_NETWORK,
+  SPAWN_SPREAD
 };
 
 #define QTHREAD_SPAWN_PARENT (1 << SPAWN_PARENT)
@@ -303,6 +325,7 @@ enum _qthread_features {
 #define QTHREAD_SPAWN_PC_SYNCVAR_T (1 << SPAWN_PC_SYNCVAR_T)
 #define QTHREAD_SPAWN_LOCAL_PRIORITY (1 << SPAWN_LOCAL_PRIORITY)
 #define QTHREAD_SPAWN_NETWORK (1 << SPAWN_NETWORK)
+#define QTHREAD_SPAWN_SPREAD (1 << SPAWN_SPREAD)
 
 int qthread_spawn(qthread_f f,
                   void const *arg,
@@ -312,6 +335,29 @@ int qthread_spawn(qthread_f f,
                   void *preconds,
                   qthread_shepherd_id_t target_shep,
                   unsigned int feature_flag);
+/* Spawns count tasks running f with one queue operation per destination
+ * shepherd; task i gets the i-th arg_size-byte element of args (or args
+ * itself, if arg_size is 0) and returns into the i-th element of rets. */
+int qthread_spawn_many(qthread_f f,
+                       void const *args,
+                       size_t arg_size,
+                       void *rets,
+                       size_t count,
+                       qthread_shepherd_id_t target_shep,
+                       unsigned int feature_flag);
+
+/* Like qthread_spawn() with an arg_size-byte argument copy, except that the
+ * copy is built in place by init(copy, arg) rather than copied from arg; this
+ * is how C++ objects are moved into a task (see qthread.hpp). init is only
+ * called once nothing else can make the spawn fail. */
+typedef void (*qthread_arg_init_f)(void *copy, void *arg);
+int qthread_spawn_init(qthread_f f,
+                       qthread_arg_init_f init,
+                       void *arg,
+                       size_t arg_size,
+                       void *ret,
+                       qthread_shepherd_id_t target_shep,
+                       unsigned int feature_flag);
 
 /* This is a function to move a thread from one shepherd to another. */
 int qthread_migrate_to(qthread_shepherd_id_t const shepherd);
@@ -376,11 +422,16 @@ enum introspective_state {
   CURRENT_WORKER,
   CURRENT_UNIQUE_WORKER,
   CURRENT_TEAM,
-  PARENT_TEAM
+  PARENT_TEAM,
+  STACK_PEAK
 };
 
 size_t qthread_readstate(const enum introspective_state type);
 
+/* Writes the scheduler trace recorded so far as Chrome trace JSON; a NULL
+ * filename means the file named by QT_TRACE. */
+int qthread_trace_dump(char const *filename);
+
 /* Task team interface. */
 typedef enum qt_team_critical_section_e {
   BEGIN,
@@ -477,6 +528,18 @@ typedef struct {
   qthread_spinlock_state_t state;
 } qthread_spinlock_t;
 
+/* A queue lock (Mellor-Crummey and Scott, TOCS 1991) kept wherever the caller
+ * puts it, so unlike with qthread_lock() nothing is looked up in a hash table.
+ * Waiters line up in FIFO order, each spinning briefly on a flag of its own
+ * before it parks, and unlocking hands the lock straight to the next in line,
+ * making it runnable if it had parked. It is not recursive. */
+struct qthread_qlock_waiter_s;
+
+typedef struct {
+  QT_Atomic(struct qthread_qlock_waiter_s *) tail;
+  QT_Atomic(struct qthread_qlock_waiter_s *) next; /* after the holder */
+} qthread_qlock_t;
+
 /* This function is just to assist with debugging; it returns 1 if the address
  * is full, and 0 if the address is empty */
 int qthread_feb_status(aligned_t const *addr);
@@ -573,6 +636,29 @@ int qthread_syncvar_readFF(uint64_t *restrict dest, syncvar_t *restrict src);
 int qthread_readFE(aligned_t *dest, aligned_t const *src);
 int qthread_syncvar_readFE(uint64_t *restrict dest, syncvar_t *restrict src);
 
+/* These functions are readFF(), readFE() and writeEF() with a timeout: if
+ * the memory is not in the state they wait for within timeout_ns nanoseconds,
+ * they give up and return QTHREAD_TIMEOUT, having changed neither the memory,
+ * its FEB state, nor dest. */
+int qthread_readFF_timed(aligned_t *dest,
+                         aligned_t const *src,
+                         uint64_t timeout_ns);
+int qthread_readFE_timed(aligned_t *dest,
+                         aligned_t const *src,
+                         uint64_t timeout_ns);
+int qthread_writeEF_timed(aligned_t *restrict dest,
+                          aligned_t const *restrict src,
+                          uint64_t timeout_ns);
+int qthread_syncvar_readFF_timed(uint64_t *restrict dest,
+                                 syncvar_t *restrict src,
+                                 uint64_t timeout_ns);
+int qthread_syncvar_readFE_timed(uint64_t *restrict dest,
+                                 syncvar_t *restrict src,
+                                 uint64_t timeout_ns);
+int qthread_syncvar_writeEF_timed(syncvar_t *restrict dest,
+                                  uint64_t const *restrict src,
+                                  uint64_t timeout_ns);
+
 /* This function ignores the FEB state. Data is read from src and written to
  * dest.
  *
@@ -581,7 +667,12 @@ int qthread_syncvar_readFE(uint64_t *restrict dest, syncvar_t *restrict src);
  * 2 - data is copied from src to destination
  */
 int qthread_readXX(aligned_t *dest, aligned_t const *src);
-// NOTE: There is no syncvar version of readXX
+int qthread_syncvar_readXX(uint64_t *restrict dest, syncvar_t *restrict src);
+
+/* This function ignores the FEB state, and does not change it or wake anyone
+ * waiting on it. Data is read from src and written to dest. */
+int qthread_syncvar_writeXX(syncvar_t *restrict dest,
+                            uint64_t const *restrict src);
 
 /* functions to implement FEB-ish locking/unlocking
  *
@@ -602,6 +693,12 @@ int qthread_spinlock_trylock(qthread_spinlock_t *a);
 int qthread_spinlocks_init(qthread_spinlock_t *a, bool const is_recursive);
 int qthread_spinlocks_destroy(qthread_spinlock_t *a);
 
+int qthread_qlock_init(qthread_qlock_t *l);
+int qthread_qlock_destroy(qthread_qlock_t *l);
+int qthread_qlock_lock(qthread_qlock_t *l);
+int qthread_qlock_unlock(qthread_qlock_t *l);
+int qthread_qlock_trylock(qthread_qlock_t *l);
+
 #define QTHREAD_SPINLOCK_IS_RECURSIVE (-1)
 #define QTHREAD_SPINLOCK_IS_NOT_RECURSIVE (-2)
 
@@ -609,6 +706,7 @@ int qthread_spinlocks_destroy(qthread_spinlock_t *a);
   {{.s = {0, 0}}, {QTHREAD_SPINLOCK_IS_NOT_RECURSIVE, 0}}
 #define QTHREAD_RECURSIVE_MUTEX_INITIALIZER                                    \
   {{.s = {0, 0}}, {QTHREAD_SPINLOCK_IS_RECURSIVE, 0}}
+#define QTHREAD_QLOCK_INITIALIZER {NULL, NULL}
 
 /* functions to implement spinlock-based locking/unlocking
  * if qthread_lock_init(adr) is called, subsequent locking over adr
@@ -1,8 +1,290 @@
 #ifndef _QTHREAD_HPP_
 #define _QTHREAD_HPP_
 
+#include <assert.h>
+#include <string.h>
+
+#include <new>
+#include <type_traits>
+#include <utility>
+
 #include "qthread.h"
 #include "syncvar.hpp"
 
+/* qthread::spawn(f) runs f(), for any callable f (such as a lambda), in a new
+ * task, and returns a qthread::future for what it returns. f is moved (or,
+ * if it is an lvalue, copied) straight into the argument copy inside the
+ * task's qthread struct, so a spawn allocates nothing but the qthread itself;
+ * callables too big for the largest argument copy (QT_ARGCOPY_SIZE) just get
+ * a bigger qthread struct from the heap. A result that fits in an aligned_t
+ * and can be copied bitwise is returned in the task's return word; any other
+ * result is constructed in the future itself, and the return word only says
+ * when that is done. f must not throw. */
+namespace qthread {
+
+template <typename T>
+class future;
+
+namespace detail {
+
+enum { VOID_RESULT, WORD_RESULT, STORED_RESULT };
+
+template <typename T>
+struct word_or_stored
+  : std::integral_constant<int,
+                           (std::is_trivially_copyable<T>::value &&
+                            sizeof(T) <= sizeof(aligned_t) &&
+                            alignof(T) <= alignof(aligned_t))
+                             ? WORD_RESULT
+                             : STORED_RESULT> {};
+
+template <typename T>
+struct result_kind
+  : std::conditional<std::is_void<T>::value,
+                     std::integral_constant<int, VOID_RESULT>,
+                     word_or_stored<T>>::type {};
+
+/* what lives in the task's argument copy; it destroys itself once the
+ * callable has returned, since nothing else will */
+template <typename F, typename R, int K = result_kind<R>::value>
+struct closure;
+
+template <typename F, typename R>
+struct closure<F, R, VOID_RESULT> {
+  F f;
+
+  template <typename G>
+  closure(G &&g, void *): f(std::forward<G>(g)) {}
+
+  static aligned_t run(void *arg) {
+    closure *const c = static_cast<closure *>(arg);
+
+    c->f();
+    c->~closure();
+    return 0;
+  }
+};
+
+template <typename F, typename R>
+struct closure<F, R, WORD_RESULT> {
+  F f;
+
+  template <typename G>
+  closure(G &&g, R *): f(std::forward<G>(g)) {}
+
+  static aligned_t run(void *arg) {
+    closure *const c = static_cast<closure *>(arg);
+    R const r(c->f());
+    aligned_t word = 0;
+
+    c->~closure();
+    memcpy(&word, &r, sizeof(R));
+    return word;
+  }
+};
+
+template <typename F, typename R>
+struct closure<F, R, STORED_RESULT> {
+  F f;
+  R *dest;
+
+  template <typename G>
+  closure(G &&g, R *d): f(std::forward<G>(g)), dest(d) {}
+
+  static aligned_t run(void *arg) {
+    closure *const c = static_cast<closure *>(arg);
+
+    new (c->dest) R(c->f());
+    c->~closure();
+    return 0;
+  }
+};
+
+template <typename G, typename R>
+struct closure_source {
+  typename std::remove_reference<G>::type *g;
+  R *dest;
+};
+
+/* the qthread_arg_init_f that builds a closure in the argument copy */
+template <typename C, typename G, typename R>
+void build_closure(void *copy, void *arg) {
+  closure_source<G, R> *const src = static_cast<closure_source<G, R> *>(arg);
+
+  new (copy) C(std::forward<G>(*src->g), src->dest);
+}
+
+/* what every future has: the task's return word, which is empty until the
+ * task is done, and whether there is a task (or a result) at all */
+class future_base {
+public:
+  bool valid() const noexcept { return valid_; }
+
+  bool ready() const noexcept {
+    return !valid_ || qthread_feb_status(&ret_);
+  }
+
+  void wait() noexcept {
+    if (valid_) { qthread_readFF(NULL, &ret_); }
+  }
+
+protected:
+  future_base() noexcept: valid_(false) {}
+
+  future_base(future_base const &) = delete;
+  future_base &operator=(future_base const &) = delete;
+
+  /* spawns the task, with R *dest as the place for a stored result */
+  template <typename F, typename R, typename G>
+  void start(G &&g, R *dest) {
+    typedef closure<F, R> closure_type;
+    closure_source<G, R> src = {&g, dest};
+
+    static_assert(alignof(closure_type) <= 16,
+                  "argument copies are only as aligned as malloc() makes them");
+    assert(!valid_);
+    if (qthread_spawn_init(closure_type::run,
+                           build_closure<closure_type, G, R>,
+                           &src,
+                           sizeof(closure_type),
+                           &ret_,
+                           NO_SHEPHERD,
+                           0) == QTHREAD_SUCCESS) {
+      valid_ = true;
+    }
+  }
+
+  aligned_t ret_;
+  bool valid_;
+};
+
+} // namespace detail
+
+/* A future is what spawn() returns; get() waits for the task and hands over
+ * its result, after which the future is no longer valid(). A future that
+ * still has a task waits for it when destroyed, and waits for it before it is
+ * moved, since the task may be writing to it. */
+template <typename T>
+class future : public detail::future_base {
+  static int const kind = detail::result_kind<T>::value;
+
+public:
+  future() noexcept {}
+
+  future(future &&other) noexcept { take(other); }
+
+  future &operator=(future &&other) noexcept {
+    if (this != &other) {
+      reset();
+      take(other);
+    }
+    return *this;
+  }
+
+  ~future() { reset(); }
+
+  T get() {
+    assert(valid_);
+    wait();
+    valid_ = false;
+    return fetch(std::integral_constant<int, kind>());
+  }
+
+private:
+  template <typename G>
+  friend future<typename std::decay<decltype(std::declval<G &>()())>::type>
+  spawn(G &&g);
+
+  T *stored() noexcept { return reinterpret_cast<T *>(storage_); }
+
+  T *dest() noexcept {
+    return (kind == detail::STORED_RESULT) ? stored() : nullptr;
+  }
+
+  T fetch(std::integral_constant<int, detail::WORD_RESULT>) {
+    memcpy(&storage_, &ret_, sizeof(T));
+    return *stored();
+  }
+
+  T fetch(std::integral_constant<int, detail::STORED_RESULT>) {
+    T value(std::move(*stored()));
+
+    stored()->~T();
+    return value;
+  }
+
+  void reset() noexcept {
+    if (valid_) {
+      wait();
+      valid_ = false;
+      if (kind == detail::STORED_RESULT) { stored()->~T(); }
+    }
+  }
+
+  void take(future &other) noexcept {
+    if (!other.valid_) { return; }
+    other.wait();
+    other.valid_ = false;
+    ret_ = other.ret_;
+    if (kind == detail::STORED_RESULT) {
+      new (stored()) T(std::move(*other.stored()));
+      other.stored()->~T();
+    }
+    valid_ = true;
+  }
+
+  alignas(T) unsigned char storage_[sizeof(T)];
+};
+
+template <>
+class future<void> : public detail::future_base {
+public:
+  future() noexcept {}
+
+  future(future &&other) noexcept { take(other); }
+
+  future &operator=(future &&other) noexcept {
+    if (this != &other) {
+      wait();
+      take(other);
+    }
+    return *this;
+  }
+
+  ~future() { wait(); }
+
+  void get() {
+    assert(valid_);
+    wait();
+    valid_ = false;
+  }
+
+private:
+  template <typename G>
+  friend future<typename std::decay<decltype(std::declval<G &>()())>::type>
+  spawn(G &&g);
+
+  void *dest() noexcept { return nullptr; }
+
+  void take(future &other) noexcept {
+    other.wait();
+    valid_ = other.valid_;
+    other.valid_ = false;
+  }
+};
+
+template <typename G>
+future<typename std::decay<decltype(std::declval<G &>()())>::type>
+spawn(G &&g) {
+  typedef typename std::decay<G>::type F;
+  typedef typename std::decay<decltype(std::declval<G &>()())>::type R;
+  future<R> fut;
+
+  fut.template start<F>(std::forward<G>(g), fut.dest());
+  return fut;
+}
+
+} // namespace qthread
+
 #endif // QTHREAD_HPP_
 /* vim:set expandtab: */
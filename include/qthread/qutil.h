@@ -28,6 +28,18 @@ void qutil_mergesort(double *array, size_t length);
 void qutil_qsort(double *array, size_t length);
 void qutil_aligned_qsort(aligned_t *array, size_t length);
 
+/* Parallel LSD radix sorts and sample sorts; unlike the sorts above, these
+ * are stable, and need scratch space as big as the array. The _kv versions
+ * move values[i] wherever they move keys[i]. */
+void qutil_aligned_radixsort(aligned_t *array, size_t length);
+void qutil_radixsort(double *array, size_t length);
+void qutil_aligned_radixsort_kv(aligned_t *keys,
+                                aligned_t *values,
+                                size_t length);
+void qutil_radixsort_kv(double *keys, aligned_t *values, size_t length);
+void qutil_aligned_samplesort(aligned_t *array, size_t length);
+void qutil_samplesort(double *array, size_t length);
+
 Q_ENDCXX /* */
 #endif   // ifndef QTHREAD_QUTIL_H
   /* vim:set expandtab: */
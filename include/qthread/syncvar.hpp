@@ -77,11 +77,17 @@ public:
 
   int status() { return qthread_syncvar_status(&the_syncvar_t); }
 
-  uint64_t read() const { return the_syncvar_t.u.s.data; }
+  // read() and write() ignore the FEB state. They still take the syncvar's
+  // lock, because while tasks wait on it, its data bits are not the value.
+  uint64_t read() const {
+    uint64_t ret = 0;
+    qthread_syncvar_readXX(&ret, const_cast<syncvar_t *>(&the_syncvar_t));
+    return ret;
+  }
 
   void write(uint64_t const src) {
     assert(!(src & 0xf000000000000000ull));
-    the_syncvar_t.u.s.data = src;
+    qthread_syncvar_writeXX(&the_syncvar_t, &src);
   }
 protected:
   syncvar_t the_syncvar_t;
@@ -1,12 +1,22 @@
 #ifndef TLS_H
 #define TLS_H
 
-typedef void **qthread_key_t;
+#include "macros.h"
+
+Q_STARTCXX
+
+/* Task-specific data, in the manner of pthread_key_create(). Keys are global;
+ * every task has its own value for each key, initially NULL. */
+typedef unsigned int qthread_key_t;
+
+#define QTHREAD_KEYS_MAX 1024
 
 int qthread_key_create(qthread_key_t *key, void (*destructor)(void *));
 int qthread_key_delete(qthread_key_t key);
 void *qthread_getspecific(qthread_key_t key);
 int qthread_setspecific(qthread_key_t key, void const *value);
 
-#endif
+Q_ENDCXX
 
+#endif
+/* vim:set expandtab: */
@@ -218,7 +218,7 @@ int INTERNAL qt_affinity_gendists(qthread_shepherd_t *sheps,
   for (size_t i = 0; i < nshepherds; ++i) {
     for (size_t j = 0, k = 0; j < nshepherds; ++j) {
       if (j != i) {
-        sheps[i].shep_dists[j] = 10;
+        sheps[i].shep_dists[j] = QTHREAD_DIST_UNKNOWN;
         sheps[i].sorted_sheplist[k++] = j;
       }
     }
@@ -301,6 +301,60 @@ void INTERNAL qt_affinity_free(void *ptr, size_t bytes) {
   hwloc_free(topology, ptr, bytes);
 }
 
+unsigned int INTERNAL qt_affinity_mem_nodes(void) {
+  int n;
+
+  if (topology == NULL) { return 1; }
+  n = hwloc_get_nbobjs_by_type(topology, HWLOC_OBJ_NUMANODE);
+  return (n > 1) ? (unsigned int)n : 1;
+}
+
+unsigned int INTERNAL qt_affinity_mem_node_here(void) {
+  qthread_worker_t *me = qthread_internal_getworker();
+  hwloc_obj_t obj = NULL;
+  hwloc_obj_t numa;
+
+  if (topology == NULL) { return 0; }
+  if (me && me->shepherd && (me->shepherd->node != UINT32_MAX)) {
+    obj = hwloc_get_obj_inside_cpuset_by_depth(
+      topology,
+      hwloc_topology_get_allowed_cpuset(topology),
+      shep_depth,
+      me->shepherd->node);
+  } else {
+    /* not a worker (yet); go by wherever this thread is running now */
+    hwloc_cpuset_t where = hwloc_bitmap_alloc();
+
+    if (hwloc_get_last_cpu_location(topology, where, HWLOC_CPUBIND_THREAD) ==
+        0) {
+      obj = hwloc_get_pu_obj_by_os_index(topology, hwloc_bitmap_first(where));
+    }
+    hwloc_bitmap_free(where);
+  }
+  if ((obj == NULL) || (obj->nodeset == NULL)) { return 0; }
+  /* a shepherd spanning several NUMA nodes counts as its first one */
+  numa = hwloc_get_numanode_obj_by_os_index(topology,
+                                            hwloc_bitmap_first(obj->nodeset));
+  return numa ? numa->logical_index : 0;
+}
+
+void INTERNAL qt_affinity_mem_bind(void *addr,
+                                   size_t bytes,
+                                   unsigned int mem_node) {
+  hwloc_obj_t numa =
+    hwloc_get_obj_by_type(topology, HWLOC_OBJ_NUMANODE, mem_node);
+
+  /* placement is only a hint; failing to bind is not an error */
+  if (numa) {
+    hwloc_set_area_membind(topology,
+                           addr,
+                           bytes,
+                           numa->nodeset,
+                           HWLOC_MEMBIND_BIND,
+                           HWLOC_MEMBIND_BYNODESET);
+  }
+}
+
 #endif /* ifdef USE_HWLOC_MEM_AFFINITY */
 
 qthread_shepherd_id_t INTERNAL guess_num_shepherds(void) {
@@ -467,6 +521,26 @@ void INTERNAL qt_affinity_set(qthread_worker_t *me,
   }
 }
 
+/* how far apart two shepherd objects are, by the closest level they share */
+static unsigned int shep_distance(hwloc_obj_t a, hwloc_obj_t b) {
+  hwloc_obj_t common;
+
+  if (a == b) { return QTHREAD_DIST_SIBLING; }
+  common = hwloc_get_common_ancestor_obj(topology, a, b);
+  if ((common->type == HWLOC_OBJ_CORE) || (common->type == HWLOC_OBJ_PU)) {
+    return QTHREAD_DIST_SIBLING;
+  }
+  if (hwloc_obj_type_is_cache(common->type)) {
+    return (common->attr->cache.depth < 3) ? QTHREAD_DIST_SIBLING
+                                           : QTHREAD_DIST_LLC;
+  }
+  if ((common->type == HWLOC_OBJ_PACKAGE) ||
+      hwloc_get_ancestor_obj_by_type(topology, HWLOC_OBJ_PACKAGE, common)) {
+    return QTHREAD_DIST_SOCKET;
+  }
+  return QTHREAD_DIST_REMOTE;
+}
+
 int INTERNAL qt_affinity_gendists(qthread_shepherd_t *sheps,
                                   qthread_shepherd_id_t nshepherds) {
   hwloc_const_cpuset_t allowed_cpuset =
@@ -484,9 +558,16 @@ int INTERNAL qt_affinity_gendists(qthread_shepherd_t *sheps,
     sheps[i].shep_dists = qt_calloc(nshepherds, sizeof(unsigned int));
   }
   for (size_t i = 0; i < nshepherds; ++i) {
+    hwloc_obj_t me = hwloc_get_obj_inside_cpuset_by_depth(
+      topology, allowed_cpuset, shep_depth, sheps[i].node);
+
     for (size_t j = 0, k = 0; j < nshepherds; ++j) {
       if (j != i) {
-        sheps[i].shep_dists[j] = 10;
+        hwloc_obj_t them = hwloc_get_obj_inside_cpuset_by_depth(
+          topology, allowed_cpuset, shep_depth, sheps[j].node);
+
+        sheps[i].shep_dists[j] = (me && them) ? shep_distance(me, them)
+                                              : QTHREAD_DIST_UNKNOWN;
         sheps[i].sorted_sheplist[k++] = j;
       }
     }
@@ -494,7 +575,6 @@ int INTERNAL qt_affinity_gendists(qthread_shepherd_t *sheps,
       sort_sheps(sheps[i].shep_dists, sheps[i].sorted_sheplist, nshepherds);
     }
   }
-  /* there does not seem to be a way to extract distances... <sigh> */
   return QTHREAD_SUCCESS;
 }
 
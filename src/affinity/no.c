@@ -25,7 +25,7 @@ int INTERNAL qt_affinity_gendists(qthread_shepherd_t *sheps,
     for (size_t j = 0, k = 0; j < nshepherds; ++j) {
       if (j != i) {
         assert(k < (nshepherds - 1));
-        sheps[i].shep_dists[j] = 10;
+        sheps[i].shep_dists[j] = QTHREAD_DIST_UNKNOWN;
         sheps[i].sorted_sheplist[k++] = j;
       }
     }
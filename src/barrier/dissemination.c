@@ -0,0 +1,245 @@
+/* System Headers */
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Installed Headers */
+#include "qthread/barrier.h"
+#include "qthread/cacheline.h"
+#include "qthread/qthread.h"
+
+/* Internal Headers */
+#include "qt_alloc.h"
+#include "qt_asserts.h"
+#include "qt_atomics.h"
+#include "qt_barrier.h"
+#include "qt_macros.h"
+#include "qt_visibility.h"
+
+/* A dissemination barrier (Hensgen, Finkel and Manber; in the form of
+ * Mellor-Crummey and Scott, TOCS 1991): in round r of an episode, participant
+ * i sets a flag of participant (i + 2^r) mod n and waits for its own flag of
+ * that round, so that after ceil(log2(n)) rounds everyone has heard, directly
+ * or not, from everyone else. Each participant's flags are on cache lines of
+ * their own, and it only ever waits on those. There are two sets of flags, used
+ * in alternate episodes, and what a flag is set to flips every other episode,
+ * so no flag needs to be reset between episodes.
+ *
+ * A participant waiting for a flag spins for a while, and then parks (as a
+ * qthread, on a FEB) until the flag is set: participants are tasks, not
+ * workers, and there may be many more of them than there are workers. When
+ * there are, the one that would set the flag is likely waiting for a worker,
+ * so instead of spinning, the waiter yields to it a few times before parking:
+ * waking a parked qthread costs far more than a yield. */
+
+#define BARRIER_SPINS 1024
+#define BARRIER_YIELDS 64
+#define PARKED 2 /* or'd into a flag by a participant that has parked */
+
+typedef struct qt_barrier_flag_s {
+  aligned_t _Atomic flag;
+  aligned_t park; /* empty while its participant is parked on it */
+} qt_barrier_flag_t;
+
+typedef struct qt_barrier_slot_s {
+  size_t episode; /* how many episodes this participant has entered */
+  qt_barrier_flag_t flags[]; /* [parity * max_rounds + round] */
+} qt_barrier_slot_t;
+
+/* The Datatype */
+struct qt_barrier_s {
+  size_t participants; /* in each episode */
+  size_t rounds;       /* ceil(log2(participants)) */
+  size_t capacity;     /* how many participants there are slots for */
+  size_t max_rounds;   /* ceil(log2(capacity)) */
+  size_t stride;       /* bytes from one slot to the next */
+  size_t spins;        /* before parking */
+  int yield;           /* rather than spin, when there are too many */
+  uint8_t *slots;
+  aligned_t next_id; /* for qt_barrier_enter() */
+};
+
+static qt_barrier_t *global_barrier = NULL;
+
+#define SLOT(b, i) ((qt_barrier_slot_t *)((b)->slots + (i) * (b)->stride))
+
+/* what an episode sets its flags to */
+static inline aligned_t qtb_sense(size_t episode) {
+  return ((episode >> 1) & 1) ^ 1;
+}
+
+static inline size_t qtb_log2_ceil(size_t n) {
+  size_t rounds = 0;
+
+  while (((size_t)1 << rounds) < n) { rounds++; }
+  return rounds;
+}
+
+static void qtb_internal_spins(qt_barrier_t *b) {
+  b->yield = (b->participants > qthread_num_workers());
+  b->spins = b->yield ? BARRIER_YIELDS : BARRIER_SPINS;
+}
+
+static void qtb_internal_alloc(qt_barrier_t *b, size_t capacity) {
+  size_t const cacheline = qthread_cacheline();
+
+  b->capacity = capacity;
+  b->max_rounds = qtb_log2_ceil(capacity);
+  b->stride = sizeof(qt_barrier_slot_t) +
+              2 * b->max_rounds * sizeof(qt_barrier_flag_t);
+  b->stride = (b->stride + cacheline - 1) / cacheline * cacheline;
+  b->slots = qt_internal_aligned_alloc(capacity * b->stride, cacheline);
+  assert(b->slots);
+}
+
+/* Sets every slot up so that the next episode is the given one. */
+static void qtb_internal_reset(qt_barrier_t *b, size_t episode) {
+  aligned_t const next[2] = {qtb_sense(episode) ^ 1,
+                             qtb_sense(episode + 1) ^ 1};
+
+  for (size_t i = 0; i < b->capacity; i++) {
+    qt_barrier_slot_t *const slot = SLOT(b, i);
+
+    slot->episode = episode;
+    for (size_t parity = 0; parity < 2; parity++) {
+      for (size_t r = 0; r < b->max_rounds; r++) {
+        qt_barrier_flag_t *const f = &slot->flags[parity * b->max_rounds + r];
+
+        atomic_store_explicit(&f->flag,
+                              next[(episode + parity) & 1],
+                              memory_order_relaxed);
+        f->park = 0;
+      }
+    }
+  }
+  atomic_thread_fence(memory_order_release);
+  b->next_id = 0;
+}
+
+qt_barrier_t API_FUNC *qt_barrier_create(size_t size,
+                                         qt_barrier_btype Q_UNUSED(type)) {
+  qt_barrier_t *b = MALLOC(sizeof(qt_barrier_t));
+
+  assert(b);
+  assert(size > 0);
+  b->participants = size;
+  b->rounds = qtb_log2_ceil(size);
+  qtb_internal_spins(b);
+  qtb_internal_alloc(b, size);
+  qtb_internal_reset(b, 0);
+  return b;
+}
+
+void API_FUNC qt_barrier_destroy(qt_barrier_t *b) {
+  assert(b);
+  qt_internal_aligned_free(b->slots, qthread_cacheline());
+  FREE(b, sizeof(qt_barrier_t));
+}
+
+/* Only while nobody is in the barrier. */
+void API_FUNC qt_barrier_resize(qt_barrier_t *b, size_t size) {
+  assert(b);
+  assert(size > 0);
+
+  size_t const episode = SLOT(b, 0)->episode;
+
+  if (size > b->capacity) {
+    qt_internal_aligned_free(b->slots, qthread_cacheline());
+    qtb_internal_alloc(b, size);
+  }
+  b->participants = size;
+  b->rounds = qtb_log2_ceil(size);
+  qtb_internal_spins(b);
+  qtb_internal_reset(b, episode);
+}
+
+static inline void qtb_internal_signal(qt_barrier_flag_t *f, aligned_t sense) {
+  if (atomic_exchange_explicit(&f->flag, sense, memory_order_acq_rel) &
+      PARKED) {
+    qthread_fill(&f->park);
+  }
+}
+
+static inline void
+qtb_internal_wait(qt_barrier_t *b, qt_barrier_flag_t *f, aligned_t sense) {
+  aligned_t unset = sense ^ 1;
+
+  for (size_t i = 0; i < b->spins; i++) {
+    if (atomic_load_explicit(&f->flag, memory_order_acquire) == sense) {
+      return;
+    }
+    if (b->yield) {
+      qthread_yield();
+    } else {
+      SPINLOCK_BODY();
+    }
+  }
+  /* The FEB is emptied before the flag says so, so a signal that sees the
+   * flag parked cannot fill it before it is emptied. */
+  qthread_empty(&f->park);
+  if (atomic_compare_exchange_strong_explicit(&f->flag,
+                                              &unset,
+                                              unset | PARKED,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+    qthread_readFF(NULL, &f->park);
+  } else {
+    qthread_fill(&f->park);
+  }
+  assert(atomic_load_explicit(&f->flag, memory_order_acquire) == sense);
+}
+
+void API_FUNC qt_barrier_enter_id(qt_barrier_t *b, size_t id) {
+  assert(b);
+  assert(id < b->participants);
+
+  qt_barrier_slot_t *const me = SLOT(b, id);
+  size_t const episode = me->episode++;
+  size_t const base = (episode & 1) * b->max_rounds;
+  aligned_t const sense = qtb_sense(episode);
+
+  for (size_t r = 0; r < b->rounds; r++) {
+    size_t const partner = (id + ((size_t)1 << r)) % b->participants;
+
+    qtb_internal_signal(&SLOT(b, partner)->flags[base + r], sense);
+    qtb_internal_wait(b, &me->flags[base + r], sense);
+  }
+}
+
+/* Participants are numbered in the order they arrive, which cannot be mixed
+ * with qt_barrier_enter_id(). */
+void API_FUNC qt_barrier_enter(qt_barrier_t *b) {
+  qt_barrier_enter_id(b, qthread_incr(&b->next_id, 1) % b->participants);
+}
+
+/* debugging... */
+void API_FUNC qt_barrier_dump(qt_barrier_t *b, qt_barrier_dtype Q_UNUSED(dt)) {
+  (void)b; /* Q_UNUSED() after the '*' would mark the type, not b */
+}
+
+void INTERNAL qt_barrier_internal_init(void) {}
+
+void qt_global_barrier(void) {
+  assert(global_barrier);
+  qt_barrier_enter(global_barrier);
+}
+
+void qt_global_barrier_init(size_t size, int Q_UNUSED(debug)) {
+  if (global_barrier == NULL) {
+    global_barrier = qt_barrier_create(size, REGION_BARRIER);
+    assert(global_barrier);
+  }
+}
+
+void qt_global_barrier_destroy(void) {
+  if (global_barrier) {
+    qt_barrier_destroy(global_barrier);
+    global_barrier = NULL;
+  }
+}
+
+void qt_global_barrier_resize(size_t size) {
+  qt_barrier_resize(global_barrier, size);
+}
+
+/* vim:set expandtab: */
@@ -0,0 +1,643 @@
+/* System Headers */
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Installed Headers */
+#include <qthread/dictionary.h>
+#include <qthread/hash.h>
+#include <qthread/qthread.h>
+
+/* Internal Headers */
+#include "qt_alloc.h"
+#include "qt_asserts.h"
+#include "qt_atomics.h"
+#include "qt_hazardptrs.h"
+
+/* An open-addressing table whose buckets are one cache line each: a word of
+ * one-byte tags (taken from the top of each entry's hash) followed by the
+ * pointers to the entries themselves. A lookup reads the tag word, and only
+ * follows the pointers whose tags match, so a miss costs one cache line and a
+ * hit usually costs two; the user's equality function is only called once the
+ * full hashes match.
+ *
+ * Buckets are grouped into segments of up to DICT_SEG_BUCKETS, each with a
+ * lock that its writers hold. An entry lives in its home bucket, or in one of
+ * the following buckets of the same segment if that one was full; a bucket
+ * that an insert had to skip is marked as having overflowed, and lookups stop
+ * at the first bucket that has not. Readers take no locks at all: they protect
+ * the entry they are about to look at with a hazard pointer, which is what
+ * keeps deleted entries (and their keys, whose cleanup is deferred along with
+ * them) alive until nobody can be comparing against them.
+ *
+ * When a segment fills up, the table starts growing into one twice its size.
+ * The writers that come along afterwards each copy a few segments into the new
+ * table before doing their own work; once a segment has been copied, each of
+ * its buckets is marked as moved, and readers and writers that land on it go
+ * on to the new table. The segments of a table are never copied into the next
+ * one until it has finished receiving its own, so the entries of each new
+ * segment all come from a single old one, and always fit. The old tables are
+ * kept until the dictionary is destroyed (readers may still be in them), which
+ * at most doubles the memory of the current one. */
+
+#define PUT_ALWAYS 0
+#define PUT_IF_ABSENT 1
+
+#define DICT_SLOTS 7 /* entry pointers per bucket; the eighth tag byte is flags */
+#define DICT_TAGS UINT64_C(0x00ffffffffffffff)
+#define DICT_OVERFLOW (UINT64_C(1) << 56) /* an insert skipped this bucket */
+#define DICT_MOVED (UINT64_C(1) << 57)    /* copied into the next table */
+#define DICT_ONES UINT64_C(0x0001010101010101)
+#define DICT_HIGHS UINT64_C(0x0080808080808080)
+#define DICT_TAG_SHIFT(slot) (8 * (slot))
+
+#define DICT_MIN_BUCKETS 8
+#define DICT_SEG_BUCKETS 32
+#define DICT_MIGRATE_CHUNK 2 /* segments each writer copies while resizing */
+
+typedef struct list_entry hash_entry;
+
+/* entries keep the cleanup function, since it runs when they are freed */
+typedef struct {
+  hash_entry e; /* must be first; it is what the iterator hands out */
+  qt_dict_cleanup_f cleanup;
+} dict_entry_t;
+
+typedef struct {
+  alignas(CACHELINE_WIDTH) _Atomic uint64_t tags;
+  hash_entry *_Atomic slots[DICT_SLOTS];
+} dict_bucket_t;
+
+typedef struct {
+  alignas(CACHELINE_WIDTH) QTHREAD_FASTLOCK_TYPE lock;
+  size_t count;
+} dict_seg_t;
+
+typedef struct dict_table_s {
+  size_t mask;      /* buckets - 1 */
+  size_t seg_mask;  /* buckets per segment - 1 */
+  unsigned seg_shift;
+  size_t nsegs;
+  dict_bucket_t *buckets;
+  dict_seg_t *segs;
+  struct dict_table_s *_Atomic next; /* the table this one is growing into */
+  struct dict_table_s *prev;         /* the table this one replaced */
+
+  alignas(CACHELINE_WIDTH) _Atomic size_t migrate_next; /* segments claimed */
+  _Atomic size_t migrated; /* segments completely copied into next */
+} dict_table_t;
+
+struct qt_dictionary {
+  dict_table_t *_Atomic table;
+
+  qt_dict_key_equals_f op_equals;
+  qt_dict_hash_f op_hash;
+  qt_dict_cleanup_f op_cleanup;
+};
+
+static inline uint64_t dict_hash(qt_dictionary const *h, void *key) {
+  return qt_hash64((uint64_t)(unsigned int)h->op_hash(key));
+}
+
+static inline uint64_t dict_tag(uint64_t hashed_key) {
+  uint64_t const tag = hashed_key >> 56;
+
+  return tag ? tag : 1; /* zero marks a free slot */
+}
+
+/* Flags the slots whose tag might be the given one (it will be, except in a
+ * slot just above one that matches exactly) */
+static inline uint64_t dict_tag_matches(uint64_t tags, uint64_t tag) {
+  uint64_t const x = (tags & DICT_TAGS) ^ (tag * DICT_ONES);
+
+  return (x - DICT_ONES) & ~x & DICT_HIGHS;
+}
+
+static inline unsigned dict_tag_slot(uint64_t matches) {
+  return (unsigned)__builtin_ctzll(matches) / 8;
+}
+
+static inline uint64_t dict_slot_tag(uint64_t tags, unsigned slot) {
+  return (tags >> DICT_TAG_SHIFT(slot)) & 0xff;
+}
+
+static inline size_t dict_next_bucket(dict_table_t const *t, size_t b) {
+  return (b & ~t->seg_mask) | ((b + 1) & t->seg_mask);
+}
+
+static inline dict_seg_t *dict_seg_of(dict_table_t const *t, size_t b) {
+  return &t->segs[b >> t->seg_shift];
+}
+
+static dict_table_t *dict_table_create(size_t nbuckets) {
+  dict_table_t *t =
+    qt_internal_aligned_alloc(sizeof(dict_table_t), CACHELINE_WIDTH);
+  size_t const seg_buckets =
+    (nbuckets < DICT_SEG_BUCKETS) ? nbuckets : DICT_SEG_BUCKETS;
+
+  if (t == NULL) { return NULL; }
+  t->mask = nbuckets - 1;
+  t->seg_mask = seg_buckets - 1;
+  t->seg_shift = (unsigned)__builtin_ctzll(seg_buckets);
+  t->nsegs = nbuckets / seg_buckets;
+  t->buckets = qt_internal_aligned_alloc(nbuckets * sizeof(dict_bucket_t),
+                                         CACHELINE_WIDTH);
+  t->segs =
+    qt_internal_aligned_alloc(t->nsegs * sizeof(dict_seg_t), CACHELINE_WIDTH);
+  if ((t->buckets == NULL) || (t->segs == NULL)) {
+    if (t->buckets) { qt_internal_aligned_free(t->buckets, CACHELINE_WIDTH); }
+    if (t->segs) { qt_internal_aligned_free(t->segs, CACHELINE_WIDTH); }
+    qt_internal_aligned_free(t, CACHELINE_WIDTH);
+    return NULL;
+  }
+  for (size_t b = 0; b < nbuckets; ++b) {
+    atomic_init(&t->buckets[b].tags, 0);
+    for (unsigned i = 0; i < DICT_SLOTS; ++i) {
+      atomic_init(&t->buckets[b].slots[i], NULL);
+    }
+  }
+  for (size_t s = 0; s < t->nsegs; ++s) {
+    QTHREAD_FASTLOCK_INIT(t->segs[s].lock);
+    t->segs[s].count = 0;
+  }
+  atomic_init(&t->next, NULL);
+  t->prev = NULL;
+  atomic_init(&t->migrate_next, 0);
+  atomic_init(&t->migrated, 0);
+  return t;
+}
+
+static void dict_table_destroy(dict_table_t *t) {
+  qt_internal_aligned_free(t->buckets, CACHELINE_WIDTH);
+  qt_internal_aligned_free(t->segs, CACHELINE_WIDTH);
+  qt_internal_aligned_free(t, CACHELINE_WIDTH);
+}
+
+static void dict_entry_free(void *ptr) {
+  dict_entry_t *de = ptr;
+
+  if (de->cleanup != NULL) { de->cleanup(de->e.key, NULL); }
+  FREE(de, sizeof(dict_entry_t));
+}
+
+/* Puts an entry into a free slot of t, starting from its home bucket. The
+ * caller holds the lock of the home bucket's segment (or is copying the only
+ * segment that feeds it), and has already made sure there is no entry for the
+ * same key. Returns 0 if the segment is full. */
+static int dict_place(dict_table_t *t, hash_entry *e) {
+  size_t const home = e->hashed_key & t->mask;
+  size_t b = home;
+
+  for (size_t probes = 0; probes <= t->seg_mask; ++probes) {
+    dict_bucket_t *bkt = &t->buckets[b];
+    uint64_t const tags =
+      atomic_load_explicit(&bkt->tags, memory_order_relaxed);
+
+    for (uint64_t m = dict_tag_matches(tags, 0); m != 0; m &= m - 1) {
+      unsigned const i = dict_tag_slot(m);
+
+      if (dict_slot_tag(tags, i) != 0) { continue; }
+      for (size_t o = home; o != b; o = dict_next_bucket(t, o)) {
+        atomic_fetch_or_explicit(
+          &t->buckets[o].tags, DICT_OVERFLOW, memory_order_relaxed);
+      }
+      /* readers that see the tag must see the entry it belongs to */
+      atomic_store_explicit(&bkt->slots[i], e, memory_order_release);
+      atomic_store_explicit(
+        &bkt->tags,
+        tags | (dict_tag(e->hashed_key) << DICT_TAG_SHIFT(i)),
+        memory_order_release);
+      dict_seg_of(t, home)->count++;
+      return 1;
+    }
+    b = dict_next_bucket(t, b);
+  }
+  return 0;
+}
+
+/* Finds key in t, holding the lock of its home bucket's segment */
+static hash_entry *dict_find_locked(qt_dictionary const *h,
+                                    dict_table_t *t,
+                                    uint64_t hk,
+                                    void *key,
+                                    dict_bucket_t **bkt_out,
+                                    unsigned *slot_out) {
+  uint64_t const tag = dict_tag(hk);
+  size_t b = hk & t->mask;
+
+  for (size_t probes = 0; probes <= t->seg_mask; ++probes) {
+    dict_bucket_t *bkt = &t->buckets[b];
+    uint64_t const tags =
+      atomic_load_explicit(&bkt->tags, memory_order_relaxed);
+
+    for (uint64_t m = dict_tag_matches(tags, tag); m != 0; m &= m - 1) {
+      unsigned const i = dict_tag_slot(m);
+      hash_entry *e = atomic_load_explicit(&bkt->slots[i], memory_order_relaxed);
+
+      if ((e != NULL) && (e->hashed_key == hk) && h->op_equals(e->key, key)) {
+        *bkt_out = bkt;
+        *slot_out = i;
+        return e;
+      }
+    }
+    if (!(tags & DICT_OVERFLOW)) { break; }
+    b = dict_next_bucket(t, b);
+  }
+  return NULL;
+}
+
+/* Copies one segment of t into t->next, and then marks its buckets as moved */
+static void dict_migrate_seg(dict_table_t *t, dict_table_t *n, size_t s) {
+  size_t const first = s << t->seg_shift;
+  size_t const last = first + t->seg_mask;
+
+  QTHREAD_FASTLOCK_LOCK(&t->segs[s].lock);
+  for (size_t b = first; b <= last; ++b) {
+    for (unsigned i = 0; i < DICT_SLOTS; ++i) {
+      hash_entry *e = atomic_load_explicit(&t->buckets[b].slots[i],
+                                           memory_order_relaxed);
+
+      /* nobody else touches the segments of n this one feeds until they
+       * are marked as moved, so their locks are not needed */
+      if (e != NULL) {
+        int const placed = dict_place(n, e);
+
+        assert(placed);
+        (void)placed;
+      }
+    }
+  }
+  /* only once everything is in the new table may anyone go looking there */
+  for (size_t b = first; b <= last; ++b) {
+    atomic_fetch_or_explicit(
+      &t->buckets[b].tags, DICT_MOVED, memory_order_release);
+  }
+  QTHREAD_FASTLOCK_UNLOCK(&t->segs[s].lock);
+}
+
+/* Copies up to budget segments of t into the table it is growing into */
+static void dict_migrate(qt_dictionary *h, dict_table_t *t, size_t budget) {
+  dict_table_t *n = atomic_load_explicit(&t->next, memory_order_acquire);
+
+  if (n == NULL) { return; }
+  while (budget-- > 0) {
+    size_t const s =
+      atomic_fetch_add_explicit(&t->migrate_next, 1, memory_order_relaxed);
+
+    if (s >= t->nsegs) { return; }
+    dict_migrate_seg(t, n, s);
+    if (atomic_fetch_add_explicit(&t->migrated, 1, memory_order_acq_rel) + 1 ==
+        t->nsegs) {
+      n->prev = t;
+      atomic_store_explicit(&h->table, n, memory_order_release);
+    }
+  }
+}
+
+/* Starts growing t, if it is the current table and is not growing already, and
+ * helps along whatever resize is in progress. Returns 0 if the new table could
+ * not be allocated. */
+static int dict_grow(qt_dictionary *h, dict_table_t *t) {
+  dict_table_t *cur = atomic_load_explicit(&h->table, memory_order_acquire);
+
+  if ((cur == t) &&
+      (atomic_load_explicit(&t->next, memory_order_acquire) == NULL)) {
+    dict_table_t *n = dict_table_create((t->mask + 1) * 2);
+    dict_table_t *expected = NULL;
+
+    if (n == NULL) { return 0; }
+    if (!atomic_compare_exchange_strong_explicit(&t->next,
+                                                 &expected,
+                                                 n,
+                                                 memory_order_acq_rel,
+                                                 memory_order_acquire)) {
+      dict_table_destroy(n);
+    }
+  }
+  dict_migrate(h, cur, DICT_MIGRATE_CHUNK);
+  return 1;
+}
+
+/* The table writers start from, once they have done their share of any
+ * resize in progress */
+static inline dict_table_t *dict_writer_table(qt_dictionary *h) {
+  dict_table_t *t = atomic_load_explicit(&h->table, memory_order_acquire);
+
+  if (atomic_load_explicit(&t->next, memory_order_relaxed) != NULL) {
+    dict_migrate(h, t, DICT_MIGRATE_CHUNK);
+    t = atomic_load_explicit(&h->table, memory_order_acquire);
+  }
+  return t;
+}
+
+/* Finishes any resize in progress; whoever calls this must be the only one
+ * that could start another */
+static void dict_finish_resize(qt_dictionary *h) {
+  while (1) {
+    dict_table_t *t = atomic_load_explicit(&h->table, memory_order_acquire);
+
+    if (atomic_load_explicit(&t->next, memory_order_acquire) == NULL) {
+      return;
+    }
+    dict_migrate(h, t, SIZE_MAX);
+    /* the last few segments may still be being copied by someone else */
+    if (atomic_load_explicit(&h->table, memory_order_acquire) == t) {
+      SPINLOCK_BODY();
+    }
+  }
+}
+
+API_FUNC qt_dictionary *qt_dictionary_create(qt_dict_key_equals_f eq,
+                                             qt_dict_hash_f hash,
+                                             qt_dict_cleanup_f cleanup) {
+  qt_dictionary *h = MALLOC(sizeof(qt_dictionary));
+  dict_table_t *t;
+
+  assert(h);
+  h->op_equals = eq;
+  h->op_hash = hash;
+  h->op_cleanup = cleanup;
+  t = dict_table_create(DICT_MIN_BUCKETS);
+  assert(t);
+  atomic_init(&h->table, t);
+  return h;
+}
+
+API_FUNC void qt_dictionary_destroy(qt_dictionary *h) {
+  dict_table_t *t;
+
+  assert(h);
+  dict_finish_resize(h);
+  t = atomic_load_explicit(&h->table, memory_order_acquire);
+  for (size_t b = 0; b <= t->mask; ++b) {
+    for (unsigned i = 0; i < DICT_SLOTS; ++i) {
+      hash_entry *e = atomic_load_explicit(&t->buckets[b].slots[i],
+                                           memory_order_relaxed);
+
+      if (e != NULL) {
+        if (h->op_cleanup) { h->op_cleanup(e->key, e->value); }
+        FREE(e, sizeof(dict_entry_t));
+      }
+    }
+  }
+  while (t != NULL) {
+    dict_table_t *prev = t->prev;
+
+    dict_table_destroy(t);
+    t = prev;
+  }
+  FREE(h, sizeof(qt_dictionary));
+}
+
+static void *
+qt_hash_put_helper(qt_dictionary *h, void *key, void *value, int put_choice) {
+  uint64_t const hk = dict_hash(h, key);
+  dict_table_t *t = dict_writer_table(h);
+
+  while (1) {
+    size_t const home = hk & t->mask;
+    dict_seg_t *seg = dict_seg_of(t, home);
+    dict_bucket_t *bkt;
+    unsigned slot;
+    hash_entry *e;
+    void *ret;
+
+    QTHREAD_FASTLOCK_LOCK(&seg->lock);
+    if (atomic_load_explicit(&t->buckets[home].tags, memory_order_relaxed) &
+        DICT_MOVED) {
+      QTHREAD_FASTLOCK_UNLOCK(&seg->lock);
+      t = atomic_load_explicit(&t->next, memory_order_acquire);
+      continue;
+    }
+    e = dict_find_locked(h, t, hk, key, &bkt, &slot);
+    if (e != NULL) {
+      if (put_choice != PUT_IF_ABSENT) { e->value = value; }
+      ret = e->value;
+      QTHREAD_FASTLOCK_UNLOCK(&seg->lock);
+      return ret;
+    }
+    if (seg->count < (t->seg_mask + 1) * DICT_SLOTS) {
+      dict_entry_t *de = MALLOC(sizeof(dict_entry_t));
+      int grow;
+
+      if (de == NULL) {
+        QTHREAD_FASTLOCK_UNLOCK(&seg->lock);
+        return NULL;
+      }
+      de->e.key = key;
+      de->e.value = value;
+      de->e.hashed_key = hk;
+      de->e.next = NULL;
+      de->cleanup = h->op_cleanup;
+      if (dict_place(t, &de->e)) {
+        /* grow once a segment is three-quarters full */
+        grow = (seg->count * 4 > (t->seg_mask + 1) * DICT_SLOTS * 3);
+        QTHREAD_FASTLOCK_UNLOCK(&seg->lock);
+        if (grow) { dict_grow(h, t); }
+        return value;
+      }
+      FREE(de, sizeof(dict_entry_t));
+    }
+    /* the segment is full: nothing can go in until it has been moved */
+    QTHREAD_FASTLOCK_UNLOCK(&seg->lock);
+    if (!dict_grow(h, t)) { return NULL; }
+  }
+}
+
+API_FUNC void *qt_dictionary_put(qt_dictionary *dict, void *key, void *value) {
+  return qt_hash_put_helper(dict, key, value, PUT_ALWAYS);
+}
+
+API_FUNC void *
+qt_dictionary_put_if_absent(qt_dictionary *dict, void *key, void *value) {
+  return qt_hash_put_helper(dict, key, value, PUT_IF_ABSENT);
+}
+
+API_FUNC void *qt_dictionary_get(qt_dictionary *h, void *key) {
+  uint64_t const hk = dict_hash(h, key);
+  uint64_t const tag = dict_tag(hk);
+  dict_table_t *t = atomic_load_explicit(&h->table, memory_order_acquire);
+  size_t b = hk & t->mask;
+  size_t probes = 0;
+  void *ret = NULL;
+
+  while (1) {
+    dict_bucket_t *bkt = &t->buckets[b];
+    uint64_t tags = atomic_load_explicit(&bkt->tags, memory_order_acquire);
+    uint64_t m;
+
+  rescan:
+    if (tags & DICT_MOVED) {
+      t = atomic_load_explicit(&t->next, memory_order_acquire);
+      b = hk & t->mask;
+      probes = 0;
+      continue;
+    }
+    for (m = dict_tag_matches(tags, tag); m != 0; m &= m - 1) {
+      unsigned const i = dict_tag_slot(m);
+      hash_entry *e =
+        atomic_load_explicit(&bkt->slots[i], memory_order_acquire);
+
+      if (e == NULL) { continue; }
+      /* the entry may only be looked at once it is protected, and it is only
+       * protected if it was still in the bucket (and the bucket still in use)
+       * after the hazard pointer became visible */
+      hazardous_ptr(0, e);
+      atomic_thread_fence(memory_order_seq_cst);
+      tags = atomic_load_explicit(&bkt->tags, memory_order_acquire);
+      if ((tags & DICT_MOVED) ||
+          (atomic_load_explicit(&bkt->slots[i], memory_order_acquire) != e)) {
+        goto rescan;
+      }
+      if ((e->hashed_key == hk) && h->op_equals(e->key, key)) {
+        ret = e->value;
+        goto done;
+      }
+    }
+    if (!(tags & DICT_OVERFLOW) || (++probes > t->seg_mask)) { break; }
+    b = dict_next_bucket(t, b);
+  }
+done:
+  hazardous_ptr(0, NULL);
+  return ret;
+}
+
+API_FUNC void *qt_dictionary_delete(qt_dictionary *h, void *key) {
+  uint64_t const hk = dict_hash(h, key);
+  dict_table_t *t = dict_writer_table(h);
+
+  while (1) {
+    size_t const home = hk & t->mask;
+    dict_seg_t *seg = dict_seg_of(t, home);
+    dict_bucket_t *bkt;
+    unsigned slot;
+    hash_entry *e;
+    void *ret;
+
+    QTHREAD_FASTLOCK_LOCK(&seg->lock);
+    if (atomic_load_explicit(&t->buckets[home].tags, memory_order_relaxed) &
+        DICT_MOVED) {
+      QTHREAD_FASTLOCK_UNLOCK(&seg->lock);
+      t = atomic_load_explicit(&t->next, memory_order_acquire);
+      continue;
+    }
+    e = dict_find_locked(h, t, hk, key, &bkt, &slot);
+    if (e == NULL) {
+      QTHREAD_FASTLOCK_UNLOCK(&seg->lock);
+      return NULL;
+    }
+    atomic_fetch_and_explicit(&bkt->tags,
+                              ~(UINT64_C(0xff) << DICT_TAG_SHIFT(slot)),
+                              memory_order_relaxed);
+    atomic_store_explicit(&bkt->slots[slot], NULL, memory_order_release);
+    seg->count--;
+    ret = e->value;
+    QTHREAD_FASTLOCK_UNLOCK(&seg->lock);
+    /* pairs with the fence readers put between their hazard pointer and
+     * checking that the entry is still there */
+    atomic_thread_fence(memory_order_seq_cst);
+    hazardous_release_node(dict_entry_free, e);
+    return ret;
+  }
+}
+
+struct qt_dictionary_iterator {
+  qt_dictionary *dict;
+  dict_table_t *table;
+  list_entry *crt; // =NULL if iterator is newly created or reached the end;
+                   // =crt elem otherwise.
+  size_t pos;      // the next slot to look at, as bucket * DICT_SLOTS + slot
+};
+
+API_FUNC qt_dictionary_iterator *
+qt_dictionary_iterator_create(qt_dictionary *dict) {
+  if (dict == NULL) { return ERROR; }
+  qt_dictionary_iterator *it =
+    (qt_dictionary_iterator *)MALLOC(sizeof(qt_dictionary_iterator));
+  /* so that every entry is in the one table */
+  dict_finish_resize(dict);
+  it->dict = dict;
+  it->table = atomic_load_explicit(&dict->table, memory_order_acquire);
+  it->crt = NULL;
+  it->pos = 0;
+  return it;
+}
+
+API_FUNC void qt_dictionary_iterator_destroy(qt_dictionary_iterator *it) {
+  if (it == NULL) { return; }
+  FREE(it, sizeof(qt_dictionary_iterator));
+}
+
+API_FUNC list_entry *qt_dictionary_iterator_next(qt_dictionary_iterator *it) {
+  if ((it == NULL) || (it->dict == NULL)) { return ERROR; }
+
+  size_t const end = (it->table->mask + 1) * DICT_SLOTS;
+  while (it->pos < end) {
+    hash_entry *e = atomic_load_explicit(
+      &it->table->buckets[it->pos / DICT_SLOTS].slots[it->pos % DICT_SLOTS],
+      memory_order_acquire);
+
+    it->pos++;
+    if (e != NULL) {
+      it->crt = e;
+      return e;
+    }
+  }
+  it->crt = NULL;
+  return NULL;
+}
+
+API_FUNC list_entry *
+qt_dictionary_iterator_get(qt_dictionary_iterator const *it) {
+  if ((it == NULL) || (it->dict == NULL)) { return ERROR; }
+  return it->crt;
+}
+
+API_FUNC qt_dictionary_iterator *qt_dictionary_end(qt_dictionary *dict) {
+  qt_dictionary_iterator *ret = qt_dictionary_iterator_create(dict);
+
+  if (ret == ERROR) { return NULL; }
+  ret->pos = (ret->table->mask + 1) * DICT_SLOTS;
+  return ret;
+}
+
+API_FUNC int qt_dictionary_iterator_equals(qt_dictionary_iterator *a,
+                                           qt_dictionary_iterator *b) {
+  if ((a == NULL) || (b == NULL)) { return a == b; }
+  return (a->crt == b->crt) && (a->dict == b->dict) && (a->pos == b->pos);
+}
+
+API_FUNC qt_dictionary_iterator *
+qt_dictionary_iterator_copy(qt_dictionary_iterator *b) {
+  if (b == NULL) { return NULL; }
+  qt_dictionary_iterator *ret = qt_dictionary_iterator_create(b->dict);
+  if ((ret == NULL) || (ret == ERROR)) { return NULL; }
+  ret->table = b->table;
+  ret->crt = b->crt;
+  ret->pos = b->pos;
+  return ret;
+}
+
+API_FUNC void qt_dictionary_printbuckets(qt_dictionary *dict) {
+  dict_table_t *t = atomic_load_explicit(&dict->table, memory_order_acquire);
+  size_t count = 0, overflowed = 0;
+
+  for (size_t s = 0; s < t->nsegs; ++s) { count += t->segs[s].count; }
+  for (size_t b = 0; b <= t->mask; ++b) {
+    if (atomic_load_explicit(&t->buckets[b].tags, memory_order_relaxed) &
+        DICT_OVERFLOW) {
+      overflowed++;
+    }
+  }
+  printf("allocated_buckets = %d; overflowed buckets = %d; total elements = "
+         "%d;%s\n",
+         (int)(t->mask + 1),
+         (int)overflowed,
+         (int)count,
+         atomic_load_explicit(&t->next, memory_order_relaxed) ? " (resizing)"
+                                                              : "");
+}
+
+/* vim:set expandtab: */
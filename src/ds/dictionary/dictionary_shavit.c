@@ -630,7 +630,7 @@ qt_dictionary_iterator_copy(qt_dictionary_iterator *b) {
   return ret;
 }
 
-void qt_dictionary_printbuckets(qt_dictionary *dict) {
+API_FUNC void qt_dictionary_printbuckets(qt_dictionary *dict) {
   /*int csize = dict->size, bucket;
    * int used_buckets = 0, total = dict->count;
    * for(bucket=0; bucket<csize-1; bucket++){
@@ -437,7 +437,7 @@ qt_dictionary_iterator_copy(qt_dictionary_iterator *b) {
   return ret;
 }
 
-void qt_dictionary_printbuckets(qt_dictionary *dict) {
+API_FUNC void qt_dictionary_printbuckets(qt_dictionary *dict) {
   int total = 0;
   int used_buckets = 0;
 
@@ -700,6 +700,6 @@ qt_dictionary_iterator_copy(qt_dictionary_iterator *b) {
   return ret;
 }
 
-void qt_dictionary_printbuckets(qt_dictionary *dict) {}
+API_FUNC void qt_dictionary_printbuckets(qt_dictionary *dict) {}
 
 /* vim:set expandtab: */
@@ -1,5 +1,6 @@
 /* System Headers */
 #include <stdlib.h> /* for calloc() */
+#include <string.h> /* for strcmp() */
 #include <sys/mman.h>
 #include <sys/types.h>
 #ifdef QTHREAD_USE_VALGRIND
@@ -16,6 +17,7 @@
 #include "qt_affinity.h"
 #include "qt_alloc.h"
 #include "qt_asserts.h"
+#include "qt_envariables.h"
 #include "qt_gcd.h" /* for qt_lcm() */
 #include "qt_int_ceil.h"
 #include "qt_shepherd_innards.h" /* for shep_to_node */
@@ -24,6 +26,12 @@
 static unsigned short pageshift = 0;
 static aligned_t *chunk_distribution_tracker = NULL;
 
+/* how base_ptr was allocated; QT_QARRAY_HUGEPAGES picks what to ask for */
+#define QARRAY_PAGES_NORMAL 0
+#define QARRAY_PAGES_TRANSPARENT 1 /* madvise()d for transparent huge pages */
+#define QARRAY_PAGES_EXPLICIT 2    /* mmap()ed from the hugetlbfs pool */
+#define QARRAY_HUGEPAGE ((size_t)2 << 20)
+
 /* local funcs */
 /* this function is for DIST *ONLY*; it returns a pointer to the location that
  * the bookkeeping data is stored (i.e. the record of where this segment is
@@ -120,13 +128,142 @@ static void qarray_free_cdt(void) {
   }
 }
 
+/* read for every array, since it is cheap next to allocating one */
+static unsigned char qarray_internal_hugepages(void) {
+  char const *str = qt_internal_get_env_str("QARRAY_HUGEPAGES", "no");
+
+  if (str == NULL) { return QARRAY_PAGES_NORMAL; }
+  if (!strcmp(str, "explicit")) { return QARRAY_PAGES_EXPLICIT; }
+  if (!strcmp(str, "transparent") || !strcmp(str, "yes")) {
+    return QARRAY_PAGES_TRANSPARENT;
+  }
+  return QARRAY_PAGES_NORMAL;
+}
+
+/* Allocates bytes (a multiple of QARRAY_HUGEPAGE) backed by huge pages, and
+ * records which kind in a->hugepages. Explicit huge pages fall back to
+ * transparent ones if none are reserved. Returns NULL if neither works. */
+static char *qarray_internal_alloc_huge(qarray *a, size_t const bytes) {
+  char *ptr;
+
+#ifdef MAP_HUGETLB
+  if (a->hugepages == QARRAY_PAGES_EXPLICIT) {
+    ptr = mmap(NULL,
+               bytes,
+               PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+               -1,
+               0);
+    if (ptr != MAP_FAILED) { return ptr; }
+  }
+#endif
+#ifdef MADV_HUGEPAGE
+  /* over-allocate by a huge page, so that the array can start on one */
+  ptr = mmap(NULL,
+             bytes + QARRAY_HUGEPAGE,
+             PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS,
+             -1,
+             0);
+  if (ptr != MAP_FAILED) {
+    size_t const lead = (QARRAY_HUGEPAGE - ((uintptr_t)ptr % QARRAY_HUGEPAGE)) %
+                        QARRAY_HUGEPAGE;
+
+    if (lead) { munmap(ptr, lead); }
+    munmap(ptr + lead + bytes, QARRAY_HUGEPAGE - lead);
+    ptr += lead;
+    madvise(ptr, bytes, MADV_HUGEPAGE);
+    a->hugepages = QARRAY_PAGES_TRANSPARENT;
+    return ptr;
+  }
+#endif
+  a->hugepages = QARRAY_PAGES_NORMAL;
+  return NULL;
+}
+
+static void qarray_internal_free_base(qarray *a, size_t const bytes) {
+  if (a->hugepages != QARRAY_PAGES_NORMAL) {
+    munmap(a->base_ptr, bytes);
+    return;
+  }
+#ifdef USE_HWLOC_MEM_AFFINITY
+  qt_affinity_free(a->base_ptr, bytes);
+#else
+  qt_internal_aligned_free(a->base_ptr, pagesize);
+#endif
+}
+
+struct qarray_touch_args {
+  qarray const *a;
+  qthread_shepherd_id_t const *owners;
+  size_t segment_count;
+  size_t stride;
+};
+
+/* writes to every page of the segments that belong to this shepherd, so that
+ * the kernel puts them in memory near it */
+static aligned_t qarray_internal_touch(void *arg_void) {
+  struct qarray_touch_args const *arg =
+    (struct qarray_touch_args const *)arg_void;
+  qthread_shepherd_id_t const shep = qthread_shep();
+  size_t const segment_bytes = arg->a->segment_bytes;
+
+  for (size_t segment = 0; segment < arg->segment_count; segment++) {
+    if (arg->owners[segment] == shep) {
+      volatile char *seghead = arg->a->base_ptr + segment * segment_bytes;
+
+      for (size_t off = 0; off < segment_bytes; off += arg->stride) {
+        seghead[off] = 0;
+      }
+    }
+  }
+  return 0;
+}
+
+/* Places each segment on its owner's NUMA node by first touch: the owning
+ * shepherds touch their own segments, in parallel */
+static void qarray_internal_first_touch(qarray const *a,
+                                        qthread_shepherd_id_t const *owners,
+                                        size_t const segment_count) {
+  qthread_shepherd_id_t const max_sheps = qthread_num_shepherds();
+  qthread_shepherd_id_t const here = qthread_shep();
+  struct qarray_touch_args args = {
+    a,
+    owners,
+    segment_count,
+    (a->hugepages == QARRAY_PAGES_NORMAL) ? pagesize : QARRAY_HUGEPAGE};
+  aligned_t *rets = MALLOC(max_sheps * sizeof(aligned_t));
+  qthread_shepherd_id_t s;
+
+  qassert_retvoid(rets != NULL);
+  for (s = 0; s < max_sheps; s++) {
+    if ((s == here) ||
+        ((a->dist_type == ALL_SAME) && (s != a->dist_specific.dist_shep))) {
+      continue;
+    }
+    qthread_fork_to(qarray_internal_touch, &args, &rets[s], s);
+  }
+  qarray_internal_touch(&args);
+  for (s = 0; s < max_sheps; s++) {
+    if ((s == here) ||
+        ((a->dist_type == ALL_SAME) && (s != a->dist_specific.dist_shep))) {
+      continue;
+    }
+    qthread_readFF(NULL, &rets[s]);
+  }
+  FREE(rets, max_sheps * sizeof(aligned_t));
+}
+
 static qarray *qarray_create_internal(size_t const count,
                                       size_t const obj_size,
                                       distribution_t const d,
                                       char const tight,
                                       int const seg_pages) {
   size_t segment_count; /* number of segments allocated */
+  size_t default_segment_bytes = 16 * pagesize;
   qarray *ret = NULL;
+  qthread_shepherd_id_t *owners = NULL;
+  int touch = 0;
 
   qassert_ret((count > 0), NULL);
   qassert_ret((obj_size > 0), NULL);
@@ -170,6 +307,15 @@ static qarray *qarray_create_internal(size_t const count,
   /***************************
    * Choose allocation sizes *
    ***************************/
+  /* Large arrays may be backed by huge pages, to spare the TLB. A huge page
+   * can only live on one node, so by default their segments are one huge
+   * page each, and an array has to have at least one per shepherd. */
+  ret->hugepages = qarray_internal_hugepages();
+  if (count * ret->unit_size < QARRAY_HUGEPAGE * qthread_num_shepherds()) {
+    ret->hugepages = QARRAY_PAGES_NORMAL;
+  } else if ((ret->hugepages != QARRAY_PAGES_NORMAL) && (seg_pages == 0)) {
+    default_segment_bytes = QARRAY_HUGEPAGE;
+  }
   switch (d) {
     case ALL_LOCAL:
     case ALL_RAND:
@@ -179,7 +325,7 @@ static qarray *qarray_create_internal(size_t const count,
     case FIXED_HASH:
     default:
       if (seg_pages == 0) {
-        ret->segment_bytes = 16 * pagesize;
+        ret->segment_bytes = default_segment_bytes;
         if (ret->unit_size > ret->segment_bytes) {
           ret->segment_bytes = qt_lcm(ret->unit_size, pagesize);
         }
@@ -201,7 +347,7 @@ static qarray *qarray_create_internal(size_t const count,
        * by 1 (thus providing space for the shepherd identifier, as long
        * as the unit-size is bigger than a shepherd identifier). */
       if (seg_pages == 0) {
-        ret->segment_bytes = 16 * pagesize;
+        ret->segment_bytes = default_segment_bytes;
       } else {
         ret->segment_bytes = seg_pages * pagesize;
       }
@@ -220,6 +366,9 @@ static qarray *qarray_create_internal(size_t const count,
       assert(ret->segment_bytes > 0);
       break;
   }
+  if (ret->segment_bytes % QARRAY_HUGEPAGE) {
+    ret->hugepages = QARRAY_PAGES_NORMAL;
+  }
 
   /*****************
    * Set dist_type *
@@ -280,39 +429,47 @@ static qarray *qarray_create_internal(size_t const count,
       break;
     default: ret->dist_specific.dist_shep = NO_SHEPHERD;
   }
-#ifdef USE_HWLOC_MEM_AFFINITY
-  switch (d) {
-    case ALL_LOCAL:
-    case ALL_RAND:
-    case ALL_LEAST:
-    case ALL_SAME:
-    default:
-      if (qthread_internal_shep_to_node(ret->dist_specific.dist_shep) ==
-          QTHREAD_NO_NODE) {
-        case DIST_STRIPES:
-        case DIST_FIELDS:
-        case DIST_RAND:
-        case DIST_LEAST:
-        case DIST:
-        case FIXED_FIELDS:
-        case FIXED_HASH:
-          ret->base_ptr =
-            (char *)qt_affinity_alloc(segment_count * ret->segment_bytes);
-          break;
-      } else {
-        ret->base_ptr = (char *)qt_affinity_alloc_onnode(
-          segment_count * ret->segment_bytes,
-          qthread_internal_shep_to_node(ret->dist_specific.dist_shep));
-      }
-      break;
+  if (ret->hugepages != QARRAY_PAGES_NORMAL) {
+    ret->base_ptr =
+      qarray_internal_alloc_huge(ret, segment_count * ret->segment_bytes);
   }
-  if (ret->base_ptr == NULL) {}
+  if (ret->base_ptr == NULL) {
+#ifdef USE_HWLOC_MEM_AFFINITY
+    switch (d) {
+      case ALL_LOCAL:
+      case ALL_RAND:
+      case ALL_LEAST:
+      case ALL_SAME:
+      default:
+        if (qthread_internal_shep_to_node(ret->dist_specific.dist_shep) ==
+            QTHREAD_NO_NODE) {
+          case DIST_STRIPES:
+          case DIST_FIELDS:
+          case DIST_RAND:
+          case DIST_LEAST:
+          case DIST:
+          case FIXED_FIELDS:
+          case FIXED_HASH:
+            ret->base_ptr =
+              (char *)qt_affinity_alloc(segment_count * ret->segment_bytes);
+            break;
+        } else {
+          ret->base_ptr = (char *)qt_affinity_alloc_onnode(
+            segment_count * ret->segment_bytes,
+            qthread_internal_shep_to_node(ret->dist_specific.dist_shep));
+        }
+        break;
+    }
+    if (ret->base_ptr == NULL) {}
 #else  /* ifdef USE_HWLOC_MEM_AFFINITY */
-  /* For speed, we want page-aligned memory, if we can get it */
-  ret->base_ptr =
-    qt_internal_aligned_alloc(segment_count * ret->segment_bytes, pagesize);
+    /* For speed, we want page-aligned memory, if we can get it */
+    ret->base_ptr =
+      qt_internal_aligned_alloc(segment_count * ret->segment_bytes, pagesize);
 #endif /* ifdef USE_HWLOC_MEM_AFFINITY */
+  }
   qassert_goto((ret->base_ptr != NULL), badret_exit);
+  owners = MALLOC(segment_count * sizeof(qthread_shepherd_id_t));
+  qassert_goto((owners != NULL), badret_exit);
 
   /********************************************
    * Assign locations, maintain segment_count *
@@ -356,11 +513,8 @@ static qarray *qarray_create_internal(size_t const count,
           assert(ret->dist_type == ALL_SAME);
           target_shep = ret->dist_specific.dist_shep;
       }
-      if (ret->dist_type == DIST) {
-        char *seghead = qarray_elem_nomigrate(ret, segment * ret->segment_size);
-        qarray_internal_segment_shep_write(ret, seghead, target_shep);
-      }
       assert(target_shep < max_sheps);
+      owners[segment] = (qthread_shepherd_id_t)target_shep;
 #ifdef USE_HWLOC_MEM_AFFINITY
       {
         /* make sure this shep has a node; if it does, put this segment there */
@@ -369,17 +523,36 @@ static qarray *qarray_create_internal(size_t const count,
           char *seghead =
             qarray_elem_nomigrate(ret, segment * ret->segment_size);
           qt_affinity_mem_tonode(seghead, ret->segment_bytes, target_node);
+        } else {
+          touch = 1;
         }
       }
+#else
+      touch = 1;
 #endif /* ifdef USE_HWLOC_MEM_AFFINITY */
       qthread_incr(&chunk_distribution_tracker[target_shep], 1);
     }
+    /* Nothing has touched the memory yet, so where a segment could not be
+     * bound to its shepherd's node, the shepherd can touch it first. Only
+     * then may the segment headers be written. */
+    if (touch && (max_sheps > 1)) {
+      qarray_internal_first_touch(ret, owners, segment_count);
+    }
+    if (ret->dist_type == DIST) {
+      for (segment = 0; segment < segment_count; segment++) {
+        char *seghead = qarray_elem_nomigrate(ret, segment * ret->segment_size);
+        qarray_internal_segment_shep_write(ret, seghead, owners[segment]);
+      }
+    }
   }
+  FREE(owners, segment_count * sizeof(qthread_shepherd_id_t));
   return ret;
 
   qgoto(badret_exit);
   if (ret) {
-    if (ret->base_ptr) { qt_free(ret->base_ptr); }
+    if (ret->base_ptr) {
+      qarray_internal_free_base(ret, segment_count * ret->segment_bytes);
+    }
     FREE(ret, sizeof(qarray));
   }
   return NULL;
@@ -438,13 +611,10 @@ API_FUNC void qarray_destroy(qarray *a) {
                                       ((a->count % a->segment_size) ? 1 : 0)));
       break;
   }
-#ifdef USE_HWLOC_MEM_AFFINITY
-  qt_affinity_free(a->base_ptr,
-                   a->segment_bytes * (a->count / a->segment_size +
-                                       ((a->count % a->segment_size) ? 1 : 0)));
-#else
-  qt_internal_aligned_free(a->base_ptr, pagesize);
-#endif
+  qarray_internal_free_base(
+    a,
+    a->segment_bytes *
+      (a->count / a->segment_size + ((a->count % a->segment_size) ? 1 : 0)));
   FREE(a, sizeof(qarray));
 }
 
@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h> /* for strcmp() */
 
 #include <qthread/qlfqueue.h>
 #include <qthread/qpool.h>
@@ -7,6 +8,8 @@
 #include "qt_alloc.h"
 #include "qt_asserts.h"
 #include "qt_atomics.h"
+#include "qt_envariables.h"
+#include "qt_epoch.h"
 #include "qt_hazardptrs.h"
 #include "qt_subsystems.h" /* for qthread_internal_cleanup_late() */
 
@@ -23,9 +26,16 @@ struct qlfqueue_s { /* typedef'd to qlfqueue_t */
 
 static qpool *qlfqueue_node_pool = NULL;
 
+/* How dequeued nodes are kept from being freed while someone may still be
+ * looking at them: with epochs (qt_epoch.h), unless QT_LFQUEUE_RECLAMATION
+ * says "hazard", for hazard pointers (qt_hazardptrs.h), which must publish
+ * and recheck every node they touch and occasionally scan everyone's. */
+static int use_epochs = 1;
+
 static void qlfqueue_internal_cleanup(void) {
   assert(qlfqueue_node_pool);
   qpool_destroy(qlfqueue_node_pool);
+  qlfqueue_node_pool = NULL;
 }
 
 /*
@@ -35,12 +45,23 @@ static void qlfqueue_internal_cleanup(void) {
  * http://www.research.ibm.com/people/m/michael/ieeetpds-2004.pdf
  */
 
+/* returns nonzero if *where no longer points to p once p is protected */
+static inline int
+qlfqueue_protect(unsigned int which, void *p, qlfqueue_node_t *const *where) {
+  if (use_epochs) { return 0; }
+  hazardous_ptr(which, p);
+  return p != *where;
+}
+
 API_FUNC qlfqueue_t *qlfqueue_create(void) {
   qlfqueue_t *q;
+  char const *scheme;
 
   if (qlfqueue_node_pool == NULL) {
     switch ((uintptr_t)qthread_cas_ptr(&qlfqueue_node_pool, NULL, (void *)1)) {
       case 0: /* I won, I will allocate */
+        scheme = qt_internal_get_env_str("LFQUEUE_RECLAMATION", "epoch");
+        use_epochs = (scheme == NULL) || (strcmp(scheme, "hazard") != 0);
         qlfqueue_node_pool = qpool_create_aligned(sizeof(qlfqueue_node_t), 0);
         qthread_internal_cleanup_late(qlfqueue_internal_cleanup);
         break;
@@ -92,11 +113,11 @@ API_FUNC int qlfqueue_enqueue(qlfqueue_t *q, void *elem) {
   memset((void *)node, 0, sizeof(qlfqueue_node_t));
   node->value = elem;
 
+  if (use_epochs) { qt_epoch_enter(); }
   while (1) {
     tail = q->tail;
 
-    hazardous_ptr(0, tail);
-    if (tail != q->tail) { continue; }
+    if (qlfqueue_protect(0, tail, &q->tail)) { continue; }
 
     next = tail->next;
     if (next != NULL) { /* tail not pointing to last node */
@@ -110,8 +131,11 @@ API_FUNC int qlfqueue_enqueue(qlfqueue_t *q, void *elem) {
     }
   }
   atomic_store_explicit((void *_Atomic *)&q->tail, node, memory_order_relaxed);
-  hazardous_ptr(0,
-                NULL); // release the ptr (avoid hazardptr resource exhaustion)
+  if (use_epochs) {
+    qt_epoch_exit();
+  } else {
+    hazardous_ptr(0, NULL); // release the ptr (avoid resource exhaustion)
+  }
   return QTHREAD_SUCCESS;
 }
 
@@ -126,19 +150,22 @@ API_FUNC void *qlfqueue_dequeue(qlfqueue_t *q) {
   qlfqueue_node_t *next_ptr;
 
   qassert_ret((q != NULL), NULL);
+  if (use_epochs) { qt_epoch_enter(); }
   while (1) {
     head = q->head;
 
-    hazardous_ptr(0, head);
-    if (head != q->head) { continue; }
+    if (qlfqueue_protect(0, head, &q->head)) { continue; }
 
     tail = q->tail;
     next_ptr = head->next;
 
-    hazardous_ptr(1, next_ptr);
+    if (!use_epochs) { hazardous_ptr(1, next_ptr); }
 
-    if (next_ptr == NULL) { return NULL; } /* queue is empty */
-    if (head == tail) {                    /* tail is falling behind! */
+    if (next_ptr == NULL) { /* queue is empty */
+      if (use_epochs) { qt_epoch_exit(); }
+      return NULL;
+    }
+    if (head == tail) { /* tail is falling behind! */
       /* advance tail ptr... */
       atomic_store_explicit(
         (void *_Atomic *)&q->tail, next_ptr, memory_order_relaxed);
@@ -151,7 +178,12 @@ API_FUNC void *qlfqueue_dequeue(qlfqueue_t *q) {
       break; /* success! */
     }
   }
-  hazardous_release_node(qlfqueue_pool_free_wrapper, head);
+  if (use_epochs) {
+    qt_epoch_exit();
+    qt_epoch_retire(qlfqueue_pool_free_wrapper, head);
+  } else {
+    hazardous_release_node(qlfqueue_pool_free_wrapper, head);
+  }
   return p;
 }
 
@@ -162,22 +194,26 @@ API_FUNC int qlfqueue_empty(qlfqueue_t *q) {
 
   qassert_ret((q != NULL), QTHREAD_BADARGS);
 
+  /* head may be dequeued and freed under us */
+  if (use_epochs) { qt_epoch_enter(); }
   while (1) {
     head = q->head;
     tail = q->tail;
     next = head->next;
     MACHINE_FENCE;
-    if (head == q->head) {  /* are head, tail, and next consistent? */
-      if (head == tail) {   /* is queue empty or tail falling behind? */
-        if (next == NULL) { /* queue is empty! */
-          return 1;
-        } else { /* tail falling behind (queue NOT empty) */
-          return 0;
-        }
-      } else { /* queue is NOT empty and tail is NOT falling behind */
-        return 0;
-      }
+    if (head == q->head) { /* are head, tail, and next consistent? */
+      break;
+    }
+  }
+  if (use_epochs) { qt_epoch_exit(); }
+  if (head == tail) {   /* is queue empty or tail falling behind? */
+    if (next == NULL) { /* queue is empty! */
+      return 1;
+    } else { /* tail falling behind (queue NOT empty) */
+      return 0;
     }
+  } else { /* queue is NOT empty and tail is NOT falling behind */
+    return 0;
   }
 }
 
@@ -0,0 +1,236 @@
+/* System Headers */
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h> /* for memset() */
+
+/* Internal Headers */
+#include "qt_alloc.h"
+#include "qt_asserts.h"
+#include "qt_epoch.h"
+#include "qt_macros.h"
+#include "qt_shepherd_innards.h"
+#include "qt_subsystems.h"
+#include "qthread_innards.h" /* for qlib */
+
+#define QT_EPOCH_BATCH 64 /* retirements between attempts to advance */
+#define QT_EPOCH_CHUNK 62 /* limbo entries per chunk (about 1 KiB) */
+
+typedef struct qt_epoch_chunk_s {
+  struct qt_epoch_chunk_s *next;
+  size_t count;
+  struct {
+    qt_epoch_free_f freefunc;
+    void *ptr;
+  } entries[QT_EPOCH_CHUNK];
+} qt_epoch_chunk_t;
+
+/* The nodes retired in one epoch. A node retired in epoch e may be freed once
+ * the global epoch reaches e + 2, so a record only ever needs three bags: when
+ * it comes back to one (in epoch e + 3), whatever is in it can go. */
+typedef struct {
+  qt_epoch_chunk_t *head;
+  uint64_t epoch;
+} qt_epoch_bag_t;
+
+typedef struct qt_epoch_record_s {
+  /* the epoch this record last entered in, shifted left by one, with the low
+   * bit set while it is inside */
+  alignas(CACHELINE_WIDTH) _Atomic uint64_t state;
+  /* the rest is only touched by the record's owner */
+  unsigned int nesting;
+  unsigned int retired; /* since the last attempt to advance */
+  qt_epoch_bag_t bags[3];
+  qt_epoch_chunk_t *spare; /* emptied chunks, for reuse */
+  struct qt_epoch_record_s *next; /* on the list of non-worker records */
+} qt_epoch_record_t;
+
+static alignas(CACHELINE_WIDTH) _Atomic uint64_t global_epoch = 0;
+static qt_epoch_record_t *records = NULL; /* one per worker */
+static size_t nrecords = 0;
+static qt_epoch_record_t *_Atomic external_records = NULL;
+static TLS_DECL_INIT(qt_epoch_record_t *, ts_epoch_record);
+
+/* Frees everything in bag, keeping its chunks as spares */
+static void qt_epoch_drain(qt_epoch_record_t *r, qt_epoch_bag_t *bag) {
+  qt_epoch_chunk_t *c = bag->head;
+
+  while (c) {
+    qt_epoch_chunk_t *next = c->next;
+
+    for (size_t i = 0; i < c->count; i++) {
+      c->entries[i].freefunc(c->entries[i].ptr);
+    }
+    c->count = 0;
+    c->next = r->spare;
+    r->spare = c;
+    c = next;
+  }
+  bag->head = NULL;
+}
+
+static void qt_epoch_record_fini(qt_epoch_record_t *r) {
+  for (int i = 0; i < 3; i++) { qt_epoch_drain(r, &r->bags[i]); }
+  while (r->spare) {
+    qt_epoch_chunk_t *c = r->spare;
+
+    r->spare = c->next;
+    FREE(c, sizeof(qt_epoch_chunk_t));
+  }
+}
+
+static void qt_epoch_subsystem_shutdown(void) {
+  qt_epoch_record_t *r =
+    atomic_load_explicit(&external_records, memory_order_acquire);
+
+  /* everyone is done, so everything can go */
+  for (size_t i = 0; i < nrecords; i++) { qt_epoch_record_fini(&records[i]); }
+  qt_internal_aligned_free(records, CACHELINE_WIDTH);
+  records = NULL;
+  nrecords = 0;
+  while (r) {
+    qt_epoch_record_t *next = r->next;
+
+    qt_epoch_record_fini(r);
+    qt_internal_aligned_free(r, CACHELINE_WIDTH);
+    r = next;
+  }
+  atomic_store_explicit(&external_records, NULL, memory_order_relaxed);
+  TLS_DELETE(ts_epoch_record);
+}
+
+void INTERNAL qt_epoch_subsystem_init(void) {
+  nrecords = qlib->nshepherds * qlib->nworkerspershep;
+  records = qt_internal_aligned_alloc(nrecords * sizeof(qt_epoch_record_t),
+                                      CACHELINE_WIDTH);
+  assert(records);
+  memset(records, 0, nrecords * sizeof(qt_epoch_record_t));
+  for (size_t i = 0; i < nrecords; i++) {
+    atomic_init(&records[i].state, 0);
+    qlib->shepherds[i / qlib->nworkerspershep]
+      .workers[i % qlib->nworkerspershep]
+      .epoch = &records[i];
+  }
+  atomic_store_explicit(&global_epoch, 0, memory_order_relaxed);
+  qthread_internal_cleanup(qt_epoch_subsystem_shutdown);
+}
+
+static inline qt_epoch_record_t *qt_epoch_record(void) {
+  qthread_worker_t *w = qthread_internal_getworker();
+  qt_epoch_record_t *r;
+
+  if (w) { return w->epoch; }
+  r = TLS_GET(ts_epoch_record);
+  if (r == NULL) {
+    r = qt_internal_aligned_alloc(sizeof(qt_epoch_record_t), CACHELINE_WIDTH);
+    assert(r);
+    memset(r, 0, sizeof(qt_epoch_record_t));
+    atomic_init(&r->state, 0);
+    r->next = atomic_load_explicit(&external_records, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&external_records,
+                                                  &r->next,
+                                                  r,
+                                                  memory_order_release,
+                                                  memory_order_relaxed)) {}
+    TLS_SET(ts_epoch_record, r);
+  }
+  return r;
+}
+
+void INTERNAL qt_epoch_enter(void) {
+  qt_epoch_record_t *r = qt_epoch_record();
+
+  if (r->nesting++ == 0) {
+    uint64_t const e = atomic_load_explicit(&global_epoch, memory_order_relaxed);
+
+    /* If the epoch moves on before this is seen, the record only claims an
+     * older one than it needs to, which holds the epoch back, not forward. */
+    atomic_store_explicit(&r->state, (e << 1) | 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+  }
+}
+
+void INTERNAL qt_epoch_exit(void) {
+  qt_epoch_record_t *r = qt_epoch_record();
+
+  assert(r->nesting > 0);
+  if (--r->nesting == 0) {
+    atomic_store_explicit(&r->state,
+                          atomic_load_explicit(&r->state,
+                                               memory_order_relaxed) &
+                            ~(uint64_t)1,
+                          memory_order_release);
+  }
+}
+
+static inline int qt_epoch_record_holds(qt_epoch_record_t *r, uint64_t e) {
+  uint64_t const s = atomic_load_explicit(&r->state, memory_order_acquire);
+
+  return (s & 1) && ((s >> 1) != e);
+}
+
+/* Moves the global epoch on by one, unless someone is still inside an older
+ * epoch than the current one */
+static void qt_epoch_try_advance(void) {
+  uint64_t e = atomic_load_explicit(&global_epoch, memory_order_seq_cst);
+
+  atomic_thread_fence(memory_order_seq_cst);
+  for (size_t i = 0; i < nrecords; i++) {
+    if (qt_epoch_record_holds(&records[i], e)) { return; }
+  }
+  for (qt_epoch_record_t *r =
+         atomic_load_explicit(&external_records, memory_order_acquire);
+       r;
+       r = r->next) {
+    if (qt_epoch_record_holds(r, e)) { return; }
+  }
+  atomic_compare_exchange_strong_explicit(
+    &global_epoch, &e, e + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+void INTERNAL qt_epoch_retire(qt_epoch_free_f freefunc, void *ptr) {
+  qt_epoch_record_t *r = qt_epoch_record();
+  /* read after ptr was unlinked, so anyone who can still reach it entered in
+   * this epoch or before */
+  uint64_t const e = atomic_load_explicit(&global_epoch, memory_order_seq_cst);
+  qt_epoch_bag_t *bag = &r->bags[e % 3];
+  qt_epoch_chunk_t *c;
+
+  assert(freefunc != NULL);
+  assert(ptr != NULL);
+  if (bag->epoch != e) {
+    /* from epoch e - 3 or before */
+    qt_epoch_drain(r, bag);
+    bag->epoch = e;
+  }
+  c = bag->head;
+  if ((c == NULL) || (c->count == QT_EPOCH_CHUNK)) {
+    if (r->spare) {
+      c = r->spare;
+      r->spare = c->next;
+    } else {
+      c = MALLOC(sizeof(qt_epoch_chunk_t));
+      assert(c);
+      c->count = 0;
+    }
+    c->next = bag->head;
+    bag->head = c;
+  }
+  c->entries[c->count].freefunc = freefunc;
+  c->entries[c->count].ptr = ptr;
+  c->count++;
+  if (++r->retired >= QT_EPOCH_BATCH) {
+    uint64_t now;
+
+    r->retired = 0;
+    qt_epoch_try_advance();
+    now = atomic_load_explicit(&global_epoch, memory_order_acquire);
+    for (int i = 0; i < 3; i++) {
+      if (r->bags[i].head && (r->bags[i].epoch + 2 <= now)) {
+        qt_epoch_drain(r, &r->bags[i]);
+      }
+    }
+  }
+}
+
+/* vim:set expandtab: */
@@ -14,6 +14,7 @@
 #include "qt_alloc.h"
 #include "qt_asserts.h"
 #include "qt_blocking_structs.h"
+#include "qt_envariables.h"
 #include "qt_hash.h"
 #include "qt_initialized.h" // for qthread_library_initialized
 #include "qt_output_macros.h"
@@ -22,6 +23,7 @@
 #include "qt_qthread_struct.h"
 #include "qt_subsystems.h"
 #include "qt_threadqueues.h"
+#include "qt_timers.h"
 #include "qthread_innards.h" /* for qlib */
 
 /********************************************************************
@@ -32,6 +34,31 @@ static qt_hash *FEBs;
 aligned_t *febs_stripes;
 #endif
 
+/* The FEB table is a lock-free, set-associative front end to the FEBs hash.
+ * Each slot packs an address with its state in the low two bits, so an
+ * address without waiters is resolved by loading the one cache line that
+ * holds its bucket. As in the hash, an address that isn't there is full.
+ * Only addresses with waiters get a qthread_addrstat_t: it lives in FEBs[]
+ * exactly as before and its slot is marked SLOW, sending everyone to the
+ * locked path. Addresses whose bucket has no room spill into FEBs[] and are
+ * counted in feb_overflow[]. Slots are only claimed or released with the
+ * stripe's hash lock held; buckets never span stripes. */
+#define QT_FEB_FULL 0
+#define QT_FEB_EMPTY 1
+#define QT_FEB_BUSY 2 /* a data copy is in progress */
+#define QT_FEB_SLOW 3 /* see the hash */
+#define QT_FEB_STATE_MASK ((uintptr_t)3)
+#define QT_FEB_STATE(w) ((w) & QT_FEB_STATE_MASK)
+#define QT_FEB_KEY(w) ((w) & ~QT_FEB_STATE_MASK)
+#define QT_FEB_WAYS 8
+#define QT_FEB_LOCKED 1 /* not a QTHREAD_* return code */
+
+typedef uintptr_t _Atomic qt_feb_slot_t;
+
+static qt_feb_slot_t *feb_table = NULL;
+static size_t feb_table_buckets = 0;
+static size_t _Atomic *feb_overflow = NULL;
+
 /********************************************************************
  * Local Types
  *********************************************************************/
@@ -57,6 +84,7 @@ typedef struct {
   void *b;
   blocker_type type;
   int retval;
+  uint64_t deadline; /* for READFF, READFE and WRITEEF */
 } qthread_feb_blocker_t;
 
 /********************************************************************
@@ -80,6 +108,15 @@ qthread_gotlock_empty_inner(qthread_shepherd_t *shep,
                             void *maddr,
                             uint_fast8_t const recursive,
                             qthread_addrres_t **precond_tasks);
+static inline int qt_feb_writeEF(aligned_t *restrict dest,
+                                 aligned_t const *restrict src,
+                                 uint64_t const deadline);
+static inline int qt_feb_readFF(aligned_t *restrict dest,
+                                aligned_t const *restrict src,
+                                uint64_t const deadline);
+static inline int qt_feb_readFE(aligned_t *restrict dest,
+                                aligned_t const *restrict src,
+                                uint64_t const deadline);
 
 /********************************************************************
  * Shared Globals
@@ -105,6 +142,11 @@ static void qt_feb_subsystem_shutdown(void) {
 #endif
   }
   FREE(FEBs, sizeof(qt_hash) * QTHREAD_LOCKING_STRIPES);
+  if (feb_table) {
+    qt_internal_aligned_free(feb_table, CACHELINE_WIDTH);
+    feb_table = NULL;
+    FREE(feb_overflow, sizeof(size_t _Atomic) * QTHREAD_LOCKING_STRIPES);
+  }
 #ifdef QTHREAD_COUNT_THREADS
   FREE(febs_stripes, sizeof(aligned_t) * QTHREAD_LOCKING_STRIPES);
 #endif
@@ -130,6 +172,31 @@ void INTERNAL qt_feb_subsystem_init(uint_fast8_t need_sync) {
     FEBs[i] = qt_hash_create(need_sync);
     assert(FEBs[i]);
   }
+#ifndef LOCK_FREE_FEBS
+  {
+    /* the stripe count already scales with the number of workers */
+    size_t slots = qt_internal_get_env_num(
+      "FEB_TABLE_SIZE", QTHREAD_LOCKING_STRIPES * 4096, 0);
+
+    if (slots > 0) {
+      feb_table_buckets = QTHREAD_LOCKING_STRIPES;
+      while (feb_table_buckets * QT_FEB_WAYS < slots) {
+        feb_table_buckets <<= 1;
+      }
+      feb_table = qt_internal_aligned_alloc(
+        feb_table_buckets * QT_FEB_WAYS * sizeof(qt_feb_slot_t),
+        CACHELINE_WIDTH);
+      assert(feb_table);
+      memset(
+        feb_table, 0, feb_table_buckets * QT_FEB_WAYS * sizeof(qt_feb_slot_t));
+      feb_overflow = MALLOC(sizeof(size_t _Atomic) * QTHREAD_LOCKING_STRIPES);
+      assert(feb_overflow);
+      for (unsigned i = 0; i < QTHREAD_LOCKING_STRIPES; i++) {
+        atomic_init(&feb_overflow[i], 0);
+      }
+    }
+  }
+#endif /* ifndef LOCK_FREE_FEBS */
   qthread_internal_cleanup_late(qt_feb_subsystem_shutdown);
 }
 
@@ -152,12 +219,12 @@ static aligned_t qthread_feb_blocker_thread(void *arg) {
   qthread_feb_blocker_t *restrict const a = (qthread_feb_blocker_t *)arg;
 
   switch (a->type) {
-    case READFE: a->retval = qthread_readFE(a->a, a->b); break;
+    case READFE: a->retval = qt_feb_readFE(a->a, a->b, a->deadline); break;
     case READFE_NB: a->retval = qthread_readFE_nb(a->a, a->b); break;
-    case READFF: a->retval = qthread_readFF(a->a, a->b); break;
+    case READFF: a->retval = qt_feb_readFF(a->a, a->b, a->deadline); break;
     case READFF_NB: a->retval = qthread_readFF_nb(a->a, a->b); break;
     case PURGE: a->retval = qthread_purge_to(a->a, a->b); break;
-    case WRITEEF: a->retval = qthread_writeEF(a->a, a->b); break;
+    case WRITEEF: a->retval = qt_feb_writeEF(a->a, a->b, a->deadline); break;
     case WRITEEF_NB: a->retval = qthread_writeEF_nb(a->a, a->b); break;
     case WRITEF: a->retval = qthread_writeF(a->a, a->b); break;
     case WRITEFF: a->retval = qthread_writeFF(a->a, a->b); break;
@@ -171,14 +238,18 @@ static aligned_t qthread_feb_blocker_thread(void *arg) {
   return 0;
 }
 
-static int qthread_feb_blocker_func(void *dest, void *src, blocker_type t) {
+static int qthread_feb_blocker_func_until(void *dest,
+                                          void *src,
+                                          blocker_type t,
+                                          uint64_t deadline) {
   qthread_feb_blocker_t args = {PTHREAD_MUTEX_INITIALIZER,
                                 PTHREAD_COND_INITIALIZER,
                                 0u,
                                 dest,
                                 src,
                                 t,
-                                QTHREAD_SUCCESS};
+                                QTHREAD_SUCCESS,
+                                deadline};
 
   pthread_mutex_lock(&args.lock);
   qthread_fork(qthread_feb_blocker_thread, &args, NULL);
@@ -189,10 +260,223 @@ static int qthread_feb_blocker_func(void *dest, void *src, blocker_type t) {
   return args.retval;
 }
 
+static int qthread_feb_blocker_func(void *dest, void *src, blocker_type t) {
+  return qthread_feb_blocker_func_until(dest, src, t, QT_TIMER_NEVER);
+}
+
 #define QTHREAD_CHOOSE_STRIPE2(addr)                                           \
   (qt_hash64((uint64_t)(uintptr_t)addr) & (QTHREAD_LOCKING_STRIPES - 1))
 
 // #define QTHREAD_CHOOSE_STRIPE2(addr) QTHREAD_CHOOSE_STRIPE(addr)
+
+#define QT_FEB_BUCKET(key) \
+  (feb_table +                                                                 \
+   (qt_hash64((uint64_t)(key)) & (feb_table_buckets - 1)) * QT_FEB_WAYS)
+
+static inline qt_feb_slot_t *qt_feb_table_find(uintptr_t const key,
+                                               uintptr_t *w) {
+  qt_feb_slot_t *b = QT_FEB_BUCKET(key);
+
+  for (int i = 0; i < QT_FEB_WAYS; i++) {
+    uintptr_t const v = atomic_load_explicit(&b[i], memory_order_acquire);
+    if (QT_FEB_KEY(v) == key) {
+      *w = v;
+      return &b[i];
+    }
+  }
+  return NULL;
+}
+
+/* Finds key's slot, waiting out BUSY. Returns NULL when key isn't in the
+ * table, with *w set to FULL, or to SLOW if its stripe has overflowed. */
+static inline qt_feb_slot_t *
+qt_feb_table_get(uintptr_t const key, int const lockbin, uintptr_t *w) {
+  do {
+    qt_feb_slot_t *slot = qt_feb_table_find(key, w);
+    if (slot == NULL) {
+      *w = atomic_load_explicit(&feb_overflow[lockbin], memory_order_acquire)
+             ? QT_FEB_SLOW
+             : QT_FEB_FULL;
+      return NULL;
+    }
+    if (QT_FEB_STATE(*w) != QT_FEB_BUSY) { return slot; }
+    SPINLOCK_BODY();
+  } while (1);
+}
+
+/* Hash lock held; key must not already be in the table. FULL slots belong to
+ * nobody, so they are reused as readily as never-used ones. */
+static qt_feb_slot_t *qt_feb_table_claim_locked(uintptr_t const key,
+                                                uintptr_t const state) {
+  qt_feb_slot_t *b = QT_FEB_BUCKET(key);
+
+  for (int i = 0; i < QT_FEB_WAYS; i++) {
+    uintptr_t v = atomic_load_explicit(&b[i], memory_order_relaxed);
+    while (QT_FEB_STATE(v) == QT_FEB_FULL) {
+      if (atomic_compare_exchange_weak_explicit(&b[i],
+                                                &v,
+                                                key | state,
+                                                memory_order_acq_rel,
+                                                memory_order_relaxed)) {
+        return &b[i];
+      }
+    }
+  }
+  return NULL;
+}
+
+/* Gives key a FULL slot so that its state can be flipped with a CAS. Returns
+ * NULL if the address lives in the hash or its bucket is out of room. */
+static qt_feb_slot_t *qt_feb_table_insert(qt_hash bin, uintptr_t const key) {
+  qt_feb_slot_t *slot;
+  uintptr_t w;
+
+  qt_hash_lock(bin);
+  slot = qt_feb_table_find(key, &w);
+  if ((slot == NULL) && (qt_hash_get_locked(bin, (void *)key) == NULL)) {
+    slot = qt_feb_table_claim_locked(key, QT_FEB_FULL);
+  }
+  qt_hash_unlock(bin);
+  return slot;
+}
+
+/* Hash lock held: an addrstat for addr was just put in the hash. */
+static inline void qt_feb_table_put_locked(void const *addr) {
+  uintptr_t const key = (uintptr_t)addr;
+
+  if (!feb_table || (key & QT_FEB_STATE_MASK)) { return; }
+  if (qt_feb_table_claim_locked(key, QT_FEB_SLOW) == NULL) {
+    atomic_fetch_add_explicit(&feb_overflow[QTHREAD_CHOOSE_STRIPE2(addr)],
+                              1,
+                              memory_order_release);
+  }
+}
+
+/* Hash lock held: addr's addrstat was just removed from the hash, full. */
+static inline void qt_feb_table_remove_locked(void const *addr) {
+  uintptr_t const key = (uintptr_t)addr;
+  qt_feb_slot_t *slot;
+  uintptr_t w;
+
+  if (!feb_table || (key & QT_FEB_STATE_MASK)) { return; }
+  slot = qt_feb_table_find(key, &w);
+  if (slot) {
+    assert(QT_FEB_STATE(w) == QT_FEB_SLOW);
+    atomic_store_explicit(slot, key | QT_FEB_FULL, memory_order_release);
+  } else {
+    atomic_fetch_sub_explicit(&feb_overflow[QTHREAD_CHOOSE_STRIPE2(addr)],
+                              1,
+                              memory_order_relaxed);
+  }
+}
+
+/* Locks addr's stripe for the hashed path. If addr still has a FULL or EMPTY
+ * slot, its state is first moved into a fresh addrstat in the hash (and the
+ * slot marked SLOW), so the hashed code sees everything it needs to. */
+static inline void qt_feb_lock_stripe(qt_hash bin, void const *addr) {
+  uintptr_t const key = (uintptr_t)addr;
+
+  qt_hash_lock(bin);
+  if (!feb_table || (key & QT_FEB_STATE_MASK)) { return; }
+  do {
+    uintptr_t w;
+    qt_feb_slot_t *slot = qt_feb_table_find(key, &w);
+
+    if ((slot == NULL) || (QT_FEB_STATE(w) == QT_FEB_SLOW)) { return; }
+    if (QT_FEB_STATE(w) == QT_FEB_BUSY) {
+      qt_hash_unlock(bin);
+      SPINLOCK_BODY();
+      qt_hash_lock(bin);
+      continue;
+    }
+    if (atomic_compare_exchange_strong_explicit(slot,
+                                                &w,
+                                                key | QT_FEB_SLOW,
+                                                memory_order_acq_rel,
+                                                memory_order_acquire)) {
+      qthread_addrstat_t *m = qthread_addrstat_new();
+      m->full = (QT_FEB_STATE(w) == QT_FEB_FULL);
+      qassertnot(qt_hash_put_locked(bin, (void *)key, m), 0);
+      return;
+    }
+  } while (1);
+}
+
+/* The lock-free path for op on addr: returns QTHREAD_SUCCESS/QTHREAD_OPFAIL
+ * if it got done, or QT_FEB_LOCKED if the caller needs the hashed path
+ * (someone has to block, or the address lives in the hash). */
+static inline int qt_feb_table_op(blocker_type const op,
+                                  aligned_t *restrict dest,
+                                  aligned_t const *restrict src,
+                                  void const *addr,
+                                  int const lockbin) {
+  uintptr_t const key = (uintptr_t)addr;
+
+  if (!feb_table || (key & QT_FEB_STATE_MASK)) { return QT_FEB_LOCKED; }
+  do {
+    uintptr_t w, next;
+    qt_feb_slot_t *slot = qt_feb_table_get(key, lockbin, &w);
+
+    if (QT_FEB_STATE(w) == QT_FEB_SLOW) { return QT_FEB_LOCKED; }
+    if (QT_FEB_STATE(w) == QT_FEB_FULL) {
+      switch (op) {
+        case READFF:
+        case READFF_NB:
+          /* Copy without taking the slot, then check that addr is still
+           * full. Only writers change *addr, and they always leave it full,
+           * so whatever was copied was full at some point in between. If it
+           * is not full now, the copy may be a value that was emptied; try
+           * again, which waits out BUSY or takes the locked path. */
+          if (dest && (dest != src)) { *dest = *src; }
+          MACHINE_FENCE;
+          if (qt_feb_table_get(key, lockbin, &next) == NULL) {
+            if (next == QT_FEB_FULL) { return QTHREAD_SUCCESS; }
+          } else if (next == (key | QT_FEB_FULL)) {
+            return QTHREAD_SUCCESS;
+          }
+          continue;
+        case FILL: return QTHREAD_SUCCESS;
+        case WRITEEF: return QT_FEB_LOCKED;
+        case WRITEEF_NB: return QTHREAD_OPFAIL;
+        default: /* READFE, READFE_NB, PURGE, EMPTY, WRITEF, WRITEFF */
+          if (slot == NULL) {
+            if (qt_feb_table_insert(FEBs[lockbin], key) == NULL) {
+              return QT_FEB_LOCKED;
+            }
+            continue;
+          }
+          next = (op == EMPTY) ? QT_FEB_EMPTY : QT_FEB_BUSY;
+          break;
+      }
+    } else {
+      switch (op) {
+        case READFF:
+        case READFE:
+        case WRITEFF: return QT_FEB_LOCKED;
+        case READFF_NB:
+        case READFE_NB: return QTHREAD_OPFAIL;
+        case EMPTY: return QTHREAD_SUCCESS;
+        default: /* WRITEEF, WRITEEF_NB, WRITEF, PURGE, FILL */
+          next = (op == FILL) ? QT_FEB_FULL : QT_FEB_BUSY;
+          break;
+      }
+    }
+    if (!atomic_compare_exchange_strong_explicit(slot,
+                                                 &w,
+                                                 key | next,
+                                                 memory_order_acq_rel,
+                                                 memory_order_relaxed)) {
+      continue;
+    }
+    if (next == QT_FEB_BUSY) {
+      if (dest && (dest != src)) { *dest = *src; }
+      next = (op == READFE || op == READFE_NB || op == PURGE) ? QT_FEB_EMPTY
+                                                              : QT_FEB_FULL;
+      atomic_store_explicit(slot, key | next, memory_order_release);
+    }
+    return QTHREAD_SUCCESS;
+  } while (1);
+}
 /* The lock ordering in these functions is very particular, and is designed to
  * reduce the impact of having only one hashtable. Don't monkey with it unless
  * you REALLY know what you're doing! If one hashtable becomes a problem, we
@@ -210,6 +494,14 @@ int API_FUNC qthread_feb_status(aligned_t const *addr) {
 
   alignedaddr = addr;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  if (feb_table && !((uintptr_t)alignedaddr & QT_FEB_STATE_MASK)) {
+    uintptr_t w;
+
+    qt_feb_table_get((uintptr_t)alignedaddr, lockbin, &w);
+    if (QT_FEB_STATE(w) != QT_FEB_SLOW) {
+      return QT_FEB_STATE(w) == QT_FEB_FULL;
+    }
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     m = qt_hash_get(FEBs[lockbin], (void *)alignedaddr);
@@ -227,7 +519,7 @@ int API_FUNC qthread_feb_status(aligned_t const *addr) {
     break;
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   {
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                  (void *)alignedaddr);
@@ -284,6 +576,7 @@ static inline void qthread_FEB_remove(void *maddr) {
       if ((m->FEQ == NULL) && (m->EFQ == NULL) && (m->FFQ == NULL) &&
           (m->FFWQ == NULL) && (m->full == 1)) {
         qassertnot(qt_hash_remove_locked(FEBs[lockbin], maddr), 0);
+        qt_feb_table_remove_locked(maddr);
       } else {
         QTHREAD_FASTLOCK_UNLOCK(&(m->lock));
         m = NULL;
@@ -302,6 +595,60 @@ static inline void qthread_FEB_remove(void *maddr) {
   }
 }
 
+/* The unlink function of a qthread's timer while it waits on the FEB for
+ * maddr with a timeout (see qt_timers.h): takes t off the FEB's waiter lists,
+ * if whoever filled or emptied it didn't get there first. The addrstat may
+ * have come and gone since t blocked, so it is looked up again. */
+static int qt_feb_timeout(void *maddr, qthread_t *t) {
+  qthread_addrstat_t *m;
+  int const lockbin = QTHREAD_CHOOSE_STRIPE2(maddr);
+  int found = 0;
+  int removeable;
+
+#ifdef LOCK_FREE_FEBS
+  do {
+    m = qt_hash_get(FEBs[lockbin], maddr);
+    if (!m) { return 0; }
+    hazardous_ptr(0, m);
+    if (m != qt_hash_get(FEBs[lockbin], maddr)) { continue; }
+    if (!m->valid) { continue; }
+    QTHREAD_FASTLOCK_LOCK(&m->lock);
+    if (!m->valid) {
+      QTHREAD_FASTLOCK_UNLOCK(&m->lock);
+      continue;
+    }
+    break;
+  } while (1);
+#else  /* ifdef LOCK_FREE_FEBS */
+  qt_hash_lock(FEBs[lockbin]);
+  m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin], maddr);
+  if (m) { QTHREAD_FASTLOCK_LOCK(&m->lock); }
+  qt_hash_unlock(FEBs[lockbin]);
+  if (!m) { return 0; }
+#endif /* ifdef LOCK_FREE_FEBS */
+  {
+    qthread_addrres_t **queues[3] = {&m->FFQ, &m->FEQ, &m->EFQ};
+
+    for (int i = 0; i < 3 && !found; i++) {
+      for (qthread_addrres_t **X = queues[i]; *X; X = &(*X)->next) {
+        if ((*X)->waiter == t) {
+          qthread_addrres_t *const gone = *X;
+
+          *X = gone->next;
+          FREE_ADDRRES(gone);
+          found = 1;
+          break;
+        }
+      }
+    }
+  }
+  removeable = (m->FEQ == NULL) && (m->EFQ == NULL) && (m->FFQ == NULL) &&
+               (m->FFWQ == NULL) && (m->full == 1);
+  QTHREAD_FASTLOCK_UNLOCK(&m->lock);
+  if (removeable) { qthread_FEB_remove(maddr); }
+  return found;
+}
+
 static inline void qthread_precond_launch(qthread_shepherd_t *shep,
                                           qthread_addrres_t *precond_tasks) {
   qthread_addrres_t *precond_tail =
@@ -504,6 +851,10 @@ int API_FUNC qthread_empty(aligned_t const *dest) {
     FEBbin = FEBs[lockbin];
 
     QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+    if (qt_feb_table_op(EMPTY, NULL, NULL, alignedaddr, lockbin) !=
+        QT_FEB_LOCKED) {
+      return QTHREAD_SUCCESS;
+    }
   }
 #ifdef LOCK_FREE_FEBS
   do {
@@ -538,7 +889,7 @@ int API_FUNC qthread_empty(aligned_t const *dest) {
     }
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBbin);
+  qt_feb_lock_stripe(FEBbin, alignedaddr);
   { /* BEGIN CRITICAL SECTION */
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBbin, (void *)alignedaddr);
     if (!m) {
@@ -550,6 +901,7 @@ int API_FUNC qthread_empty(aligned_t const *dest) {
       }
       m->full = 0;
       qassertnot(qt_hash_put_locked(FEBbin, (void *)alignedaddr, m), 0);
+      qt_feb_table_put_locked(alignedaddr);
       m = NULL;
     } else {
       /* it could be either full or not, don't know */
@@ -574,8 +926,12 @@ int API_FUNC qthread_fill(aligned_t const *dest) {
 
   if (!shep) { return qthread_feb_blocker_func((void *)dest, NULL, FILL); }
   alignedaddr = dest;
-  /* lock hash */
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  if (qt_feb_table_op(FILL, NULL, NULL, alignedaddr, lockbin) !=
+      QT_FEB_LOCKED) {
+    return QTHREAD_SUCCESS;
+  }
+  /* lock hash */
 #ifdef LOCK_FREE_FEBS
   do {
     m = qt_hash_get(FEBs[lockbin], (void *)alignedaddr);
@@ -594,7 +950,7 @@ int API_FUNC qthread_fill(aligned_t const *dest) {
     break;
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   { /* BEGIN CRITICAL SECTION */
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                  (void *)alignedaddr);
@@ -627,6 +983,10 @@ int API_FUNC qthread_writeF(aligned_t *dest, aligned_t const *src) {
   if (!shep) { return qthread_feb_blocker_func(dest, (void *)src, WRITEF); }
   alignedaddr = dest;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  if (qt_feb_table_op(WRITEF, dest, src, alignedaddr, lockbin) !=
+      QT_FEB_LOCKED) {
+    return QTHREAD_SUCCESS;
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     qthread_addrstat_t *m2;
@@ -649,7 +1009,7 @@ int API_FUNC qthread_writeF(aligned_t *dest, aligned_t const *src) {
     break;
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   { /* lock hash */
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                  (void *)alignedaddr);
@@ -690,6 +1050,10 @@ int API_FUNC qthread_purge_to(aligned_t *restrict dest,
     FEBbin = FEBs[lockbin];
 
     QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+    if (qt_feb_table_op(PURGE, dest, src, alignedaddr, lockbin) !=
+        QT_FEB_LOCKED) {
+      return QTHREAD_SUCCESS;
+    }
   }
 #ifdef LOCK_FREE_FEBS
   do {
@@ -724,7 +1088,7 @@ int API_FUNC qthread_purge_to(aligned_t *restrict dest,
     }
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBbin);
+  qt_feb_lock_stripe(FEBbin, alignedaddr);
   { /* BEGIN CRITICAL SECTION */
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBbin, (void *)alignedaddr);
     if (!m) {
@@ -736,6 +1100,7 @@ int API_FUNC qthread_purge_to(aligned_t *restrict dest,
       }
       m->full = 0;
       qassertnot(qt_hash_put_locked(FEBbin, (void *)alignedaddr, m), 0);
+      qt_feb_table_put_locked(alignedaddr);
       m = NULL;
     } else {
       /* it could be either full or not, don't know */
@@ -764,8 +1129,9 @@ int API_FUNC qthread_purge(aligned_t *dest) {
  * 3 - the destination's FEB state gets changed from empty to full
  */
 
-int API_FUNC qthread_writeEF(aligned_t *restrict dest,
-                             aligned_t const *restrict src) {
+static inline int qt_feb_writeEF(aligned_t *restrict dest,
+                                 aligned_t const *restrict src,
+                                 uint64_t const deadline) {
   aligned_t *alignedaddr;
 
   qthread_addrstat_t *m;
@@ -775,9 +1141,16 @@ int API_FUNC qthread_writeEF(aligned_t *restrict dest,
 
   assert(qthread_library_initialized);
 
-  if (!me) { return qthread_feb_blocker_func(dest, (void *)src, WRITEEF); }
+  if (!me) {
+    return qthread_feb_blocker_func_until(
+      dest, (void *)src, WRITEEF, deadline);
+  }
   alignedaddr = dest;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  {
+    int const ret = qt_feb_table_op(WRITEEF, dest, src, alignedaddr, lockbin);
+    if (ret != QT_FEB_LOCKED) { return ret; }
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     m = qt_hash_get(FEBs[lockbin], (void *)alignedaddr);
@@ -815,7 +1188,7 @@ int API_FUNC qthread_writeEF(aligned_t *restrict dest,
     }
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   {
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                  (void *)alignedaddr);
@@ -826,6 +1199,7 @@ int API_FUNC qthread_writeEF(aligned_t *restrict dest,
         return QTHREAD_MALLOC_ERROR;
       }
       qassertnot(qt_hash_put_locked(FEBs[lockbin], alignedaddr, m), 0);
+      qt_feb_table_put_locked(alignedaddr);
     }
     QTHREAD_FASTLOCK_LOCK(&(m->lock));
   }
@@ -843,6 +1217,9 @@ int API_FUNC qthread_writeEF(aligned_t *restrict dest,
     X->waiter = me;
     X->next = m->EFQ;
     m->EFQ = X;
+    if (deadline != QT_TIMER_NEVER) {
+      qt_timer_arm(me, deadline, qt_feb_timeout, alignedaddr);
+    }
     atomic_store_explicit(
       &me->thread_state, QTHREAD_STATE_FEB_BLOCKED, memory_order_relaxed);
     me->rdata->blockedon.addr = m;
@@ -850,6 +1227,9 @@ int API_FUNC qthread_writeEF(aligned_t *restrict dest,
     MACHINE_FENCE;
 #endif
     qthread_back_to_master(me);
+    if ((deadline != QT_TIMER_NEVER) && qt_timer_disarm(me)) {
+      return QTHREAD_TIMEOUT;
+    }
   } else {
     if (dest && (dest != src)) { *(aligned_t *)dest = *(aligned_t *)src; }
     MACHINE_FENCE;
@@ -858,6 +1238,17 @@ int API_FUNC qthread_writeEF(aligned_t *restrict dest,
   return QTHREAD_SUCCESS;
 }
 
+int API_FUNC qthread_writeEF(aligned_t *restrict dest,
+                             aligned_t const *restrict src) {
+  return qt_feb_writeEF(dest, src, QT_TIMER_NEVER);
+}
+
+int API_FUNC qthread_writeEF_timed(aligned_t *restrict dest,
+                                   aligned_t const *restrict src,
+                                   uint64_t timeout_ns) {
+  return qt_feb_writeEF(dest, src, qt_timer_deadline(timeout_ns));
+}
+
 int API_FUNC qthread_writeEF_const(aligned_t *dest, aligned_t src) {
   return qthread_writeEF(dest, &src);
 }
@@ -873,6 +1264,11 @@ int API_FUNC qthread_writeEF_nb(aligned_t *restrict dest,
   if (!me) { return qthread_feb_blocker_func(dest, (void *)src, WRITEEF); }
   alignedaddr = dest;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  {
+    int const ret =
+      qt_feb_table_op(WRITEEF_NB, dest, src, alignedaddr, lockbin);
+    if (ret != QT_FEB_LOCKED) { return ret; }
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     m = qt_hash_get(FEBs[lockbin], (void *)alignedaddr);
@@ -890,7 +1286,7 @@ int API_FUNC qthread_writeEF_nb(aligned_t *restrict dest,
     }
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   {
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                  (void *)alignedaddr);
@@ -932,6 +1328,10 @@ int API_FUNC qthread_writeFF(aligned_t *restrict dest,
   if (!me) { return qthread_feb_blocker_func(dest, (void *)src, WRITEFF); }
   alignedaddr = dest;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  {
+    int const ret = qt_feb_table_op(WRITEFF, dest, src, alignedaddr, lockbin);
+    if (ret != QT_FEB_LOCKED) { return ret; }
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     m = qt_hash_get(FEBs[lockbin], (void *)alignedaddr);
@@ -947,7 +1347,7 @@ int API_FUNC qthread_writeFF(aligned_t *restrict dest,
     break;
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   {
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                  (void *)alignedaddr);
@@ -993,8 +1393,9 @@ int API_FUNC qthread_writeFF_const(aligned_t *dest, aligned_t src) {
  * 2 - data is copied from src to destination
  */
 
-int API_FUNC qthread_readFF(aligned_t *restrict dest,
-                            aligned_t const *restrict src) {
+static inline int qt_feb_readFF(aligned_t *restrict dest,
+                                aligned_t const *restrict src,
+                                uint64_t const deadline) {
   aligned_t const *alignedaddr;
 
   qthread_addrstat_t *m = NULL;
@@ -1004,9 +1405,15 @@ int API_FUNC qthread_readFF(aligned_t *restrict dest,
 
   assert(qthread_library_initialized);
 
-  if (!me) { return qthread_feb_blocker_func(dest, (void *)src, READFF); }
+  if (!me) {
+    return qthread_feb_blocker_func_until(dest, (void *)src, READFF, deadline);
+  }
   alignedaddr = src;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  {
+    int const ret = qt_feb_table_op(READFF, dest, src, alignedaddr, lockbin);
+    if (ret != QT_FEB_LOCKED) { return ret; }
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     m = qt_hash_get(FEBs[lockbin], (void *)alignedaddr);
@@ -1022,7 +1429,7 @@ int API_FUNC qthread_readFF(aligned_t *restrict dest,
     break;
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   {
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                  (void *)alignedaddr);
@@ -1044,6 +1451,9 @@ int API_FUNC qthread_readFF(aligned_t *restrict dest,
     X->waiter = me;
     X->next = m->FFQ;
     m->FFQ = X;
+    if (deadline != QT_TIMER_NEVER) {
+      qt_timer_arm(me, deadline, qt_feb_timeout, (void *)alignedaddr);
+    }
     atomic_store_explicit(
       &me->thread_state, QTHREAD_STATE_FEB_BLOCKED, memory_order_relaxed);
     me->rdata->blockedon.addr = m;
@@ -1051,6 +1461,9 @@ int API_FUNC qthread_readFF(aligned_t *restrict dest,
 #ifndef QTHREAD_SWAPS_IMPLY_ACQ_REL_FENCES
     MACHINE_FENCE;
 #endif
+    if ((deadline != QT_TIMER_NEVER) && qt_timer_disarm(me)) {
+      return QTHREAD_TIMEOUT;
+    }
   } else { /* exists AND is empty... weird, but that's life */
     MACHINE_FENCE;
     if (dest && (dest != src)) { *(aligned_t *)dest = *(aligned_t *)src; }
@@ -1059,6 +1472,17 @@ int API_FUNC qthread_readFF(aligned_t *restrict dest,
   return QTHREAD_SUCCESS;
 }
 
+int API_FUNC qthread_readFF(aligned_t *restrict dest,
+                            aligned_t const *restrict src) {
+  return qt_feb_readFF(dest, src, QT_TIMER_NEVER);
+}
+
+int API_FUNC qthread_readFF_timed(aligned_t *restrict dest,
+                                  aligned_t const *restrict src,
+                                  uint64_t timeout_ns) {
+  return qt_feb_readFF(dest, src, qt_timer_deadline(timeout_ns));
+}
+
 int API_FUNC qthread_readFF_nb(aligned_t *restrict dest,
                                aligned_t const *restrict src) {
   aligned_t const *alignedaddr;
@@ -1070,6 +1494,10 @@ int API_FUNC qthread_readFF_nb(aligned_t *restrict dest,
   if (!me) { return qthread_feb_blocker_func(dest, (void *)src, READFF_NB); }
   alignedaddr = src;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  {
+    int const ret = qt_feb_table_op(READFF_NB, dest, src, alignedaddr, lockbin);
+    if (ret != QT_FEB_LOCKED) { return ret; }
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     qthread_addrstat_t *m2;
@@ -1090,7 +1518,7 @@ int API_FUNC qthread_readFF_nb(aligned_t *restrict dest,
     break;
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   {
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                  (void *)alignedaddr);
@@ -1119,8 +1547,9 @@ int API_FUNC qthread_readFF_nb(aligned_t *restrict dest,
  * 3 - the src's FEB bits get changed from full to empty
  */
 
-int API_FUNC qthread_readFE(aligned_t *restrict dest,
-                            aligned_t const *restrict src) {
+static inline int qt_feb_readFE(aligned_t *restrict dest,
+                                aligned_t const *restrict src,
+                                uint64_t const deadline) {
   aligned_t const *alignedaddr;
 
   qthread_addrstat_t *m;
@@ -1129,10 +1558,16 @@ int API_FUNC qthread_readFE(aligned_t *restrict dest,
 
   assert(qthread_library_initialized);
 
-  if (!me) { return qthread_feb_blocker_func(dest, (void *)src, READFE); }
+  if (!me) {
+    return qthread_feb_blocker_func_until(dest, (void *)src, READFE, deadline);
+  }
   assert(me->rdata);
   alignedaddr = src;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  {
+    int const ret = qt_feb_table_op(READFE, dest, src, alignedaddr, lockbin);
+    if (ret != QT_FEB_LOCKED) { return ret; }
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     m = qt_hash_get(FEBs[lockbin], alignedaddr);
@@ -1166,7 +1601,7 @@ int API_FUNC qthread_readFE(aligned_t *restrict dest,
     }
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   {
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin], alignedaddr);
     if (!m) {
@@ -1176,6 +1611,7 @@ int API_FUNC qthread_readFE(aligned_t *restrict dest,
         return QTHREAD_MALLOC_ERROR;
       }
       qassertnot(qt_hash_put_locked(FEBs[lockbin], alignedaddr, m), 0);
+      qt_feb_table_put_locked(alignedaddr);
     }
     QTHREAD_FASTLOCK_LOCK(&(m->lock));
   }
@@ -1194,6 +1630,9 @@ int API_FUNC qthread_readFE(aligned_t *restrict dest,
     X->waiter = me;
     X->next = m->FEQ;
     m->FEQ = X;
+    if (deadline != QT_TIMER_NEVER) {
+      qt_timer_arm(me, deadline, qt_feb_timeout, (void *)alignedaddr);
+    }
     atomic_store_explicit(
       &me->thread_state, QTHREAD_STATE_FEB_BLOCKED, memory_order_relaxed);
     /* so that the shepherd will unlock it */
@@ -1202,6 +1641,9 @@ int API_FUNC qthread_readFE(aligned_t *restrict dest,
 #ifndef QTHREAD_SWAPS_IMPLY_ACQ_REL_FENCES
     MACHINE_FENCE;
 #endif
+    if ((deadline != QT_TIMER_NEVER) && qt_timer_disarm(me)) {
+      return QTHREAD_TIMEOUT;
+    }
   } else { /* full, thus IT IS OURS! MUAHAHAHA! */
     MACHINE_FENCE;
     if (dest && (dest != src)) { *(aligned_t *)dest = *(aligned_t *)src; }
@@ -1210,6 +1652,17 @@ int API_FUNC qthread_readFE(aligned_t *restrict dest,
   return QTHREAD_SUCCESS;
 }
 
+int API_FUNC qthread_readFE(aligned_t *restrict dest,
+                            aligned_t const *restrict src) {
+  return qt_feb_readFE(dest, src, QT_TIMER_NEVER);
+}
+
+int API_FUNC qthread_readFE_timed(aligned_t *restrict dest,
+                                  aligned_t const *restrict src,
+                                  uint64_t timeout_ns) {
+  return qt_feb_readFE(dest, src, qt_timer_deadline(timeout_ns));
+}
+
 /* the way this works is that:
  * 1 - src's FEB state is ignored
  * 2 - data is copied from src to destination
@@ -1234,6 +1687,10 @@ int API_FUNC qthread_readFE_nb(aligned_t *restrict dest,
   if (!me) { return qthread_feb_blocker_func(dest, (void *)src, READFE_NB); }
   alignedaddr = src;
   QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+  {
+    int const ret = qt_feb_table_op(READFE_NB, dest, src, alignedaddr, lockbin);
+    if (ret != QT_FEB_LOCKED) { return ret; }
+  }
 #ifdef LOCK_FREE_FEBS
   do {
     m = qt_hash_get(FEBs[lockbin], alignedaddr);
@@ -1262,7 +1719,7 @@ int API_FUNC qthread_readFE_nb(aligned_t *restrict dest,
     }
   } while (1);
 #else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(FEBs[lockbin]);
+  qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
   {
     m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin], alignedaddr);
     if (!m) {
@@ -1272,6 +1729,7 @@ int API_FUNC qthread_readFE_nb(aligned_t *restrict dest,
         return QTHREAD_MALLOC_ERROR;
       }
       qassertnot(qt_hash_put_locked(FEBs[lockbin], alignedaddr, m), 0);
+      qt_feb_table_put_locked(alignedaddr);
     }
     QTHREAD_FASTLOCK_LOCK(&(m->lock));
   }
@@ -1322,6 +1780,12 @@ int INTERNAL qthread_check_feb_preconds(qthread_t *t) {
 
     alignedaddr = this_sync;
     QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
+    if (qt_feb_table_op(READFF_NB, NULL, NULL, alignedaddr, lockbin) ==
+        QTHREAD_SUCCESS) {
+      /* already full! */
+      these_preconds[0] = (aligned_t *)(((uintptr_t)these_preconds[0]) - 1);
+      continue;
+    }
 #ifdef LOCK_FREE_FEBS
     do {
       m = qt_hash_get(FEBs[lockbin], (void *)alignedaddr);
@@ -1337,7 +1801,7 @@ int INTERNAL qthread_check_feb_preconds(qthread_t *t) {
       break;
     } while (1);
 #else                /* ifdef LOCK_FREE_FEBS */
-    qt_hash_lock(FEBs[lockbin]);
+    qt_feb_lock_stripe(FEBs[lockbin], alignedaddr);
     {
       m = (qthread_addrstat_t *)qt_hash_get_locked(FEBs[lockbin],
                                                    (void *)alignedaddr);
@@ -1401,19 +1865,9 @@ static filter_code qt_feb_tf_call_cb(qt_key_t const addr,
   void *tls;
 
   if (waiter->rdata->tasklocal_size <= qlib->qthread_tasklocal_size) {
-    if (atomic_load_explicit(&waiter->flags, memory_order_relaxed) &
-        QTHREAD_BIG_STRUCT) {
-      tls = &waiter->data[qlib->qthread_argcopy_size];
-    } else {
-      tls = waiter->data;
-    }
+    tls = waiter->data;
   } else {
-    if (atomic_load_explicit(&waiter->flags, memory_order_relaxed) &
-        QTHREAD_BIG_STRUCT) {
-      tls = *(void **)&waiter->data[qlib->qthread_argcopy_size];
-    } else {
-      tls = *(void **)&waiter->data[0];
-    }
+    tls = *(void **)&waiter->data[0];
   }
   f((void *)addr,
     waiter->f,
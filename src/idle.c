@@ -0,0 +1,142 @@
+/* System Headers */
+#include <stdalign.h>
+#include <time.h> /* for clock_gettime() */
+
+/* Internal Headers */
+#include "qt_asserts.h"
+#include "qt_envariables.h"
+#include "qt_idle.h"
+#include "qt_shepherd_innards.h"
+#include "qt_timers.h"
+#include "qthread_innards.h" /* for qlib */
+
+int qt_idle_parking = 0;
+alignas(CACHELINE_WIDTH) _Atomic uint32_t qt_idle_nparked = 0;
+
+/* bounds on each worker's spin budget, in ns */
+static uint64_t idle_spin_max = 0;
+static uint64_t idle_spin_min = 0;
+
+static inline uint64_t qt_idle_now(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+void INTERNAL qt_idle_subsystem_init(void) {
+  qt_idle_parking = qt_internal_get_env_bool("IDLE_PARK", 1);
+  idle_spin_max = qt_internal_get_env_num("IDLE_SPIN", 100, 100) * 1000;
+  idle_spin_min = idle_spin_max / 64;
+  if (idle_spin_min == 0) { idle_spin_min = 1; }
+}
+
+void INTERNAL qt_idle_init(qt_idle_t *idle) {
+  atomic_init(&idle->epoch, 0);
+  atomic_init(&idle->parked, 0);
+}
+
+void INTERNAL qt_idle_wake(qt_idle_t *idle) {
+  atomic_fetch_add_explicit(&idle->epoch, 1, memory_order_seq_cst);
+  qt_wake_one(&idle->epoch);
+}
+
+/* the task just published can be stolen: if nobody is parked on its own
+ * queue, wake a worker parked anywhere else to come and take it */
+void INTERNAL qt_idle_wake_thief(qt_idle_t *idle) {
+  if (atomic_load_explicit(&idle->parked, memory_order_relaxed)) {
+    qt_idle_wake(idle);
+    return;
+  }
+  for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds; i++) {
+    qt_idle_t *other = qt_threadqueue_idle(qlib->shepherds[i].ready);
+    if (atomic_load_explicit(&other->parked, memory_order_relaxed)) {
+      qt_idle_wake(other);
+      return;
+    }
+  }
+}
+
+/* for tasks only one particular worker may run */
+void INTERNAL qt_idle_wake_all(void) {
+  if (!qt_idle_parking) { return; }
+  atomic_thread_fence(memory_order_seq_cst);
+  if (!atomic_load_explicit(&qt_idle_nparked, memory_order_relaxed)) { return; }
+  for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds; i++) {
+    qt_idle_t *idle = qt_threadqueue_idle(qlib->shepherds[i].ready);
+    if (atomic_load_explicit(&idle->parked, memory_order_relaxed)) {
+      atomic_fetch_add_explicit(&idle->epoch, 1, memory_order_seq_cst);
+      qt_wake_all(&idle->epoch);
+    }
+  }
+}
+
+int INTERNAL qt_idle_due(uint64_t *since) {
+  qthread_worker_t *me;
+  uint64_t now;
+
+  if (!qt_idle_parking) { return 0; }
+  now = qt_idle_now();
+  if (*since == 0) {
+    *since = now;
+    return 0;
+  }
+  me = qthread_internal_getworker();
+  assert(me);
+  if (me->idle_spin == 0) { me->idle_spin = idle_spin_max; }
+  return now - *since >= me->idle_spin;
+}
+
+void INTERNAL qt_idle_park(qt_idle_t *idle,
+                           uint64_t *since,
+                           qt_idle_check_f check,
+                           void *arg) {
+  qthread_worker_t *me = qthread_internal_getworker();
+  uint64_t const now = qt_idle_now();
+  uint64_t slept, limit;
+  uint32_t epoch;
+
+  /* The epoch is read before we count ourselves as parked, so a wake-up
+   * issued after an enqueuer sees the count changes it and keeps us from
+   * sleeping; and the check runs after, so anything published before the
+   * enqueuer looked at the count is seen here. */
+  epoch = atomic_load_explicit(&idle->epoch, memory_order_seq_cst);
+  atomic_fetch_add_explicit(&idle->parked, 1, memory_order_seq_cst);
+  atomic_fetch_add_explicit(&qt_idle_nparked, 1, memory_order_seq_cst);
+  atomic_thread_fence(memory_order_seq_cst);
+  /* nobody else fires this worker's timers, so it wakes up for them */
+  limit = qt_timer_park_ns(me);
+  if (!check(arg) && limit > 0) {
+    if (limit == QT_TIMER_NEVER) {
+      qt_wait_on_address(&idle->epoch, epoch);
+    } else {
+      qt_wait_on_address_for(&idle->epoch, epoch, limit);
+    }
+  }
+  atomic_fetch_sub_explicit(&qt_idle_nparked, 1, memory_order_relaxed);
+  atomic_fetch_sub_explicit(&idle->parked, 1, memory_order_relaxed);
+
+  slept = qt_idle_now() - now;
+  if (limit != QT_TIMER_NEVER) {
+    /* cut short by a timer: says nothing about how long to spin */
+  } else if (slept < me->idle_spin) {
+    /* spinning a little longer would have saved the round trip */
+    me->idle_spin *= 2;
+    if (me->idle_spin > idle_spin_max) { me->idle_spin = idle_spin_max; }
+  } else if (slept > 16 * me->idle_spin) {
+    me->idle_spin /= 2;
+    if (me->idle_spin < idle_spin_min) { me->idle_spin = idle_spin_min; }
+  }
+  *since = 0;
+}
+
+int INTERNAL qt_idle_round(qt_idle_t *idle,
+                           uint64_t *since,
+                           qt_idle_check_f check,
+                           void *arg) {
+  if (!qt_idle_due(since)) { return 0; }
+  qt_idle_park(idle, since, check, arg);
+  return 1;
+}
+
+/* vim:set expandtab: */
@@ -24,8 +24,14 @@
 #include <sys/resource.h>
 #include <sys/time.h>
 #include <sys/wait.h>
+#ifdef QTHREAD_USE_IO_URING
+/* - io_uring(7) */
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#endif
 
 /* Internal Headers */
+#include "qt_alloc.h"
 #include "qt_asserts.h"
 #include "qt_envariables.h"
 #include "qt_io.h"
@@ -54,6 +60,300 @@ static unsigned long timeout = DEFAULT_TIMEOUT; // in microseconds
 static int _Atomic proxy_exit = 0;
 TLS_DECL_INIT(qthread_t *, IO_task_struct);
 
+#ifdef QTHREAD_USE_IO_URING
+/* The io_uring engine: each shepherd owns a submission/completion ring pair.
+ * Syscall jobs that the kernel can perform asynchronously are submitted as
+ * SQEs by the worker that parked the qthread, and completions are reaped by
+ * whichever worker of that shepherd next passes through the scheduler (see
+ * qt_blocking_subsystem_poll()). Everything else, and every job issued while
+ * the engine is unavailable, goes to the proxy pool below. */
+typedef struct {
+  int fd;
+  unsigned sq_entries;
+  unsigned cq_entries;
+  QTHREAD_FASTLOCK_TYPE sq_lock;
+  QTHREAD_TRYLOCK_TYPE cq_lock;
+  /* ring pointers, shared with the kernel */
+  _Atomic unsigned *sq_head;
+  _Atomic unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+  _Atomic unsigned *cq_head;
+  _Atomic unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+  /* mappings, for teardown */
+  void *ring_ptr;
+  size_t ring_sz;
+  size_t sqes_sz;
+  /* submitted but not yet reaped; bounded by cq_entries so the CQ can never
+   * overflow */
+  _Atomic unsigned inflight;
+} qt_io_ring_t;
+
+static qt_io_ring_t *io_rings = NULL;
+static qthread_shepherd_id_t io_ring_count = 0;
+static uint8_t io_ring_ops[IORING_OP_LAST];
+static int _Atomic io_ring_exit = 0;
+int qt_io_uring_active = 0;
+
+static inline int qt_io_uring_setup(unsigned entries,
+                                    struct io_uring_params *p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int qt_io_uring_enter(int fd, unsigned to_submit) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, 0, 0, NULL, 0);
+}
+
+static int qt_io_ring_init(qt_io_ring_t *r, unsigned entries) {
+  struct io_uring_params p;
+  char *sq_ptr, *cq_ptr;
+
+  memset(&p, 0, sizeof(p));
+  r->fd = qt_io_uring_setup(entries, &p);
+  if (r->fd < 0) { return -1; }
+  /* older kernels map the SQ and CQ rings separately; only the single-mmap
+   * layout (5.4+) is supported, everything older uses the proxy pool */
+  if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+    close(r->fd);
+    r->fd = -1;
+    return -1;
+  }
+  r->sq_entries = p.sq_entries;
+  r->cq_entries = p.cq_entries;
+  r->ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  if (r->ring_sz < p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe)) {
+    r->ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  }
+  r->ring_ptr = mmap(NULL,
+                     r->ring_sz,
+                     PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE,
+                     r->fd,
+                     IORING_OFF_SQ_RING);
+  if (r->ring_ptr == MAP_FAILED) {
+    close(r->fd);
+    r->fd = -1;
+    return -1;
+  }
+  r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+  r->sqes = mmap(NULL,
+                 r->sqes_sz,
+                 PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE,
+                 r->fd,
+                 IORING_OFF_SQES);
+  if (r->sqes == MAP_FAILED) {
+    munmap(r->ring_ptr, r->ring_sz);
+    close(r->fd);
+    r->fd = -1;
+    return -1;
+  }
+  sq_ptr = cq_ptr = r->ring_ptr;
+  r->sq_head = (_Atomic unsigned *)(sq_ptr + p.sq_off.head);
+  r->sq_tail = (_Atomic unsigned *)(sq_ptr + p.sq_off.tail);
+  r->sq_mask = (unsigned *)(sq_ptr + p.sq_off.ring_mask);
+  r->sq_array = (unsigned *)(sq_ptr + p.sq_off.array);
+  r->cq_head = (_Atomic unsigned *)(cq_ptr + p.cq_off.head);
+  r->cq_tail = (_Atomic unsigned *)(cq_ptr + p.cq_off.tail);
+  r->cq_mask = (unsigned *)(cq_ptr + p.cq_off.ring_mask);
+  r->cqes = (struct io_uring_cqe *)(cq_ptr + p.cq_off.cqes);
+  QTHREAD_FASTLOCK_INIT(r->sq_lock);
+  QTHREAD_TRYLOCK_INIT(r->cq_lock);
+  atomic_store_explicit(&r->inflight, 0, memory_order_relaxed);
+  return 0;
+}
+
+static void qt_io_ring_destroy(qt_io_ring_t *r) {
+  if (r->fd < 0) { return; }
+  munmap(r->sqes, r->sqes_sz);
+  munmap(r->ring_ptr, r->ring_sz);
+  close(r->fd);
+  r->fd = -1;
+}
+
+/* Ask the kernel which opcodes it implements; IORING_OP_READ and friends
+ * only appeared in 5.6, so a ring on its own is not enough. */
+static int qt_io_ring_probe(qt_io_ring_t *r) {
+  size_t len = sizeof(struct io_uring_probe) +
+               IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+  struct io_uring_probe *probe = qt_calloc(1, len);
+  int ret;
+
+  assert(probe);
+  ret = (int)syscall(
+    __NR_io_uring_register, r->fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST);
+  if (ret == 0) {
+    for (unsigned i = 0; i < probe->ops_len && i < IORING_OP_LAST; i++) {
+      io_ring_ops[i] = (probe->ops[i].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+  }
+  qt_free(probe);
+  return ret;
+}
+
+static void qt_io_uring_init(void) {
+  unsigned entries;
+
+  if (!qt_internal_get_env_bool("IO_URING", 1)) { return; }
+  entries = (unsigned)qt_internal_get_env_num("IO_URING_ENTRIES", 256, 1);
+  io_ring_count = qlib->nshepherds;
+  io_rings = qt_calloc(io_ring_count, sizeof(qt_io_ring_t));
+  assert(io_rings);
+  for (qthread_shepherd_id_t i = 0; i < io_ring_count; i++) {
+    io_rings[i].fd = -1;
+  }
+  for (qthread_shepherd_id_t i = 0; i < io_ring_count; i++) {
+    if (qt_io_ring_init(&io_rings[i], entries) != 0) { goto fallback; }
+  }
+  if (qt_io_ring_probe(&io_rings[0]) != 0) { goto fallback; }
+  atomic_store_explicit(&io_ring_exit, 0, memory_order_relaxed);
+  qt_io_uring_active = 1;
+  return;
+
+fallback:
+  for (qthread_shepherd_id_t i = 0; i < io_ring_count; i++) {
+    qt_io_ring_destroy(&io_rings[i]);
+  }
+  qt_free(io_rings);
+  io_rings = NULL;
+  io_ring_count = 0;
+}
+
+static void qt_io_uring_complete(qt_blocking_queue_node_t *job, int res) {
+  if (res < 0) {
+    job->ret = -1;
+    job->err = -res;
+  } else {
+    job->ret = res;
+    job->err = 0;
+  }
+  qt_threadqueue_enqueue(job->thread->rdata->shepherd_ptr->ready, job->thread);
+}
+
+/* Returns 1 if the job now belongs to the ring, 0 if the caller should hand
+ * it to the proxy pool instead. */
+static int qt_io_uring_submit(qt_blocking_queue_node_t *job) {
+  qthread_shepherd_t *shep = qthread_internal_getshep();
+  qt_io_ring_t *r;
+  struct io_uring_sqe *sqe;
+  unsigned tail, idx;
+  uint8_t opcode;
+  int fd, ret;
+
+  switch (job->op) {
+    case READ:
+    case PREAD: opcode = IORING_OP_READ; break;
+    case WRITE:
+    case PWRITE: opcode = IORING_OP_WRITE; break;
+    case ACCEPT: opcode = IORING_OP_ACCEPT; break;
+    case CONNECT: opcode = IORING_OP_CONNECT; break;
+    default: return 0;
+  }
+  /* the SQE length field is 32 bits wide */
+  if (!io_ring_ops[opcode] || shep == NULL ||
+      (uint64_t)job->args[2] > UINT32_MAX) {
+    return 0;
+  }
+  r = &io_rings[shep->shepherd_id];
+
+  QTHREAD_FASTLOCK_LOCK(&r->sq_lock);
+  tail = atomic_load_explicit(r->sq_tail, memory_order_relaxed);
+  if ((atomic_load_explicit(&r->inflight, memory_order_relaxed) >=
+       r->cq_entries) ||
+      (tail - atomic_load_explicit(r->sq_head, memory_order_acquire) >=
+       r->sq_entries)) {
+    QTHREAD_FASTLOCK_UNLOCK(&r->sq_lock);
+    return 0;
+  }
+  idx = tail & *r->sq_mask;
+  sqe = &r->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  memcpy(&fd, &job->args[0], sizeof(int));
+  sqe->fd = fd;
+  sqe->user_data = (uint64_t)(uintptr_t)job;
+  switch (job->op) {
+    case READ:
+    case WRITE:
+      sqe->addr = (uint64_t)job->args[1];
+      sqe->len = (uint32_t)job->args[2];
+      sqe->off = (uint64_t)-1; /* use (and advance) the file position */
+      break;
+    case PREAD:
+    case PWRITE: {
+      off_t offset;
+      memcpy(&offset, &job->args[3], sizeof(off_t));
+      sqe->addr = (uint64_t)job->args[1];
+      sqe->len = (uint32_t)job->args[2];
+      sqe->off = (uint64_t)offset;
+      break;
+    }
+    case ACCEPT:
+      sqe->addr = (uint64_t)job->args[1];
+      sqe->addr2 = (uint64_t)job->args[2];
+      break;
+    case CONNECT:
+      sqe->addr = (uint64_t)job->args[1];
+      sqe->off = (uint64_t)(socklen_t)job->args[2];
+      break;
+    default: break;
+  }
+  r->sq_array[idx] = idx;
+  atomic_store_explicit(r->sq_tail, tail + 1, memory_order_release);
+  atomic_fetch_add_explicit(&r->inflight, 1, memory_order_relaxed);
+  do {
+    ret = qt_io_uring_enter(r->fd, 1);
+  } while (ret < 0 && (errno == EINTR || errno == EAGAIN || errno == EBUSY));
+  QTHREAD_FASTLOCK_UNLOCK(&r->sq_lock);
+  if (ret < 0) {
+    perror("qt_blocking_subsystem_enqueue: io_uring_enter() failed");
+    abort();
+  }
+  return 1;
+}
+
+int INTERNAL qt_blocking_subsystem_poll(qthread_shepherd_t *shep) {
+  qt_io_ring_t *r;
+  unsigned head, tail;
+  int reaped = 0;
+
+  if (!qt_io_uring_active || shep == NULL ||
+      atomic_load_explicit(&io_ring_exit, memory_order_relaxed)) {
+    return 0;
+  }
+  r = &io_rings[shep->shepherd_id];
+  if (atomic_load_explicit(&r->inflight, memory_order_relaxed) == 0) {
+    return 0;
+  }
+  if (!QTHREAD_TRYLOCK_TRY(&r->cq_lock)) { return 0; }
+  head = atomic_load_explicit(r->cq_head, memory_order_relaxed);
+  tail = atomic_load_explicit(r->cq_tail, memory_order_acquire);
+  while (head != tail) {
+    struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+    qt_blocking_queue_node_t *job =
+      (qt_blocking_queue_node_t *)(uintptr_t)cqe->user_data;
+    int res = cqe->res;
+
+    head++;
+    atomic_store_explicit(r->cq_head, head, memory_order_release);
+    atomic_fetch_sub_explicit(&r->inflight, 1, memory_order_relaxed);
+    qt_io_uring_complete(job, res);
+    reaped++;
+  }
+  QTHREAD_TRYLOCK_UNLOCK(&r->cq_lock);
+  return reaped;
+}
+
+int INTERNAL qt_blocking_subsystem_pending(qthread_shepherd_t *shep) {
+  if (!qt_io_uring_active || shep == NULL) { return 0; }
+  return atomic_load_explicit(&io_rings[shep->shepherd_id].inflight,
+                              memory_order_relaxed) != 0;
+}
+#endif /* ifdef QTHREAD_USE_IO_URING */
+
 static void qt_blocking_subsystem_internal_stopwork(void) {
   atomic_store_explicit(&proxy_exit, 1, memory_order_relaxed);
   MACHINE_FENCE;
@@ -61,9 +361,25 @@ static void qt_blocking_subsystem_internal_stopwork(void) {
     SPINLOCK_BODY();
   QTHREAD_LOCK(&theQueue.lock);
   QTHREAD_UNLOCK(&theQueue.lock);
+#ifdef QTHREAD_USE_IO_URING
+  /* stop reaping; anything still in flight belongs to a qthread that will
+   * never be resumed, same as a job abandoned by an exiting proxy thread */
+  atomic_store_explicit(&io_ring_exit, 1, memory_order_relaxed);
+#endif
 }
 
 static void qt_blocking_subsystem_internal_freemem(void) {
+#ifdef QTHREAD_USE_IO_URING
+  if (qt_io_uring_active) {
+    for (qthread_shepherd_id_t i = 0; i < io_ring_count; i++) {
+      qt_io_ring_destroy(&io_rings[i]);
+    }
+    qt_free(io_rings);
+    io_rings = NULL;
+    io_ring_count = 0;
+    qt_io_uring_active = 0;
+  }
+#endif
   qt_mpool_destroy(syscall_job_pool);
   QTHREAD_DESTROYLOCK(&theQueue.lock);
   QTHREAD_DESTROYCOND(&theQueue.notempty);
@@ -104,6 +420,9 @@ void INTERNAL qt_blocking_subsystem_init(void) {
   TLS_INIT(IO_task_struct);
   qassert(pthread_mutex_init(&theQueue.lock, NULL), 0);
   qassert(pthread_cond_init(&theQueue.notempty, NULL), 0);
+#ifdef QTHREAD_USE_IO_URING
+  qt_io_uring_init();
+#endif
   /* thread(s) must be stopped *before* shepherds die, to keep them from
    * trying to push orphan threads into shepherd queues */
   qthread_internal_cleanup_early(qt_blocking_subsystem_internal_stopwork);
@@ -229,6 +548,7 @@ int INTERNAL qt_process_blocking_call(void) {
     case WRITE:
       item->ret = write(
         (int)item->args[0], (void const *)item->args[1], (size_t)item->args[2]);
+      break;
     case PWRITE:
       item->ret = pwrite((int)item->args[0],
                          (void const *)item->args[1],
@@ -258,6 +578,9 @@ void INTERNAL qt_blocking_subsystem_enqueue(qt_blocking_queue_node_t *job) {
 
   assert(job->next == NULL);
   assert(job->thread->rdata);
+#ifdef QTHREAD_USE_IO_URING
+  if (qt_io_uring_active && qt_io_uring_submit(job)) { return; }
+#endif
   QTHREAD_LOCK(&theQueue.lock);
   prev = theQueue.tail;
   theQueue.tail = job;
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 
 /* The API */
@@ -7,10 +8,14 @@
 
 /* Internal Headers */
 #include "qt_alloc.h"
+#include "qt_asserts.h"
 #include "qt_atomics.h"
 #include "qt_feb.h"
 #include "qt_hash.h"
 #include "qt_locks.h"
+#include "qt_qthread_mgmt.h"   /* for qthread_internal_self() */
+#include "qt_qthread_struct.h" /* to pass data back to worker */
+#include "qt_threadqueues.h"
 #include "qt_visibility.h"
 
 #define SPINLOCK_IS_RECURSIVE (-1)
@@ -257,6 +262,207 @@ static int spinlock_unlock(qthread_spinlock_t *a) {
   return QTHREAD_OPFAIL;
 }
 
+/* queue locks: see qthread_qlock_t in qthread.h
+ *
+ * This is the variant of the MCS lock from K42 (Auslander et al., US patent
+ * 6,965,961), in which the lock doubles as the queue node of whoever holds
+ * it, so nobody needs a node once they hold the lock and a waiter's node can
+ * live on its own stack. The tail is NULL when the lock is free and points at
+ * the lock itself when it is held with nobody waiting. */
+
+#define QLOCK_SPINS 128 /* times a waiter checks its flag before it parks */
+
+/* waiter states */
+#define QLOCK_WAITING 0
+#define QLOCK_PARKED 1  /* switched out, for whoever grants it to wake */
+#define QLOCK_GRANTED 2 /* holds the lock */
+
+typedef struct qthread_qlock_waiter_s {
+  struct qthread_qlock_waiter_s *_Atomic next;
+  _Atomic uint_fast8_t state;
+  qthread_t *waiter; /* NULL for a thread that is not a qthread */
+} qthread_qlock_waiter_t;
+
+#define QLOCK_HELD(l) ((qthread_qlock_waiter_t *)(l))
+
+/* makes t, which has parked, runnable again */
+static void qthread_qlock_launch(qthread_t *t) {
+  qthread_shepherd_t *cur_shep = qthread_internal_getshep();
+
+  atomic_store_explicit(
+    &t->thread_state, QTHREAD_STATE_RUNNING, memory_order_relaxed);
+  if ((cur_shep == NULL) ||
+      ((atomic_load_explicit(&t->flags, memory_order_relaxed) &
+        QTHREAD_UNSTEALABLE) &&
+       (t->rdata->shepherd_ptr != cur_shep))) {
+    qt_threadqueue_enqueue(t->rdata->shepherd_ptr->ready, t);
+  } else {
+    qt_threadqueue_enqueue(cur_shep->ready, t);
+  }
+}
+
+void INTERNAL qthread_qlock_internal_park(qthread_t *t) {
+  qthread_qlock_waiter_t *w = t->rdata->blockedon.qlock;
+  uint_fast8_t expected = QLOCK_WAITING;
+
+  /* once parked, w and t belong to whoever grants the lock */
+  if (!atomic_compare_exchange_strong_explicit(&w->state,
+                                               &expected,
+                                               QLOCK_PARKED,
+                                               memory_order_acq_rel,
+                                               memory_order_acquire)) {
+    assert(expected == QLOCK_GRANTED);
+    qthread_qlock_launch(t);
+  }
+}
+
+static void qthread_qlock_wait(qthread_qlock_waiter_t *w) {
+  for (int i = 0; i < QLOCK_SPINS; i++) {
+    if (atomic_load_explicit(&w->state, memory_order_acquire) ==
+        QLOCK_GRANTED) {
+      return;
+    }
+    SPINLOCK_BODY();
+  }
+  if (w->waiter) {
+    atomic_store_explicit(
+      &w->waiter->thread_state, QTHREAD_STATE_PARKED, memory_order_relaxed);
+    w->waiter->rdata->blockedon.qlock = w;
+    qthread_back_to_master(w->waiter);
+    assert(atomic_load_explicit(&w->state, memory_order_acquire) ==
+           QLOCK_GRANTED);
+  } else {
+    while (atomic_load_explicit(&w->state, memory_order_acquire) !=
+           QLOCK_GRANTED) {
+      SPINLOCK_BODY();
+    }
+  }
+}
+
+static void qthread_qlock_grant(qthread_qlock_waiter_t *w) {
+  /* w may vanish as soon as it sees the grant */
+  qthread_t *const t = w->waiter;
+
+  if (atomic_exchange_explicit(
+        &w->state, QLOCK_GRANTED, memory_order_acq_rel) == QLOCK_PARKED) {
+    qthread_qlock_launch(t);
+  }
+}
+
+int API_FUNC qthread_qlock_init(qthread_qlock_t *l) {
+  qassert_ret(l != NULL, QTHREAD_BADARGS);
+  atomic_init(&l->tail, NULL);
+  atomic_init(&l->next, NULL);
+  return QTHREAD_SUCCESS;
+}
+
+int API_FUNC qthread_qlock_destroy(qthread_qlock_t *l) {
+  qassert_ret(l != NULL, QTHREAD_BADARGS);
+  qassert_ret(atomic_load_explicit(&l->tail, memory_order_relaxed) == NULL,
+              QTHREAD_BADARGS);
+  return QTHREAD_SUCCESS;
+}
+
+int API_FUNC qthread_qlock_trylock(qthread_qlock_t *l) {
+  qthread_qlock_waiter_t *expected = NULL;
+
+  qassert_ret(l != NULL, QTHREAD_BADARGS);
+  if (atomic_compare_exchange_strong_explicit(&l->tail,
+                                              &expected,
+                                              QLOCK_HELD(l),
+                                              memory_order_acquire,
+                                              memory_order_relaxed)) {
+    return QTHREAD_SUCCESS;
+  }
+  return QTHREAD_OPFAIL;
+}
+
+int API_FUNC qthread_qlock_lock(qthread_qlock_t *l) {
+  qthread_qlock_waiter_t me;
+  qthread_qlock_waiter_t *prev;
+  qthread_qlock_waiter_t *succ;
+
+  qassert_ret(l != NULL, QTHREAD_BADARGS);
+  prev = atomic_load_explicit(&l->tail, memory_order_relaxed);
+  while (1) {
+    if (prev == NULL) {
+      if (atomic_compare_exchange_weak_explicit(&l->tail,
+                                                &prev,
+                                                QLOCK_HELD(l),
+                                                memory_order_acquire,
+                                                memory_order_relaxed)) {
+        return QTHREAD_SUCCESS;
+      }
+      continue;
+    }
+    atomic_init(&me.next, NULL);
+    atomic_init(&me.state, QLOCK_WAITING);
+    me.waiter = qthread_internal_self();
+    if (atomic_compare_exchange_weak_explicit(&l->tail,
+                                              &prev,
+                                              &me,
+                                              memory_order_acq_rel,
+                                              memory_order_relaxed)) {
+      break;
+    }
+  }
+
+  /* get in line behind prev, which is the lock if only its holder is ahead */
+  if (prev == QLOCK_HELD(l)) {
+    atomic_store_explicit(&l->next, &me, memory_order_release);
+  } else {
+    atomic_store_explicit(&prev->next, &me, memory_order_release);
+  }
+  qthread_qlock_wait(&me);
+
+  /* now hold the lock, so pass the rest of the line on to it */
+  succ = atomic_load_explicit(&me.next, memory_order_acquire);
+  if (succ == NULL) {
+    qthread_qlock_waiter_t *expected = &me;
+
+    atomic_store_explicit(&l->next, NULL, memory_order_relaxed);
+    if (atomic_compare_exchange_strong_explicit(&l->tail,
+                                                &expected,
+                                                QLOCK_HELD(l),
+                                                memory_order_acq_rel,
+                                                memory_order_relaxed)) {
+      return QTHREAD_SUCCESS;
+    }
+    /* someone got in line after me, and is about to say so */
+    while ((succ = atomic_load_explicit(&me.next, memory_order_acquire)) ==
+           NULL) {
+      SPINLOCK_BODY();
+    }
+  }
+  atomic_store_explicit(&l->next, succ, memory_order_relaxed);
+  return QTHREAD_SUCCESS;
+}
+
+int API_FUNC qthread_qlock_unlock(qthread_qlock_t *l) {
+  qthread_qlock_waiter_t *succ;
+
+  qassert_ret(l != NULL, QTHREAD_BADARGS);
+  succ = atomic_load_explicit(&l->next, memory_order_acquire);
+  if (succ == NULL) {
+    qthread_qlock_waiter_t *expected = QLOCK_HELD(l);
+
+    if (atomic_compare_exchange_strong_explicit(&l->tail,
+                                                &expected,
+                                                NULL,
+                                                memory_order_release,
+                                                memory_order_relaxed)) {
+      return QTHREAD_SUCCESS;
+    }
+    qassert_ret(expected != NULL, QTHREAD_OPFAIL); /* was not locked */
+    while ((succ = atomic_load_explicit(&l->next, memory_order_acquire)) ==
+           NULL) {
+      SPINLOCK_BODY();
+    }
+  }
+  qthread_qlock_grant(succ);
+  return QTHREAD_SUCCESS;
+}
+
 /* Functions to implement FEB-ish locking/unlocking*/
 
 int API_FUNC qthread_lock_init(aligned_t const *a, bool const is_recursive) {
@@ -20,6 +20,9 @@
 #endif
 
 /* Internal Includes */
+#ifdef USE_HWLOC_MEM_AFFINITY
+#include "qt_affinity.h"
+#endif
 #include "qt_alloc.h"
 #include "qt_asserts.h"
 #include "qt_atomics.h"
@@ -38,6 +41,25 @@
 
 typedef struct threadlocal_cache_s qt_mpool_threadlocal_cache_t;
 
+/* Blocks of items, and the chains of freed items that are handed back for
+ * reuse, belong to a NUMA node. Without hwloc memory affinity (or on a single
+ * node) there is only node 0, and blocks are laid out as they always were.
+ * Otherwise, blocks are alloc_size-aligned (alloc_size being a power of two)
+ * and their first item slot holds a qt_mpool_block_t, so the home node of any
+ * item can be found from its address. */
+typedef struct qt_mpool_node_s {
+  QTHREAD_FASTLOCK_TYPE reuse_lock;
+  void *_Atomic reuse_pool;
+
+  QTHREAD_FASTLOCK_TYPE pool_lock;
+  void **alloc_list;
+  size_t _Atomic alloc_list_pos;
+} qt_mpool_node_t;
+
+typedef struct qt_mpool_block_s {
+  unsigned int node;
+} qt_mpool_block_t;
+
 #ifdef TLS
 static TLS_DECL_INIT(qt_mpool_threadlocal_cache_t *, pool_caches);
 static TLS_DECL_INIT(uintptr_t, pool_cache_count);
@@ -58,12 +80,9 @@ struct qt_mpool_s {
 #endif
   qt_mpool_threadlocal_cache_t *_Atomic caches; // for cleanup
 
-  QTHREAD_FASTLOCK_TYPE reuse_lock;
-  void *_Atomic reuse_pool;
-
-  QTHREAD_FASTLOCK_TYPE pool_lock;
-  void **alloc_list;
-  size_t _Atomic alloc_list_pos;
+  size_t block_offset; // where the items start in each block
+  unsigned int nnodes;
+  qt_mpool_node_t *nodes;
 };
 
 typedef struct qt_mpool_cache_entry_s {
@@ -72,11 +91,19 @@ typedef struct qt_mpool_cache_entry_s {
   uint8_t data[];
 } qt_mpool_cache_t;
 
+/* items freed by a thread on another node than theirs, batched per node */
+typedef struct qt_mpool_remote_s {
+  qt_mpool_cache_t *cache;
+  size_t count;
+} qt_mpool_remote_t;
+
 struct threadlocal_cache_s {
   qt_mpool_cache_t *cache;
   uint_fast16_t count;
   uint8_t *block;
   uint_fast32_t i;
+  unsigned int node;
+  qt_mpool_remote_t *remote; // nnodes entries, allocated on first use
   qt_mpool_threadlocal_cache_t *_Atomic next; // for cleanup
 };
 
@@ -115,6 +142,29 @@ static inline void qt_mpool_internal_aligned_free(void *freeme,
   qt_internal_aligned_free(freeme, alignment);
 }
 
+static inline unsigned int qt_mpool_internal_home(qt_mpool pool, void *mem) {
+  return ((qt_mpool_block_t *)((uintptr_t)mem & ~(uintptr_t)(pool->alloc_size -
+                                                             1)))
+    ->node;
+}
+
+/* pushes a chain of items_per_alloc items, in block_tail form, onto the
+ * reuse pool of the given node */
+static inline void qt_mpool_internal_reuse(qt_mpool_node_t *node,
+                                           qt_mpool_cache_t *chain) {
+  qt_mpool_cache_t *tail =
+    atomic_load_explicit(&chain->block_tail, memory_order_relaxed);
+
+  assert(tail);
+  QTHREAD_FASTLOCK_LOCK(&node->reuse_lock);
+  atomic_store_explicit(
+    &tail->next,
+    atomic_load_explicit(&node->reuse_pool, memory_order_relaxed),
+    memory_order_relaxed);
+  atomic_store_explicit(&node->reuse_pool, chain, memory_order_relaxed);
+  QTHREAD_FASTLOCK_UNLOCK(&node->reuse_lock);
+}
+
 // sync means lock-protected
 // item_size is how many bytes to return
 // ...memory is always allocated in multiples of getpagesize()
@@ -127,10 +177,19 @@ qt_mpool INTERNAL qt_mpool_create_aligned(size_t item_size, size_t alignment) {
    * item_size * 2 after item_size has been adjusted for alignment, so that
    * at least two items can be allocated. */
   static size_t max_alloc_size = 0;
+  static unsigned int nnodes = 0;
   if (max_alloc_size == 0) {
     max_alloc_size =
       qt_internal_get_env_num("MAX_POOL_ALLOC_SIZE", SIZE_MAX, 0);
   }
+  if (nnodes == 0) {
+    nnodes = 1;
+#ifdef USE_HWLOC_MEM_AFFINITY
+    if (qt_internal_get_env_bool("MPOOL_NUMA", 1)) {
+      nnodes = qt_affinity_mem_nodes();
+    }
+#endif
+  }
 
   qassert_ret((pool != NULL), NULL);
   VALGRIND_CREATE_MEMPOOL(pool, 0, 0);
@@ -179,14 +238,21 @@ qt_mpool INTERNAL qt_mpool_create_aligned(size_t item_size, size_t alignment) {
     }
     while (alloc_size < pagesize * 16) { alloc_size *= 2; }
   }
-  QTHREAD_FASTLOCK_INIT(pool->reuse_lock);
-  QTHREAD_FASTLOCK_INIT(pool->pool_lock);
-  QTHREAD_FASTLOCK_LOCK(&pool->reuse_lock);
-  atomic_store_explicit(&pool->reuse_pool, NULL, memory_order_relaxed);
-  QTHREAD_FASTLOCK_UNLOCK(&pool->reuse_lock);
-  QTHREAD_FASTLOCK_LOCK(&pool->pool_lock);
+  pool->nnodes = nnodes;
+  pool->block_offset = 0;
+  if (nnodes > 1) {
+    /* make room for the block header, and make blocks self-aligned */
+    if (alloc_size < item_size * 3) { alloc_size = item_size * 3; }
+    while (alloc_size & (alloc_size - 1)) {
+      alloc_size += alloc_size & -alloc_size;
+    }
+    pool->block_offset = item_size;
+  }
   pool->alloc_size = alloc_size;
-  pool->items_per_alloc = alloc_size / item_size;
+  pool->items_per_alloc = (alloc_size - pool->block_offset) / item_size;
+  pool->nodes = qt_internal_aligned_alloc(nnodes * sizeof(qt_mpool_node_t),
+                                          CACHELINE_WIDTH);
+  qassert_goto((pool->nodes != NULL), errexit);
 #ifdef TLS
   pool->offset = qthread_incr(&pool_cache_global_max, 1);
 #else
@@ -194,13 +260,19 @@ qt_mpool INTERNAL qt_mpool_create_aligned(size_t item_size, size_t alignment) {
 #endif
   /* this assumes that pagesize is a multiple of sizeof(void*) */
   assert(pagesize % sizeof(void *) == 0);
-  pool->alloc_list = qt_internal_aligned_alloc(pagesize, pagesize);
-  qassert_goto((pool->alloc_list != NULL), errexit);
-  memset(pool->alloc_list, 0, pagesize);
-  atomic_store_explicit(&pool->alloc_list_pos, 0u, memory_order_relaxed);
+  for (unsigned int n = 0; n < nnodes; n++) {
+    qt_mpool_node_t *node = &pool->nodes[n];
+
+    QTHREAD_FASTLOCK_INIT(node->reuse_lock);
+    QTHREAD_FASTLOCK_INIT(node->pool_lock);
+    atomic_store_explicit(&node->reuse_pool, NULL, memory_order_relaxed);
+    node->alloc_list = qt_internal_aligned_alloc(pagesize, pagesize);
+    qassert_goto((node->alloc_list != NULL), errexit);
+    memset(node->alloc_list, 0, pagesize);
+    atomic_store_explicit(&node->alloc_list_pos, 0u, memory_order_relaxed);
+  }
 
   atomic_store_explicit(&pool->caches, NULL, memory_order_relaxed);
-  QTHREAD_FASTLOCK_UNLOCK(&pool->pool_lock);
   return pool;
 
   qgoto(errexit);
@@ -269,6 +341,11 @@ static qt_mpool_threadlocal_cache_t *qt_mpool_internal_getcache(qt_mpool pool) {
     tc->count = 0;
     tc->block = NULL;
     tc->i = 0;
+    tc->node = 0;
+#ifdef USE_HWLOC_MEM_AFFINITY
+    if (pool->nnodes > 1) { tc->node = qt_affinity_mem_node_here(); }
+#endif
+    tc->remote = NULL;
     qt_mpool_threadlocal_cache_t *old_caches;
     do {
       old_caches = atomic_load_explicit(&pool->caches, memory_order_relaxed);
@@ -302,24 +379,25 @@ void INTERNAL *qt_mpool_alloc(qt_mpool pool) {
     return ret;
   } else {
     size_t const items_per_alloc = pool->items_per_alloc;
+    qt_mpool_node_t *node = &pool->nodes[tc->node];
     qt_mpool_cache_t *cache = NULL;
 
     cnt = 0;
     /* cache is empty; need to fill it */
-    if (atomic_load_explicit(&pool->reuse_pool,
+    if (atomic_load_explicit(&node->reuse_pool,
                              memory_order_relaxed)) { // global cache
-      QTHREAD_FASTLOCK_LOCK(&pool->reuse_lock);
-      if (atomic_load_explicit(&pool->reuse_pool, memory_order_relaxed)) {
-        cache = atomic_load_explicit(&pool->reuse_pool, memory_order_relaxed);
+      QTHREAD_FASTLOCK_LOCK(&node->reuse_lock);
+      if (atomic_load_explicit(&node->reuse_pool, memory_order_relaxed)) {
+        cache = atomic_load_explicit(&node->reuse_pool, memory_order_relaxed);
         atomic_store_explicit(
-          &pool->reuse_pool,
+          &node->reuse_pool,
           atomic_load_explicit(&cache->block_tail->next, memory_order_relaxed),
           memory_order_relaxed);
         atomic_store_explicit(
           &cache->block_tail->next, NULL, memory_order_relaxed);
         cnt = items_per_alloc;
       }
-      QTHREAD_FASTLOCK_UNLOCK(&pool->reuse_lock);
+      QTHREAD_FASTLOCK_UNLOCK(&node->reuse_lock);
     }
     if (NULL == cache) {
       uint8_t *p;
@@ -327,29 +405,42 @@ void INTERNAL *qt_mpool_alloc(qt_mpool pool) {
 
       /* need to allocate a new block and record that I did so in the central
        * pool */
-      p = qt_mpool_internal_aligned_alloc(pool->alloc_size, pool->alignment);
-      qassert_ret((p != NULL), NULL);
+      if (pool->nnodes > 1) {
+        p = qt_mpool_internal_aligned_alloc(pool->alloc_size,
+                                            pool->alloc_size);
+        qassert_ret((p != NULL), NULL);
+#ifdef USE_HWLOC_MEM_AFFINITY
+        /* before anything touches it */
+        qt_affinity_mem_bind(p, pool->alloc_size, tc->node);
+#endif
+        VALGRIND_MAKE_MEM_DEFINED(p, sizeof(qt_mpool_block_t));
+        ((qt_mpool_block_t *)p)->node = tc->node;
+      } else {
+        p = qt_mpool_internal_aligned_alloc(pool->alloc_size,
+                                            pool->alignment);
+        qassert_ret((p != NULL), NULL);
+      }
       assert(pool->alignment == 0 ||
              (((uintptr_t)p) & (pool->alignment - 1)) == 0);
-      QTHREAD_FASTLOCK_LOCK(&pool->pool_lock);
-      if (atomic_load_explicit(&pool->alloc_list_pos, memory_order_relaxed) ==
+      QTHREAD_FASTLOCK_LOCK(&node->pool_lock);
+      if (atomic_load_explicit(&node->alloc_list_pos, memory_order_relaxed) ==
           (pagesize / sizeof(void *) - 1)) {
         void **tmp = qt_internal_aligned_alloc(pagesize, pagesize);
         qassert_ret((tmp != NULL), NULL);
         memset(tmp, 0, pagesize);
-        tmp[pagesize / sizeof(void *) - 1] = pool->alloc_list;
-        pool->alloc_list = tmp;
-        atomic_store_explicit(&pool->alloc_list_pos, 0, memory_order_relaxed);
+        tmp[pagesize / sizeof(void *) - 1] = node->alloc_list;
+        node->alloc_list = tmp;
+        atomic_store_explicit(&node->alloc_list_pos, 0, memory_order_relaxed);
       }
-      pool->alloc_list[atomic_load_explicit(&pool->alloc_list_pos,
+      node->alloc_list[atomic_load_explicit(&node->alloc_list_pos,
                                             memory_order_relaxed)] = p;
       atomic_fetch_add_explicit(
-        &pool->alloc_list_pos, 1u, memory_order_relaxed);
-      QTHREAD_FASTLOCK_UNLOCK(&pool->pool_lock);
+        &node->alloc_list_pos, 1u, memory_order_relaxed);
+      QTHREAD_FASTLOCK_UNLOCK(&node->pool_lock);
       /* store the block for later allocation */
-      tc->block = p;
+      tc->block = p + pool->block_offset;
       tc->i = 1;
-      return p;
+      return tc->block;
     } else {
       tc->cache = atomic_load_explicit(&cache->next, memory_order_relaxed);
       tc->count = cnt - 1;
@@ -360,6 +451,66 @@ void INTERNAL *qt_mpool_alloc(qt_mpool pool) {
   }
 }
 
+/* Fills items with n allocations, looking up the calling thread's cache once
+ * rather than once per item. */
+void INTERNAL qt_mpool_alloc_many(qt_mpool pool, void **items, size_t n) {
+  qt_mpool_threadlocal_cache_t *tc;
+  size_t i = 0;
+
+  qassert_retvoid((pool != NULL));
+  qassert_retvoid((items != NULL));
+
+  tc = qt_mpool_internal_getcache(pool);
+  while (i < n) {
+    while (i < n && tc->cache) {
+      qt_mpool_cache_t *cache = tc->cache;
+      tc->cache = atomic_load_explicit(&cache->next, memory_order_relaxed);
+      --tc->count;
+      items[i++] = cache;
+    }
+    while (i < n && tc->block) {
+      items[i++] = &(tc->block[tc->i * pool->item_size]);
+      if (++tc->i == pool->items_per_alloc) { tc->block = NULL; }
+    }
+    /* the cache ran dry: refill it from the global pool or a fresh block */
+    if (i < n) { items[i++] = qt_mpool_alloc(pool); }
+  }
+}
+
+/* Batches an item freed away from its home node; once the batch makes up a
+ * whole chain it goes back to that node's reuse pool, rather than into the
+ * freeing thread's cache where it would be handed out as remote memory.
+ * Returns zero if the item has to be cached locally after all. */
+static int qt_mpool_internal_free_remote(qt_mpool pool,
+                                         qt_mpool_threadlocal_cache_t *tc,
+                                         unsigned int home,
+                                         qt_mpool_cache_t *n) {
+  qt_mpool_remote_t *r;
+
+  if (NULL == tc->remote) {
+    tc->remote = qt_calloc(pool->nnodes, sizeof(qt_mpool_remote_t));
+    if (NULL == tc->remote) { return 0; }
+  }
+  r = &tc->remote[home];
+  if (r->cache) {
+    atomic_store_explicit(&n->next, r->cache, memory_order_relaxed);
+    atomic_store_explicit(
+      &n->block_tail,
+      atomic_load_explicit(&r->cache->block_tail, memory_order_relaxed),
+      memory_order_relaxed);
+  } else {
+    atomic_store_explicit(&n->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&n->block_tail, n, memory_order_relaxed);
+  }
+  r->cache = n;
+  if (++r->count == pool->items_per_alloc) {
+    qt_mpool_internal_reuse(&pool->nodes[home], n);
+    r->cache = NULL;
+    r->count = 0;
+  }
+  return 1;
+}
+
 void INTERNAL qt_mpool_free(qt_mpool pool, void *mem) {
   qt_mpool_threadlocal_cache_t *tc;
   qt_mpool_cache_t *cache = NULL;
@@ -370,6 +521,15 @@ void INTERNAL qt_mpool_free(qt_mpool pool, void *mem) {
   qassert_retvoid((mem != NULL));
   qassert_retvoid((pool != NULL));
   tc = qt_mpool_internal_getcache(pool);
+  if (pool->nnodes > 1) {
+    unsigned int const home = qt_mpool_internal_home(pool, mem);
+
+    if ((home != tc->node) &&
+        qt_mpool_internal_free_remote(pool, tc, home, n)) {
+      VALGRIND_MEMPOOL_FREE(pool, mem);
+      return;
+    }
+  }
   cache = tc->cache;
   cnt = tc->count;
   if (cache) {
@@ -399,14 +559,7 @@ void INTERNAL qt_mpool_free(qt_mpool pool, void *mem) {
       NULL,
       memory_order_relaxed);
     assert(toglobal);
-    assert(atomic_load_explicit(&toglobal->block_tail, memory_order_relaxed));
-    QTHREAD_FASTLOCK_LOCK(&pool->reuse_lock);
-    atomic_store_explicit(
-      &atomic_load_explicit(&toglobal->block_tail, memory_order_relaxed)->next,
-      atomic_load_explicit(&pool->reuse_pool, memory_order_relaxed),
-      memory_order_relaxed);
-    atomic_store_explicit(&pool->reuse_pool, toglobal, memory_order_relaxed);
-    QTHREAD_FASTLOCK_UNLOCK(&pool->reuse_lock);
+    qt_mpool_internal_reuse(&pool->nodes[tc->node], toglobal);
     cnt -= items_per_alloc;
   } else if (cnt == items_per_alloc + 1) {
     atomic_store_explicit(&n->block_tail, n, memory_order_relaxed);
@@ -418,33 +571,41 @@ void INTERNAL qt_mpool_free(qt_mpool pool, void *mem) {
 
 void INTERNAL qt_mpool_destroy(qt_mpool pool) {
   qassert_retvoid((pool != NULL));
-  while (pool->alloc_list) {
-    unsigned int i = 0;
+  size_t const block_alignment =
+    (pool->nnodes > 1) ? pool->alloc_size : pool->alignment;
+  for (unsigned int n = 0; n < pool->nnodes; n++) {
+    qt_mpool_node_t *node = &pool->nodes[n];
+
+    while (node->alloc_list) {
+      unsigned int i = 0;
 
-    void *p = pool->alloc_list[0];
+      void *p = node->alloc_list[0];
 
-    while (p && i < (pagesize / sizeof(void *) - 1)) {
-      qt_mpool_internal_aligned_free(p, pool->alignment);
-      i++;
-      p = pool->alloc_list[i];
+      while (p && i < (pagesize / sizeof(void *) - 1)) {
+        qt_mpool_internal_aligned_free(p, block_alignment);
+        i++;
+        p = node->alloc_list[i];
+      }
+      p = node->alloc_list;
+      node->alloc_list = node->alloc_list[pagesize / sizeof(void *) - 1];
+      qt_internal_aligned_free(p, pagesize);
     }
-    p = pool->alloc_list;
-    pool->alloc_list = pool->alloc_list[pagesize / sizeof(void *) - 1];
-    qt_internal_aligned_free(p, pagesize);
+    QTHREAD_FASTLOCK_DESTROY(node->pool_lock);
+    QTHREAD_FASTLOCK_DESTROY(node->reuse_lock);
   }
+  qt_internal_aligned_free(pool->nodes, CACHELINE_WIDTH);
   qt_mpool_threadlocal_cache_t *freeme;
   while ((freeme = atomic_load_explicit(&pool->caches, memory_order_relaxed))) {
     atomic_store_explicit(
       &pool->caches,
       atomic_load_explicit(&freeme->next, memory_order_relaxed),
       memory_order_relaxed);
+    if (freeme->remote) { qt_free(freeme->remote); }
     qt_internal_aligned_free(freeme, CACHELINE_WIDTH);
   }
 #ifndef TLS
   pthread_key_delete(pool->threadlocal_cache);
 #endif
-  QTHREAD_FASTLOCK_DESTROY(pool->pool_lock);
-  QTHREAD_FASTLOCK_DESTROY(pool->reuse_lock);
   VALGRIND_DESTROY_MEMPOOL(pool);
   FREE(pool, sizeof(struct qt_mpool_s));
 }
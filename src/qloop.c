@@ -1,9 +1,11 @@
 /* System Headers */
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 /* Installed Headers */
 #include <qthread/barrier.h>
+#include <qthread/cacheline.h>
 #include <qthread/qloop.h>
 #include <qthread/qthread.h>
 #include <qthread/qtimer.h>
@@ -16,6 +18,7 @@
 #include "qt_barrier.h"
 #include "qt_expect.h"
 #include "qt_initialized.h" // for qthread_library_initialized
+#include "qt_qthread_mgmt.h" // for qthread_internal_work_wanted()
 
 typedef enum { ALIGNED, SYNCVAR_T, SINC_T, DONECOUNT, NO_SYNC } synctype_t;
 
@@ -153,17 +156,19 @@ static aligned_t qt_loop_wrapper(void *restrict arg_void) {
 }
 
 #define QT_LOOP_SPAWNER_SIMPLE (1 << 0)
+#define QT_LOOP_SPAWN_BATCH 256
 
 static void
 qt_loop_spawner(size_t const start, size_t const stop, void *args_) {
   size_t i, threadct;
   size_t steps = stop - start;
-  struct qt_loop_wrapper_args qwa;
+  size_t const batch =
+    (steps < QT_LOOP_SPAWN_BATCH) ? (steps ? steps : 1) : QT_LOOP_SPAWN_BATCH;
+  struct qt_loop_wrapper_args *qwa;
   unsigned int flags = 0;
   synctype_t const sync_type = ((struct qt_loop_spawner_arg *)args_)->sync_type;
   qt_loop_f const func = ((struct qt_loop_spawner_arg *)args_)->func;
   void *const argptr = ((struct qt_loop_spawner_arg *)args_)->argptr;
-  void *retptr = NULL;
   aligned_t dc;
   int yieldarg = 2;
 
@@ -177,7 +182,7 @@ qt_loop_spawner(size_t const start, size_t const stop, void *args_) {
 
   switch (sync_type) {
     case SYNCVAR_T:
-      retptr = sync.syncvar = MALLOC(steps * sizeof(syncvar_t));
+      sync.syncvar = MALLOC(steps * sizeof(syncvar_t));
       assert(sync.syncvar);
       for (i = 0; i < (stop - start); ++i) {
         sync.syncvar[i] = SYNCVAR_EMPTY_INITIALIZER;
@@ -189,7 +194,7 @@ qt_loop_spawner(size_t const start, size_t const stop, void *args_) {
       assert(sync.sinc);
       break;
     case ALIGNED:
-      retptr = sync.aligned = qt_internal_aligned_alloc(
+      sync.aligned = qt_internal_aligned_alloc(
         steps * sizeof(aligned_t), QTHREAD_ALIGNMENT_ALIGNED_T);
       assert(sync.aligned);
       for (i = 0; i < (stop - start); ++i) { qthread_empty(&sync.aligned[i]); }
@@ -206,30 +211,43 @@ qt_loop_spawner(size_t const start, size_t const stop, void *args_) {
       yieldarg = 0;
       break;
   }
-  for (i = start, threadct = 0; i < stop; ++i, ++threadct) {
-    qwa.func = func;
-    qwa.startat = i;
-    qwa.stopat = i + 1;
-    qwa.arg = argptr;
-    qwa.id = threadct;
-    qwa.sync_type = sync_type;
-    if (sync_type == DONECOUNT) {
-      qwa.sync = &dc;
-      qassert_aligned(dc, QTHREAD_ALIGNMENT_ALIGNED_T);
-    } else {
-      qwa.sync = sync.syncvar;
+  /* spawn in batches, each handed to the scheduler in one go */
+  qwa = MALLOC(batch * sizeof(struct qt_loop_wrapper_args));
+  assert(qwa);
+  for (i = start, threadct = 0; i < stop;) {
+    size_t const n = (stop - i < batch) ? stop - i : batch;
+    void *rets = NULL;
+
+    switch (sync_type) {
+      case SYNCVAR_T: rets = sync.syncvar + threadct; break;
+      case ALIGNED: rets = sync.aligned + threadct; break;
+      default: break;
+    }
+    for (size_t j = 0; j < n; ++j, ++i, ++threadct) {
+      qwa[j].func = func;
+      qwa[j].startat = i;
+      qwa[j].stopat = i + 1;
+      qwa[j].arg = argptr;
+      qwa[j].id = threadct;
+      qwa[j].sync_type = sync_type;
+      if (sync_type == DONECOUNT) {
+        qwa[j].sync = &dc;
+        qassert_aligned(dc, QTHREAD_ALIGNMENT_ALIGNED_T);
+      } else {
+        qwa[j].sync = sync.syncvar;
+      }
     }
-    qassert(qthread_spawn((qthread_f)qt_loop_wrapper,
-                          &qwa,
-                          sizeof(struct qt_loop_wrapper_args),
-                          retptr,
-                          0,
-                          NULL,
-                          NO_SHEPHERD,
-                          flags),
+    qassert(qthread_spawn_many((qthread_f)qt_loop_wrapper,
+                               qwa,
+                               sizeof(struct qt_loop_wrapper_args),
+                               rets,
+                               n,
+                               NO_SHEPHERD,
+                               flags),
             QTHREAD_SUCCESS);
     qthread_yield_(yieldarg);
   }
+  FREE(qwa, batch * sizeof(struct qt_loop_wrapper_args));
   switch (sync_type) {
     case SYNCVAR_T:
       for (i = 0; i < steps; i++) {
@@ -713,6 +731,188 @@ API_FUNC void qt_loopaccum_balance_dc(size_t const start,
     start, stop, size, out, func, argptr, acc, 0, DONECOUNT);
 }
 
+/* qt_loop_balance() divides the iterations evenly up front, which leaves
+ * everyone waiting for the slowest chunk when iterations differ in cost. The
+ * adaptive loops use lazy binary splitting instead: one task starts with the
+ * whole range and works through it a few iterations (a "grain") at a time.
+ * Before each grain, if the range left is bigger than that and its shepherd
+ * looks short of work (see qthread_internal_work_wanted()), it spawns a task
+ * for the upper half of the range and keeps the lower half, and the new task
+ * does the same. So a loop only splits as far as there are idle workers to
+ * take the pieces, and keeps splitting wherever the expensive iterations
+ * turn out to be. The tasks are counted with a sinc; accumulated values are
+ * combined in one slot per worker, and then into the result. */
+#define QT_LOOP_ADAPTIVE_GRAINS 64 /* per worker, at most */
+
+struct qt_loop_adaptive_s {
+  qt_loop_f func;
+  qt_loopr_f rfunc;
+  qt_accum_f acc;
+  void *arg;
+  size_t grain;
+  size_t size;     /* of an accumulated value (0 for qt_loop_adaptive()) */
+  size_t argsize;  /* of a task's arguments, including its values */
+  size_t stride;   /* between workers' slots: a value, then a "set" flag */
+  uint8_t *slots;
+  qt_sinc_t sinc;
+};
+
+struct qt_loop_adaptive_args {
+  struct qt_loop_adaptive_s *loop;
+  size_t startat, stopat;
+  uint8_t values[]; /* this task's value, then room for one more */
+};
+
+static aligned_t qt_loop_adaptive_wrapper(void *restrict arg_void) {
+  /* a copy that belongs to this task, so it can be modified */
+  struct qt_loop_adaptive_args *const arg =
+    (struct qt_loop_adaptive_args *)arg_void;
+  struct qt_loop_adaptive_s *const l = arg->loop;
+  size_t start = arg->startat;
+  size_t stop = arg->stopat;
+  int have_value = 0;
+
+  while (start < stop) {
+    size_t end;
+
+    if ((stop - start > l->grain) && qthread_internal_work_wanted()) {
+      size_t const mid = start + (stop - start) / 2;
+
+      /* spawning copies the arguments, so the upper half goes in this
+       * task's own copy for as long as that takes */
+      arg->startat = mid;
+      arg->stopat = stop;
+      qt_sinc_expect(&l->sinc, 1);
+      qassert(qthread_spawn((qthread_f)qt_loop_adaptive_wrapper,
+                            arg,
+                            l->argsize,
+                            NULL,
+                            0,
+                            NULL,
+                            NO_SHEPHERD,
+                            0),
+              QTHREAD_SUCCESS);
+      stop = mid;
+      continue;
+    }
+    end = (stop - start > l->grain) ? start + l->grain : stop;
+    if (l->size == 0) {
+      l->func(start, end, l->arg);
+    } else if (!have_value) {
+      l->rfunc(start, end, l->arg, arg->values);
+      have_value = 1;
+    } else {
+      l->rfunc(start, end, l->arg, arg->values + l->size);
+      l->acc(arg->values, arg->values + l->size);
+    }
+    start = end;
+  }
+  if (have_value) {
+    /* nothing between here and the submit can block, so no other task
+     * uses this worker's slot in the meantime */
+    uint8_t *const slot =
+      l->slots + qthread_readstate(CURRENT_UNIQUE_WORKER) * l->stride;
+
+    if (slot[l->size]) {
+      l->acc(slot, arg->values);
+    } else {
+      memcpy(slot, arg->values, l->size);
+      slot[l->size] = 1;
+    }
+  }
+  qt_sinc_submit(&l->sinc, NULL);
+  return 0;
+}
+
+static void qt_loop_adaptive_inner(size_t const start,
+                                   size_t const stop,
+                                   size_t const size,
+                                   void *restrict out,
+                                   qt_loop_f const func,
+                                   qt_loopr_f const rfunc,
+                                   void *restrict argptr,
+                                   qt_accum_f const acc) {
+  size_t const nslots = qthread_readstate(TOTAL_WORKERS);
+  struct qt_loop_adaptive_s l;
+  struct qt_loop_adaptive_args *root;
+
+  assert(func || (rfunc && acc && size > 0));
+  assert(qthread_library_initialized);
+  if (start >= stop) { return; }
+
+  l.func = func;
+  l.rfunc = rfunc;
+  l.acc = acc;
+  l.arg = argptr;
+  l.grain = (stop - start) / (qthread_num_workers() * QT_LOOP_ADAPTIVE_GRAINS);
+  if (l.grain == 0) { l.grain = 1; }
+  l.size = size;
+  l.argsize = sizeof(struct qt_loop_adaptive_args) + 2 * size;
+  l.stride = 0;
+  l.slots = NULL;
+  if (size > 0) {
+    size_t const line = qthread_cacheline();
+
+    l.stride = (size + 1 + line - 1) / line * line;
+    l.slots = qt_internal_aligned_alloc(l.stride * nslots, line);
+    assert(l.slots);
+    for (size_t w = 0; w < nslots; w++) { l.slots[w * l.stride + size] = 0; }
+  }
+  qt_sinc_init(&l.sinc, 0, NULL, NULL, 1);
+
+  root = MALLOC(l.argsize);
+  assert(root);
+  root->loop = &l;
+  root->startat = start;
+  root->stopat = stop;
+  qassert(qthread_spawn((qthread_f)qt_loop_adaptive_wrapper,
+                        root,
+                        l.argsize,
+                        NULL,
+                        0,
+                        NULL,
+                        NO_SHEPHERD,
+                        0),
+          QTHREAD_SUCCESS);
+  FREE(root, l.argsize);
+  qt_sinc_wait(&l.sinc, NULL);
+  qt_sinc_fini(&l.sinc);
+
+  if (size > 0) {
+    int have_value = 0;
+
+    for (size_t w = 0; w < nslots; w++) {
+      uint8_t const *const slot = l.slots + w * l.stride;
+
+      if (!slot[size]) { continue; }
+      if (have_value) {
+        acc(out, slot);
+      } else {
+        memcpy(out, slot, size);
+        have_value = 1;
+      }
+    }
+    qt_internal_aligned_free(l.slots, qthread_cacheline());
+  }
+}
+
+API_FUNC void qt_loop_adaptive(size_t const start,
+                               size_t const stop,
+                               qt_loop_f const func,
+                               void *argptr) {
+  qt_loop_adaptive_inner(start, stop, 0, NULL, func, NULL, argptr, NULL);
+}
+
+API_FUNC void qt_loopaccum_adaptive(size_t const start,
+                                    size_t const stop,
+                                    size_t const size,
+                                    void *restrict out,
+                                    qt_loopr_f const func,
+                                    void *restrict argptr,
+                                    qt_accum_f const acc) {
+  qt_loop_adaptive_inner(start, stop, size, out, NULL, func, argptr, acc);
+}
+
 /* Now, the easy option for qt_loop_balance() is... effective, but has a major
  * drawback: if some iterations take longer than others, we will have a laggard
  * thread holding everyone up. Even worse, imagine if a shepherd is disabled
@@ -56,8 +56,10 @@
 #include "qt_alloc.h"
 #include "qt_blocking_structs.h"
 #include "qt_envariables.h"
+#include "qt_epoch.h"
 #include "qt_feb.h"
 #include "qt_hash.h"
+#include "qt_idle.h"
 #include "qt_int_log.h"
 #include "qt_io.h"
 #include "qt_locks.h"
@@ -71,6 +73,8 @@
 #include "qt_teams.h"
 #include "qt_threadqueue_scheduler.h"
 #include "qt_threadqueues.h"
+#include "qt_tls.h"
+#include "qt_trace.h"
 
 #define QTHREAD_STACK_ALIGNMENT 16u
 
@@ -126,13 +130,66 @@ static inline qthread_t *qthread_thread_new(qthread_f f,
 /*Make method externally available for the schedulers*/
 void qthread_thread_free(qthread_t *t);
 
-qt_mpool generic_qthread_pool = NULL;
-qt_mpool generic_big_qthread_pool = NULL;
-#define ALLOC_QTHREAD() (qthread_t *)qt_mpool_alloc(generic_qthread_pool)
-#define ALLOC_BIG_QTHREAD()                                                    \
-  (qthread_t *)qt_mpool_alloc(generic_big_qthread_pool)
-#define FREE_QTHREAD(t) qt_mpool_free(generic_qthread_pool, t)
-#define FREE_BIG_QTHREAD(t) qt_mpool_free(generic_big_qthread_pool, t)
+/* qthread structs come in a few sizes, so that a task's argument copy always
+ * lives in the struct itself without every struct being as big as the largest
+ * copy allowed (ARGCOPY_SIZE). A struct's data[] holds the task-local space,
+ * rounded up to qthread_argcopy_offset, and then the argument copy; the
+ * smallest class is what a task with no arguments needs, each of the next ones
+ * is twice the size of the one before, and the last one has room for
+ * ARGCOPY_SIZE bytes. Larger copies get a struct of their own from the heap. */
+#define QTHREAD_SIZE_CLASSES 4
+#define QTHREAD_HEAP_CLASS QTHREAD_SIZE_CLASSES
+
+static qt_mpool qthread_pools[QTHREAD_SIZE_CLASSES];
+static size_t qthread_class_argcopy[QTHREAD_SIZE_CLASSES]; /* bytes of args */
+static unsigned qthread_nclasses = 0;
+static size_t qthread_argcopy_offset = 0;
+
+static inline unsigned qthread_size_class(size_t arg_size) {
+  for (unsigned c = 0; c < qthread_nclasses; c++) {
+    if (arg_size <= qthread_class_argcopy[c]) { return c; }
+  }
+  return QTHREAD_HEAP_CLASS;
+}
+
+static inline qthread_t *qthread_struct_alloc(unsigned size_class,
+                                              size_t arg_size) {
+  qthread_t *t;
+
+  if (QTHREAD_LIKELY(size_class != QTHREAD_HEAP_CLASS)) {
+    t = qt_mpool_alloc(qthread_pools[size_class]);
+  } else {
+    t = qt_malloc(sizeof(qthread_t) + qthread_argcopy_offset + arg_size);
+  }
+  assert(t);
+  t->size_class = size_class;
+  return t;
+}
+
+static inline void qthread_struct_free(qthread_t *t) {
+  if (QTHREAD_LIKELY(t->size_class != QTHREAD_HEAP_CLASS)) {
+    qt_mpool_free(qthread_pools[t->size_class], t);
+  } else {
+    qt_free(t);
+  }
+}
+
+static void qthread_size_classes_init(void) {
+  size_t const line = qthread_cacheline();
+  size_t const base = sizeof(qthread_t) + qthread_argcopy_offset;
+  size_t size = (base + line - 1) / line * line;
+
+  qthread_nclasses = 0;
+  while ((qthread_nclasses < QTHREAD_SIZE_CLASSES - 1) &&
+         (size - base < qlib->qthread_argcopy_size)) {
+    qthread_class_argcopy[qthread_nclasses] = size - base;
+    qthread_pools[qthread_nclasses++] = qt_mpool_create_aligned(size, line);
+    size *= 2;
+  }
+  size = (base + qlib->qthread_argcopy_size + line - 1) / line * line;
+  qthread_class_argcopy[qthread_nclasses] = size - base;
+  qthread_pools[qthread_nclasses++] = qt_mpool_create_aligned(size, line);
+}
 
 static qt_mpool generic_stack_pool = NULL;
 #ifdef QTHREAD_GUARD_PAGES
@@ -177,6 +234,224 @@ static inline void FREE_STACK(void *t) {
 #define FREE_STACK(t) qt_mpool_free(generic_stack_pool, t)
 #endif /* ifdef QTHREAD_GUARD_PAGES */
 
+/* Lazily-committed stacks (QT_LAZY_STACKS). Stacks are carved out of
+ * MAP_NORESERVE slabs, each laid out as [guard page][stack][runtime data], so
+ * physical pages are only committed as a task actually touches them and
+ * QT_STACK_SIZE can be sized for the worst-case task. Guard pages are
+ * installed with MADV_GUARD_INSTALL where the kernel has it, so a slab stays
+ * a single VMA no matter how many stacks it holds; older kernels fall back to
+ * mprotect(). Released stacks are cached per shepherd; once a cache holds
+ * more than QT_STACK_CACHE_HIGHWATER stacks, further stacks entering it have
+ * their pages handed back to the kernel with MADV_FREE. */
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifdef MADV_FREE
+#define QT_MADV_RELEASE MADV_FREE
+#else
+#define QT_MADV_RELEASE MADV_DONTNEED
+#endif
+#if defined(__linux__) && !defined(MADV_GUARD_INSTALL)
+#define MADV_GUARD_INSTALL 102 /* Linux 6.13+; not in every libc yet */
+#endif
+#define LAZY_STACKS_PER_SLAB 64
+
+typedef struct qt_stack_cache_s {
+  QTHREAD_FASTLOCK_TYPE lock;
+  void *head; /* linked through the (unused) runtime data of each stack */
+  size_t count;
+} qt_stack_cache_t;
+
+typedef struct qt_stack_slab_s {
+  struct qt_stack_slab_s *next;
+  void *base;
+} qt_stack_slab_t;
+
+static int lazy_stacks = 0;
+static size_t lazy_stack_span = 0; /* bytes per stack, guard page included */
+static size_t lazy_stack_highwater = 0;
+/* one cache per shepherd, plus one for non-qthread callers */
+static qt_stack_cache_t *lazy_stack_caches = NULL;
+static qt_stack_slab_t *lazy_stack_slabs = NULL;
+static QTHREAD_FASTLOCK_TYPE lazy_stack_slabs_lock;
+#ifdef MADV_GUARD_INSTALL
+static int _Atomic lazy_stack_guard_madvise = 1;
+#endif
+
+#define LAZY_STACK_NEXT(stack)                                                 \
+  (*(void **)((uint8_t *)(stack) + qlib->qthread_stack_size))
+
+static inline qt_stack_cache_t *lazy_stack_cache(void) {
+  qthread_shepherd_t *shep = qthread_internal_getshep();
+
+  return &lazy_stack_caches[shep ? shep->shepherd_id : qlib->nshepherds];
+}
+
+static void lazy_stack_guard(uint8_t *page) {
+#ifdef MADV_GUARD_INSTALL
+  if (atomic_load_explicit(&lazy_stack_guard_madvise, memory_order_relaxed)) {
+    if (madvise(page, pagesize, MADV_GUARD_INSTALL) == 0) { return; }
+    atomic_store_explicit(&lazy_stack_guard_madvise, 0, memory_order_relaxed);
+  }
+#endif
+  if (mprotect(page, pagesize, PROT_NONE) != 0) {
+    perror("mprotect in lazy_stack_guard");
+  }
+}
+
+/* Map a new slab; returns its first stack and chains the rest through
+ * LAZY_STACK_NEXT(). */
+static void *lazy_stack_slab_new(void) {
+  qt_stack_slab_t *slab;
+  uint8_t *base;
+
+  base = mmap(NULL,
+              lazy_stack_span * LAZY_STACKS_PER_SLAB,
+              PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+              -1,
+              0);
+  if (base == MAP_FAILED) {
+    perror("mmap in lazy_stack_slab_new");
+    return NULL;
+  }
+  for (size_t i = 0; i < LAZY_STACKS_PER_SLAB; i++) {
+    uint8_t *stack = base + i * lazy_stack_span + pagesize;
+
+    lazy_stack_guard(stack - pagesize);
+    LAZY_STACK_NEXT(stack) =
+      (i + 1 < LAZY_STACKS_PER_SLAB) ? stack + lazy_stack_span : NULL;
+  }
+  slab = qt_malloc(sizeof(qt_stack_slab_t));
+  assert(slab);
+  slab->base = base;
+  QTHREAD_FASTLOCK_LOCK(&lazy_stack_slabs_lock);
+  slab->next = lazy_stack_slabs;
+  lazy_stack_slabs = slab;
+  QTHREAD_FASTLOCK_UNLOCK(&lazy_stack_slabs_lock);
+  return base + pagesize;
+}
+
+static void *lazy_stack_alloc(void) {
+  qt_stack_cache_t *cache = lazy_stack_cache();
+  void *stack;
+
+  QTHREAD_FASTLOCK_LOCK(&cache->lock);
+  stack = cache->head;
+  if (stack != NULL) {
+    cache->head = LAZY_STACK_NEXT(stack);
+    cache->count--;
+  }
+  QTHREAD_FASTLOCK_UNLOCK(&cache->lock);
+  if (stack != NULL) { return stack; }
+
+  stack = lazy_stack_slab_new();
+  if (stack != NULL) {
+    void *rest = LAZY_STACK_NEXT(stack);
+    void *last = rest;
+
+    if (rest != NULL) {
+      while (LAZY_STACK_NEXT(last) != NULL) { last = LAZY_STACK_NEXT(last); }
+      QTHREAD_FASTLOCK_LOCK(&cache->lock);
+      LAZY_STACK_NEXT(last) = cache->head;
+      cache->head = rest;
+      cache->count += LAZY_STACKS_PER_SLAB - 1;
+      QTHREAD_FASTLOCK_UNLOCK(&cache->lock);
+    }
+  }
+  return stack;
+}
+
+static void lazy_stack_free(void *stack) {
+  qt_stack_cache_t *cache = lazy_stack_cache();
+
+  /* the count is only a hint, so it is read without the lock; the pages must
+   * be released before the stack is visible to other allocators */
+  if (cache->count >= lazy_stack_highwater) {
+    madvise(stack, qlib->qthread_stack_size, QT_MADV_RELEASE);
+  }
+  QTHREAD_FASTLOCK_LOCK(&cache->lock);
+  LAZY_STACK_NEXT(stack) = cache->head;
+  cache->head = stack;
+  cache->count++;
+  QTHREAD_FASTLOCK_UNLOCK(&cache->lock);
+}
+
+static void lazy_stack_subsystem_init(void) {
+  size_t body;
+
+  /* Round the reservation up to whole pages, then let the stack grow into
+   * whatever the runtime data leaves of the top page, so a shallow task
+   * commits a single page. */
+  body = qlib->qthread_stack_size + sizeof(struct qthread_runtime_data_s);
+  body = (body + pagesize - 1) & ~(pagesize - 1);
+  qlib->qthread_stack_size =
+    (unsigned)((body - sizeof(struct qthread_runtime_data_s)) &
+               ~(size_t)(QTHREAD_STACK_ALIGNMENT - 1));
+  lazy_stack_span = pagesize + body;
+  lazy_stack_highwater = qt_internal_get_env_num(
+    "STACK_CACHE_HIGHWATER", 2 * LAZY_STACKS_PER_SLAB, 0);
+  lazy_stack_caches = qt_calloc(qlib->nshepherds + 1, sizeof(qt_stack_cache_t));
+  assert(lazy_stack_caches);
+  for (size_t i = 0; i <= qlib->nshepherds; i++) {
+    QTHREAD_FASTLOCK_INIT(lazy_stack_caches[i].lock);
+  }
+  lazy_stack_slabs = NULL;
+  QTHREAD_FASTLOCK_INIT(lazy_stack_slabs_lock);
+}
+
+/* Unmaps every slab, including the stacks of any task that never finished,
+ * just as destroying generic_stack_pool would. */
+static void lazy_stack_subsystem_destroy(void) {
+  while (lazy_stack_slabs != NULL) {
+    qt_stack_slab_t *slab = lazy_stack_slabs;
+
+    lazy_stack_slabs = slab->next;
+    munmap(slab->base, lazy_stack_span * LAZY_STACKS_PER_SLAB);
+    qt_free(slab);
+  }
+  for (size_t i = 0; i <= qlib->nshepherds; i++) {
+    QTHREAD_FASTLOCK_DESTROY(lazy_stack_caches[i].lock);
+  }
+  QTHREAD_FASTLOCK_DESTROY(lazy_stack_slabs_lock);
+  qt_free(lazy_stack_caches);
+  lazy_stack_caches = NULL;
+}
+
+/* Stack high-water mark (STACK_PEAK). A task records the deepest stack
+ * address it has been seen at: whenever it blocks or yields, and whenever it
+ * asks for its peak. Neither a recycled stack's old contents nor what the
+ * kernel keeps resident affect this; a deeper call that returned in between
+ * those points does not either, so it is a lower bound on the true peak. */
+static inline void qthread_stack_mark(qthread_t *t) {
+  char here;
+
+  if ((t->rdata->stack_low == 0) || ((uintptr_t)&here < t->rdata->stack_low)) {
+    t->rdata->stack_low = (uintptr_t)&here;
+  }
+}
+
+/* Scratch stacks (QT_SCRATCH_STACK). Each worker keeps the stack of the last
+ * task it ran to completion, and starts the next new task on it. A task that
+ * blocks or yields simply keeps the stack it is running on, so nothing is
+ * copied and pointers into its frames stay valid; the worker goes back to the
+ * stack pool for its next new task, and takes that task's stack as scratch
+ * when it completes. Tasks that never block therefore never touch the pool,
+ * and keep running on the same, cache-warm, memory. */
+static int scratch_stacks = 0;
+
+static inline void scratch_stack_keep(qthread_worker_t *w, qthread_t *t) {
+  if (scratch_stacks && (w->scratch_stack == NULL) && (t->rdata != NULL) &&
+      !(atomic_load_explicit(&t->flags, memory_order_relaxed) &
+        QTHREAD_SIMPLE)) {
+    w->scratch_stack = t->rdata->stack;
+    t->rdata->stack = NULL;
+  }
+}
+
 static qt_mpool generic_rdata_pool = NULL;
 #define ALLOC_RDATA()                                                          \
   (struct qthread_runtime_data_s *)qt_mpool_alloc(generic_rdata_pool)
@@ -189,12 +464,29 @@ int qthread_library_initialized = 0;
 void *shep0arg = NULL;
 #endif
 
-static inline void alloc_rdata(qthread_shepherd_t *me, qthread_t *t) {
+static inline void alloc_rdata(qthread_worker_t *w, qthread_t *t) {
+  qthread_shepherd_t *me = w->shepherd;
   void *stack = NULL;
   struct qthread_runtime_data_s *rdata;
 
   if (atomic_load_explicit(&t->flags, memory_order_relaxed) & QTHREAD_SIMPLE) {
     rdata = t->rdata = ALLOC_RDATA();
+  } else if (w->scratch_stack != NULL) {
+    /* laid out just like the stacks allocated below */
+    stack = w->scratch_stack;
+    w->scratch_stack = NULL;
+    rdata = t->rdata =
+      (struct qthread_runtime_data_s *)(((uint8_t *)stack) +
+                                        ((GUARD_PAGES && !lazy_stacks)
+                                           ? getpagesize()
+                                           : 0) +
+                                        qlib->qthread_stack_size);
+  } else if (lazy_stacks) {
+    stack = lazy_stack_alloc();
+    assert(stack);
+    rdata = t->rdata =
+      (struct qthread_runtime_data_s *)(((uint8_t *)stack) +
+                                        qlib->qthread_stack_size);
   } else {
     stack = ALLOC_STACK();
     assert(stack);
@@ -209,10 +501,14 @@ static inline void alloc_rdata(qthread_shepherd_t *me, qthread_t *t) {
     }
   }
   rdata->tasklocal_size = 0;
+  rdata->tls = NULL;
+  rdata->tls_size = 0;
   rdata->criticalsect = 0;
+  rdata->stack_low = 0;
   rdata->stack = stack;
   rdata->shepherd_ptr = me;
   rdata->blockedon.io = NULL;
+  atomic_init(&rdata->timer.state, QT_TIMER_IDLE);
 #ifdef QTHREAD_USE_VALGRIND
   if (stack) {
     rdata->valgrind_stack_id =
@@ -293,6 +589,36 @@ static inline void alloc_rdata(qthread_shepherd_t *me, qthread_t *t) {
 #define qthread_after_swap_from_main()
 #endif
 
+/* records why t stopped running on w */
+static void qthread_trace_stop(qthread_worker_t *w, qthread_t *t) {
+  switch (atomic_load_explicit(&t->thread_state, memory_order_relaxed)) {
+    case QTHREAD_STATE_MIGRATING:
+      qt_trace_record(w, QT_TRACE_MIGRATE, (uintptr_t)t, t->target_shepherd);
+      break;
+    case QTHREAD_STATE_YIELDED_NEAR:
+    case QTHREAD_STATE_YIELDED:
+      qt_trace_record(w, QT_TRACE_YIELD, (uintptr_t)t, 0);
+      break;
+    case QTHREAD_STATE_QUEUE:
+    case QTHREAD_STATE_PARKED:
+      qt_trace_record(w, QT_TRACE_QUEUE_BLOCK, (uintptr_t)t, 0);
+      break;
+    case QTHREAD_STATE_FEB_BLOCKED:
+      qt_trace_record(w, QT_TRACE_FEB_BLOCK, (uintptr_t)t, 0);
+      break;
+    case QTHREAD_STATE_PARENT_YIELD:
+      qt_trace_record(w, QT_TRACE_PARENT_BLOCK, (uintptr_t)t, 0);
+      break;
+    case QTHREAD_STATE_SYSCALL:
+      qt_trace_record(w, QT_TRACE_SYSCALL, (uintptr_t)t, 0);
+      break;
+    case QTHREAD_STATE_TERMINATED:
+      qt_trace_record(w, QT_TRACE_TERMINATE, (uintptr_t)t, 0);
+      break;
+    default: break;
+  }
+}
+
 /* the qthread_master() function is the loop responsible for actually
  * executing the work units
  *
@@ -356,6 +682,9 @@ static void *qthread_master(void *arg) {
     while (!atomic_load_explicit(&me_worker->active, memory_order_relaxed)) {
       SPINLOCK_BODY();
     }
+    /* completions are otherwise only reaped when the scheduler runs dry */
+    qt_blocking_subsystem_poll(me);
+    qt_timer_poll(me_worker);
     t = qt_scheduler_get_thread(
       threadqueue, atomic_load_explicit(&me->active, memory_order_relaxed));
     assert(t);
@@ -384,7 +713,7 @@ static void *qthread_master(void *arg) {
              atomic_load_explicit(&t->flags, memory_order_relaxed) &
                QTHREAD_REAL_MCCOY);
       if (t->rdata == NULL) {
-        alloc_rdata(me, t);
+        alloc_rdata(me_worker, t);
       } else {
         assert(t->rdata->shepherd_ptr != NULL);
         if (t->rdata->shepherd_ptr != me) { t->rdata->shepherd_ptr = me; }
@@ -395,6 +724,10 @@ static void *qthread_master(void *arg) {
           atomic_load_explicit(&qlib->shepherds[t->target_shepherd].active,
                                memory_order_relaxed)) {
         /* send this thread home */
+        if (unlikely(qt_trace_enabled)) {
+          qt_trace_record(
+            me_worker, QT_TRACE_MIGRATE, (uintptr_t)t, t->target_shepherd);
+        }
         t->rdata->shepherd_ptr = &qlib->shepherds[t->target_shepherd];
         assert(t->rdata->shepherd_ptr->ready != NULL);
         qt_threadqueue_enqueue(qlib->shepherds[t->target_shepherd].ready, t);
@@ -418,6 +751,12 @@ static void *qthread_master(void *arg) {
         assert(t->rdata->shepherd_ptr);
         if (t->rdata->shepherd_ptr == NULL) { t->rdata->shepherd_ptr = me; }
         assert(t->rdata->shepherd_ptr->ready != NULL);
+        if (unlikely(qt_trace_enabled)) {
+          qt_trace_record(me_worker,
+                          QT_TRACE_MIGRATE,
+                          (uintptr_t)t,
+                          t->rdata->shepherd_ptr->shepherd_id);
+        }
         qt_threadqueue_enqueue(t->rdata->shepherd_ptr->ready, t);
       } else { /* me->active */
 
@@ -426,12 +765,18 @@ static void *qthread_master(void *arg) {
 #ifdef USE_SYSTEM_SWAPCONTEXT
         getcontext(&my_context);
 #endif
+        if (unlikely(qt_trace_enabled)) {
+          qt_trace_record(me_worker, QT_TRACE_RUN, (uintptr_t)t, 0);
+        }
         qthread_exec(t, &my_context);
 
         t = *current; // necessary for direct-swap sanity
         atomic_store_explicit(
           current, NULL, memory_order_relaxed); // neessary for "queue sanity"
 
+        /* before the switch makes t visible to other workers */
+        if (unlikely(qt_trace_enabled)) { qthread_trace_stop(me_worker, t); }
+
         /* now clean up, based on the thread's state */
         switch (atomic_load_explicit(&t->thread_state, memory_order_relaxed)) {
           case QTHREAD_STATE_MIGRATING:
@@ -494,15 +839,30 @@ static void *qthread_master(void *arg) {
               &t->thread_state, QTHREAD_STATE_RUNNING, memory_order_relaxed);
             qt_blocking_subsystem_enqueue(t->rdata->blockedon.io);
             break;
+          case QTHREAD_STATE_SLEEPING:
+            /* its timer (on this worker) holds it until it is due */
+            break;
+          case QTHREAD_STATE_PARKED:
+            qthread_qlock_internal_park(t);
+            break;
           case QTHREAD_STATE_TERMINATED:
             /* we can remove the stack etc. */
             Q_PREFETCH(threadqueue);
+            scratch_stack_keep(me_worker, t);
             qthread_thread_free(t);
             break;
         }
       }
     }
   }
+  if (me_worker->scratch_stack != NULL) {
+    if (lazy_stacks) {
+      lazy_stack_free(me_worker->scratch_stack);
+    } else {
+      FREE_STACK(me_worker->scratch_stack);
+    }
+    me_worker->scratch_stack = NULL;
+  }
 
   if (my_id == 0 && me_worker->worker_id == 0) {
     qthread_before_swap_from_main();
@@ -576,6 +936,14 @@ int API_FUNC qthread_initialize(void) {
   MACHINE_FENCE;
 #endif
 
+#ifdef QTHREAD_MULTI_SCHEDULER
+  /* before the topology layer asks the scheduler about its policies */
+  {
+    char const *scheduler = qt_threadqueue_select();
+    if (print_info) { print_status("Using the %s scheduler.\n", scheduler); }
+  }
+#endif
+
   qt_topology_init(&nshepherds, &nworkerspershep, &hw_par);
 
   if ((nshepherds == 1) && (nworkerspershep == 1)) { need_sync = 0; }
@@ -619,6 +987,12 @@ int API_FUNC qthread_initialize(void) {
         pagesize - (qlib->qthread_stack_size % pagesize);
     }
   }
+  lazy_stacks = qt_internal_get_env_bool("LAZY_STACKS", 0);
+  if (lazy_stacks) {
+    lazy_stack_subsystem_init();
+    if (print_info) { print_status("Lazily-committed stacks enabled\n"); }
+  }
+  scratch_stacks = qt_internal_get_env_bool("SCRATCH_STACK", 1);
   if (print_info) {
     print_status("Using %u byte stack size.\n", qlib->qthread_stack_size);
   }
@@ -660,6 +1034,16 @@ int API_FUNC qthread_initialize(void) {
     assert(qlib->shepherds[0].sorted_sheplist);
     assert(qlib->shepherds[0].shep_dists);
   }
+  for (i = 0; i < nshepherds; i++) {
+    qthread_shepherd_t *const s = &qlib->shepherds[i];
+    qthread_shepherd_id_t n = 0;
+
+    while (n < nshepherds - 1 &&
+           s->shep_dists[s->sorted_sheplist[n]] < QTHREAD_DIST_REMOTE) {
+      n++;
+    }
+    s->steal_local = n;
+  }
 
   // Set task argument buffer size
   qlib->qthread_argcopy_size =
@@ -669,12 +1053,9 @@ int API_FUNC qthread_initialize(void) {
   qlib->qthread_tasklocal_size = qt_internal_get_env_num(
     "TASKLOCAL_SIZE", TASKLOCAL_DEFAULT, sizeof(void *));
 
-  generic_qthread_pool = qt_mpool_create_aligned(
-    sizeof(qthread_t) + sizeof(void *) + qlib->qthread_tasklocal_size,
-    qthread_cacheline());
-  generic_big_qthread_pool =
-    qt_mpool_create(sizeof(qthread_t) + qlib->qthread_argcopy_size +
-                    qlib->qthread_tasklocal_size);
+  /* keeps argument copies as aligned as malloc() would */
+  qthread_argcopy_offset = (qlib->qthread_tasklocal_size + 15) & ~(size_t)15;
+  qthread_size_classes_init();
   if (GUARD_PAGES) {
     generic_stack_pool = qt_mpool_create_aligned(
       qlib->qthread_stack_size + sizeof(struct qthread_runtime_data_s) +
@@ -687,12 +1068,16 @@ int API_FUNC qthread_initialize(void) {
   }
   generic_rdata_pool = qt_mpool_create(sizeof(struct qthread_runtime_data_s));
   initialize_hazardptrs();
+  qt_epoch_subsystem_init();
   qt_internal_teams_init();
   qthread_queue_subsystem_init();
   qt_feb_subsystem_init(need_sync);
   qt_syncvar_subsystem_init(need_sync);
+  qt_idle_subsystem_init();
   qt_threadqueue_subsystem_init();
   qt_blocking_subsystem_init();
+  qt_timer_subsystem_init();
+  qt_trace_subsystem_init();
 
   /* initialize the shepherd structures */
   for (i = 0; i < nshepherds; i++) {
@@ -744,6 +1129,9 @@ int API_FUNC qthread_initialize(void) {
   qlib->mccoy_thread->rdata->shepherd_ptr = &(qlib->shepherds[0]);
   qlib->mccoy_thread->rdata->stack = NULL;
   qlib->mccoy_thread->rdata->tasklocal_size = 0;
+  qlib->mccoy_thread->rdata->tls = NULL;
+  qlib->mccoy_thread->rdata->tls_size = 0;
+  atomic_init(&qlib->mccoy_thread->rdata->timer.state, QT_TIMER_IDLE);
 
 #if defined(__has_feature)
 #if __has_feature(thread_sanitizer)
@@ -1112,12 +1500,13 @@ void API_FUNC qthread_finalize(void) {
 #endif
 #endif
   assert(qlib->mccoy_thread->rdata->stack == NULL);
+  qt_tls_free(qlib->mccoy_thread->rdata);
   if (qlib->mccoy_thread->rdata->tasklocal_size > 0) {
     FREE(*(void **)&qlib->mccoy_thread->data[0],
          qlib->mccoy_thread->rdata->tasklocal_size);
   }
   FREE(qlib->mccoy_thread->rdata, sizeof(struct qthread_runtime_data_s));
-  FREE_QTHREAD(qlib->mccoy_thread);
+  qthread_struct_free(qlib->mccoy_thread);
   FREE(qlib->master_stack, qlib->master_stack_size);
   while (qt_cleanup_late_funcs != NULL) {
     struct qt_cleanup_funcs_s *tmp = qt_cleanup_late_funcs;
@@ -1137,12 +1526,14 @@ void API_FUNC qthread_finalize(void) {
     }
   }
 
-  qt_mpool_destroy(generic_qthread_pool);
-  generic_qthread_pool = NULL;
-  qt_mpool_destroy(generic_big_qthread_pool);
-  generic_big_qthread_pool = NULL;
+  for (unsigned c = 0; c < qthread_nclasses; c++) {
+    qt_mpool_destroy(qthread_pools[c]);
+    qthread_pools[c] = NULL;
+  }
+  qthread_nclasses = 0;
   qt_mpool_destroy(generic_stack_pool);
   generic_stack_pool = NULL;
+  if (lazy_stacks) { lazy_stack_subsystem_destroy(); }
   qt_mpool_destroy(generic_rdata_pool);
   generic_rdata_pool = NULL;
   FREE(qlib->shepherds, qlib->nshepherds * sizeof(qthread_shepherd_t));
@@ -1180,20 +1571,9 @@ void API_FUNC *qthread_get_tasklocal(unsigned int size) {
     unsigned int const tl_sz = f->rdata->tasklocal_size;
     if ((0 == tl_sz) && (size <= qlib->qthread_tasklocal_size)) {
       // Use default space
-      if (atomic_load_explicit(&f->flags, memory_order_relaxed) &
-          QTHREAD_BIG_STRUCT) {
-        return &f->data[qlib->qthread_argcopy_size];
-      } else {
-        return &f->data;
-      }
+      return &f->data;
     } else {
-      void **data_blob;
-      if (atomic_load_explicit(&f->flags, memory_order_relaxed) &
-          QTHREAD_BIG_STRUCT) {
-        data_blob = (void **)&f->data[qlib->qthread_argcopy_size];
-      } else {
-        data_blob = (void **)&f->data[0];
-      }
+      void **data_blob = (void **)&f->data[0];
       if (0 == tl_sz) {
         void *tmp_data = MALLOC(size);
         assert(NULL != tmp_data);
@@ -1266,12 +1646,38 @@ size_t API_FUNC qthread_stackleft(void) {
   }
 }
 
+/* Whether the caller's shepherd looks short of work: some worker has parked,
+ * or its ready queue holds fewer tasks than it has workers. It only reads a
+ * couple of counters, so lazily-splitting loops (qt_loop_adaptive) ask it
+ * between every few iterations. */
+int INTERNAL qthread_internal_work_wanted(void) {
+  qthread_shepherd_t *shep = qthread_internal_getshep();
+
+  if ((shep == NULL) || (qlib->nworkers_active <= 1)) { return 0; }
+  if (atomic_load_explicit(&qt_idle_nparked, memory_order_relaxed)) {
+    return 1;
+  }
+  return qt_threadqueue_advisory_queuelen(shep->ready) <
+         (ssize_t)qlib->nworkerspershep;
+}
+
 size_t API_FUNC qthread_readstate(const enum introspective_state type) {
   switch (type) {
     case STACK_SIZE: return qlib->qthread_stack_size;
 
     case RUNTIME_DATA_SIZE: return sizeof(struct qthread_runtime_data_s);
 
+    case STACK_PEAK: {
+      qthread_t *f = qthread_internal_self();
+
+      if ((f == NULL) || (f->rdata == NULL) || (f->rdata->stack == NULL)) {
+        return 0;
+      }
+      qthread_stack_mark(f);
+      /* the stack grows down from its runtime data */
+      return (uintptr_t)f->rdata - f->rdata->stack_low;
+    }
+
     case BUSYNESS: {
       qthread_shepherd_t *shep = qthread_internal_getshep();
       if (shep == NULL) {
@@ -1371,20 +1777,13 @@ aligned_t API_FUNC *qthread_retloc(void) {
 /************************************************************/
 /* functions to manage thread stack allocation/deallocation */
 /************************************************************/
-static inline qthread_t *qthread_thread_new(qthread_f const f,
-                                            void const *arg,
-                                            size_t arg_size,
-                                            void *ret,
-                                            qt_team_t *team,
-                                            int team_leader) {
-  qthread_t *t;
-
-  if ((arg_size > 0) && (arg_size <= qlib->qthread_argcopy_size)) {
-    t = ALLOC_BIG_QTHREAD();
-  } else {
-    t = ALLOC_QTHREAD();
-  }
-
+static inline void qthread_thread_init(qthread_t *t,
+                                       qthread_f const f,
+                                       void const *arg,
+                                       size_t arg_size,
+                                       void *ret,
+                                       qt_team_t *team,
+                                       int team_leader) {
   t->f = f;
   t->arg = (void *)arg;
   t->ret = ret;
@@ -1395,21 +1794,13 @@ static inline qthread_t *qthread_thread_new(qthread_f const f,
 
   t->target_shepherd = NO_SHEPHERD;
 
-  // should I use the builtin block for args?
+  // the struct was sized to hold the argument copy after the tasklocal space
+  // (which is left for the spawner to fill in if there is no arg)
   if (arg_size > 0) {
-    if (arg_size <= qlib->qthread_argcopy_size) {
-      t->arg = (void *)(&t->data);
-      atomic_store_explicit(
-        &t->flags, QTHREAD_BIG_STRUCT, memory_order_relaxed);
-    } else {
-      t->arg = MALLOC(arg_size);
-      atomic_store_explicit(
-        &t->flags, QTHREAD_HAS_ARGCOPY, memory_order_relaxed);
-    }
-    memcpy(t->arg, arg, arg_size);
-  } else {
-    atomic_store_explicit(&t->flags, 0, memory_order_relaxed);
+    t->arg = (void *)(&t->data[qthread_argcopy_offset]);
+    if (arg) { memcpy(t->arg, arg, arg_size); }
   }
+  atomic_store_explicit(&t->flags, 0, memory_order_relaxed);
 
   // am I the team leader?
   if (team_leader) {
@@ -1419,7 +1810,17 @@ static inline qthread_t *qthread_thread_new(qthread_f const f,
 
   atomic_store_explicit(
     &t->thread_state, QTHREAD_STATE_NEW, memory_order_relaxed);
+}
+
+static inline qthread_t *qthread_thread_new(qthread_f const f,
+                                            void const *arg,
+                                            size_t arg_size,
+                                            void *ret,
+                                            qt_team_t *team,
+                                            int team_leader) {
+  qthread_t *t = qthread_struct_alloc(qthread_size_class(arg_size), arg_size);
 
+  qthread_thread_init(t, f, arg, arg_size, ret, team, team_leader);
   return t;
 }
 
@@ -1427,16 +1828,10 @@ void qthread_thread_free(qthread_t *t) {
   assert(t != NULL);
 
   if (t->rdata != NULL) {
+    if (t->rdata->tls_size > 0) { qt_tls_destroy(t->rdata); }
     if (t->rdata->tasklocal_size > 0) {
-      if (atomic_load_explicit(&t->flags, memory_order_relaxed) &
-          QTHREAD_BIG_STRUCT) {
-        FREE(*(void **)&t->data[qlib->qthread_argcopy_size],
-             t->rdata->tasklocal_size);
-        *(void **)&t->data[qlib->qthread_argcopy_size] = NULL;
-      } else {
-        FREE(*(void **)&t->data[0], t->rdata->tasklocal_size);
-        *(void **)&t->data[0] = NULL;
-      }
+      FREE(*(void **)&t->data[0], t->rdata->tasklocal_size);
+      *(void **)&t->data[0] = NULL;
     }
 #ifdef QTHREAD_USE_VALGRIND
     VALGRIND_STACK_DEREGISTER(t->rdata->valgrind_stack_id);
@@ -1450,26 +1845,17 @@ void qthread_thread_free(qthread_t *t) {
     if (atomic_load_explicit(&t->flags, memory_order_relaxed) &
         QTHREAD_SIMPLE) {
       FREE_RDATA(t->rdata);
-    } else {
-      assert(t->rdata->stack);
-      FREE_STACK(t->rdata->stack);
+    } else if (t->rdata->stack != NULL) { /* unless kept as scratch */
+      if (lazy_stacks) {
+        lazy_stack_free(t->rdata->stack);
+      } else {
+        FREE_STACK(t->rdata->stack);
+      }
     }
 
     t->rdata = NULL;
   }
-  if (atomic_load_explicit(&t->flags, memory_order_relaxed) &
-      QTHREAD_HAS_ARGCOPY) {
-    assert(&t->data != t->arg);
-    qt_free(t->arg); // I don't record the size of this anywhere, so I can't
-                     // scribble it
-    t->arg = NULL;
-  }
-  if (atomic_load_explicit(&t->flags, memory_order_relaxed) &
-      QTHREAD_BIG_STRUCT) {
-    FREE_BIG_QTHREAD(t);
-  } else {
-    FREE_QTHREAD(t);
-  }
+  qthread_struct_free(t);
 }
 
 #ifdef QTHREAD_ALLOW_HPCTOOLKIT_STACK_UNWINDING
@@ -1487,7 +1873,7 @@ void API_FUNC
 qthread_call_method(qthread_f f, void *arg, void *ret, uint16_t flags) {
   if (ret) {
     if (flags & QTHREAD_RET_IS_SINC) {
-      if (flags & QTHREAD_RET_IS_VOID_SINC) {
+      if ((flags & QTHREAD_RET_IS_VOID_SINC) == QTHREAD_RET_IS_VOID_SINC) {
         (f)(arg);
         qt_sinc_submit((qt_sinc_t *)ret, NULL);
       } else {
@@ -1568,8 +1954,8 @@ static void qthread_wrapper(void *ptr) {
   if (t->ret) {
     if (atomic_load_explicit(&t->flags, memory_order_relaxed) &
         QTHREAD_RET_IS_SINC) {
-      if (atomic_load_explicit(&t->flags, memory_order_relaxed) &
-          QTHREAD_RET_IS_VOID_SINC) {
+      if ((atomic_load_explicit(&t->flags, memory_order_relaxed) &
+           QTHREAD_RET_IS_VOID_SINC) == QTHREAD_RET_IS_VOID_SINC) {
         (t->f)(t->arg);
         if (NULL != t->team) {
           qt_internal_teamfinish(
@@ -1780,14 +2166,17 @@ void API_FUNC qthread_flushsc(void) {}
 #define QTHREAD_SPAWN_MASK_TEAMS                                               \
   (QTHREAD_SPAWN_NEW_TEAM | QTHREAD_SPAWN_NEW_SUBTEAM)
 
-int API_FUNC qthread_spawn(qthread_f f,
-                           void const *arg,
-                           size_t arg_size,
-                           void *ret,
-                           size_t npreconds,
-                           void *preconds,
-                           qthread_shepherd_id_t target_shep,
-                           unsigned int feature_flag) {
+/* with init, the argument copy is built by init(copy, arg) instead of being
+ * copied from arg, once nothing else can make the spawn fail */
+static inline int qthread_spawn_inner(qthread_f f,
+                                      qthread_arg_init_f init,
+                                      void const *arg,
+                                      size_t arg_size,
+                                      void *ret,
+                                      size_t npreconds,
+                                      void *preconds,
+                                      qthread_shepherd_id_t target_shep,
+                                      unsigned int feature_flag) {
   assert(qthread_library_initialized);
   qthread_t *t;
   qthread_t *me = qthread_internal_self(); // note: cannot be myshep->current on
@@ -1863,7 +2252,7 @@ int API_FUNC qthread_spawn(qthread_f f,
   }
 
   t = qthread_thread_new(
-    f, arg, arg_size, (aligned_t *)ret, new_team, team_leader);
+    f, init ? NULL : arg, arg_size, (aligned_t *)ret, new_team, team_leader);
   qassert_ret(t, QTHREAD_MALLOC_ERROR);
 
   if (QTHREAD_UNLIKELY(target_shep != NO_SHEPHERD)) {
@@ -1917,6 +2306,7 @@ int API_FUNC qthread_spawn(qthread_f f,
       return test;
     }
   }
+  if (init) { init(t->arg, (void *)arg); }
   /* Step 5: Prepare the input preconditions (if necessary) */
   if (QTHREAD_LIKELY(!preconds) || (qthread_check_feb_preconds(t) == 0)) {
     /* Step 6: Set it going */
@@ -1942,6 +2332,182 @@ int API_FUNC qthread_spawn(qthread_f f,
   return QTHREAD_SUCCESS;
 }
 
+int API_FUNC qthread_spawn(qthread_f f,
+                           void const *arg,
+                           size_t arg_size,
+                           void *ret,
+                           size_t npreconds,
+                           void *preconds,
+                           qthread_shepherd_id_t target_shep,
+                           unsigned int feature_flag) {
+  return qthread_spawn_inner(f,
+                             NULL,
+                             arg,
+                             arg_size,
+                             ret,
+                             npreconds,
+                             preconds,
+                             target_shep,
+                             feature_flag);
+}
+
+int API_FUNC qthread_spawn_init(qthread_f f,
+                                qthread_arg_init_f init,
+                                void *arg,
+                                size_t arg_size,
+                                void *ret,
+                                qthread_shepherd_id_t target_shep,
+                                unsigned int feature_flag) {
+  qassert_ret(f && init && arg_size > 0, QTHREAD_BADARGS);
+  return qthread_spawn_inner(
+    f, init, arg, arg_size, ret, 0, NULL, target_shep, feature_flag);
+}
+
+/**
+ * Spawn count qthreads running f at once: they are allocated from the qthread
+ * pool in bulk and handed to the scheduler as one chain per destination
+ * shepherd, rather than with an enqueue apiece.
+ *
+ * Task i gets a copy of the i-th arg_size-byte element of args (or args
+ * itself, if arg_size is 0). Its return value goes to the i-th element of
+ * rets, an array of aligned_t or, with QTHREAD_SPAWN_RET_SYNCVAR_T, of
+ * syncvar_t; with QTHREAD_SPAWN_RET_SINC(_VOID) all tasks submit to the single
+ * sinc rets. QTHREAD_SPAWN_SPREAD deals the tasks out round-robin, one chain
+ * per shepherd, starting from the usual destination (or target_shep). New
+ * teams are not supported.
+ */
+int API_FUNC qthread_spawn_many(qthread_f f,
+                                void const *args,
+                                size_t arg_size,
+                                void *rets,
+                                size_t count,
+                                qthread_shepherd_id_t target_shep,
+                                unsigned int feature_flag) {
+  assert(qthread_library_initialized);
+  qthread_t *me = qthread_internal_self();
+  qt_team_t *team = (me && me->team) ? me->team : NULL;
+  unsigned const ret_type =
+    feature_flag & (QTHREAD_SPAWN_RET_SYNCVAR_T | QTHREAD_SPAWN_RET_SINC |
+                    QTHREAD_SPAWN_RET_SINC_VOID);
+  qthread_shepherd_id_t dest_shep;
+  qthread_t **ts;
+  size_t nchains, done;
+  uint32_t flags = 0;
+  unsigned const size_class = qthread_size_class(arg_size);
+
+  qassert_ret(!(feature_flag & QTHREAD_SPAWN_MASK_TEAMS), QTHREAD_BADARGS);
+  if (count == 0) { return QTHREAD_SUCCESS; }
+
+  if (target_shep != NO_SHEPHERD) {
+    dest_shep = target_shep % qlib->nshepherds;
+    flags |= QTHREAD_UNSTEALABLE;
+  } else {
+    dest_shep =
+      qt_threadqueue_choose_dest(me ? me->rdata->shepherd_ptr : NULL);
+  }
+  if (feature_flag & QTHREAD_SPAWN_SIMPLE) { flags |= QTHREAD_SIMPLE; }
+  if (feature_flag & QTHREAD_SPAWN_NETWORK) { flags |= QTHREAD_NETWORK; }
+  switch (ret_type) {
+    case QTHREAD_SPAWN_RET_SYNCVAR_T: flags |= QTHREAD_RET_IS_SYNCVAR; break;
+    case QTHREAD_SPAWN_RET_SINC: flags |= QTHREAD_RET_IS_SINC; break;
+    case QTHREAD_SPAWN_RET_SINC_VOID: flags |= QTHREAD_RET_IS_VOID_SINC; break;
+  }
+
+  ts = qt_malloc(sizeof(qthread_t *) * count);
+  qassert_ret(ts, QTHREAD_MALLOC_ERROR);
+  if (QTHREAD_LIKELY(size_class != QTHREAD_HEAP_CLASS)) {
+    qt_mpool_alloc_many(qthread_pools[size_class], (void **)ts, count);
+    for (size_t i = 0; i < count; i++) { ts[i]->size_class = size_class; }
+  } else {
+    for (size_t i = 0; i < count; i++) {
+      ts[i] = qthread_struct_alloc(size_class, arg_size);
+    }
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    qthread_t *t = ts[i];
+    void *ret = NULL;
+    int test = QTHREAD_SUCCESS;
+
+    if (rets) {
+      switch (ret_type) {
+        case QTHREAD_SPAWN_RET_SYNCVAR_T:
+          ret = (syncvar_t *)rets + i;
+          if (qthread_syncvar_status(ret)) {
+            test = qthread_syncvar_empty(ret);
+          }
+          break;
+        case QTHREAD_SPAWN_RET_SINC:
+        case QTHREAD_SPAWN_RET_SINC_VOID: ret = rets; break;
+        default:
+          ret = (aligned_t *)rets + i;
+          test = qthread_empty(ret);
+          break;
+      }
+    }
+    qthread_thread_init(t,
+                        f,
+                        arg_size ? (uint8_t const *)args + i * arg_size : args,
+                        arg_size,
+                        ret,
+                        team,
+                        0);
+    if (flags) {
+      atomic_store_explicit(
+        &t->flags,
+        atomic_load_explicit(&t->flags, memory_order_relaxed) | flags,
+        memory_order_relaxed);
+    }
+    t->preconds = NULL;
+    if (QTHREAD_UNLIKELY(test != QTHREAD_SUCCESS)) {
+      for (size_t j = 0; j <= i; j++) { qthread_thread_free(ts[j]); }
+      for (size_t j = i + 1; j < count; j++) {
+        /* never initialized; free them by hand */
+        qthread_struct_free(ts[j]);
+      }
+      qt_free(ts);
+      return test;
+    }
+  }
+  if (team) { qt_sinc_expect(team->sinc, count); }
+#ifdef QTHREAD_COUNT_THREADS
+  QTHREAD_FASTLOCK_LOCK(&concurrentthreads_lock);
+  for (size_t i = 0; i < count; i++) {
+    threadcount++;
+    concurrentthreads++;
+    if (concurrentthreads > maxconcurrentthreads) {
+      maxconcurrentthreads = concurrentthreads;
+    }
+    avg_concurrent_threads =
+      (avg_concurrent_threads * (double)(threadcount - 1.0) / threadcount) +
+      ((double)concurrentthreads / threadcount);
+  }
+  QTHREAD_FASTLOCK_UNLOCK(&concurrentthreads_lock);
+#endif /* ifdef QTHREAD_COUNT_THREADS */
+
+  nchains = 1;
+  if ((feature_flag & QTHREAD_SPAWN_SPREAD) && (qlib->nshepherds > 1)) {
+    nchains = (count < qlib->nshepherds) ? count : qlib->nshepherds;
+  }
+  done = 0;
+  for (size_t c = 0; c < nchains; c++) {
+    size_t const len = (count - done) / (nchains - c);
+    qthread_shepherd_id_t const shep =
+      (qthread_shepherd_id_t)((dest_shep + c) % qlib->nshepherds);
+
+    if (QTHREAD_UNLIKELY(target_shep != NO_SHEPHERD)) {
+      for (size_t i = done; i < done + len; i++) {
+        ts[i]->target_shepherd = shep;
+      }
+    }
+    qt_threadqueue_enqueue_many(qlib->threadqueues[shep], ts + done, len);
+    done += len;
+  }
+  qt_free(ts);
+
+  return QTHREAD_SUCCESS;
+}
+
 int API_FUNC qthread_fork(qthread_f f, void const *arg, aligned_t *ret) {
   return qthread_spawn(f, arg, 0, ret, 0, NULL, NO_SHEPHERD, 0);
 }
@@ -2082,6 +2648,39 @@ int API_FUNC qthread_fork_precond(
   return qthread_spawn(f, arg, 0, ret, npreconds, preconds, NO_SHEPHERD, 0);
 }
 
+/*
+ * A continuation is a task with preconditions: qthread_check_feb_preconds()
+ * queues it on the first of its return locations that is still empty, and
+ * re-checks the rest each time one fills, so it only takes a qthread struct
+ * (and the precondition list) until it can run.
+ */
+int API_FUNC qthread_when_all(aligned_t *const *rets,
+                              size_t n,
+                              qthread_f f,
+                              void const *arg,
+                              aligned_t *result) {
+  aligned_t **preconds = NULL;
+
+  qassert_ret(f, QTHREAD_BADARGS);
+  qassert_ret(rets || (n == 0), QTHREAD_BADARGS);
+  if (n > 0) {
+    for (size_t i = 0; i < n; i++) { qassert_ret(rets[i], QTHREAD_BADARGS); }
+    preconds = MALLOC((n + 1) * sizeof(aligned_t *));
+    qassert_ret(preconds, QTHREAD_MALLOC_ERROR);
+    preconds[0] = (aligned_t *)(uintptr_t)n;
+    memcpy(preconds + 1, rets, n * sizeof(aligned_t *));
+  }
+  return qthread_spawn(f, arg, 0, result, n, preconds, NO_SHEPHERD, 0);
+}
+
+int API_FUNC qthread_then(aligned_t *ret,
+                          qthread_f f,
+                          void const *arg,
+                          aligned_t *result) {
+  qassert_ret(ret, QTHREAD_BADARGS);
+  return qthread_when_all(&ret, 1, f, arg, result);
+}
+
 int API_FUNC qthread_fork_copyargs_to(qthread_f f,
                                       void const *arg,
                                       size_t arg_size,
@@ -2146,6 +2745,7 @@ int API_FUNC qthread_fork_syncvar_to(qthread_f f,
 void INTERNAL qthread_back_to_master(qthread_t *t) {
   assert((atomic_load_explicit(&t->flags, memory_order_relaxed) &
           QTHREAD_SIMPLE) == 0);
+  qthread_stack_mark(t);
 #ifdef QTHREAD_USE_VALGRIND
   VALGRIND_CHECK_MEM_IS_ADDRESSABLE(&t->rdata->context, sizeof(qt_context_t));
   VALGRIND_CHECK_MEM_IS_ADDRESSABLE(
@@ -1,8 +1,15 @@
 /* System Headers */
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 /* API Headers */
 #include <qthread/cacheline.h>
 #include <qthread/qthread.h>
@@ -1030,4 +1037,592 @@ void API_FUNC qutil_aligned_qsort(aligned_t *array, size_t const length) {
   qutil_aligned_qsort_inner(&arg);
 }
 
+/* Parallel LSD radix sort and sample sort.
+ *
+ * Both sort 64-bit unsigned keys; doubles are first mapped, in place, to keys
+ * that compare the same way (flipping the sign bit of positive numbers and
+ * every bit of negative ones), and mapped back at the end. The array is split
+ * into one contiguous block per task (no more tasks than workers, and none
+ * with fewer than QUTIL_SORT_BLOCK elements); each task counts its block into
+ * a histogram of its own, a serial prefix sum over all of them gives each
+ * task where in the output every bucket of its block goes, and the tasks then
+ * scatter their blocks there in parallel, which keeps the sort stable.
+ *
+ * The radix sort does that once for each byte of the key, least significant
+ * first, skipping the bytes that are the same in every key (which one pass
+ * over the array, counting all of them at once, finds out).
+ *
+ * The sample sort picks 2^logb - 1 splitters from a sorted random sample,
+ * puts each key in the bucket between the splitters it falls between (a
+ * branch-free walk down a search tree of them, done for several keys at a
+ * time with AVX2, SSE4.2 or NEON where the compiler targets them), scatters
+ * the buckets as above, and then radix sorts every bucket in a task of its
+ * own. */
+
+#define QUTIL_RADIX_BITS 8
+#define QUTIL_RADIX (1 << QUTIL_RADIX_BITS)
+#define QUTIL_KEY_DIGITS (64 / QUTIL_RADIX_BITS)
+#define QUTIL_SORT_BLOCK 16384   /* the fewest elements worth a task */
+#define QUTIL_SORT_INSERTION 32  /* insertion sort anything this small */
+#define QUTIL_SAMPLE_OVERSAMPLE 16
+#define QUTIL_SAMPLE_MAX_LOGB 8 /* so that a bucket fits in a uint8_t */
+
+#define QUTIL_DIGIT(k, d)                                                      \
+  ((size_t)((k) >> ((d) * QUTIL_RADIX_BITS)) & (QUTIL_RADIX - 1))
+/* task t's histogram of digit d */
+#define QUTIL_RADIX_COUNTS(s, t, d)                                            \
+  ((s)->counts + ((t) * QUTIL_KEY_DIGITS + (d)) * QUTIL_RADIX)
+
+typedef struct qutil_sort_s {
+  uint64_t *src; /* the keys of the current pass */
+  uint64_t *dst; /* where it puts them */
+  uint64_t *home; /* where they must end up: src or dst */
+  aligned_t *vsrc, *vdst, *vhome; /* values to move with them, or NULL */
+  size_t n;
+  size_t ntasks;
+  size_t *counts; /* a histogram for each task, then where its buckets go */
+  int map_in;     /* src holds doubles, to be mapped to keys */
+  int map_out;    /* ...and the sorted keys should be mapped back */
+  unsigned digit; /* the one the current radix pass sorts on */
+
+  /* sample sort */
+  unsigned logb;
+  uint8_t *oracle; /* which bucket each key goes to */
+  size_t *bounds;  /* where each bucket starts, once scattered */
+  uint64_t tree[1 << QUTIL_SAMPLE_MAX_LOGB]; /* splitters, rooted at 1 */
+} qutil_sort_t;
+
+typedef struct {
+  qutil_sort_t *s;
+  size_t id;
+} qutil_sort_task_t;
+
+static inline uint64_t qutil_double_to_key(uint64_t u) {
+  return u ^ ((uint64_t)((int64_t)u >> 63) | (UINT64_C(1) << 63));
+}
+
+static inline uint64_t qutil_key_to_double(uint64_t k) {
+  return k ^ (((k >> 63) - 1) | (UINT64_C(1) << 63));
+}
+
+static size_t qutil_sort_ntasks(size_t n) {
+  size_t const workers = qthread_num_workers();
+  size_t const tasks = n / QUTIL_SORT_BLOCK;
+
+  if (tasks < 1) { return 1; }
+  return (tasks > workers) ? workers : tasks;
+}
+
+static inline void qutil_sort_block(qutil_sort_t const *s,
+                                    size_t id,
+                                    size_t *start,
+                                    size_t *stop) {
+  *start = s->n * id / s->ntasks;
+  *stop = s->n * (id + 1) / s->ntasks;
+}
+
+/* runs f once for each of s->ntasks tasks (the first of them in the caller),
+ * and waits for them all */
+static void qutil_sort_run(qutil_sort_t *s, qthread_f f) {
+  qutil_sort_task_t *tasks;
+  aligned_t *rets;
+
+  tasks = MALLOC(sizeof(qutil_sort_task_t) * s->ntasks);
+  rets = MALLOC(sizeof(aligned_t) * s->ntasks);
+  assert(tasks && rets);
+  for (size_t i = 0; i < s->ntasks; i++) {
+    tasks[i].s = s;
+    tasks[i].id = i;
+    if (i > 0) { qthread_fork(f, tasks + i, rets + i); }
+  }
+  f(tasks);
+  for (size_t i = 1; i < s->ntasks; i++) { qthread_readFF(NULL, rets + i); }
+  FREE(rets, sizeof(aligned_t) * s->ntasks);
+  FREE(tasks, sizeof(qutil_sort_task_t) * s->ntasks);
+}
+
+/* Turns the histograms of every task (counts[t * stride + b], for nbins
+ * buckets b) into where each task puts the first key of each bucket */
+static void qutil_sort_offsets(size_t *counts,
+                               size_t ntasks,
+                               size_t stride,
+                               size_t nbins) {
+  size_t sum = 0;
+
+  for (size_t b = 0; b < nbins; b++) {
+    for (size_t t = 0; t < ntasks; t++) {
+      size_t const c = counts[t * stride + b];
+
+      counts[t * stride + b] = sum;
+      sum += c;
+    }
+  }
+}
+
+static void
+qutil_sort_insertion(uint64_t *keys, aligned_t *vals, size_t n) {
+  for (size_t i = 1; i < n; i++) {
+    uint64_t const k = keys[i];
+    aligned_t const v = vals ? vals[i] : 0;
+    size_t j = i;
+
+    while (j > 0 && keys[j - 1] > k) {
+      keys[j] = keys[j - 1];
+      if (vals) { vals[j] = vals[j - 1]; }
+      j--;
+    }
+    keys[j] = k;
+    if (vals) { vals[j] = v; }
+  }
+}
+
+/* counts every digit of the task's block at once, mapping doubles on the way
+ */
+static aligned_t qutil_radix_count_all(void *arg) {
+  qutil_sort_task_t const *task = (qutil_sort_task_t *)arg;
+  qutil_sort_t *s = task->s;
+  size_t *c = QUTIL_RADIX_COUNTS(s, task->id, 0);
+  size_t start, stop;
+
+  qutil_sort_block(s, task->id, &start, &stop);
+  memset(c, 0, sizeof(size_t) * QUTIL_KEY_DIGITS * QUTIL_RADIX);
+  for (size_t i = start; i < stop; i++) {
+    uint64_t k = s->src[i];
+
+    if (s->map_in) { s->src[i] = k = qutil_double_to_key(k); }
+    for (unsigned d = 0; d < QUTIL_KEY_DIGITS; d++) {
+      c[d * QUTIL_RADIX + QUTIL_DIGIT(k, d)]++;
+    }
+  }
+  return 0;
+}
+
+static aligned_t qutil_radix_count(void *arg) {
+  qutil_sort_task_t const *task = (qutil_sort_task_t *)arg;
+  qutil_sort_t *s = task->s;
+  unsigned const d = s->digit;
+  size_t *c = QUTIL_RADIX_COUNTS(s, task->id, d);
+  size_t start, stop;
+
+  qutil_sort_block(s, task->id, &start, &stop);
+  memset(c, 0, sizeof(size_t) * QUTIL_RADIX);
+  for (size_t i = start; i < stop; i++) {
+    c[QUTIL_DIGIT(s->src[i], d)]++;
+  }
+  return 0;
+}
+
+static aligned_t qutil_radix_scatter(void *arg) {
+  qutil_sort_task_t const *task = (qutil_sort_task_t *)arg;
+  qutil_sort_t *s = task->s;
+  unsigned const d = s->digit;
+  size_t *c = QUTIL_RADIX_COUNTS(s, task->id, d);
+  size_t start, stop;
+
+  qutil_sort_block(s, task->id, &start, &stop);
+  if (s->vsrc) {
+    for (size_t i = start; i < stop; i++) {
+      size_t const o = c[QUTIL_DIGIT(s->src[i], d)]++;
+
+      s->dst[o] = s->src[i];
+      s->vdst[o] = s->vsrc[i];
+    }
+  } else {
+    for (size_t i = start; i < stop; i++) {
+      s->dst[c[QUTIL_DIGIT(s->src[i], d)]++] = s->src[i];
+    }
+  }
+  return 0;
+}
+
+/* moves the sorted keys from src to home, mapping doubles back on the way */
+static aligned_t qutil_radix_finish(void *arg) {
+  qutil_sort_task_t const *task = (qutil_sort_task_t *)arg;
+  qutil_sort_t *s = task->s;
+  size_t start, stop;
+
+  qutil_sort_block(s, task->id, &start, &stop);
+  if (s->map_out) {
+    for (size_t i = start; i < stop; i++) {
+      s->home[i] = qutil_key_to_double(s->src[i]);
+    }
+  } else if (s->src != s->home) {
+    memcpy(s->home + start, s->src + start, (stop - start) * sizeof(uint64_t));
+  }
+  if (s->vsrc && s->vsrc != s->vhome) {
+    memcpy(
+      s->vhome + start, s->vsrc + start, (stop - start) * sizeof(aligned_t));
+  }
+  return 0;
+}
+
+/* Sorts the s->n keys in s->src (and values in s->vsrc, if there are any)
+ * into s->home, which is either s->src or s->dst, using the other as scratch
+ * space; s->ntasks must be set. */
+static void qutil_radix_sort_internal(qutil_sort_t *s) {
+  int passes = 0;
+
+  if (s->n <= QUTIL_SORT_INSERTION) {
+    if (s->map_in) {
+      for (size_t i = 0; i < s->n; i++) {
+        s->src[i] = qutil_double_to_key(s->src[i]);
+      }
+    }
+    qutil_sort_insertion(s->src, s->vsrc, s->n);
+    s->ntasks = 1;
+    qutil_radix_finish(&(qutil_sort_task_t){s, 0});
+    return;
+  }
+  s->counts =
+    MALLOC(sizeof(size_t) * s->ntasks * QUTIL_KEY_DIGITS * QUTIL_RADIX);
+  assert(s->counts);
+  qutil_sort_run(s, qutil_radix_count_all);
+  for (unsigned d = 0; d < QUTIL_KEY_DIGITS; d++) {
+    /* how many keys share the first one's digit: if all do, skip it */
+    size_t const b = QUTIL_DIGIT(s->src[0], d);
+    size_t same = 0;
+
+    for (size_t t = 0; t < s->ntasks; t++) {
+      same += QUTIL_RADIX_COUNTS(s, t, d)[b];
+    }
+    if (same == s->n) { continue; }
+
+    s->digit = d;
+    /* the first pass can use what qutil_radix_count_all() counted */
+    if (passes > 0) { qutil_sort_run(s, qutil_radix_count); }
+    qutil_sort_offsets(QUTIL_RADIX_COUNTS(s, 0, d),
+                       s->ntasks,
+                       QUTIL_KEY_DIGITS * QUTIL_RADIX,
+                       QUTIL_RADIX);
+    qutil_sort_run(s, qutil_radix_scatter);
+    {
+      uint64_t *k = s->src;
+      aligned_t *v = s->vsrc;
+
+      s->src = s->dst;
+      s->dst = k;
+      s->vsrc = s->vdst;
+      s->vdst = v;
+    }
+    passes++;
+  }
+  if ((s->src != s->home) || s->map_out) {
+    qutil_sort_run(s, qutil_radix_finish);
+  }
+  FREE(s->counts, sizeof(size_t) * s->ntasks * QUTIL_KEY_DIGITS * QUTIL_RADIX);
+  s->counts = NULL;
+}
+
+static void qutil_radix_sort(uint64_t *keys,
+                             aligned_t *vals,
+                             size_t n,
+                             int doubles) {
+  qutil_sort_t s;
+  uint64_t *tkeys = NULL;
+  aligned_t *tvals = NULL;
+
+  assert(qthread_library_initialized);
+  if (n < 2) { return; }
+  memset(&s, 0, sizeof(qutil_sort_t));
+  if (n > QUTIL_SORT_INSERTION) {
+    tkeys = MALLOC(sizeof(uint64_t) * n);
+    assert(tkeys);
+    if (vals) {
+      tvals = MALLOC(sizeof(aligned_t) * n);
+      assert(tvals);
+    }
+  }
+  s.src = s.home = keys;
+  s.vsrc = s.vhome = vals;
+  s.dst = tkeys;
+  s.vdst = tvals;
+  s.n = n;
+  s.ntasks = qutil_sort_ntasks(n);
+  s.map_in = s.map_out = doubles;
+  qutil_radix_sort_internal(&s);
+  if (tkeys) { FREE(tkeys, sizeof(uint64_t) * n); }
+  if (tvals) { FREE(tvals, sizeof(aligned_t) * n); }
+}
+
+/* Puts each of the n keys in its bucket (in oracle) and counts the buckets
+ * (in c), given the 2^logb - 1 splitters in tree[1..] as an implicit search
+ * tree: the bucket of k is the number of splitters below it. */
+static void qutil_sample_classify(uint64_t const *tree,
+                                  unsigned logb,
+                                  uint64_t const *keys,
+                                  size_t n,
+                                  uint8_t *oracle,
+                                  size_t *c) {
+  size_t const nbuckets = (size_t)1 << logb;
+  size_t i = 0;
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+  /* There is only a signed 64-bit compare, so flip everyone's sign bit. */
+  int64_t btree[1 << QUTIL_SAMPLE_MAX_LOGB];
+
+  for (size_t j = 1; j < nbuckets; j++) {
+    btree[j] = (int64_t)(tree[j] ^ (UINT64_C(1) << 63));
+  }
+#endif
+#if defined(__AVX2__)
+  {
+    __m256i const bias = _mm256_set1_epi64x(INT64_MIN);
+    __m256i const base = _mm256_set1_epi64x((long long)nbuckets);
+
+    for (; i + 4 <= n; i += 4) {
+      __m256i const k = _mm256_xor_si256(
+        _mm256_loadu_si256((__m256i const *)(keys + i)), bias);
+      __m256i j = _mm256_set1_epi64x(1);
+      uint64_t b[4];
+
+      for (unsigned l = 0; l < logb; l++) {
+        __m256i const sp =
+          _mm256_i64gather_epi64((long long const *)btree, j, 8);
+
+        /* the compare gives -1 where k is greater */
+        j = _mm256_sub_epi64(_mm256_add_epi64(j, j), _mm256_cmpgt_epi64(k, sp));
+      }
+      _mm256_storeu_si256((__m256i *)b, _mm256_sub_epi64(j, base));
+      for (int l = 0; l < 4; l++) {
+        oracle[i + l] = (uint8_t)b[l];
+        c[b[l]]++;
+      }
+    }
+  }
+#elif defined(__SSE4_2__)
+  {
+    __m128i const bias = _mm_set1_epi64x(INT64_MIN);
+
+    for (; i + 2 <= n; i += 2) {
+      __m128i const k =
+        _mm_xor_si128(_mm_loadu_si128((__m128i const *)(keys + i)), bias);
+      size_t j0 = 1, j1 = 1;
+
+      for (unsigned l = 0; l < logb; l++) {
+        int const gt = _mm_movemask_pd(_mm_castsi128_pd(
+          _mm_cmpgt_epi64(k, _mm_set_epi64x(btree[j1], btree[j0]))));
+
+        j0 = 2 * j0 + (gt & 1);
+        j1 = 2 * j1 + (gt >> 1);
+      }
+      oracle[i] = (uint8_t)(j0 - nbuckets);
+      oracle[i + 1] = (uint8_t)(j1 - nbuckets);
+      c[j0 - nbuckets]++;
+      c[j1 - nbuckets]++;
+    }
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 2 <= n; i += 2) {
+    uint64x2_t const k = vld1q_u64(keys + i);
+    size_t j0 = 1, j1 = 1;
+
+    for (unsigned l = 0; l < logb; l++) {
+      uint64x2_t const gt = vcgtq_u64(
+        k, vcombine_u64(vcreate_u64(tree[j0]), vcreate_u64(tree[j1])));
+
+      j0 = 2 * j0 + (vgetq_lane_u64(gt, 0) & 1);
+      j1 = 2 * j1 + (vgetq_lane_u64(gt, 1) & 1);
+    }
+    oracle[i] = (uint8_t)(j0 - nbuckets);
+    oracle[i + 1] = (uint8_t)(j1 - nbuckets);
+    c[j0 - nbuckets]++;
+    c[j1 - nbuckets]++;
+  }
+#endif
+  for (; i < n; i++) {
+    size_t j = 1;
+
+    for (unsigned l = 0; l < logb; l++) { j = 2 * j + (keys[i] > tree[j]); }
+    oracle[i] = (uint8_t)(j - nbuckets);
+    c[j - nbuckets]++;
+  }
+}
+
+static aligned_t qutil_sample_count(void *arg) {
+  qutil_sort_task_t const *task = (qutil_sort_task_t *)arg;
+  qutil_sort_t *s = task->s;
+  size_t *c = s->counts + (task->id << s->logb);
+  size_t start, stop;
+
+  qutil_sort_block(s, task->id, &start, &stop);
+  memset(c, 0, sizeof(size_t) << s->logb);
+  if (s->map_in) {
+    for (size_t i = start; i < stop; i++) {
+      s->src[i] = qutil_double_to_key(s->src[i]);
+    }
+  }
+  qutil_sample_classify(
+    s->tree, s->logb, s->src + start, stop - start, s->oracle + start, c);
+  return 0;
+}
+
+static aligned_t qutil_sample_scatter(void *arg) {
+  qutil_sort_task_t const *task = (qutil_sort_task_t *)arg;
+  qutil_sort_t *s = task->s;
+  size_t *c = s->counts + (task->id << s->logb);
+  size_t start, stop;
+
+  qutil_sort_block(s, task->id, &start, &stop);
+  for (size_t i = start; i < stop; i++) {
+    s->dst[c[s->oracle[i]]++] = s->src[i];
+  }
+  return 0;
+}
+
+/* radix sorts bucket task->id from dst back into src */
+static aligned_t qutil_sample_bucket(void *arg) {
+  qutil_sort_task_t const *task = (qutil_sort_task_t *)arg;
+  qutil_sort_t const *s = task->s;
+  size_t const start = s->bounds[task->id];
+  qutil_sort_t b;
+
+  memset(&b, 0, sizeof(qutil_sort_t));
+  b.n = s->bounds[task->id + 1] - start;
+  if (b.n == 0) { return 0; }
+  b.src = s->dst + start;
+  b.dst = b.home = s->src + start;
+  b.ntasks = qutil_sort_ntasks(b.n);
+  b.map_out = s->map_out;
+  qutil_radix_sort_internal(&b);
+  return 0;
+}
+
+/* the splitters, in order, into an implicit search tree rooted at j */
+static void qutil_sample_tree(uint64_t *tree,
+                              size_t nbuckets,
+                              size_t j,
+                              uint64_t const **splitters) {
+  if (j >= nbuckets) { return; }
+  qutil_sample_tree(tree, nbuckets, 2 * j, splitters);
+  tree[j] = *(*splitters)++;
+  qutil_sample_tree(tree, nbuckets, 2 * j + 1, splitters);
+}
+
+static void qutil_sample_sort(uint64_t *keys, size_t n, int doubles) {
+  qutil_sort_t s;
+  size_t nbuckets, nsample;
+  uint64_t *sample;
+  uint64_t const *splitters;
+  uint64_t rng = 0x9E3779B97F4A7C15ull;
+
+  assert(qthread_library_initialized);
+  if ((n < 2 * QUTIL_SORT_BLOCK) || (qthread_num_workers() == 1)) {
+    /* not worth splitting up */
+    qutil_radix_sort(keys, NULL, n, doubles);
+    return;
+  }
+  memset(&s, 0, sizeof(qutil_sort_t));
+  s.n = n;
+  s.ntasks = qutil_sort_ntasks(n);
+  s.map_in = s.map_out = doubles;
+  /* about four buckets per worker, so that they balance out */
+  s.logb = 1;
+  while ((s.logb < QUTIL_SAMPLE_MAX_LOGB) &&
+         ((size_t)1 << s.logb) < 4 * qthread_num_workers()) {
+    s.logb++;
+  }
+  nbuckets = (size_t)1 << s.logb;
+
+  /* the splitters are evenly spaced in a sorted random sample */
+  nsample = QUTIL_SAMPLE_OVERSAMPLE * nbuckets;
+  sample = MALLOC(sizeof(uint64_t) * nsample);
+  assert(sample);
+  for (size_t i = 0; i < nsample; i++) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    sample[i] = keys[rng % n];
+    if (doubles) { sample[i] = qutil_double_to_key(sample[i]); }
+  }
+  qutil_radix_sort(sample, NULL, nsample, 0);
+  for (size_t i = 0; i + 1 < nbuckets; i++) {
+    sample[i] = sample[(i + 1) * QUTIL_SAMPLE_OVERSAMPLE];
+  }
+  splitters = sample;
+  qutil_sample_tree(s.tree, nbuckets, 1, &splitters);
+  FREE(sample, sizeof(uint64_t) * nsample);
+
+  /* partition into the buckets... */
+  s.src = keys;
+  s.dst = MALLOC(sizeof(uint64_t) * n);
+  s.oracle = MALLOC(n);
+  s.counts = MALLOC(sizeof(size_t) * s.ntasks * nbuckets);
+  s.bounds = MALLOC(sizeof(size_t) * (nbuckets + 1));
+  assert(s.dst && s.oracle && s.counts && s.bounds);
+  qutil_sort_run(&s, qutil_sample_count);
+  s.map_in = 0;
+  qutil_sort_offsets(s.counts, s.ntasks, nbuckets, nbuckets);
+  for (size_t b = 0; b < nbuckets; b++) { s.bounds[b] = s.counts[b]; }
+  s.bounds[nbuckets] = n;
+  qutil_sort_run(&s, qutil_sample_scatter);
+
+  /* ...and sort each of them */
+  FREE(s.counts, sizeof(size_t) * s.ntasks * nbuckets);
+  FREE(s.oracle, n);
+  s.ntasks = nbuckets;
+  qutil_sort_run(&s, qutil_sample_bucket);
+  FREE(s.bounds, sizeof(size_t) * (nbuckets + 1));
+  FREE(s.dst, sizeof(uint64_t) * n);
+}
+
+#if QTHREAD_BITS == 64
+#define QUTIL_KEYS(array, length) ((uint64_t *)(array))
+#define QUTIL_KEYS_DONE(keys, array, length)
+#else
+/* sorts work on 64-bit keys, so aligned_ts are widened to them and back */
+static uint64_t *qutil_widen(aligned_t const *array, size_t length) {
+  uint64_t *keys = MALLOC(sizeof(uint64_t) * length);
+
+  assert(keys);
+  for (size_t i = 0; i < length; i++) { keys[i] = array[i]; }
+  return keys;
+}
+
+static void qutil_narrow(uint64_t *keys, aligned_t *array, size_t length) {
+  for (size_t i = 0; i < length; i++) { array[i] = (aligned_t)keys[i]; }
+  FREE(keys, sizeof(uint64_t) * length);
+}
+
+#define QUTIL_KEYS(array, length) qutil_widen((array), (length))
+#define QUTIL_KEYS_DONE(keys, array, length)                                   \
+  qutil_narrow((keys), (array), (length))
+#endif
+
+void API_FUNC qutil_aligned_radixsort(aligned_t *array, size_t length) {
+  uint64_t *keys = QUTIL_KEYS(array, length);
+
+  qutil_radix_sort(keys, NULL, length, 0);
+  QUTIL_KEYS_DONE(keys, array, length);
+}
+
+void API_FUNC qutil_radixsort(double *array, size_t length) {
+  qutil_radix_sort((uint64_t *)array, NULL, length, 1);
+}
+
+void API_FUNC qutil_aligned_radixsort_kv(aligned_t *keys,
+                                         aligned_t *values,
+                                         size_t length) {
+  uint64_t *k = QUTIL_KEYS(keys, length);
+
+  qutil_radix_sort(k, values, length, 0);
+  QUTIL_KEYS_DONE(k, keys, length);
+}
+
+void API_FUNC qutil_radixsort_kv(double *keys,
+                                 aligned_t *values,
+                                 size_t length) {
+  qutil_radix_sort((uint64_t *)keys, values, length, 1);
+}
+
+void API_FUNC qutil_aligned_samplesort(aligned_t *array, size_t length) {
+  uint64_t *keys = QUTIL_KEYS(array, length);
+
+  qutil_sample_sort(keys, length, 0);
+  QUTIL_KEYS_DONE(keys, array, length);
+}
+
+void API_FUNC qutil_samplesort(double *array, size_t length) {
+  qutil_sample_sort((uint64_t *)array, length, 1);
+}
+
 /* vim:set expandtab: */
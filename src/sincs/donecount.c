@@ -217,7 +217,7 @@ void API_FUNC qt_sinc_expect(qt_sinc_t *sinc_, size_t count) {
   assert(sinc && (0 < sinc->counter));
 }
 
-void *qt_sinc_tmpdata(qt_sinc_t *sinc_) {
+void API_FUNC *qt_sinc_tmpdata(qt_sinc_t *sinc_) {
   qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
 
   assert(sinc);
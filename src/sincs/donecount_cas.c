@@ -173,7 +173,7 @@ void qt_sinc_expect(qt_sinc_t *sinc_, size_t count) {
   if (oldc == 0) { qthread_empty(&sinc->ready); }
 }
 
-void *qt_sinc_tmpdata(qt_sinc_t *sinc_) {
+void API_FUNC *qt_sinc_tmpdata(qt_sinc_t *sinc_) {
   assert(sinc_);
   qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
   if (NULL != sinc->rdata) {
@@ -226,7 +226,7 @@ void qt_sinc_expect(qt_sinc_t *sinct, size_t count) {
   }
 }
 
-void *qt_sinc_tmpdata(qt_sinc_t *sinct) {
+void API_FUNC *qt_sinc_tmpdata(qt_sinc_t *sinct) {
   struct qt_sinc_s *sinc = (struct qt_sinc_s *)sinct;
   if (NULL != sinc->values) {
     size_t const shep_offset = qthread_shep() * sinc->sizeof_shep_value_part;
@@ -56,7 +56,7 @@ static unsigned int cacheline;
 
 static void qt_sinc_internal_collate(qt_sinc_t *sinc);
 
-void qt_sinc_init(qt_sinc_t *restrict sinc_,
+void API_FUNC qt_sinc_init(qt_sinc_t *restrict sinc_,
                   size_t sizeof_value,
                   void const *restrict initial_value,
                   qt_sinc_op_f op,
@@ -140,7 +140,7 @@ void qt_sinc_init(qt_sinc_t *restrict sinc_,
   }
 }
 
-qt_sinc_t *qt_sinc_create(size_t const sizeof_value,
+qt_sinc_t API_FUNC *qt_sinc_create(size_t const sizeof_value,
                           void const *initial_value,
                           qt_sinc_op_f op,
                           size_t const expect) {
@@ -152,7 +152,7 @@ qt_sinc_t *qt_sinc_create(size_t const sizeof_value,
   return sinc;
 }
 
-void qt_sinc_reset(qt_sinc_t *sinc_, size_t const will_spawn) {
+void API_FUNC qt_sinc_reset(qt_sinc_t *sinc_, size_t const will_spawn) {
   qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
   qt_sinc_reduction_t *rdata = sinc->rdata;
 
@@ -199,7 +199,7 @@ void qt_sinc_reset(qt_sinc_t *sinc_, size_t const will_spawn) {
   }
 }
 
-void qt_sinc_fini(qt_sinc_t *sinc_) {
+void API_FUNC qt_sinc_fini(qt_sinc_t *sinc_) {
   qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
 
   assert(sinc);
@@ -217,7 +217,7 @@ void qt_sinc_fini(qt_sinc_t *sinc_) {
   }
 }
 
-void qt_sinc_destroy(qt_sinc_t *sinc_) {
+void API_FUNC qt_sinc_destroy(qt_sinc_t *sinc_) {
   qt_sinc_fini(sinc_);
   qt_free(sinc_);
 }
@@ -229,7 +229,7 @@ void qt_sinc_destroy(qt_sinc_t *sinc_) {
  * Pre:  sinc was created
  * Post: aggregate count is positive
  */
-void qt_sinc_expect(qt_sinc_t *sinc_, size_t count) {
+void API_FUNC qt_sinc_expect(qt_sinc_t *sinc_, size_t count) {
   assert(sinc_);
   qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
   qt_sinc_snzi_t *restrict const snzi = sinc->snzi;
@@ -261,7 +261,7 @@ void qt_sinc_expect(qt_sinc_t *sinc_, size_t count) {
   }
 }
 
-void *qt_sinc_tmpdata(qt_sinc_t *sinc_) {
+void API_FUNC *qt_sinc_tmpdata(qt_sinc_t *sinc_) {
   assert(sinc_);
   qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
   if (NULL != sinc->rdata) {
@@ -297,7 +297,8 @@ static void qt_sinc_internal_collate(qt_sinc_t *sinc_) {
   qthread_fill(&sinc->ready);
 }
 
-void qt_sinc_submit(qt_sinc_t *restrict sinc_, void const *restrict value) {
+void API_FUNC qt_sinc_submit(qt_sinc_t *restrict sinc_,
+                             void const *restrict value) {
   assert(sinc_);
   qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
   qthread_shepherd_id_t shep_id = qthread_shep();
@@ -360,7 +361,7 @@ void qt_sinc_submit(qt_sinc_t *restrict sinc_, void const *restrict value) {
   } while (1);
 }
 
-void qt_sinc_wait(qt_sinc_t *restrict sinc_, void *restrict target) {
+void API_FUNC qt_sinc_wait(qt_sinc_t *restrict sinc_, void *restrict target) {
   assert(sinc_);
   qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
   qthread_readFF(NULL, &sinc->ready);
@@ -0,0 +1,626 @@
+/* System Headers */
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The API */
+#include "qthread/cacheline.h"
+#include "qthread/qthread.h"
+#include "qthread/sinc.h"
+
+/* Internal Headers */
+#include "qt_alloc.h"
+#include "qt_asserts.h"
+#include "qt_atomics.h"
+#include "qt_expect.h"
+#include "qt_int_ceil.h"
+#include "qt_shepherd_innards.h"
+#include "qt_subsystems.h"
+#include "qt_visibility.h"
+
+/* A sinc that is a tree of scalable non-zero indicators (SNZI, Ellen et al.,
+ * PODC 2007). Every worker has a leaf; the leaves of a shepherd hang off a
+ * node of their own, the shepherds of a NUMA node off theirs, and so on up to
+ * a single root, at most TREE_ARITY children to a node. qt_sinc_expect()
+ * arrives at the caller's leaf, which only touches the nodes above it when
+ * the leaf goes from zero to non-zero; qt_sinc_submit() departs from the
+ * caller's leaf if it has anything to depart from, and otherwise from the
+ * nearest leaf that does. The root only counts the subtrees that are
+ * non-zero, so it is the root going to zero that says everyone is done.
+ *
+ * Values are reduced on the way up: a submit combines its value into the leaf
+ * it departs from, and a node that goes to zero combines its value into its
+ * parent before departing from it. Thus the work of reducing is spread over
+ * the submitters, and the last one only combines what is left along its path
+ * to the root, instead of every worker's value.
+ *
+ * Counting is lock-free, but combining values takes the node's lock. The
+ * reduction is an arbitrary qt_sinc_op_f over values of any size, so it
+ * cannot be applied with a compare-and-swap, and a value must not land in a
+ * node after that node has handed its value up. Locks are taken child before
+ * parent, and a sinc without values never takes one. */
+
+#define TREE_ARITY 4
+#define NO_PARENT ((size_t)-1)
+
+/* A node's state is a count, in the low half, and a version, in the high
+ * half. The count is 0 for zero, HALF while the node is arriving at its
+ * parent, and n + 1 for n arrivals; the version changes whenever the node
+ * leaves zero, so that a thread that saw the node at HALF does not mistake a
+ * later HALF for it. The root has no parent, and so is never HALF. */
+#define SNZI_HALF 1
+#define SNZI_ONE 2
+#define SNZI_COUNT(s) ((uint32_t)(s))
+#define SNZI_VERSION(s) ((s) >> 32)
+#define SNZI_STATE(v, c) (((uint64_t)(v) << 32) | (uint32_t)(c))
+
+typedef struct qt_sinc_node_s {
+  uint64_t _Atomic state;
+  QTHREAD_FASTLOCK_TYPE lock; /* held while combining values */
+  /* followed by the value, when there is one */
+} qt_sinc_node_t;
+
+/* qt_sinc_tmpdata() hands each worker one of these, which its next submit
+ * folds in */
+typedef struct qt_sinc_scratch_s {
+  int used;
+  /* followed by the value */
+} qt_sinc_scratch_t;
+
+typedef struct qt_sinc_reduction_ {
+  qt_sinc_op_f op;
+  void *restrict result;
+  void *restrict initial_value;
+  size_t sizeof_value;
+  uint8_t *scratch; /* num_workers of them, scratch_size bytes apart */
+} qt_sinc_reduction_t;
+
+typedef struct qt_sinc_s {
+  uint8_t *nodes; /* num_nodes of them, node_size bytes apart */
+  aligned_t ready;
+  qt_sinc_reduction_t *rdata;
+} qt_internal_sinc_t;
+
+/* The shape of the tree, which is the same for every sinc. Nodes are numbered
+ * leaves first, one per worker (shepherd * num_wps + worker), and the root
+ * last. */
+static struct {
+  size_t num_nodes;
+  size_t *parent;
+  size_t *kids; /* node n's children are kids[first_kid[n]] onwards */
+  size_t *first_kid;
+  size_t *num_kids;
+} tree;
+
+static int _Atomic tree_built; /* 0 = not yet, 1 = being built, 2 = built */
+static size_t num_sheps;
+static size_t num_workers;
+static size_t num_wps;
+static unsigned int cacheline;
+
+#define NODE(sinc, n)                                                          \
+  ((qt_sinc_node_t *)((sinc)->nodes + (n) * node_size(sinc)))
+#define NODE_VALUE(node) ((void *)((node) + 1))
+#define SCRATCH(rdata, w)                                                      \
+  ((qt_sinc_scratch_t *)((rdata)->scratch + (w) * scratch_size(rdata)))
+#define SCRATCH_VALUE(scr) ((void *)((scr) + 1))
+
+static inline size_t node_size(qt_internal_sinc_t const *sinc) {
+  size_t const bytes = sizeof(qt_sinc_node_t) +
+                       ((sinc->rdata == NULL) ? 0 : sinc->rdata->sizeof_value);
+
+  return QT_CEIL_RATIO(bytes, cacheline) * cacheline;
+}
+
+static inline size_t scratch_size(qt_sinc_reduction_t const *rdata) {
+  size_t const bytes = sizeof(qt_sinc_scratch_t) + rdata->sizeof_value;
+
+  return QT_CEIL_RATIO(bytes, cacheline) * cacheline;
+}
+
+static void qt_sinc_tree_teardown(void) {
+  FREE(tree.parent, 2 * num_workers * sizeof(size_t));
+  FREE(tree.kids, 2 * num_workers * sizeof(size_t));
+  FREE(tree.first_kid, 2 * num_workers * sizeof(size_t));
+  FREE(tree.num_kids, 2 * num_workers * sizeof(size_t));
+  num_sheps = 0;
+  atomic_store_explicit(&tree_built, 0, memory_order_relaxed);
+}
+
+/* Gives each run of up to TREE_ARITY consecutive items with the same key a
+ * new parent (a run of one is left as it is), until no two items share a key;
+ * items and keys are replaced by the roots of the subtrees and their keys. */
+static size_t
+qt_sinc_tree_combine(size_t *items, size_t *keys, size_t count) {
+  int again = 1;
+
+  while (again) {
+    size_t out = 0;
+
+    again = 0;
+    for (size_t i = 0; i < count;) {
+      size_t j = i + 1;
+
+      while (j < count && j - i < TREE_ARITY && keys[j] == keys[i]) { j++; }
+      if (j - i == 1) {
+        items[out] = items[i];
+      } else {
+        size_t const p = tree.num_nodes++;
+
+        tree.first_kid[p] = tree.first_kid[p - 1] + tree.num_kids[p - 1];
+        tree.num_kids[p] = j - i;
+        for (size_t k = i; k < j; k++) {
+          tree.parent[items[k]] = p;
+          tree.kids[tree.first_kid[p] + k - i] = items[k];
+        }
+        tree.parent[p] = NO_PARENT;
+        items[out] = p;
+      }
+      if (out > 0 && keys[out - 1] == keys[i]) { again = 1; }
+      keys[out++] = keys[i];
+      i = j;
+    }
+    count = out;
+  }
+  return count;
+}
+
+static int qt_sinc_shep_by_node(void const *a, void const *b) {
+  qthread_shepherd_id_t const sa = *(qthread_shepherd_id_t const *)a;
+  qthread_shepherd_id_t const sb = *(qthread_shepherd_id_t const *)b;
+  unsigned int const na = qthread_internal_shep_to_node(sa);
+  unsigned int const nb = qthread_internal_shep_to_node(sb);
+
+  if (na != nb) { return (na < nb) ? -1 : 1; }
+  return (sa < sb) ? -1 : (sa > sb);
+}
+
+static void qt_sinc_tree_build(void) {
+  size_t const max_nodes = 2 * num_workers;
+  qthread_shepherd_id_t *sheps =
+    MALLOC(num_sheps * sizeof(qthread_shepherd_id_t));
+  size_t *items = MALLOC(num_workers * sizeof(size_t));
+  size_t *keys = MALLOC(num_workers * sizeof(size_t));
+  size_t count = 0;
+
+  assert(sheps && items && keys);
+  tree.parent = MALLOC(max_nodes * sizeof(size_t));
+  tree.kids = MALLOC(max_nodes * sizeof(size_t));
+  tree.first_kid = MALLOC(max_nodes * sizeof(size_t));
+  tree.num_kids = MALLOC(max_nodes * sizeof(size_t));
+  assert(tree.parent && tree.kids && tree.first_kid && tree.num_kids);
+  for (size_t n = 0; n < num_workers; n++) {
+    tree.parent[n] = NO_PARENT;
+    tree.first_kid[n] = 0;
+    tree.num_kids[n] = 0;
+  }
+  tree.num_nodes = num_workers;
+
+  /* shepherds in NUMA node order, so that neighbours share a subtree */
+  for (size_t s = 0; s < num_sheps; s++) { sheps[s] = s; }
+  qsort(sheps, num_sheps, sizeof(qthread_shepherd_id_t), qt_sinc_shep_by_node);
+
+  /* the workers of each shepherd, then the shepherds of each NUMA node, then
+   * everything */
+  for (size_t s = 0; s < num_sheps; s++) {
+    for (size_t w = 0; w < num_wps; w++) {
+      items[count] = sheps[s] * num_wps + w;
+      keys[count++] = sheps[s];
+    }
+  }
+  count = qt_sinc_tree_combine(items, keys, count);
+  for (size_t i = 0; i < count; i++) {
+    keys[i] = qthread_internal_shep_to_node(sheps[i]);
+  }
+  count = qt_sinc_tree_combine(items, keys, count);
+  for (size_t i = 0; i < count; i++) { keys[i] = 0; }
+  count = qt_sinc_tree_combine(items, keys, count);
+  assert(count == 1 && items[0] == tree.num_nodes - 1);
+  assert(tree.num_nodes <= max_nodes);
+
+  FREE(keys, num_workers * sizeof(size_t));
+  FREE(items, num_workers * sizeof(size_t));
+  FREE(sheps, num_sheps * sizeof(qthread_shepherd_id_t));
+  qthread_internal_cleanup(qt_sinc_tree_teardown);
+}
+
+static void qt_sinc_tree_init(void) {
+  int expected = 0;
+
+  if (QTHREAD_EXPECT(
+        atomic_load_explicit(&tree_built, memory_order_acquire) == 2, 1)) {
+    return;
+  }
+  if (atomic_compare_exchange_strong_explicit(&tree_built,
+                                              &expected,
+                                              1,
+                                              memory_order_acquire,
+                                              memory_order_relaxed)) {
+    num_sheps = qthread_readstate(TOTAL_SHEPHERDS);
+    num_workers = qthread_readstate(TOTAL_WORKERS);
+    num_wps = num_workers / num_sheps;
+    cacheline = qthread_cacheline();
+    qt_sinc_tree_build();
+    atomic_store_explicit(&tree_built, 2, memory_order_release);
+  } else {
+    while (atomic_load_explicit(&tree_built, memory_order_acquire) != 2) {
+      SPINLOCK_BODY();
+    }
+  }
+}
+
+static inline size_t qt_sinc_my_leaf(void) {
+  qthread_shepherd_id_t const shep = qthread_shep();
+
+  if (shep == NO_SHEPHERD) { return 0; }
+  return shep * num_wps + qthread_readstate(CURRENT_WORKER);
+}
+
+/* Sets every node to zero (and its value, and every worker's scratch value,
+ * to the initial value), then gives the caller's leaf expect arrivals, and
+ * its ancestors one each. */
+static void qt_sinc_tree_set(qt_internal_sinc_t *sinc, size_t expect) {
+  qt_sinc_reduction_t *const rdata = sinc->rdata;
+
+  if (rdata) {
+    for (size_t w = 0; w < num_workers; w++) {
+      qt_sinc_scratch_t *const scr = SCRATCH(rdata, w);
+
+      scr->used = 0;
+      memcpy(SCRATCH_VALUE(scr), rdata->initial_value, rdata->sizeof_value);
+    }
+  }
+
+  for (size_t n = 0; n < tree.num_nodes; n++) {
+    qt_sinc_node_t *const node = NODE(sinc, n);
+
+    atomic_store_explicit(&node->state, 0, memory_order_relaxed);
+    QTHREAD_FASTLOCK_INIT_PTR(&node->lock);
+    if (rdata) {
+      memcpy(NODE_VALUE(node), rdata->initial_value, rdata->sizeof_value);
+    }
+  }
+  if (expect != 0) {
+    assert(expect < UINT32_MAX - SNZI_ONE);
+    for (size_t n = qt_sinc_my_leaf(); n != NO_PARENT; n = tree.parent[n]) {
+      atomic_store_explicit(
+        &NODE(sinc, n)->state, SNZI_STATE(0, expect + 1), memory_order_release);
+      expect = 1;
+    }
+    qthread_empty(&sinc->ready);
+  } else {
+    qthread_fill(&sinc->ready);
+  }
+}
+
+void API_FUNC qt_sinc_init(qt_sinc_t *restrict sinc_,
+                           size_t sizeof_value,
+                           void const *restrict initial_value,
+                           qt_sinc_op_f op,
+                           size_t expect) {
+  assert((0 == sizeof_value && NULL == initial_value) ||
+         (0 != sizeof_value && NULL != initial_value));
+  qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
+  assert(sinc);
+
+  qt_sinc_tree_init();
+
+  if (sizeof_value == 0) {
+    sinc->rdata = NULL;
+  } else {
+    qt_sinc_reduction_t *restrict const rdata = sinc->rdata =
+      MALLOC(sizeof(qt_sinc_reduction_t));
+    assert(rdata);
+    rdata->op = op;
+    rdata->sizeof_value = sizeof_value;
+    rdata->initial_value = MALLOC(2 * sizeof_value);
+    assert(rdata->initial_value);
+    memcpy(rdata->initial_value, initial_value, sizeof_value);
+    rdata->result = ((uint8_t *)rdata->initial_value) + sizeof_value;
+    memcpy(rdata->result, initial_value, sizeof_value);
+    rdata->scratch = qt_internal_aligned_alloc(
+      num_workers * scratch_size(rdata), cacheline);
+    assert(rdata->scratch);
+  }
+  sinc->nodes = qt_internal_aligned_alloc(tree.num_nodes * node_size(sinc),
+                                          cacheline);
+  assert(sinc->nodes);
+  qt_sinc_tree_set(sinc, expect);
+}
+
+qt_sinc_t API_FUNC *qt_sinc_create(size_t const sizeof_value,
+                                   void const *initial_value,
+                                   qt_sinc_op_f op,
+                                   size_t const will_spawn) {
+  qt_sinc_t *restrict const sinc = MALLOC(sizeof(qt_sinc_t));
+
+  assert(sinc);
+
+  qt_sinc_init(sinc, sizeof_value, initial_value, op, will_spawn);
+
+  return sinc;
+}
+
+void API_FUNC qt_sinc_reset(qt_sinc_t *sinc_, size_t const will_spawn) {
+  qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
+
+  assert(sinc);
+  qt_sinc_tree_set(sinc, will_spawn);
+}
+
+void API_FUNC qt_sinc_fini(qt_sinc_t *sinc_) {
+  qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
+
+  assert(sinc);
+
+  qt_internal_aligned_free(sinc->nodes, cacheline);
+  sinc->nodes = NULL;
+  if (sinc->rdata) {
+    qt_sinc_reduction_t *restrict const rdata = sinc->rdata;
+    assert(rdata->initial_value);
+    qt_internal_aligned_free(rdata->scratch, cacheline);
+    FREE(rdata->initial_value, 2 * rdata->sizeof_value);
+    FREE(rdata, sizeof(qt_sinc_reduction_t));
+    sinc->rdata = NULL;
+  }
+  qassert(qthread_fill(&sinc->ready), QTHREAD_SUCCESS);
+}
+
+void API_FUNC qt_sinc_destroy(qt_sinc_t *sinc_) {
+  qt_sinc_fini(sinc_);
+  FREE(sinc_, sizeof(qt_sinc_t));
+}
+
+static void qt_sinc_tree_depart_parent(qt_internal_sinc_t *sinc, size_t n);
+
+/* Departs from node n, after combining value (if any) into it, unless n has
+ * no arrivals to depart from; returns whether it did. If value is scr's, scr
+ * is reset once it has been combined, since the sinc may be gone as soon as
+ * the departure is done. */
+static int qt_sinc_tree_depart(qt_internal_sinc_t *sinc,
+                               size_t n,
+                               void const *value,
+                               qt_sinc_scratch_t *scr) {
+  qt_sinc_reduction_t *const rdata = sinc->rdata;
+  qt_sinc_node_t *const node = NODE(sinc, n);
+  uint64_t s = atomic_load_explicit(&node->state, memory_order_acquire);
+
+  if (SNZI_COUNT(s) < SNZI_ONE) { return 0; }
+  /* Only departures lower the count, and departures with values hold the
+   * lock, so once the lock is held and the count is at least one, it stays so
+   * until this thread lowers it. */
+  if (rdata) {
+    QTHREAD_FASTLOCK_LOCK(&node->lock);
+    s = atomic_load_explicit(&node->state, memory_order_acquire);
+    if (SNZI_COUNT(s) < SNZI_ONE) {
+      QTHREAD_FASTLOCK_UNLOCK(&node->lock);
+      return 0;
+    }
+    if (value) { rdata->op(NODE_VALUE(node), value); }
+    if (scr) {
+      memcpy(SCRATCH_VALUE(scr), rdata->initial_value, rdata->sizeof_value);
+      scr->used = 0;
+    }
+  } else {
+    assert(value == NULL);
+  }
+  for (;;) {
+    uint64_t const next = SNZI_STATE(
+      SNZI_VERSION(s), (SNZI_COUNT(s) == SNZI_ONE) ? 0 : SNZI_COUNT(s) - 1);
+
+    if (atomic_compare_exchange_weak_explicit(&node->state,
+                                              &s,
+                                              next,
+                                              memory_order_acq_rel,
+                                              memory_order_acquire)) {
+      break;
+    }
+    if (SNZI_COUNT(s) < SNZI_ONE) {
+      assert(rdata == NULL);
+      return 0;
+    }
+  }
+  if (SNZI_COUNT(s) != SNZI_ONE) {
+    if (rdata) { QTHREAD_FASTLOCK_UNLOCK(&node->lock); }
+    return 1;
+  }
+
+  /* n is now zero: hand its value up (with n still locked, so that nothing is
+   * combined into it in the meantime) and depart from the parent */
+  size_t const parent = tree.parent[n];
+
+  if (parent == NO_PARENT) {
+    if (rdata) {
+      memcpy(rdata->result, rdata->initial_value, rdata->sizeof_value);
+      rdata->op(rdata->result, NODE_VALUE(node));
+      QTHREAD_FASTLOCK_UNLOCK(&node->lock);
+    }
+    qthread_fill(&sinc->ready);
+    return 1;
+  }
+  if (rdata) {
+    qt_sinc_node_t *const up = NODE(sinc, parent);
+
+    QTHREAD_FASTLOCK_LOCK(&up->lock);
+    rdata->op(NODE_VALUE(up), NODE_VALUE(node));
+    QTHREAD_FASTLOCK_UNLOCK(&up->lock);
+    memcpy(NODE_VALUE(node), rdata->initial_value, rdata->sizeof_value);
+    QTHREAD_FASTLOCK_UNLOCK(&node->lock);
+  }
+  qt_sinc_tree_depart_parent(sinc, n);
+  return 1;
+}
+
+/* n was counted as one arrival at its parent, which is thus non-zero */
+static void qt_sinc_tree_depart_parent(qt_internal_sinc_t *sinc, size_t n) {
+  int const departed = qt_sinc_tree_depart(sinc, tree.parent[n], NULL, NULL);
+
+  assert(departed);
+  (void)departed;
+}
+
+static void
+qt_sinc_tree_arrive(qt_internal_sinc_t *sinc, size_t n, size_t count) {
+  qt_sinc_node_t *const node = NODE(sinc, n);
+  size_t const parent = tree.parent[n];
+  uint64_t s = atomic_load_explicit(&node->state, memory_order_acquire);
+
+  assert(count < UINT32_MAX - SNZI_ONE);
+  for (;;) {
+    uint32_t const c = SNZI_COUNT(s);
+
+    if (c >= SNZI_ONE) {
+      if (atomic_compare_exchange_weak_explicit(&node->state,
+                                                &s,
+                                                s + count,
+                                                memory_order_acq_rel,
+                                                memory_order_acquire)) {
+        return;
+      }
+    } else if (parent == NO_PARENT) {
+      if (atomic_compare_exchange_weak_explicit(
+            &node->state,
+            &s,
+            SNZI_STATE(SNZI_VERSION(s), count + 1),
+            memory_order_acq_rel,
+            memory_order_acquire)) {
+        qthread_empty(&sinc->ready);
+        return;
+      }
+    } else {
+      uint64_t half = s;
+
+      if (c == 0) {
+        half = SNZI_STATE(SNZI_VERSION(s) + 1, SNZI_HALF);
+        if (!atomic_compare_exchange_weak_explicit(&node->state,
+                                                   &s,
+                                                   half,
+                                                   memory_order_acq_rel,
+                                                   memory_order_acquire)) {
+          continue;
+        }
+      }
+      qt_sinc_tree_arrive(sinc, parent, 1);
+      s = half;
+      if (atomic_compare_exchange_strong_explicit(
+            &node->state,
+            &s,
+            SNZI_STATE(SNZI_VERSION(half), count + 1),
+            memory_order_acq_rel,
+            memory_order_acquire)) {
+        return;
+      }
+      /* someone else finished the arrival at the parent first */
+      qt_sinc_tree_depart_parent(sinc, n);
+    }
+  }
+}
+
+/* Looks for a node with arrivals to depart from under n, trying first the
+ * subtrees that are not zero. */
+static size_t qt_sinc_tree_find(qt_internal_sinc_t *sinc, size_t n) {
+  if (tree.num_kids[n] == 0) {
+    uint64_t const s =
+      atomic_load_explicit(&NODE(sinc, n)->state, memory_order_relaxed);
+    return (SNZI_COUNT(s) >= SNZI_ONE) ? n : NO_PARENT;
+  }
+  for (size_t k = 0; k < tree.num_kids[n]; k++) {
+    size_t const kid = tree.kids[tree.first_kid[n] + k];
+    uint64_t const s =
+      atomic_load_explicit(&NODE(sinc, kid)->state, memory_order_relaxed);
+
+    if (SNZI_COUNT(s) >= SNZI_ONE) {
+      size_t const found = qt_sinc_tree_find(sinc, kid);
+      if (found != NO_PARENT) { return found; }
+    }
+  }
+  return NO_PARENT;
+}
+
+/* Adds a new participant to the sinc.
+ * Pre:  sinc was created
+ * Post: aggregate count is positive
+ */
+void API_FUNC qt_sinc_expect(qt_sinc_t *sinc_, size_t count) {
+  qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
+
+  assert(sinc);
+
+  if (count != 0) { qt_sinc_tree_arrive(sinc, qt_sinc_my_leaf(), count); }
+}
+
+/* Departs from the caller's leaf, or from wherever the arrivals are. */
+static void qt_sinc_tree_submit(qt_internal_sinc_t *sinc,
+                                size_t leaf,
+                                void const *value,
+                                qt_sinc_scratch_t *scr) {
+  if (qt_sinc_tree_depart(sinc, leaf, value, scr)) { return; }
+  /* the arrivals are elsewhere: look for them in ever larger subtrees */
+  for (;;) {
+    for (size_t n = tree.parent[leaf]; n != NO_PARENT; n = tree.parent[n]) {
+      size_t const found = qt_sinc_tree_find(sinc, n);
+
+      if (found != NO_PARENT && qt_sinc_tree_depart(sinc, found, value, scr)) {
+        return;
+      }
+    }
+    if (tree.parent[leaf] == NO_PARENT &&
+        qt_sinc_tree_depart(sinc, leaf, value, scr)) {
+      return;
+    }
+    SPINLOCK_BODY();
+  }
+}
+
+/* Values are combined into the tree as they are submitted, which other
+ * workers may be doing to the same node, so what is handed out here is the
+ * worker's scratch value instead: the worker's next qt_sinc_submit() combines
+ * its value into the scratch value and submits that. */
+void API_FUNC *qt_sinc_tmpdata(qt_sinc_t *sinc_) {
+  qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
+
+  assert(sinc);
+
+  if (sinc->rdata) {
+    qt_sinc_scratch_t *const scr = SCRATCH(sinc->rdata, qt_sinc_my_leaf());
+
+    scr->used = 1;
+    return SCRATCH_VALUE(scr);
+  } else {
+    return NULL;
+  }
+}
+
+void API_FUNC qt_sinc_submit(qt_sinc_t *restrict sinc_,
+                             void const *restrict value) {
+  qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
+  size_t const leaf = qt_sinc_my_leaf();
+  qt_sinc_scratch_t *scr = NULL;
+
+  assert(sinc);
+  assert(value == NULL || sinc->rdata);
+
+  if (sinc->rdata && SCRATCH(sinc->rdata, leaf)->used) {
+    scr = SCRATCH(sinc->rdata, leaf);
+    if (value) { sinc->rdata->op(SCRATCH_VALUE(scr), value); }
+    value = SCRATCH_VALUE(scr);
+  }
+  qt_sinc_tree_submit(sinc, leaf, value, scr);
+}
+
+void API_FUNC qt_sinc_wait(qt_sinc_t *restrict sinc_, void *restrict target) {
+  qt_internal_sinc_t *restrict const sinc = (qt_internal_sinc_t *)sinc_;
+
+  assert(sinc);
+  assert(NULL == target || NULL != sinc->rdata);
+
+  qthread_readFF(NULL, &sinc->ready);
+
+  if (target && sinc->rdata) {
+    memcpy(target, sinc->rdata->result, sinc->rdata->sizeof_value);
+  }
+}
+
+/* vim:set expandtab: */
@@ -11,30 +11,19 @@
 #include "qt_syncvar.h"
 
 /* Internal Headers */
-#include "qt_addrstat.h"
 #include "qt_alloc.h"
 #include "qt_asserts.h"
 #include "qt_blocking_structs.h"
-#include "qt_hash.h"
 #include "qt_initialized.h" // for qthread_library_initialized
+#include "qt_mpool.h"
 #include "qt_profiling.h"
 #include "qt_qthread_mgmt.h"
 #include "qt_qthread_struct.h"
 #include "qt_subsystems.h"
 #include "qt_threadqueues.h"
+#include "qt_timers.h"
 #include "qthread_innards.h"
 
-/* Internal Prototypes */
-static inline void qthread_syncvar_gotlock_fill(qthread_shepherd_t *shep,
-                                                qthread_addrstat_t *m,
-                                                syncvar_t *maddr,
-                                                uint64_t const ret);
-static inline void qthread_syncvar_gotlock_empty(qthread_shepherd_t *shep,
-                                                 qthread_addrstat_t *m,
-                                                 syncvar_t *maddr,
-                                                 uint64_t const ret);
-static inline void qthread_syncvar_remove(void *maddr);
-
 /* Internal Structs */
 typedef struct {
   unsigned int cf : 1; // there was a timeout
@@ -65,19 +54,57 @@ typedef struct {
   void *b;
   blocker_type type;
   int retval;
+  uint64_t deadline; /* for READFF, READFE and WRITEEF */
 } qthread_syncvar_blocker_t;
 
+/* Waiter records. While a syncvar has waiters (states 1 and 3), the data bits
+ * of its word point to one of these, and its value moves into the record. A
+ * record is only ever found through the word, while holding the word's lock
+ * bit, and is locked before that bit is released; once the word has been
+ * unlocked without waiters, whoever holds the record owns it. So blocking and
+ * waking never look anything up by address. The records are also listed in
+ * a table per shepherd, but only so that qthread_syncvar_callback() can find
+ * the waiting tasks. */
+typedef struct qt_syncvar_waiters_s {
+  qthread_addrstat_t m; /* first: blocked tasks' blockedon.addr points here */
+  uint64_t value;       /* the syncvar's value */
+  syncvar_t *addr;
+  struct qt_syncvar_waiters_s *prev;
+  struct qt_syncvar_waiters_s *next;
+  qthread_shepherd_id_t table;
+} qt_syncvar_waiters_t;
+
+typedef struct {
+  QTHREAD_FASTLOCK_TYPE lock;
+  qt_syncvar_waiters_t *head;
+} qt_syncvar_table_t;
+
+/* Internal Prototypes */
+static inline void qthread_syncvar_gotlock_fill(qthread_shepherd_t *shep,
+                                                qt_syncvar_waiters_t *w,
+                                                syncvar_t *maddr,
+                                                uint64_t const ret);
+static inline void qthread_syncvar_gotlock_empty(qthread_shepherd_t *shep,
+                                                 qt_syncvar_waiters_t *w,
+                                                 syncvar_t *maddr,
+                                                 uint64_t const sf);
+static inline int qt_syncvar_readFF(uint64_t *restrict dest,
+                                    syncvar_t *restrict src,
+                                    uint64_t const deadline);
+static inline int qt_syncvar_readFE(uint64_t *restrict dest,
+                                    syncvar_t *restrict src,
+                                    uint64_t const deadline);
+static inline int qt_syncvar_writeEF(syncvar_t *restrict dest,
+                                     uint64_t const *restrict src,
+                                     uint64_t const deadline);
+
 /* Internal Variables */
-static qt_hash *syncvars;
-#ifdef QTHREAD_COUNT_THREADS
-extern aligned_t *febs_stripes;
-#endif
-extern unsigned int QTHREAD_LOCKING_STRIPES;
+static qt_mpool syncvar_waiters_pool = NULL;
+static qt_syncvar_table_t *syncvar_tables = NULL;
 
 /* Internal Macros */
 #define BUILD_UNLOCKED_SYNCVAR(data, state) (((data) << 4) | ((state) << 1))
-#define QTHREAD_CHOOSE_STRIPE(addr)                                            \
-  (((size_t)addr >> 4) & (QTHREAD_LOCKING_STRIPES - 1))
+#define SYNCVAR_WAITERS(data) ((qt_syncvar_waiters_t *)(uintptr_t)(data))
 
 #if (QTHREAD_ASSEMBLY_ARCH == QTHREAD_AMD64 ||                                 \
      QTHREAD_ASSEMBLY_ARCH == QTHREAD_ARM ||                                   \
@@ -198,6 +225,9 @@ static uint64_t qthread_mwaitc(syncvar_t *restrict const addr,
       e.pf = (unsigned char)((locked.u.s.state >> 1u) & 1u);
       e.of = (unsigned char)((locked.u.s.state >> 2u) & 1u);
       *err = e;
+      if (locked.u.s.state & 1u) {
+        return SYNCVAR_WAITERS(locked.u.s.data)->value;
+      }
       return locked.u.s.data;
     } else {
       /* this is NOT a state of interest, so unlock the locked bit */
@@ -214,20 +244,129 @@ errexit:
   return 0;
 }
 
+/* The waiter record of a syncvar that the caller has locked, and that has
+ * waiters */
+static inline qt_syncvar_waiters_t *qt_syncvar_waiters_of(syncvar_t *addr) {
+  syncvar_t locked;
+
+  locked.u.w =
+    atomic_load_explicit((_Atomic uint64_t *)addr, memory_order_relaxed);
+  assert(locked.u.s.lock == 1);
+  assert(locked.u.s.state & 1u);
+  return SYNCVAR_WAITERS(locked.u.s.data);
+}
+
+/* Locks and returns the waiter record of a syncvar that the caller has
+ * locked: its own if it has waiters, otherwise a new one (or NULL, if there
+ * is no memory for one). */
+static qt_syncvar_waiters_t *qt_syncvar_waiters_lock(syncvar_t *addr,
+                                                     unsigned int waiters) {
+  qt_syncvar_waiters_t *w;
+
+  if (waiters) {
+    w = qt_syncvar_waiters_of(addr);
+  } else {
+    qthread_shepherd_t *shep = qthread_internal_getshep();
+    qt_syncvar_table_t *table;
+
+    w = qt_mpool_alloc(syncvar_waiters_pool);
+    if (w == NULL) { return NULL; }
+    assert(((uintptr_t)w >> 60) == 0); /* it has to fit in the data bits */
+    QTHREAD_FASTLOCK_INIT_PTR(&w->m.lock);
+    w->m.EFQ = NULL;
+    w->m.FEQ = NULL;
+    w->m.FFQ = NULL;
+    w->m.FFWQ = NULL;
+    w->m.full = 1;
+    w->m.valid = 1;
+    w->addr = addr;
+    w->prev = NULL;
+    w->table = shep ? shep->shepherd_id : 0;
+    table = &syncvar_tables[w->table];
+    QTHREAD_FASTLOCK_LOCK(&table->lock);
+    w->next = table->head;
+    if (w->next) { w->next->prev = w; }
+    table->head = w;
+    QTHREAD_FASTLOCK_UNLOCK(&table->lock);
+  }
+  QTHREAD_FASTLOCK_LOCK(&w->m.lock);
+  return w;
+}
+
+/* Unlocks and frees a waiter record that its syncvar no longer points to */
+static void qt_syncvar_waiters_release(qt_syncvar_waiters_t *w) {
+  qt_syncvar_table_t *table = &syncvar_tables[w->table];
+
+  /* qthread_syncvar_taskfilter() locks records under the table lock */
+  QTHREAD_FASTLOCK_UNLOCK(&w->m.lock);
+  QTHREAD_FASTLOCK_LOCK(&table->lock);
+  if (w->prev) {
+    w->prev->next = w->next;
+  } else {
+    table->head = w->next;
+  }
+  if (w->next) { w->next->prev = w->prev; }
+  QTHREAD_FASTLOCK_UNLOCK(&table->lock);
+  QTHREAD_FASTLOCK_DESTROY(w->m.lock);
+  qt_mpool_free(syncvar_waiters_pool, w);
+}
+
+/* Unlocks a syncvar that the caller has locked, leaving it in the given state
+ * with the given value. With waiters, the value is kept in w, or in the
+ * syncvar's own record if w is NULL. */
+static inline void qt_syncvar_unlock(syncvar_t *addr,
+                                     qt_syncvar_waiters_t *w,
+                                     uint64_t val,
+                                     uint64_t const state) {
+  if (state & 1u) {
+    if (w == NULL) { w = qt_syncvar_waiters_of(addr); }
+    w->value = val;
+    val = (uintptr_t)w;
+  }
+  UNLOCK_THIS_MODIFIED_SYNCVAR(addr, val, state);
+}
+
+/* Undoes qt_syncvar_waiters_lock() (which may have returned NULL) for a task
+ * that cannot block after all, unlocking the syncvar as it was found */
+static void qt_syncvar_waiters_abandon(syncvar_t *addr,
+                                       qt_syncvar_waiters_t *w,
+                                       uint64_t val,
+                                       uint64_t const state) {
+  if (state & 1u) {
+    qt_syncvar_unlock(addr, w, val, state);
+    QTHREAD_FASTLOCK_UNLOCK(&w->m.lock);
+  } else {
+    UNLOCK_THIS_MODIFIED_SYNCVAR(addr, val, state);
+    if (w) { qt_syncvar_waiters_release(w); }
+  }
+}
+
 static void qt_syncvar_subsystem_shutdown(void) {
-  for (unsigned i = 0; i < QTHREAD_LOCKING_STRIPES; i++) {
-    qt_hash_destroy_deallocate(syncvars[i],
-                               (qt_hash_deallocator_fn)qthread_addrstat_delete);
+  for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds; i++) {
+    qt_syncvar_waiters_t *w = syncvar_tables[i].head;
+
+    while (w) {
+      qt_syncvar_waiters_t *next = w->next;
+
+      QTHREAD_FASTLOCK_DESTROY(w->m.lock);
+      qt_mpool_free(syncvar_waiters_pool, w);
+      w = next;
+    }
+    QTHREAD_FASTLOCK_DESTROY(syncvar_tables[i].lock);
   }
-  FREE(syncvars, sizeof(qt_hash) * QTHREAD_LOCKING_STRIPES);
+  FREE(syncvar_tables, sizeof(qt_syncvar_table_t) * qlib->nshepherds);
+  syncvar_tables = NULL;
+  qt_mpool_destroy(syncvar_waiters_pool);
+  syncvar_waiters_pool = NULL;
 }
 
 void INTERNAL qt_syncvar_subsystem_init(uint_fast8_t need_sync) {
-  syncvars = MALLOC(sizeof(qt_hash) * QTHREAD_LOCKING_STRIPES);
-  assert(syncvars);
-  for (unsigned i = 0; i < QTHREAD_LOCKING_STRIPES; i++) {
-    syncvars[i] = qt_hash_create(need_sync);
-    assert(syncvars[i]);
+  syncvar_waiters_pool = qt_mpool_create(sizeof(qt_syncvar_waiters_t));
+  syncvar_tables = MALLOC(sizeof(qt_syncvar_table_t) * qlib->nshepherds);
+  assert(syncvar_waiters_pool && syncvar_tables);
+  for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds; i++) {
+    QTHREAD_FASTLOCK_INIT(syncvar_tables[i].lock);
+    syncvar_tables[i].head = NULL;
   }
   qthread_internal_cleanup_late(qt_syncvar_subsystem_shutdown);
 }
@@ -278,11 +417,17 @@ static aligned_t qthread_syncvar_blocker_thread(void *arg) {
     (qthread_syncvar_blocker_t *)arg;
 
   switch (a->type) {
-    case READFE: a->retval = qthread_syncvar_readFE(a->a, a->b); break;
+    case READFE:
+      a->retval = qt_syncvar_readFE(a->a, a->b, a->deadline);
+      break;
     case READFE_NB: a->retval = qthread_syncvar_readFE_nb(a->a, a->b); break;
-    case READFF: a->retval = qthread_syncvar_readFF(a->a, a->b); break;
+    case READFF:
+      a->retval = qt_syncvar_readFF(a->a, a->b, a->deadline);
+      break;
     case READFF_NB: a->retval = qthread_syncvar_readFF_nb(a->a, a->b); break;
-    case WRITEEF: a->retval = qthread_syncvar_writeEF(a->a, a->b); break;
+    case WRITEEF:
+      a->retval = qt_syncvar_writeEF(a->a, a->b, a->deadline);
+      break;
     case WRITEEF_NB: a->retval = qthread_syncvar_writeEF_nb(a->a, a->b); break;
     case WRITEF: a->retval = qthread_syncvar_writeF(a->a, a->b); break;
     case FILL: a->retval = qthread_syncvar_fill(a->a); break;
@@ -304,20 +449,25 @@ qthread_syncvar_nonblocker_func(void *dest, void *src, blocker_type t) {
                                     dest,
                                     src,
                                     t,
-                                    QTHREAD_SUCCESS};
+                                    QTHREAD_SUCCESS,
+                                    QT_TIMER_NEVER};
 
   qthread_fork(qthread_syncvar_nonblocker_thread, &args, NULL);
   return args.retval;
 }
 
-static int qthread_syncvar_blocker_func(void *dest, void *src, blocker_type t) {
+static int qthread_syncvar_blocker_func_until(void *dest,
+                                              void *src,
+                                              blocker_type t,
+                                              uint64_t deadline) {
   qthread_syncvar_blocker_t args = {PTHREAD_MUTEX_INITIALIZER,
                                     PTHREAD_COND_INITIALIZER,
                                     0u,
                                     dest,
                                     src,
                                     t,
-                                    QTHREAD_SUCCESS};
+                                    QTHREAD_SUCCESS,
+                                    deadline};
 
   pthread_mutex_lock(&args.lock);
   qthread_fork(qthread_syncvar_blocker_thread, &args, NULL);
@@ -328,6 +478,10 @@ static int qthread_syncvar_blocker_func(void *dest, void *src, blocker_type t) {
   return args.retval;
 }
 
+static int qthread_syncvar_blocker_func(void *dest, void *src, blocker_type t) {
+  return qthread_syncvar_blocker_func_until(dest, src, t, QT_TIMER_NEVER);
+}
+
 /* state 0: full, no waiters
  * state 1: full, queued waiters (who are waiting for it to be empty)
  * state 2: empty, no waiters
@@ -349,15 +503,61 @@ static int qthread_syncvar_blocker_func(void *dest, void *src, blocker_type t) {
 #define SYNCFEB_STATE_EMPTY_NO_WAITERS 0x2
 #define SYNCFEB_STATE_EMPTY_WITH_WAITERS 0x3
 
-int API_FUNC qthread_syncvar_readFF(uint64_t *restrict dest,
-                                    syncvar_t *restrict src) {
+/* The unlink function of a qthread's timer while it waits on a syncvar with
+ * a timeout (see qt_timers.h): takes t off the syncvar's waiter lists, if
+ * whoever filled or emptied it didn't get there first. The waiter record t
+ * blocked on may be gone by now, so it is found through the syncvar again. */
+static int qt_syncvar_timeout(void *addr, qthread_t *t) {
+  syncvar_t *const v = addr;
+  eflags_t e = {0u, 0u, 0u, 0u, 0u};
+  uint64_t const ret = qthread_mwaitc(v, SYNCFEB_ANY, INT_MAX, &e);
+  qt_syncvar_waiters_t *w;
+  qthread_addrres_t **queues[3];
+  int found = 0;
+
+  assert(e.cf == 0u);
+  if (e.sf == 0u) {
+    UNLOCK_THIS_MODIFIED_SYNCVAR(v, ret, e.pf << 1u);
+    return 0;
+  }
+  w = qt_syncvar_waiters_lock(v, 1);
+  queues[0] = &w->m.FFQ;
+  queues[1] = &w->m.FEQ;
+  queues[2] = &w->m.EFQ;
+  for (int i = 0; i < 3 && !found; i++) {
+    for (qthread_addrres_t **X = queues[i]; *X; X = &(*X)->next) {
+      if ((*X)->waiter == t) {
+        qthread_addrres_t *const gone = *X;
+
+        *X = gone->next;
+        FREE_ADDRRES(gone);
+        found = 1;
+        break;
+      }
+    }
+  }
+  if ((w->m.EFQ == NULL) && (w->m.FEQ == NULL) && (w->m.FFQ == NULL)) {
+    UNLOCK_THIS_MODIFIED_SYNCVAR(v, ret, e.pf << 1u);
+    qt_syncvar_waiters_release(w);
+  } else {
+    qt_syncvar_unlock(v, w, ret, (e.pf << 1u) | 1u);
+    QTHREAD_FASTLOCK_UNLOCK(&w->m.lock);
+  }
+  return found;
+}
+
+static inline int qt_syncvar_readFF(uint64_t *restrict dest,
+                                    syncvar_t *restrict src,
+                                    uint64_t const deadline) {
   assert(qthread_library_initialized);
   eflags_t e = {0u, 0u, 0u, 0u, 0u};
   uint64_t ret;
   qthread_t *me = qthread_internal_self();
   assert(src);
 
-  if (!me) { return qthread_syncvar_blocker_func(dest, src, READFF); }
+  if (!me) {
+    return qthread_syncvar_blocker_func_until(dest, src, READFF, deadline);
+  }
 
 #if (QTHREAD_ASSEMBLY_ARCH == QTHREAD_AMD64) ||                                \
   (QTHREAD_ASSEMBLY_ARCH == QTHREAD_POWERPC64) ||                              \
@@ -366,14 +566,14 @@ int API_FUNC qthread_syncvar_readFF(uint64_t *restrict dest,
   {
     /* I'm being optimistic here; this only works if a basic 64-bit load is
      * atomic (on most platforms it is). Thus, if I've done an atomic read
-     * and the syncvar is both unlocked and full, then I figure I can trust
-     * that state and do not need to do a locked atomic operation of any
-     * kind (e.g. cas) */
+     * and the syncvar is unlocked, full, and has no waiters (with waiters, the
+     * data bits are not the value), then I figure I can trust that state and
+     * do not need to do a locked atomic operation of any kind (e.g. cas) */
     syncvar_t local_copy_of_src;
     local_copy_of_src.u.w =
       atomic_load_explicit((_Atomic uint64_t *)src, memory_order_relaxed);
     if ((local_copy_of_src.u.s.lock == 0) &&
-        ((local_copy_of_src.u.s.state & 2) == 0)) { /* full and unlocked */
+        (local_copy_of_src.u.s.state == SYNCFEB_STATE_FULL_NO_WAITERS)) {
       /* short-circuit */
       if (dest) { *dest = local_copy_of_src.u.s.data; }
       return QTHREAD_SUCCESS;
@@ -385,8 +585,7 @@ int API_FUNC qthread_syncvar_readFF(uint64_t *restrict dest,
              (QTHREAD_ASSEMBLY_ARCH == QTHREAD_ARMV8_A64)) */
   ret = qthread_mwaitc(src, SYNCFEB_FULL, INITIAL_TIMEOUT, &e);
   if (e.cf) { /* there was a timeout */
-    int const lockbin = QTHREAD_CHOOSE_STRIPE(src);
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
     qthread_addrres_t *X;
 
     ret = qthread_mwaitc(src, SYNCFEB_ANY, INT_MAX, &e);
@@ -395,70 +594,49 @@ int API_FUNC qthread_syncvar_readFF(uint64_t *restrict dest,
     if (e.pf == 0u) {             /* it got full! */
       goto locked_full;
     }
-    QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)src);
-    got_m:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)src, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)src))) {
-          m = m2;
-          goto got_m;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else  /* ifdef LOCK_FREE_FEBS */
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-    QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
-    m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)src);
-    if (!m) {
-      m = qthread_addrstat_new();
-      assert(m);
-      if (!m) { return QTHREAD_MALLOC_ERROR; }
-      qassertnot(qt_hash_put(syncvars[lockbin], (void *)src, m), 0);
-    }
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif /* ifdef LOCK_FREE_FEBS */
-    UNLOCK_THIS_MODIFIED_SYNCVAR(src, ret, SYNCFEB_STATE_EMPTY_WITH_WAITERS);
-    X = ALLOC_ADDRRES();
-    assert(X);
+    w = qt_syncvar_waiters_lock(src, e.sf);
+    X = w ? ALLOC_ADDRRES() : NULL;
     if (!X) {
-      qthread_syncvar_remove(src);
+      qt_syncvar_waiters_abandon(
+        src, w, ret, SYNCFEB_STATE_EMPTY_NO_WAITERS | e.sf);
       return ENOMEM;
     }
     X->addr = (aligned_t *)dest;
     X->waiter = me;
-    X->next = m->FFQ;
-    m->FFQ = X;
+    X->next = w->m.FFQ;
+    w->m.FFQ = X;
+    if (deadline != QT_TIMER_NEVER) {
+      qt_timer_arm(me, deadline, qt_syncvar_timeout, src);
+    }
+    qt_syncvar_unlock(src, w, ret, SYNCFEB_STATE_EMPTY_WITH_WAITERS);
     atomic_store_explicit(
       &me->thread_state, QTHREAD_STATE_FEB_BLOCKED, memory_order_relaxed);
-    me->rdata->blockedon.addr = m;
+    me->rdata->blockedon.addr = &w->m;
     qthread_back_to_master(me);
+    if ((deadline != QT_TIMER_NEVER) && qt_timer_disarm(me)) {
+      return QTHREAD_TIMEOUT;
+    }
   } else {
   locked_full:
     /* at this point, the syncvar is locked and e.pf should be 0 */
     assert(e.pf == 0);
-    UNLOCK_THIS_MODIFIED_SYNCVAR(src, ret, e.sf);
+    qt_syncvar_unlock(src, NULL, ret, e.sf);
     if (dest) { *dest = ret; }
   }
   return QTHREAD_SUCCESS;
 }
 
+int API_FUNC qthread_syncvar_readFF(uint64_t *restrict dest,
+                                    syncvar_t *restrict src) {
+  return qt_syncvar_readFF(dest, src, QT_TIMER_NEVER);
+}
+
+int API_FUNC qthread_syncvar_readFF_timed(uint64_t *restrict dest,
+                                          syncvar_t *restrict src,
+                                          uint64_t timeout_ns) {
+  return qt_syncvar_readFF(dest, src, qt_timer_deadline(timeout_ns));
+}
+
 int API_FUNC qthread_syncvar_readFF_nb(uint64_t *restrict dest,
                                        syncvar_t *restrict src) {
   eflags_t e = {0u, 0u, 0u, 0u, 0u};
@@ -476,12 +654,12 @@ int API_FUNC qthread_syncvar_readFF_nb(uint64_t *restrict dest,
   {
     /* I'm being optimistic here; this only works if a basic 64-bit load is
      * atomic (on most platforms it is). Thus, if I've done an atomic read
-     * and the syncvar is both unlocked and full, then I figure I can trust
-     * that state and do not need to do a locked atomic operation of any
-     * kind (e.g. cas) */
+     * and the syncvar is unlocked, full, and has no waiters, then I figure I
+     * can trust that state and do not need to do a locked atomic operation of
+     * any kind (e.g. cas) */
     syncvar_t local_copy_of_src = *src;
     if ((local_copy_of_src.u.s.lock == 0) &&
-        ((local_copy_of_src.u.s.state & 2) == 0)) { /* full and unlocked */
+        (local_copy_of_src.u.s.state == SYNCFEB_STATE_FULL_NO_WAITERS)) {
       /* short-circuit */
       if (dest) { *dest = local_copy_of_src.u.s.data; }
       return QTHREAD_SUCCESS;
@@ -497,12 +675,46 @@ int API_FUNC qthread_syncvar_readFF_nb(uint64_t *restrict dest,
   } else {
     /* at this point, the syncvar is locked and e.pf should be 0 */
     assert(e.pf == 0u);
-    UNLOCK_THIS_MODIFIED_SYNCVAR(src, ret, e.sf);
+    qt_syncvar_unlock(src, NULL, ret, e.sf);
     if (dest) { *dest = ret; }
   }
   return QTHREAD_SUCCESS;
 }
 
+int API_FUNC qthread_syncvar_readXX(uint64_t *restrict dest,
+                                    syncvar_t *restrict src) {
+  eflags_t e = {0u, 0u, 0u, 0u, 0u};
+  uint64_t ret;
+  syncvar_t locked;
+
+  assert(src);
+  /* takes the lock even when unlocked-looking, because with waiters the data
+   * bits hold the waiter record, not the value */
+  ret = qthread_mwaitc(src, SYNCFEB_ANY, INT_MAX, &e);
+  qassert_ret(e.cf == 0u,
+              QTHREAD_TIMEOUT); /* there better not have been a timeout */
+  locked.u.w =
+    atomic_load_explicit((_Atomic uint64_t *)src, memory_order_relaxed);
+  UNLOCK_THIS_UNMODIFIED_SYNCVAR(
+    src, BUILD_UNLOCKED_SYNCVAR(locked.u.s.data, locked.u.s.state));
+  if (dest) { *dest = ret; }
+  return QTHREAD_SUCCESS;
+}
+
+int API_FUNC qthread_syncvar_writeXX(syncvar_t *restrict dest,
+                                     uint64_t const *restrict src) {
+  eflags_t e = {0u, 0u, 0u, 0u, 0u};
+
+  assert(dest);
+  qassert_ret((*src >> 60) == 0, QTHREAD_OVERFLOW);
+  (void)qthread_mwaitc(dest, SYNCFEB_ANY, INT_MAX, &e);
+  qassert_ret(e.cf == 0u,
+              QTHREAD_TIMEOUT); /* there better not have been a timeout */
+  /* the state, and any waiters, stay as they are */
+  qt_syncvar_unlock(dest, NULL, *src, (e.of << 2u) | (e.pf << 1u) | e.sf);
+  return QTHREAD_SUCCESS;
+}
+
 int API_FUNC qthread_syncvar_fill(syncvar_t *restrict addr) {
   assert(qthread_library_initialized);
   eflags_t e = {0u, 0u, 0u, 0u, 0u};
@@ -517,61 +729,28 @@ int API_FUNC qthread_syncvar_fill(syncvar_t *restrict addr) {
               QTHREAD_TIMEOUT); /* there better not have been a timeout */
   if (e.pf == 1u) {   /* currently empty, so it needs to change state */
     if (e.sf == 1u) { /* waiters! */
-      int const lockbin = QTHREAD_CHOOSE_STRIPE(addr);
-      qthread_addrstat_t *m;
+      qt_syncvar_waiters_t *w;
 
-      QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
       e.sf = 0u; // I'm releasing waiters
       e.pf = 0u; // I'm going to mark this as full
-#ifdef LOCK_FREE_FEBS
-      do {
-        m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)addr);
-      got_m:
-        if (!m) {
-          m = qthread_addrstat_new();
-          if (!m) { return QTHREAD_MALLOC_ERROR; }
-          QTHREAD_FASTLOCK_LOCK(&m->lock);
-          qassertnot(qt_hash_put(syncvars[lockbin], (void *)addr, m), 0);
-        } else {
-          qthread_addrstat_t *m2;
-          hazardous_ptr(0, m);
-          if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)addr))) {
-            m = m2;
-            goto got_m;
-          }
-          if (!m->valid) { continue; }
-          QTHREAD_FASTLOCK_LOCK(&m->lock);
-          if (!m->valid) {
-            QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-            continue;
-          }
-        }
-        break;
-      } while (1);
-#else  /* ifdef LOCK_FREE_FEBS */
-      /* Note that locking the hash table is unnecessary because we have
-       * locked the syncvar itself. */
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)addr);
-      assert(m); // otherwise there weren't really any waiters
-      QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif /* ifdef LOCK_FREE_FEBS */
-      if (m->FEQ) {
+      w = qt_syncvar_waiters_lock(addr, 1);
+      if (w->m.FEQ) {
         e.pf = 1u; // back to being empty
-        if (m->FEQ->next) {
+        if (w->m.FEQ->next) {
           e.sf = 1u; // only one will be dequeued, so it'll still have waiters
         }
       }
-      UNLOCK_THIS_MODIFIED_SYNCVAR(addr, ret, (e.pf << 1) | e.sf);
-      assert(m->FFQ || m->FEQ); // otherwise there weren't really any waiters
-      assert(m->EFQ == NULL);   // someone snuck in!
-      qthread_syncvar_gotlock_fill(shep, m, addr, ret);
+      qt_syncvar_unlock(addr, w, ret, (e.pf << 1) | e.sf);
+      assert(w->m.FFQ || w->m.FEQ); // otherwise there weren't really waiters
+      assert(w->m.EFQ == NULL);     // someone snuck in!
+      qthread_syncvar_gotlock_fill(shep, w, addr, ret);
     } else {
       assert(e.sf == 0u); /* no waiters */
       UNLOCK_THIS_MODIFIED_SYNCVAR(addr, ret, 0);
     }
   } else { /* already full, so just release the lock */
     assert(e.pf == 0u);
-    UNLOCK_THIS_MODIFIED_SYNCVAR(addr, ret, e.sf);
+    qt_syncvar_unlock(addr, NULL, ret, e.sf);
   }
   return QTHREAD_SUCCESS;
 }
@@ -590,73 +769,41 @@ int API_FUNC qthread_syncvar_empty(syncvar_t *restrict addr) {
               QTHREAD_TIMEOUT); /* there better not have been a timeout */
   if (e.pf == 0u) {   /* currently full, so it needs to change state */
     if (e.sf == 1u) { /* waiters! */
-      int const lockbin = QTHREAD_CHOOSE_STRIPE(addr);
-      qthread_addrstat_t *m;
+      qt_syncvar_waiters_t *w;
 
-      QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
       e.sf = 0u; // released!
                  // wanted to mark it empty, but the waiters will fill it
-#ifdef LOCK_FREE_FEBS
-      do {
-        m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)addr);
-      got_m:
-        if (!m) {
-          m = qthread_addrstat_new();
-          if (!m) { return QTHREAD_MALLOC_ERROR; }
-          QTHREAD_FASTLOCK_LOCK(&m->lock);
-          qassertnot(qt_hash_put(syncvars[lockbin], (void *)addr, m), 0);
-        } else {
-          qthread_addrstat_t *m2;
-          hazardous_ptr(0, m);
-          if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)addr))) {
-            m = m2;
-            goto got_m;
-          }
-          if (!m->valid) { continue; }
-          QTHREAD_FASTLOCK_LOCK(&m->lock);
-          if (!m->valid) {
-            QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-            continue;
-          }
-        }
-        break;
-      } while (1);
-#else                 /* ifdef LOCK_FREE_FEBS */
-      /* Note that locking the hash table is unnecessary because we have
-       * locked the syncvar itself. */
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)addr);
-      assert(m); // otherwise, there weren't any waiters
-      QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif                /* ifdef LOCK_FREE_FEBS */
-      assert(m->EFQ); // otherwise there weren't really any waiters
-      assert(m->FFQ == NULL && m->FEQ == NULL); // someone snuck in!
-      if (m->EFQ->next) { e.sf = 1u; }
-      // addr->u.w = BUILD_UNLOCKED_SYNCVAR(ret, e.sf); // this must be done by
-      // gotlock_empty so we know what value to write
-      qthread_syncvar_gotlock_empty(shep, m, addr, e.sf);
+      w = qt_syncvar_waiters_lock(addr, 1);
+      assert(w->m.EFQ); // otherwise there weren't really any waiters
+      assert(w->m.FFQ == NULL && w->m.FEQ == NULL); // someone snuck in!
+      if (w->m.EFQ->next) { e.sf = 1u; }
+      // the syncvar must be unlocked by gotlock_empty so we know what value
+      // to write
+      qthread_syncvar_gotlock_empty(shep, w, addr, e.sf);
     } else {
       assert(e.sf == 0u); /* no waiters */
       UNLOCK_THIS_MODIFIED_SYNCVAR(addr, ret, SYNCFEB_STATE_EMPTY_NO_WAITERS);
     }
   } else { /* already empty, so just release the lock */
     assert(e.pf == 1u);
-    UNLOCK_THIS_MODIFIED_SYNCVAR(
-      addr, ret, SYNCFEB_STATE_EMPTY_NO_WAITERS | e.sf);
+    qt_syncvar_unlock(addr, NULL, ret, SYNCFEB_STATE_EMPTY_NO_WAITERS | e.sf);
   }
   return QTHREAD_SUCCESS;
 }
 
-int API_FUNC qthread_syncvar_readFE(uint64_t *restrict dest,
-                                    syncvar_t *restrict src) {
+static inline int qt_syncvar_readFE(uint64_t *restrict dest,
+                                    syncvar_t *restrict src,
+                                    uint64_t const deadline) {
   assert(qthread_library_initialized);
   eflags_t e = {0u, 0u, 0u, 0u, 0u};
   uint64_t ret;
-  int const lockbin = QTHREAD_CHOOSE_STRIPE(src);
   qthread_t *me = qthread_internal_self();
 
   assert(src);
 
-  if (!me) { return qthread_syncvar_blocker_func(dest, src, READFE); }
+  if (!me) {
+    return qthread_syncvar_blocker_func_until(dest, src, READFE, deadline);
+  }
 
   assert(me->rdata);
   assert(me->rdata->shepherd_ptr);
@@ -665,7 +812,7 @@ int API_FUNC qthread_syncvar_readFE(uint64_t *restrict dest,
 
   ret = qthread_mwaitc(src, SYNCFEB_FULL, INITIAL_TIMEOUT, &e);
   if (e.cf) { /* there was a timeout */
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
     qthread_addrres_t *X;
 
     ret = qthread_mwaitc(src, SYNCFEB_ANY, INT_MAX, &e);
@@ -678,111 +825,44 @@ int API_FUNC qthread_syncvar_readFE(uint64_t *restrict dest,
         goto locked_full;
       }
     }
-    QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)src);
-    got_m:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)src, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)src))) {
-          m = m2;
-          goto got_m;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else  /* ifdef LOCK_FREE_FEBS */
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-    qt_hash_lock(syncvars[lockbin]);
-    {
-      m = (qthread_addrstat_t *)qt_hash_get_locked(syncvars[lockbin],
-                                                   (void *)src);
-      if (!m) {
-        m = qthread_addrstat_new();
-        assert(m);
-        if (!m) { return ENOMEM; }
-        qassertnot(qt_hash_put_locked(syncvars[lockbin], (void *)src, m), 0);
-      }
-      QTHREAD_FASTLOCK_LOCK(&(m->lock));
-    }
-    qt_hash_unlock(syncvars[lockbin]);
-#endif /* ifdef LOCK_FREE_FEBS */
-    UNLOCK_THIS_MODIFIED_SYNCVAR(src, ret, SYNCFEB_STATE_EMPTY_WITH_WAITERS);
-    X = ALLOC_ADDRRES();
-    assert(X);
+    w = qt_syncvar_waiters_lock(src, e.sf);
+    X = w ? ALLOC_ADDRRES() : NULL;
     if (!X) {
-      qthread_syncvar_remove(src);
+      qt_syncvar_waiters_abandon(
+        src, w, ret, SYNCFEB_STATE_EMPTY_NO_WAITERS | e.sf);
       return ENOMEM;
     }
     X->addr = (aligned_t *)&ret;
     X->waiter = me;
-    X->next = m->FEQ;
-    m->FEQ = X;
+    X->next = w->m.FEQ;
+    w->m.FEQ = X;
+    if (deadline != QT_TIMER_NEVER) {
+      qt_timer_arm(me, deadline, qt_syncvar_timeout, src);
+    }
+    qt_syncvar_unlock(src, w, ret, SYNCFEB_STATE_EMPTY_WITH_WAITERS);
     atomic_store_explicit(
       &me->thread_state, QTHREAD_STATE_FEB_BLOCKED, memory_order_relaxed);
-    me->rdata->blockedon.addr = m;
+    me->rdata->blockedon.addr = &w->m;
     qthread_back_to_master(me);
+    if ((deadline != QT_TIMER_NEVER) && qt_timer_disarm(me)) {
+      return QTHREAD_TIMEOUT;
+    }
   } else if (e.sf == 1u) { /* waiters! */
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
 
   locked_full_waiters:
     assert(e.pf == 0u); // otherwise we should have gotten a timeout
     e.sf = 0u;          // released!
     // wanted to mark it empty (pf=1), but the waiters will fill it
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)src);
-    got_m2:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)src, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)src))) {
-          m = m2;
-          goto got_m2;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else               /* ifdef LOCK_FREE_FEBS */
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-    m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)src);
-    assert(m); // otherwise, there weren't any waiters
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif              /* ifdef LOCK_FREE_FEBS */
-    assert(m->EFQ); // otherwise there weren't really any waiters
-    assert(m->FFQ == NULL && m->FEQ == NULL); // someone snuck in!
-    if (m->EFQ->next) { // there will be a waiter still waiting
+    w = qt_syncvar_waiters_lock(src, 1);
+    assert(w->m.EFQ); // otherwise there weren't really any waiters
+    assert(w->m.FFQ == NULL && w->m.FEQ == NULL); // someone snuck in!
+    if (w->m.EFQ->next) { // there will be a waiter still waiting
       e.sf = 1u;
     }
-    // src->u.w = BUILD_UNLOCKED_SYNCVAR(ret, e.sf); // this must be done by
-    // gotlock_empty so we know what value to write
-    qthread_syncvar_gotlock_empty(me->rdata->shepherd_ptr, m, src, e.sf);
+    // the syncvar must be unlocked by gotlock_empty so we know what value to
+    // write
+    qthread_syncvar_gotlock_empty(me->rdata->shepherd_ptr, w, src, e.sf);
   } else {
   locked_full:
     assert(e.pf == 0u); // otherwise this isn't really full
@@ -792,11 +872,21 @@ int API_FUNC qthread_syncvar_readFE(uint64_t *restrict dest,
   return QTHREAD_SUCCESS;
 }
 
+int API_FUNC qthread_syncvar_readFE(uint64_t *restrict dest,
+                                    syncvar_t *restrict src) {
+  return qt_syncvar_readFE(dest, src, QT_TIMER_NEVER);
+}
+
+int API_FUNC qthread_syncvar_readFE_timed(uint64_t *restrict dest,
+                                          syncvar_t *restrict src,
+                                          uint64_t timeout_ns) {
+  return qt_syncvar_readFE(dest, src, qt_timer_deadline(timeout_ns));
+}
+
 int API_FUNC qthread_syncvar_readFE_nb(uint64_t *restrict dest,
                                        syncvar_t *restrict src) {
   eflags_t e = {0u, 0u, 0u, 0u, 0u};
   uint64_t ret;
-  int const lockbin = QTHREAD_CHOOSE_STRIPE(src);
   qthread_t *me = qthread_internal_self();
 
   assert(src);
@@ -812,52 +902,20 @@ int API_FUNC qthread_syncvar_readFE_nb(uint64_t *restrict dest,
   if (e.cf) { /* there was a timeout */
     return QTHREAD_OPFAIL;
   } else if (e.sf == 1u) { /* waiters! */
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
 
     assert(e.pf == 0u); // otherwise we should have gotten a timeout
     e.sf = 0u;          // released!
-    QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
     // wanted to mark it empty (pf=1), but the waiters will fill it
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)src);
-    got_m:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)src, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)src))) {
-          m = m2;
-          goto got_m;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else               /* ifdef LOCK_FREE_FEBS */
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-    m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)src);
-    assert(m); // otherwise, there weren't any waiters
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif              /* ifdef LOCK_FREE_FEBS */
-    assert(m->EFQ); // otherwise there weren't really any waiters
-    assert(m->FFQ == NULL && m->FEQ == NULL); // someone snuck in!
-    if (m->EFQ->next) { // there will be a waiter still waiting
+    w = qt_syncvar_waiters_lock(src, 1);
+    assert(w->m.EFQ); // otherwise there weren't really any waiters
+    assert(w->m.FFQ == NULL && w->m.FEQ == NULL); // someone snuck in!
+    if (w->m.EFQ->next) { // there will be a waiter still waiting
       e.sf = 1u;
     }
-    // src->u.w = BUILD_UNLOCKED_SYNCVAR(ret, e.sf); // this must be done by
-    // gotlock_empty so we know what value to write
-    qthread_syncvar_gotlock_empty(me->rdata->shepherd_ptr, m, src, e.sf);
+    // the syncvar must be unlocked by gotlock_empty so we know what value to
+    // write
+    qthread_syncvar_gotlock_empty(me->rdata->shepherd_ptr, w, src, e.sf);
   } else {
     assert(e.pf == 0u); // otherwise this isn't really full
     UNLOCK_THIS_MODIFIED_SYNCVAR(src, ret, SYNCFEB_STATE_EMPTY_NO_WAITERS);
@@ -880,121 +938,66 @@ static inline void qthread_syncvar_schedule(qthread_t *waiter,
   }
 }
 
-static inline void qthread_syncvar_remove(void *maddr) {
-  int const lockbin = QTHREAD_CHOOSE_STRIPE(maddr);
-  qthread_addrstat_t *m;
-
-#ifdef LOCK_FREE_FEBS
-  {
-    qthread_addrstat_t *m2;
-    m = qt_hash_get(syncvars[lockbin], (void *)maddr);
-  got_m:
-    if (!m) { return; }
-    hazardous_ptr(0, m);
-    if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)maddr))) {
-      m = m2;
-      goto got_m;
-    }
-    if (!m->valid) { return; }
-    QTHREAD_FASTLOCK_LOCK(&m->lock);
-    if (!m->valid) { return; }
-    if ((m->FEQ == NULL) && (m->EFQ == NULL) && (m->FFQ == NULL)) {
-      m->valid = 0;
-      qassertnot(qt_hash_remove(syncvars[lockbin], (void *)maddr), 0);
-    } else {
-      QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-      return;
-    }
-  }
-  assert(m);
-#else  /* ifdef LOCK_FREE_FEBS */
-  qt_hash_lock(syncvars[lockbin]);
-  m =
-    (qthread_addrstat_t *)qt_hash_get_locked(syncvars[lockbin], (void *)maddr);
-  if (m) {
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-    if ((m->FEQ == NULL) && (m->EFQ == NULL) && (m->FFQ == NULL)) {
-      qt_hash_remove_locked(syncvars[lockbin], (void *)maddr);
-    } else {
-      QTHREAD_FASTLOCK_UNLOCK(&(m->lock));
-      m = NULL;
-    }
-  }
-  qt_hash_unlock(syncvars[lockbin]);
-#endif /* ifdef LOCK_FREE_FEBS */
-  if (m != NULL) {
-    QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-#ifdef LOCK_FREE_FEBS
-    hazardous_release_node((hazardous_free_f)qthread_addrstat_delete, m);
-#else
-    qthread_addrstat_delete(m);
-#endif
-  }
-}
-
+/* Both gotlock functions are called with the waiter record locked, and free
+ * it if they take its last waiter (in which case the syncvar no longer points
+ * to it). */
 static inline void qthread_syncvar_gotlock_empty(qthread_shepherd_t *shep,
-                                                 qthread_addrstat_t *m,
+                                                 qt_syncvar_waiters_t *w,
                                                  syncvar_t *maddr,
                                                  uint64_t const sf) {
   qthread_addrres_t *X = NULL;
-  int removeable;
 
-  m->full = 0;
-  if (m->EFQ != NULL) {
+  w->m.full = 0;
+  if (w->m.EFQ != NULL) {
     /* dequeue one EFQ, do its operation, and schedule the thread */
-    X = m->EFQ;
-    m->EFQ = X->next;
+    X = w->m.EFQ;
+    w->m.EFQ = X->next;
     /* op */
     if (maddr && (maddr != (syncvar_t *)X->addr)) {
-      UNLOCK_THIS_MODIFIED_SYNCVAR(maddr, *((uint64_t *)X->addr), sf);
+      qt_syncvar_unlock(maddr, w, *((uint64_t *)X->addr), sf);
     }
     qthread_syncvar_schedule(X->waiter, shep);
     FREE_ADDRRES(X);
   }
-  if ((m->EFQ == NULL) && (m->FEQ == NULL) && (m->FFQ == NULL)) {
-    removeable = 1;
+  if ((w->m.EFQ == NULL) && (w->m.FEQ == NULL) && (w->m.FFQ == NULL)) {
+    qt_syncvar_waiters_release(w);
   } else {
-    removeable = 0;
+    QTHREAD_FASTLOCK_UNLOCK(&w->m.lock);
   }
-  QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-  if (removeable) { qthread_syncvar_remove(maddr); }
 }
 
 static inline void qthread_syncvar_gotlock_fill(qthread_shepherd_t *shep,
-                                                qthread_addrstat_t *m,
+                                                qt_syncvar_waiters_t *w,
                                                 syncvar_t *maddr,
                                                 uint64_t const ret) {
   qthread_addrres_t *X = NULL;
-  int removeable;
 
-  m->full = 1;
+  w->m.full = 1;
   /* dequeue all FFQ, do their operation, and schedule them */
-  while (m->FFQ != NULL) {
+  while (w->m.FFQ != NULL) {
     /* dQ */
-    X = m->FFQ;
-    m->FFQ = X->next;
+    X = w->m.FFQ;
+    w->m.FFQ = X->next;
     /* op */
     if (X->addr) { *(uint64_t *)X->addr = ret; }
     /* schedule */
     qthread_syncvar_schedule(X->waiter, shep);
     FREE_ADDRRES(X);
   }
-  if (m->FEQ != NULL) {
+  if (w->m.FEQ != NULL) {
     /* dequeue one FEQ, do their operation, and reschedule them */
-    X = m->FEQ;
-    m->FEQ = X->next;
+    X = w->m.FEQ;
+    w->m.FEQ = X->next;
     /* op */
     if (X->addr) { *(uint64_t *)X->addr = ret; }
     qthread_syncvar_schedule(X->waiter, shep);
     FREE_ADDRRES(X);
   }
-  if ((m->EFQ == NULL) && (m->FEQ == NULL) && (m->FFQ == NULL)) {
-    removeable = 1;
+  if ((w->m.EFQ == NULL) && (w->m.FEQ == NULL) && (w->m.FFQ == NULL)) {
+    qt_syncvar_waiters_release(w);
   } else {
-    removeable = 0;
+    QTHREAD_FASTLOCK_UNLOCK(&w->m.lock);
   }
-  QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-  if (removeable) { qthread_syncvar_remove(maddr); }
 }
 
 int API_FUNC qthread_syncvar_writeF(syncvar_t *restrict dest,
@@ -1013,56 +1016,24 @@ int API_FUNC qthread_syncvar_writeF(syncvar_t *restrict dest,
   qassert_ret(e.cf == 0u,
               QTHREAD_TIMEOUT);       /* there better not have been a timeout */
   if ((e.pf == 1u) && (e.sf == 1u)) { /* there are waiters to release */
-    int const lockbin = QTHREAD_CHOOSE_STRIPE(dest);
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
 
-    QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
     e.sf = 0u; // I'm releasing waiters
     e.pf = 0u; // I'm going to mark this as full
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)dest);
-    got_m:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)dest, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)dest))) {
-          m = m2;
-          goto got_m;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else  /* ifdef LOCK_FREE_FEBS */
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-    m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)dest);
-    assert(m); // otherwise there weren't really any waiters
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif /* ifdef LOCK_FREE_FEBS */
-    if (m->FEQ) {
+    w = qt_syncvar_waiters_lock(dest, 1);
+    if (w->m.FEQ) {
       e.pf = 1u; // back to being empty
-      if (m->FEQ->next) {
+      if (w->m.FEQ->next) {
         e.sf = 1u; // only one will be dequeued, so it'll still have waiters
       }
     }
-    UNLOCK_THIS_MODIFIED_SYNCVAR(dest, ret, (e.pf << 1u) | e.sf);
-    assert(m->FFQ || m->FEQ); // otherwise there weren't really any waiters
-    assert(m->EFQ == NULL);   // someone snuck in!
-    qthread_syncvar_gotlock_fill(shep, m, dest, ret);
+    qt_syncvar_unlock(dest, w, ret, (e.pf << 1u) | e.sf);
+    assert(w->m.FFQ || w->m.FEQ); // otherwise there weren't really waiters
+    assert(w->m.EFQ == NULL);     // someone snuck in!
+    qthread_syncvar_gotlock_fill(shep, w, dest, ret);
   } else {
-    UNLOCK_THIS_MODIFIED_SYNCVAR(dest, ret, 0);
+    /* full, possibly with writers waiting for it to be emptied */
+    qt_syncvar_unlock(dest, NULL, ret, e.sf);
   }
 
   return QTHREAD_SUCCESS;
@@ -1074,19 +1045,22 @@ int API_FUNC qthread_syncvar_writeF_const(syncvar_t *restrict dest,
   return qthread_syncvar_writeF(dest, &src);
 }
 
-int API_FUNC qthread_syncvar_writeEF(syncvar_t *restrict dest,
-                                     uint64_t const *restrict src) {
+static inline int qt_syncvar_writeEF(syncvar_t *restrict dest,
+                                     uint64_t const *restrict src,
+                                     uint64_t const deadline) {
   assert(qthread_library_initialized);
   eflags_t e = {0u, 0u, 0u, 0u, 0u};
-  int const lockbin = QTHREAD_CHOOSE_STRIPE(dest);
   qthread_t *me = qthread_internal_self();
 
   qassert_ret((*src >> 60) == 0, QTHREAD_OVERFLOW);
 
-  if (!me) { return qthread_syncvar_blocker_func(dest, (void *)src, WRITEEF); }
+  if (!me) {
+    return qthread_syncvar_blocker_func_until(
+      dest, (void *)src, WRITEEF, deadline);
+  }
   (void)qthread_mwaitc(dest, SYNCFEB_EMPTY, INITIAL_TIMEOUT, &e);
   if (e.cf) { /* there was a timeout */
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
     qthread_addrres_t *X;
 
     uint64_t ret = qthread_mwaitc(dest, SYNCFEB_ANY, INT_MAX, &e);
@@ -1099,109 +1073,46 @@ int API_FUNC qthread_syncvar_writeEF(syncvar_t *restrict dest,
         goto locked_empty;
       }
     }
-    QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)dest);
-    got_m:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)dest, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)dest))) {
-          m = m2;
-          goto got_m;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else  /* ifdef LOCK_FREE_FEBS */
-    qt_hash_lock(syncvars[lockbin]);
-    m =
-      (qthread_addrstat_t *)qt_hash_get_locked(syncvars[lockbin], (void *)dest);
-    if (!m) {
-      m = qthread_addrstat_new();
-      assert(m);
-      if (!m) { return QTHREAD_MALLOC_ERROR; }
-      qassertnot(qt_hash_put_locked(syncvars[lockbin], (void *)dest, m), 0);
+    w = qt_syncvar_waiters_lock(dest, e.sf);
+    X = w ? ALLOC_ADDRRES() : NULL;
+    if (!X) {
+      qt_syncvar_waiters_abandon(
+        dest, w, ret, SYNCFEB_STATE_FULL_NO_WAITERS | e.sf);
+      return ENOMEM;
     }
-    /* lock the addrstat (already within the hash) and then unlock the syncvar
-     */
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-    qt_hash_unlock(syncvars[lockbin]);
-#endif /* ifdef LOCK_FREE_FEBS */
-    UNLOCK_THIS_MODIFIED_SYNCVAR(dest, ret, SYNCFEB_STATE_FULL_WITH_WAITERS);
-    X = ALLOC_ADDRRES();
-    assert(X);
     X->addr = (aligned_t *)src;
     X->waiter = me;
-    X->next = m->EFQ;
-    m->EFQ = X;
+    X->next = w->m.EFQ;
+    w->m.EFQ = X;
+    if (deadline != QT_TIMER_NEVER) {
+      qt_timer_arm(me, deadline, qt_syncvar_timeout, dest);
+    }
+    qt_syncvar_unlock(dest, w, ret, SYNCFEB_STATE_FULL_WITH_WAITERS);
     atomic_store_explicit(
       &me->thread_state, QTHREAD_STATE_FEB_BLOCKED, memory_order_relaxed);
-    me->rdata->blockedon.addr = m;
+    me->rdata->blockedon.addr = &w->m;
     qthread_back_to_master(me);
+    if ((deadline != QT_TIMER_NEVER) && qt_timer_disarm(me)) {
+      return QTHREAD_TIMEOUT;
+    }
   } else if (e.sf == 1u) { /* there are waiters to release! */
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
 
   locked_empty_waiters:
     assert(e.pf == 1u); // otherwise it wasn't really empty
     e.pf = 0u;          // mark full
     e.sf = 0u;          // released!
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)dest);
-    got_m2:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)dest, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)dest))) {
-          m = m2;
-          goto got_m2;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else                         /* ifdef LOCK_FREE_FEBS */
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-    m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)dest);
-    assert(m); // otherwise there weren't really any waiters
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif                        /* ifdef LOCK_FREE_FEBS */
-    assert(m->FFQ || m->FEQ); // otherwise there weren't really any waiters
-    assert(m->EFQ == NULL);   // someone snuck in!
-    if (m->FEQ) {
+    w = qt_syncvar_waiters_lock(dest, 1);
+    assert(w->m.FFQ || w->m.FEQ); // otherwise there weren't really waiters
+    assert(w->m.EFQ == NULL);     // someone snuck in!
+    if (w->m.FEQ) {
       e.pf = 1u;
-      if (m->FEQ->next) { e.sf = 1u; }
+      if (w->m.FEQ->next) { e.sf = 1u; }
     }
     {
       uint64_t val = *src;
-      UNLOCK_THIS_MODIFIED_SYNCVAR(dest, val, (e.pf << 1u) | e.sf);
-      qthread_syncvar_gotlock_fill(me->rdata->shepherd_ptr, m, dest, val);
+      qt_syncvar_unlock(dest, w, val, (e.pf << 1u) | e.sf);
+      qthread_syncvar_gotlock_fill(me->rdata->shepherd_ptr, w, dest, val);
     }
   } else {
     uint64_t val;
@@ -1215,6 +1126,17 @@ int API_FUNC qthread_syncvar_writeEF(syncvar_t *restrict dest,
   return QTHREAD_SUCCESS;
 }
 
+int API_FUNC qthread_syncvar_writeEF(syncvar_t *restrict dest,
+                                     uint64_t const *restrict src) {
+  return qt_syncvar_writeEF(dest, src, QT_TIMER_NEVER);
+}
+
+int API_FUNC qthread_syncvar_writeEF_timed(syncvar_t *restrict dest,
+                                           uint64_t const *restrict src,
+                                           uint64_t timeout_ns) {
+  return qt_syncvar_writeEF(dest, src, qt_timer_deadline(timeout_ns));
+}
+
 int API_FUNC qthread_syncvar_writeEF_const(syncvar_t *restrict dest,
                                            uint64_t const src) {
   assert(qthread_library_initialized);
@@ -1224,7 +1146,6 @@ int API_FUNC qthread_syncvar_writeEF_const(syncvar_t *restrict dest,
 int qthread_syncvar_writeEF_nb(syncvar_t *restrict dest,
                                uint64_t const *restrict src) {
   eflags_t e = {0u, 0u, 0u, 0u, 0u};
-  int const lockbin = QTHREAD_CHOOSE_STRIPE(dest);
   qthread_t *me = qthread_internal_self();
 
   qassert_ret((*src >> 60) == 0, QTHREAD_OVERFLOW);
@@ -1236,54 +1157,22 @@ int qthread_syncvar_writeEF_nb(syncvar_t *restrict dest,
   if (e.cf) { /* there was a timeout */
     return QTHREAD_OPFAIL;
   } else if (e.sf == 1u) { /* there are waiters to release! */
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
 
-    QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
     assert(e.pf == 1u); // otherwise it wasn't really empty
     e.pf = 0u;          // mark full
     e.sf = 0u;          // released!
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)dest);
-    got_m:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)dest, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)dest))) {
-          m = m2;
-          goto got_m;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else                         /* ifdef LOCK_FREE_FEBS */
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-    m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)dest);
-    assert(m); // otherwise there weren't really any waiters
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif                        /* ifdef LOCK_FREE_FEBS */
-    assert(m->FFQ || m->FEQ); // otherwise there weren't really any waiters
-    assert(m->EFQ == NULL);   // someone snuck in!
-    if (m->FEQ) {
+    w = qt_syncvar_waiters_lock(dest, 1);
+    assert(w->m.FFQ || w->m.FEQ); // otherwise there weren't really waiters
+    assert(w->m.EFQ == NULL);     // someone snuck in!
+    if (w->m.FEQ) {
       e.pf = 1u;
-      if (m->FEQ->next) { e.sf = 1u; }
+      if (w->m.FEQ->next) { e.sf = 1u; }
     }
     {
       uint64_t val = *src;
-      UNLOCK_THIS_MODIFIED_SYNCVAR(dest, val, (e.pf << 1u) | e.sf);
-      qthread_syncvar_gotlock_fill(me->rdata->shepherd_ptr, m, dest, val);
+      qt_syncvar_unlock(dest, w, val, (e.pf << 1u) | e.sf);
+      qthread_syncvar_gotlock_fill(me->rdata->shepherd_ptr, w, dest, val);
     }
   } else {
     uint64_t val;
@@ -1310,63 +1199,28 @@ uint64_t API_FUNC qthread_syncvar_incrF(syncvar_t *restrict operand,
 
   assert(operand);
   if (!me) { return qthread_syncvar_blocker_func(operand, (void *)&inc, INCR); }
-  qthread_mwaitc(operand, SYNCFEB_ANY, INT_MAX, &e);
+  newv = qthread_mwaitc(operand, SYNCFEB_ANY, INT_MAX, &e) + inc;
   qassert_ret(
     e.cf == 0u,
     (uint64_t)QTHREAD_TIMEOUT);       /* there better not have been a timeout */
   if ((e.pf == 1u) && (e.sf == 1u)) { /* there are waiters to release */
-    int const lockbin = QTHREAD_CHOOSE_STRIPE(operand);
-    qthread_addrstat_t *m;
+    qt_syncvar_waiters_t *w;
 
-    QTHREAD_COUNT_THREADS_BINCOUNTER(febs, lockbin);
     e.sf = 0u; // I'm releasing waiters
     e.pf = 0u; // I'm going to mark this as full
-#ifdef LOCK_FREE_FEBS
-    do {
-      m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)operand);
-    got_m:
-      if (!m) {
-        m = qthread_addrstat_new();
-        if (!m) { return QTHREAD_MALLOC_ERROR; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        qassertnot(qt_hash_put(syncvars[lockbin], (void *)operand, m), 0);
-      } else {
-        qthread_addrstat_t *m2;
-        hazardous_ptr(0, m);
-        if (m != (m2 = qt_hash_get(syncvars[lockbin], (void *)operand))) {
-          m = m2;
-          goto got_m;
-        }
-        if (!m->valid) { continue; }
-        QTHREAD_FASTLOCK_LOCK(&m->lock);
-        if (!m->valid) {
-          QTHREAD_FASTLOCK_UNLOCK(&m->lock);
-          continue;
-        }
-      }
-      break;
-    } while (1);
-#else  /* ifdef LOCK_FREE_FEBS */
-    /* Note that locking the hash table is unnecessary because we have
-     * locked the syncvar itself. */
-    m = (qthread_addrstat_t *)qt_hash_get(syncvars[lockbin], (void *)operand);
-    assert(m); // otherwise there weren't really any waiters
-    QTHREAD_FASTLOCK_LOCK(&(m->lock));
-#endif /* ifdef LOCK_FREE_FEBS */
-    if (m->FEQ) {
+    w = qt_syncvar_waiters_lock(operand, 1);
+    if (w->m.FEQ) {
       e.pf = 1u; // back to being empty
-      if (m->FEQ->next) {
+      if (w->m.FEQ->next) {
         e.sf = 1u; // only one will be dequeued, so it'll still have waiters
       }
     }
-    newv = operand->u.s.data + inc;
-    UNLOCK_THIS_MODIFIED_SYNCVAR(operand, newv, (e.pf << 1u) | e.sf);
-    assert(m->FFQ || m->EFQ); // otherwise there weren't really any waiters
-    assert(m->FEQ == NULL);   // someone snuck in!
-    qthread_syncvar_gotlock_fill(me->rdata->shepherd_ptr, m, operand, newv);
+    qt_syncvar_unlock(operand, w, newv, (e.pf << 1u) | e.sf);
+    assert(w->m.FFQ || w->m.FEQ); // otherwise there weren't really waiters
+    assert(w->m.EFQ == NULL);     // someone snuck in!
+    qthread_syncvar_gotlock_fill(me->rdata->shepherd_ptr, w, operand, newv);
   } else {
-    newv = operand->u.s.data + inc;
-    UNLOCK_THIS_MODIFIED_SYNCVAR(operand, newv, (e.pf << 1u) | e.sf);
+    qt_syncvar_unlock(operand, NULL, newv, (e.pf << 1u) | e.sf);
   }
 
   return newv;
@@ -1380,19 +1234,9 @@ static filter_code qt_syncvar_tf_call_cb(qt_key_t const addr,
   void *tls;
 
   if (waiter->rdata->tasklocal_size <= qlib->qthread_tasklocal_size) {
-    if (atomic_load_explicit(&waiter->flags, memory_order_relaxed) &
-        QTHREAD_BIG_STRUCT) {
-      tls = &waiter->data[qlib->qthread_argcopy_size];
-    } else {
-      tls = waiter->data;
-    }
+    tls = waiter->data;
   } else {
-    if (atomic_load_explicit(&waiter->flags, memory_order_relaxed) &
-        QTHREAD_BIG_STRUCT) {
-      tls = *(void **)&waiter->data[qlib->qthread_argcopy_size];
-    } else {
-      tls = *(void **)&waiter->data[0];
-    }
+    tls = *(void **)&waiter->data[0];
   }
   f((void *)addr,
     waiter->f,
@@ -1450,9 +1294,10 @@ void INTERNAL qthread_syncvar_taskfilter_serial(qt_syncvar_taskfilter_f tf,
                                                 void *arg) {
   void *pass[3] = {tf, arg, NULL};
 
-  for (unsigned int i = 0; i < QTHREAD_LOCKING_STRIPES; i++) {
-    qt_hash_callback(
-      syncvars[i], (qt_hash_callback_fn)qt_syncvar_call_tf, pass);
+  for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds; i++) {
+    for (qt_syncvar_waiters_t *w = syncvar_tables[i].head; w; w = w->next) {
+      qt_syncvar_call_tf((qt_key_t)w->addr, &w->m, pass);
+    }
   }
 }
 
@@ -1460,9 +1305,12 @@ void INTERNAL qthread_syncvar_taskfilter(qt_syncvar_taskfilter_f tf,
                                          void *arg) {
   void *pass[3] = {tf, arg, (void *)(uintptr_t)1};
 
-  for (unsigned int i = 0; i < QTHREAD_LOCKING_STRIPES; i++) {
-    qt_hash_callback(
-      syncvars[i], (qt_hash_callback_fn)qt_syncvar_call_tf, pass);
+  for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds; i++) {
+    QTHREAD_FASTLOCK_LOCK(&syncvar_tables[i].lock);
+    for (qt_syncvar_waiters_t *w = syncvar_tables[i].head; w; w = w->next) {
+      qt_syncvar_call_tf((qt_key_t)w->addr, &w->m, pass);
+    }
+    QTHREAD_FASTLOCK_UNLOCK(&syncvar_tables[i].lock);
   }
 }
 
@@ -13,9 +13,9 @@
 #include "qt_qthread_mgmt.h"
 #include "qthread_innards.h" /* for qlib */
 
-int qt_accept(int socket,
-              struct sockaddr *restrict address,
-              socklen_t *restrict address_len) {
+int API_FUNC qt_accept(int socket,
+                       struct sockaddr *restrict address,
+                       socklen_t *restrict address_len) {
   qt_blocking_queue_node_t *job = ALLOC_SYSCALLJOB();
   int ret;
   qthread_t *me = qthread_internal_self();
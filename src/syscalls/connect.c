@@ -13,9 +13,9 @@
 #include "qt_qthread_mgmt.h"
 #include "qthread_innards.h" /* for qlib */
 
-int qt_connect(int socket,
-               const struct sockaddr *address,
-               socklen_t address_len) {
+int API_FUNC qt_connect(int socket,
+                        const struct sockaddr *address,
+                        socklen_t address_len) {
   qthread_t *me = qthread_internal_self();
   qt_blocking_queue_node_t *job = ALLOC_SYSCALLJOB();
   int ret;
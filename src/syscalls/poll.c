@@ -12,7 +12,7 @@
 #include "qt_qthread_mgmt.h"
 #include "qthread_innards.h" /* for qlib */
 
-int qt_poll(struct pollfd fds[], nfds_t nfds, int timeout) {
+int API_FUNC qt_poll(struct pollfd fds[], nfds_t nfds, int timeout) {
   qthread_t *me = qthread_internal_self();
   qt_blocking_queue_node_t *job = ALLOC_SYSCALLJOB();
   int ret;
@@ -15,7 +15,10 @@
 #include "qt_qthread_mgmt.h"
 #include "qthread_innards.h" /* for qlib */
 
-ssize_t qt_pread(int filedes, void *buf, size_t nbyte, off_t offset) {
+ssize_t API_FUNC qt_pread(int filedes,
+                          void *buf,
+                          size_t nbyte,
+                          off_t offset) {
   qthread_t *me = qthread_internal_self();
   qt_blocking_queue_node_t *job = ALLOC_SYSCALLJOB();
   ssize_t ret;
@@ -15,11 +15,11 @@
 #include "qt_qthread_mgmt.h"
 #include "qthread_innards.h" /* for qlib */
 
-int qt_select(int nfds,
-              fd_set *restrict readfds,
-              fd_set *restrict writefds,
-              fd_set *restrict errorfds,
-              struct timeval *restrict timeout) {
+int API_FUNC qt_select(int nfds,
+                       fd_set *restrict readfds,
+                       fd_set *restrict writefds,
+                       fd_set *restrict errorfds,
+                       struct timeval *restrict timeout) {
   qthread_t *me = qthread_internal_self();
   qt_blocking_queue_node_t *job = ALLOC_SYSCALLJOB();
   int ret;
@@ -13,7 +13,10 @@
 #include "qt_qthread_mgmt.h"
 #include "qthread_innards.h" /* for qlib */
 
-pid_t qt_wait4(pid_t pid, int *stat_loc, int options, struct rusage *rusage) {
+pid_t API_FUNC qt_wait4(pid_t pid,
+                        int *stat_loc,
+                        int options,
+                        struct rusage *rusage) {
   qthread_t *me = qthread_internal_self();
   qt_blocking_queue_node_t *job = ALLOC_SYSCALLJOB();
   pid_t ret;
@@ -15,7 +15,7 @@
 #include "qt_qthread_mgmt.h"
 #include "qthread_innards.h" /* for qlib */
 
-ssize_t qt_write(int filedes, void const *buf, size_t nbyte) {
+ssize_t API_FUNC qt_write(int filedes, void const *buf, size_t nbyte) {
   qthread_t *me = qthread_internal_self();
   qt_blocking_queue_node_t *job = ALLOC_SYSCALLJOB();
   ssize_t ret;
@@ -0,0 +1,665 @@
+/* System Headers */
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+/* Public Headers */
+#include "qthread/cacheline.h"
+#include "qthread/qthread.h"
+
+/* Internal Headers */
+#include "qt_alloc.h"
+#include "qt_asserts.h"
+#include "qt_envariables.h"
+#include "qt_expect.h"
+#include "qt_idle.h"
+#include "qt_io.h" /* for qt_blocking_subsystem_poll() */
+#include "qt_prefetch.h"
+#include "qt_qthread_mgmt.h" /* for qthread_thread_free() */
+#include "qt_qthread_struct.h"
+#include "qt_shepherd_innards.h"
+#include "qt_subsystems.h"
+#include "qt_threadqueue_ops.h"
+#include "qt_threadqueue_scheduler.h"
+#include "qt_threadqueues.h"
+#include "qt_trace.h"
+#include "qt_visibility.h"
+#include "qthread_innards.h" /* for qlib */
+
+/* This thread queueing uses one Chase-Lev work-stealing deque per worker, see
+ * "Dynamic Circular Work-Stealing Deque" (Chase & Lev, SPAA'05) and, for the
+ * memory orderings, "Correct and Efficient Work-Stealing for Weak Memory
+ * Models" (Le et al., PPoPP'13).
+ *
+ * Only the worker that owns a deque may push to or pop from its bottom, which
+ * it does LIFO and without any read-modify-write atomics unless it is racing a
+ * thief for the very last element. Thieves (sibling workers in the same
+ * shepherd first, then workers of other shepherds) take from the top with a
+ * CAS. Everything that is not the owner (other shepherds, I/O proxy threads,
+ * yielded tasks) goes through a per-shepherd lock-free inbox instead, which
+ * is drained into the owner's deque once the deque runs dry. */
+
+#define CL_INITIAL_LOG_SIZE 8
+#define CL_UNSTEALABLE ((uintptr_t)1)
+#define CL_PTR(x) ((qthread_t *)((x) & ~CL_UNSTEALABLE))
+
+typedef struct qt_threadqueue_node_s qt_threadqueue_node_t;
+
+/* Data Structures */
+struct qt_threadqueue_node_s {
+  struct qt_threadqueue_node_s *next;
+  qthread_t *thread;
+};
+
+typedef struct qt_cl_array_s {
+  struct qt_cl_array_s *retired; /* older (smaller) arrays, freed with the
+                                  * deque since thieves may still read them */
+  long mask;
+  /* each slot holds a qthread_t pointer, tagged with CL_UNSTEALABLE when the
+   * task may not leave its shepherd */
+  _Atomic uintptr_t buf[];
+} qt_cl_array_t;
+
+typedef struct {
+  alignas(CACHELINE_WIDTH) _Atomic long top;
+  alignas(CACHELINE_WIDTH) _Atomic long bottom;
+  qt_cl_array_t *_Atomic array;
+} qt_cl_deque_t;
+
+struct _qt_threadqueue {
+  qt_cl_deque_t *deques; /* one per worker in the shepherd */
+  alignas(CACHELINE_WIDTH) qt_threadqueue_node_t *_Atomic inbox;
+  _Atomic long inbox_len;
+  qthread_t *_Atomic mccoy; /* only ever run by shepherd 0 worker 0 */
+  int mccoy_ran;            /* so a yield loop in main cannot starve others */
+  qt_idle_t idle;
+} /* qt_threadqueue_t */;
+
+static aligned_t steal_disable = 0;
+static long steal_chunksize = 0;
+
+/* Memory Management */
+static qt_threadqueue_pools_t generic_threadqueue_pools;
+#define ALLOC_THREADQUEUE()                                                    \
+  (qt_threadqueue_t *)qt_mpool_alloc(generic_threadqueue_pools.queues)
+#define FREE_THREADQUEUE(t) qt_mpool_free(generic_threadqueue_pools.queues, t)
+#define ALLOC_TQNODE()                                                         \
+  (qt_threadqueue_node_t *)qt_mpool_alloc(generic_threadqueue_pools.nodes)
+#define FREE_TQNODE(t) qt_mpool_free(generic_threadqueue_pools.nodes, t)
+
+static void qt_threadqueue_subsystem_shutdown(void) {
+  qt_mpool_destroy(generic_threadqueue_pools.nodes);
+  qt_mpool_destroy(generic_threadqueue_pools.queues);
+}
+
+void INTERNAL qt_threadqueue_subsystem_init(void) {
+  generic_threadqueue_pools.queues = qt_mpool_create_aligned(
+    sizeof(qt_threadqueue_t), _Alignof(qt_threadqueue_t));
+  generic_threadqueue_pools.nodes =
+    qt_mpool_create_aligned(sizeof(qt_threadqueue_node_t), 8);
+  steal_chunksize = qt_internal_get_env_num("STEAL_CHUNK", 0, 0);
+  qthread_internal_cleanup(qt_threadqueue_subsystem_shutdown);
+}
+
+/*****************************************/
+/* the per-worker Chase-Lev deque        */
+/*****************************************/
+
+static inline qt_cl_array_t *qt_cl_array_new(long log_size) {
+  qt_cl_array_t *a =
+    qt_malloc(sizeof(qt_cl_array_t) + (sizeof(uintptr_t) << log_size));
+
+  assert(a);
+  a->retired = NULL;
+  a->mask = (1l << log_size) - 1;
+  return a;
+}
+
+static inline void qt_cl_deque_init(qt_cl_deque_t *d) {
+  atomic_init(&d->top, 0);
+  atomic_init(&d->bottom, 0);
+  atomic_init(&d->array, qt_cl_array_new(CL_INITIAL_LOG_SIZE));
+}
+
+static inline void qt_cl_deque_destroy(qt_cl_deque_t *d) {
+  qt_cl_array_t *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+
+  while (a) {
+    qt_cl_array_t *next = a->retired;
+    qt_free(a);
+    a = next;
+  }
+}
+
+/* owner only */
+static qt_cl_array_t *
+qt_cl_deque_grow(qt_cl_deque_t *d, qt_cl_array_t *a, long t, long b) {
+  long log_size = 0;
+
+  while ((1l << log_size) <= a->mask) { log_size++; }
+  qt_cl_array_t *n = qt_cl_array_new(log_size + 1);
+  for (long i = t; i < b; i++) {
+    atomic_store_explicit(
+      &n->buf[i & n->mask],
+      atomic_load_explicit(&a->buf[i & a->mask], memory_order_relaxed),
+      memory_order_relaxed);
+  }
+  n->retired = a;
+  atomic_store_explicit(&d->array, n, memory_order_release);
+  return n;
+}
+
+/* owner only: push at the bottom */
+static inline void qt_cl_deque_push(qt_cl_deque_t *d, uintptr_t x) {
+  long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+  long t = atomic_load_explicit(&d->top, memory_order_acquire);
+  qt_cl_array_t *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+
+  if (QTHREAD_UNLIKELY(b - t > a->mask)) { a = qt_cl_deque_grow(d, a, t, b); }
+  atomic_store_explicit(&a->buf[b & a->mask], x, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+}
+
+/* owner only: pop from the bottom (LIFO) */
+static inline uintptr_t qt_cl_deque_take(qt_cl_deque_t *d) {
+  long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+  qt_cl_array_t *a = atomic_load_explicit(&d->array, memory_order_relaxed);
+  uintptr_t x = 0;
+  long t;
+
+  atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  t = atomic_load_explicit(&d->top, memory_order_relaxed);
+  if (t <= b) {
+    x = atomic_load_explicit(&a->buf[b & a->mask], memory_order_relaxed);
+    if (t == b) {
+      /* last element: race the thieves for it */
+      if (!atomic_compare_exchange_strong_explicit(&d->top,
+                                                   &t,
+                                                   t + 1,
+                                                   memory_order_seq_cst,
+                                                   memory_order_relaxed)) {
+        x = 0;
+      }
+      atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    }
+  } else {
+    atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+  }
+  return x;
+}
+
+/* anyone: take from the top (FIFO). Unstealable tasks are only handed to
+ * thieves from the same shepherd; a foreign thief that finds one at the top
+ * simply gives up on this deque. */
+static inline uintptr_t qt_cl_deque_steal(qt_cl_deque_t *d,
+                                          int same_shepherd) {
+  long t = atomic_load_explicit(&d->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+
+  if (t < b) {
+    qt_cl_array_t *a = atomic_load_explicit(&d->array, memory_order_acquire);
+    uintptr_t x =
+      atomic_load_explicit(&a->buf[t & a->mask], memory_order_relaxed);
+    if (!same_shepherd && (x & CL_UNSTEALABLE)) { return 0; }
+    if (!atomic_compare_exchange_strong_explicit(&d->top,
+                                                 &t,
+                                                 t + 1,
+                                                 memory_order_seq_cst,
+                                                 memory_order_relaxed)) {
+      return 0;
+    }
+    return x;
+  }
+  return 0;
+}
+
+static inline long qt_cl_deque_size(qt_cl_deque_t *d) {
+  long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+  long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+
+  return (b > t) ? (b - t) : 0;
+}
+
+/*****************************************/
+/* functions to manage the thread queues */
+/*****************************************/
+
+qt_threadqueue_t INTERNAL *qt_threadqueue_new(void) {
+  qt_threadqueue_t *q = ALLOC_THREADQUEUE();
+
+  qassert_ret(q != NULL, NULL);
+
+  q->deques = qt_internal_aligned_alloc(
+    qlib->nworkerspershep * sizeof(qt_cl_deque_t), CACHELINE_WIDTH);
+  qassert_ret(q->deques != NULL, NULL);
+  for (qthread_worker_id_t i = 0; i < qlib->nworkerspershep; i++) {
+    qt_cl_deque_init(&q->deques[i]);
+  }
+  atomic_init(&q->inbox, NULL);
+  atomic_init(&q->inbox_len, 0);
+  atomic_init(&q->mccoy, NULL);
+  q->mccoy_ran = 0;
+  qt_idle_init(&q->idle);
+
+  return q;
+}
+
+qt_idle_t INTERNAL *qt_threadqueue_idle(qt_threadqueue_t *q) {
+  return &q->idle;
+}
+
+void INTERNAL qt_threadqueue_free(qt_threadqueue_t *q) {
+  qt_threadqueue_node_t *node;
+
+  assert(q);
+  for (qthread_worker_id_t i = 0; i < qlib->nworkerspershep; i++) {
+    uintptr_t x;
+    while ((x = qt_cl_deque_take(&q->deques[i])) != 0) {
+      qthread_thread_free(CL_PTR(x));
+    }
+    qt_cl_deque_destroy(&q->deques[i]);
+  }
+  node = atomic_exchange_explicit(&q->inbox, NULL, memory_order_acquire);
+  while (node) {
+    qt_threadqueue_node_t *next = node->next;
+    qthread_thread_free(node->thread);
+    FREE_TQNODE(node);
+    node = next;
+  }
+  qt_internal_aligned_free(q->deques, CACHELINE_WIDTH);
+  FREE_THREADQUEUE(q);
+}
+
+static inline uintptr_t qt_threadqueue_tag(qthread_t *t) {
+  return (atomic_load_explicit(&t->flags, memory_order_relaxed) &
+          QTHREAD_UNSTEALABLE)
+           ? ((uintptr_t)t | CL_UNSTEALABLE)
+           : (uintptr_t)t;
+}
+
+static inline void qt_threadqueue_enqueue_inbox(qt_threadqueue_t *restrict q,
+                                                qthread_t *restrict t) {
+  qt_threadqueue_node_t *node = ALLOC_TQNODE();
+  qt_threadqueue_node_t *head;
+
+  assert(node != NULL);
+  node->thread = t;
+  head = atomic_load_explicit(&q->inbox, memory_order_relaxed);
+  do {
+    node->next = head;
+  } while (!atomic_compare_exchange_weak_explicit(
+    &q->inbox, &head, node, memory_order_release, memory_order_relaxed));
+  atomic_fetch_add_explicit(&q->inbox_len, 1, memory_order_relaxed);
+  /* only the shepherd's own workers drain the inbox */
+  qt_idle_notify(&q->idle);
+}
+
+void INTERNAL qt_threadqueue_enqueue(qt_threadqueue_t *restrict q,
+                                     qthread_t *restrict t) {
+  qthread_worker_t *w = qthread_internal_getworker();
+
+  assert(q);
+  assert(t);
+
+  if (QTHREAD_UNLIKELY(atomic_load_explicit(&t->flags, memory_order_relaxed) &
+                       QTHREAD_REAL_MCCOY)) {
+    atomic_store_explicit(&q->mccoy, t, memory_order_release);
+    qt_idle_wake_all();
+  } else if (QTHREAD_LIKELY(w != NULL && w->shepherd->ready == q)) {
+    qt_cl_deque_push(&q->deques[w->worker_id], qt_threadqueue_tag(t));
+    /* No fence, to keep pushes free of full barriers: a thief that parks
+     * without seeing this task costs parallelism, not progress, since we
+     * will get to the task ourselves. */
+    if (QTHREAD_UNLIKELY(
+          atomic_load_explicit(&qt_idle_nparked, memory_order_relaxed))) {
+      qt_idle_wake_thief(&q->idle);
+    }
+  } else {
+    qt_threadqueue_enqueue_inbox(q, t);
+  }
+}
+
+/* A worker's batch for its own shepherd goes on its deque, anything else is
+ * pushed onto the inbox as one chain with a single CAS. */
+void INTERNAL qt_threadqueue_enqueue_many(qt_threadqueue_t *restrict q,
+                                          qthread_t *const *restrict t,
+                                          size_t n) {
+  qthread_worker_t *w = qthread_internal_getworker();
+
+  assert(q);
+  if (n == 0) { return; }
+
+  if (w != NULL && w->shepherd->ready == q) {
+    for (size_t i = 0; i < n; i++) {
+      assert(t[i]);
+      qt_cl_deque_push(&q->deques[w->worker_id], qt_threadqueue_tag(t[i]));
+    }
+    qt_idle_notify_stealable_many(&q->idle, n);
+  } else {
+    qt_threadqueue_node_t *first = NULL, *last = NULL;
+    qt_threadqueue_node_t *head;
+
+    /* the inbox is a LIFO stack, reversed again when it is drained */
+    for (size_t i = 0; i < n; i++) {
+      qt_threadqueue_node_t *node = ALLOC_TQNODE();
+
+      assert(node != NULL);
+      assert(t[i]);
+      node->thread = t[i];
+      node->next = first;
+      first = node;
+      if (last == NULL) { last = node; }
+    }
+    head = atomic_load_explicit(&q->inbox, memory_order_relaxed);
+    do {
+      last->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(
+      &q->inbox, &head, first, memory_order_release, memory_order_relaxed));
+    atomic_fetch_add_explicit(&q->inbox_len, n, memory_order_relaxed);
+    qt_idle_notify(&q->idle);
+  }
+}
+
+/* Pushing a yielded task on our own bottom would just pop it straight back,
+ * so it goes through the inbox, which is not drained until the deque is
+ * empty. */
+void INTERNAL qt_threadqueue_enqueue_yielded(qt_threadqueue_t *restrict q,
+                                             qthread_t *restrict t) {
+  assert(q);
+  assert(t);
+
+  if (QTHREAD_UNLIKELY(atomic_load_explicit(&t->flags, memory_order_relaxed) &
+                       QTHREAD_REAL_MCCOY)) {
+    atomic_store_explicit(&q->mccoy, t, memory_order_release);
+    qt_idle_wake_all();
+  } else {
+    qt_threadqueue_enqueue_inbox(q, t);
+  }
+}
+
+ssize_t INTERNAL qt_threadqueue_advisory_queuelen(qt_threadqueue_t *q) {
+  ssize_t len = atomic_load_explicit(&q->inbox_len, memory_order_relaxed);
+
+  assert(q);
+  for (qthread_worker_id_t i = 0; i < qlib->nworkerspershep; i++) {
+    len += qt_cl_deque_size(&q->deques[i]);
+  }
+  return len;
+}
+
+/* Move the whole inbox onto the owner's deque, oldest task on the bottom so
+ * that the inbox is run in FIFO order. */
+static inline qthread_t *qt_threadqueue_drain_inbox(qt_threadqueue_t *q,
+                                                    qt_cl_deque_t *mine) {
+  qt_threadqueue_node_t *node;
+  long n = 0;
+
+  if (atomic_load_explicit(&q->inbox, memory_order_relaxed) == NULL) {
+    return NULL;
+  }
+  node = atomic_exchange_explicit(&q->inbox, NULL, memory_order_acquire);
+  while (node) {
+    qt_threadqueue_node_t *next = node->next;
+    qt_cl_deque_push(mine, qt_threadqueue_tag(node->thread));
+    FREE_TQNODE(node);
+    node = next;
+    n++;
+  }
+  atomic_fetch_sub_explicit(&q->inbox_len, n, memory_order_relaxed);
+  if (n > 1) { qt_idle_notify_stealable(&q->idle); }
+  return CL_PTR(qt_cl_deque_take(mine));
+}
+
+/* Steal up to STEAL_CHUNK tasks (default: half of the victim) from d; the
+ * first one is returned and the surplus goes onto our own deque. */
+static inline qthread_t *qt_threadqueue_steal_from(qt_cl_deque_t *d,
+                                                   qt_cl_deque_t *mine,
+                                                   int same_shepherd) {
+  long desired_stolen;
+  uintptr_t first;
+
+  if (qt_cl_deque_size(d) == 0) { return NULL; }
+  if (steal_chunksize == 0) {
+    desired_stolen = qt_cl_deque_size(d) / 2;
+  } else {
+    desired_stolen = steal_chunksize;
+  }
+  if (desired_stolen == 0) { desired_stolen = 1; }
+
+  first = qt_cl_deque_steal(d, same_shepherd);
+  if (first == 0) { return NULL; }
+  for (long i = 1; i < desired_stolen; i++) {
+    uintptr_t x = qt_cl_deque_steal(d, same_shepherd);
+    if (x == 0) { break; }
+    qt_cl_deque_push(mine, x);
+  }
+  return CL_PTR(first);
+}
+
+static inline qthread_t *qthread_steal(qthread_shepherd_t *thief_shepherd,
+                                       qt_cl_deque_t *mine) {
+  qthread_shepherd_t *const shepherds = qlib->shepherds;
+  qthread_shepherd_id_t *const sorted_sheplist =
+    thief_shepherd->sorted_sheplist;
+  qthread_t *t;
+
+  assert(sorted_sheplist);
+  for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds - 1; i++) {
+    qthread_shepherd_t *victim = &shepherds[sorted_sheplist[i]];
+    qt_threadqueue_t *victim_queue = victim->ready;
+    for (qthread_worker_id_t w = 0; w < qlib->nworkerspershep; w++) {
+      t = qt_threadqueue_steal_from(&victim_queue->deques[w], mine, 0);
+      if (t) {
+        /* mine was empty, so the surplus is all that's on it */
+        qt_trace(
+          QT_TRACE_STEAL, 1 + qt_cl_deque_size(mine), sorted_sheplist[i]);
+        return t;
+      }
+    }
+  }
+  return NULL;
+}
+
+static inline int qt_threadqueue_nonempty(qt_threadqueue_t *q) {
+  for (qthread_worker_id_t i = 0; i < qlib->nworkerspershep; i++) {
+    if (qt_cl_deque_size(&q->deques[i]) > 0) { return 1; }
+  }
+  return 0;
+}
+
+/* whether a worker of shep about to park could find work */
+static int qt_threadqueue_has_work(void *arg) {
+  qthread_shepherd_t *shep = arg;
+  qt_threadqueue_t *q = shep->ready;
+  int const is_mccoy_worker = (shep->shepherd_id == 0) &&
+                              (qthread_internal_getworker()->worker_id == 0);
+
+  if (qt_threadqueue_nonempty(q) ||
+      atomic_load_explicit(&q->inbox, memory_order_relaxed) ||
+      (is_mccoy_worker &&
+       atomic_load_explicit(&q->mccoy, memory_order_relaxed)) ||
+      qt_blocking_subsystem_pending(shep)) {
+    return 1;
+  }
+  if (atomic_load_explicit(&shep->active, memory_order_relaxed) &&
+      !steal_disable) {
+    for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds; i++) {
+      if (qt_threadqueue_nonempty(qlib->shepherds[i].ready)) { return 1; }
+    }
+  }
+  return 0;
+}
+
+qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *q,
+                                            uint_fast8_t active) {
+  qthread_worker_t *me_worker = qthread_internal_getworker();
+  qthread_shepherd_t *my_shepherd = me_worker->shepherd;
+  qthread_worker_id_t const my_id = me_worker->worker_id;
+  int const is_mccoy_worker = (my_shepherd->shepherd_id == 0) && (my_id == 0);
+  qt_cl_deque_t *mine = &q->deques[my_id];
+  qthread_t *t;
+  uint64_t idle_since = 0;
+
+  assert(q != NULL);
+  assert(my_shepherd->ready == q);
+
+  while (1) {
+    if (is_mccoy_worker) {
+      if (!q->mccoy_ran &&
+          atomic_load_explicit(&q->mccoy, memory_order_relaxed)) {
+        t = atomic_exchange_explicit(&q->mccoy, NULL, memory_order_acquire);
+        if (t) {
+          q->mccoy_ran = 1;
+          return t;
+        }
+      }
+      q->mccoy_ran = 0;
+    }
+
+    t = CL_PTR(qt_cl_deque_take(mine));
+    if (t) { return t; }
+
+    t = qt_threadqueue_drain_inbox(q, mine);
+    if (t) { return t; }
+
+    if (is_mccoy_worker &&
+        atomic_load_explicit(&q->mccoy, memory_order_relaxed)) {
+      continue;
+    }
+
+    /* siblings may take anything, including unstealable tasks */
+    for (qthread_worker_id_t i = 1; i < qlib->nworkerspershep; i++) {
+      qthread_worker_id_t victim = (my_id + i) % qlib->nworkerspershep;
+      t = qt_threadqueue_steal_from(&q->deques[victim], mine, 1);
+      if (t) {
+        qt_trace(QT_TRACE_STEAL,
+                 1 + qt_cl_deque_size(mine),
+                 my_shepherd->shepherd_id);
+        return t;
+      }
+    }
+
+    if (active && (qlib->nshepherds > 1) && !steal_disable) {
+      t = qthread_steal(my_shepherd, mine);
+      if (t) { return t; }
+    }
+    /* a whole round came up empty: pick up finished I/O and due timers,
+     * then let whoever has the work run */
+    if (qt_blocking_subsystem_poll(my_shepherd)) { continue; }
+    if (qt_timer_poll(qthread_internal_getworker())) { continue; }
+    if (!qt_idle_round(
+          &q->idle, &idle_since, qt_threadqueue_has_work, my_shepherd)) {
+      sched_yield();
+      SPINLOCK_BODY();
+    }
+  }
+}
+
+/* the calling worker's own deque in q, or NULL if it does not have one */
+static inline qt_cl_deque_t *qt_threadqueue_mine(qt_threadqueue_t *q) {
+  qthread_worker_t *w = qthread_internal_getworker();
+
+  if ((w == NULL) || (w->shepherd->ready != q)) { return NULL; }
+  return &q->deques[w->worker_id];
+}
+
+/* walk queue removing all tasks matching this description
+ * NOTE: only the calling worker's own deque is walked. Nobody else may pop
+ * from the bottom of a deque, so the walk pops with qt_cl_deque_take(), like
+ * any other dequeue, and pushes the survivors back in order; tasks that are
+ * stolen in the meantime are simply never seen. */
+void INTERNAL qt_threadqueue_filter(qt_threadqueue_t *q,
+                                    qt_threadqueue_filter_f f) {
+  qt_cl_deque_t *mine;
+  uintptr_t *kept;
+  uintptr_t x;
+  long n = 0;
+
+  assert(q != NULL);
+
+  mine = qt_threadqueue_mine(q);
+  if ((mine == NULL) || (qt_cl_deque_size(mine) == 0)) { return; }
+  /* only we push onto mine, so it cannot grow while we walk it */
+  kept = qt_malloc(qt_cl_deque_size(mine) * sizeof(uintptr_t));
+  assert(kept);
+
+  /* dequeue order is bottom-up */
+  while ((x = qt_cl_deque_take(mine)) != 0) {
+    filter_code fc = f(CL_PTR(x));
+    if ((fc == IGNORE_AND_CONTINUE) || (fc == IGNORE_AND_STOP)) {
+      kept[n++] = x;
+    }
+    if ((fc == IGNORE_AND_STOP) || (fc == REMOVE_AND_STOP)) { break; }
+  }
+  while (n > 0) { qt_cl_deque_push(mine, kept[--n]); }
+  qt_free(kept);
+}
+
+/* some place-holder functions */
+void INTERNAL qthread_steal_stat(void) {}
+
+void INTERNAL qthread_cas_steal_stat(void) {}
+
+/* look for the task that will fill value on the calling worker's own deque
+ * and, if it is there, move it to the bottom so that it is the next one this
+ * worker runs. As in qt_threadqueue_filter(), the tasks above it are popped
+ * and pushed back rather than shuffled in place under the thieves. A task on
+ * another worker's deque or in the inbox is not found, and NULL is returned,
+ * just as when it is already running. */
+qthread_t INTERNAL *qt_threadqueue_dequeue_specific(qt_threadqueue_t *q,
+                                                    void *value) {
+  qt_cl_deque_t *mine;
+  uintptr_t *skipped;
+  uintptr_t x, found = 0;
+  long n = 0;
+
+  assert(q != NULL);
+
+  mine = qt_threadqueue_mine(q);
+  if ((mine == NULL) || (qt_cl_deque_size(mine) == 0)) { return NULL; }
+  skipped = qt_malloc(qt_cl_deque_size(mine) * sizeof(uintptr_t));
+  assert(skipped);
+
+  while ((x = qt_cl_deque_take(mine)) != 0) {
+    if (CL_PTR(x)->ret == value) {
+      found = x;
+      break;
+    }
+    skipped[n++] = x;
+  }
+  while (n > 0) { qt_cl_deque_push(mine, skipped[--n]); }
+  if (found) { qt_cl_deque_push(mine, found); }
+  qt_free(skipped);
+
+  return CL_PTR(found);
+}
+
+void INTERNAL qthread_steal_enable(void) { steal_disable = 0; }
+
+void INTERNAL qthread_steal_disable(void) { steal_disable = 1; }
+
+qthread_shepherd_id_t INTERNAL
+qt_threadqueue_choose_dest(qthread_shepherd_t *curr_shep) {
+  if (curr_shep) {
+    return curr_shep->shepherd_id;
+  } else {
+    return (qthread_shepherd_id_t)0;
+  }
+}
+
+size_t INTERNAL qt_threadqueue_policy(const enum threadqueue_policy policy) {
+  switch (policy) {
+    default: return THREADQUEUE_POLICY_UNSUPPORTED;
+  }
+}
+
+#ifdef QT_THREADQUEUE_PREFIX
+QT_THREADQUEUE_OPS_DEFINE();
+#endif
+
+/* vim:set expandtab: */
@@ -0,0 +1,122 @@
+/* System Headers */
+#include <stdio.h>
+#include <strings.h> /* for strcasecmp() */
+
+/* Internal Headers */
+#include "qt_asserts.h"
+#include "qt_envariables.h"
+#include "qt_threadqueue_ops.h"
+#include "qt_visibility.h"
+
+/* The qt_threadqueue interface for libraries with several schedulers built in:
+ * every entry point calls through the scheduler that qt_threadqueue_select()
+ * picked when the library was initialized. */
+
+#define QT_TQ_OPS2(n) n##_qt_threadqueue_ops
+#define QT_TQ_OPS(n) QT_TQ_OPS2(n)
+
+#ifdef QTHREAD_SCHEDULER_NEMESIS
+extern qt_threadqueue_ops_t const nemesis_qt_threadqueue_ops;
+#endif
+#ifdef QTHREAD_SCHEDULER_SHERWOOD
+extern qt_threadqueue_ops_t const sherwood_qt_threadqueue_ops;
+#endif
+#ifdef QTHREAD_SCHEDULER_DISTRIB
+extern qt_threadqueue_ops_t const distrib_qt_threadqueue_ops;
+#endif
+#ifdef QTHREAD_SCHEDULER_CHASELEV
+extern qt_threadqueue_ops_t const chaselev_qt_threadqueue_ops;
+#endif
+
+static qt_threadqueue_ops_t const *const schedulers[] = {
+#ifdef QTHREAD_SCHEDULER_NEMESIS
+  &nemesis_qt_threadqueue_ops,
+#endif
+#ifdef QTHREAD_SCHEDULER_SHERWOOD
+  &sherwood_qt_threadqueue_ops,
+#endif
+#ifdef QTHREAD_SCHEDULER_DISTRIB
+  &distrib_qt_threadqueue_ops,
+#endif
+#ifdef QTHREAD_SCHEDULER_CHASELEV
+  &chaselev_qt_threadqueue_ops,
+#endif
+};
+
+/* the first scheduler listed in QTHREADS_SCHEDULER */
+static qt_threadqueue_ops_t const *ops =
+  &QT_TQ_OPS(QTHREAD_DEFAULT_SCHEDULER);
+
+char const INTERNAL *qt_threadqueue_select(void) {
+  qt_threadqueue_ops_t const *dflt = &QT_TQ_OPS(QTHREAD_DEFAULT_SCHEDULER);
+  char const *name = qt_internal_get_env_str("SCHEDULER", dflt->name);
+
+  ops = dflt;
+  if (name == NULL) { return ops->name; }
+  for (size_t i = 0; i < sizeof(schedulers) / sizeof(schedulers[0]); i++) {
+    if (!strcasecmp(name, schedulers[i]->name)) {
+      ops = schedulers[i];
+      return ops->name;
+    }
+  }
+  fprintf(stderr,
+          "QTHREADS: scheduler \"%s\" is not built in; using %s.\n",
+          name,
+          ops->name);
+  return ops->name;
+}
+
+void INTERNAL qt_threadqueue_subsystem_init(void) { ops->subsystem_init(); }
+
+qt_threadqueue_t INTERNAL *qt_threadqueue_new(void) { return ops->new(); }
+
+void INTERNAL qt_threadqueue_free(qt_threadqueue_t *q) { ops->free(q); }
+
+void INTERNAL qt_threadqueue_enqueue(qt_threadqueue_t *restrict q,
+                                     qthread_t *restrict t) {
+  ops->enqueue(q, t);
+}
+
+void INTERNAL qt_threadqueue_enqueue_yielded(qt_threadqueue_t *restrict q,
+                                             qthread_t *restrict t) {
+  ops->enqueue_yielded(q, t);
+}
+
+void INTERNAL qt_threadqueue_enqueue_many(qt_threadqueue_t *restrict q,
+                                          qthread_t *const *restrict t,
+                                          size_t n) {
+  ops->enqueue_many(q, t, n);
+}
+
+ssize_t INTERNAL qt_threadqueue_advisory_queuelen(qt_threadqueue_t *q) {
+  return ops->advisory_queuelen(q);
+}
+
+qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *q,
+                                            uint_fast8_t active) {
+  return ops->get_thread(q, active);
+}
+
+qthread_t INTERNAL *qt_threadqueue_dequeue_specific(qt_threadqueue_t *q,
+                                                    void *value) {
+  return ops->dequeue_specific(q, value);
+}
+
+void INTERNAL qthread_steal_enable(void) { ops->steal_enable(); }
+
+void INTERNAL qthread_steal_disable(void) { ops->steal_disable(); }
+
+size_t INTERNAL qt_threadqueue_policy(const enum threadqueue_policy policy) {
+  return ops->policy(policy);
+}
+
+qt_idle_t INTERNAL *qt_threadqueue_idle(qt_threadqueue_t *q) {
+  return ops->idle(q);
+}
+
+qthread_shepherd_id_t INTERNAL
+qt_threadqueue_choose_dest(qthread_shepherd_t *curr_shep) {
+  return ops->choose_dest(curr_shep);
+}
+
+/* vim:set expandtab: */
@@ -13,13 +13,17 @@
 #include "qt_asserts.h"
 #include "qt_envariables.h"
 #include "qt_expect.h"
+#include "qt_idle.h"
+#include "qt_io.h" /* for qt_blocking_subsystem_poll() */
 #include "qt_prefetch.h"
 #include "qt_qthread_mgmt.h"
 #include "qt_qthread_struct.h"
 #include "qt_shepherd_innards.h"
 #include "qt_subsystems.h"
+#include "qt_threadqueue_ops.h"
 #include "qt_threadqueue_scheduler.h"
 #include "qt_threadqueues.h"
+#include "qt_trace.h"
 #include "qt_visibility.h"
 #include "qthread_innards.h" /* for qlib */
 
@@ -27,10 +31,9 @@
 typedef uint8_t cacheline[CACHELINE_WIDTH];
 
 /* Cutoff variables */
-int max_backoff;
-int spinloop_backoff;
-int condwait_backoff;
-int steal_ratio;
+static int steal_ratio;
+static unsigned int steal_local_rounds;
+static long steal_remote_chunk;
 
 typedef struct qt_threadqueue_node_s qt_threadqueue_node_t;
 
@@ -58,17 +61,16 @@ struct _qt_threadqueue {
   qt_threadqueue_internal *t;
   size_t num_queues;
   w_ind *w_inds;
-  QTHREAD_COND_DECL(cond);
-  _Atomic uint64_t numwaiters;
+  qt_idle_t idle;
 };
 
 // global cond pool
-_Atomic int finalizing;
+static _Atomic int finalizing;
 
-qthread_t *_Atomic mccoy = NULL;
+static qthread_t *_Atomic mccoy = NULL;
 
 /* Memory Management and Initialization/Shutdown */
-qt_threadqueue_pools_t generic_threadqueue_pools;
+static qt_threadqueue_pools_t generic_threadqueue_pools;
 
 #define mycounter(q)                                                           \
   (q->w_inds[qthread_worker(NULL) %                                            \
@@ -86,7 +88,7 @@ static qt_threadqueue_t *alloc_threadqueue(void) {
   t->t = qt_malloc(sizeof(qt_threadqueue_internal) * t->num_queues);
   t->w_inds =
     qt_calloc(qlib->nshepherds * qlib->nworkerspershep, sizeof(w_ind));
-  atomic_store_explicit(&t->numwaiters, 0ull, memory_order_relaxed);
+  qt_idle_init(&t->idle);
   return t;
 }
 
@@ -105,12 +107,6 @@ static inline void free_tqnode(qt_threadqueue_node_t *t) {
   qt_mpool_free(generic_threadqueue_pools.nodes, t);
 }
 
-extern qt_mpool generic_qthread_pool;
-
-static inline void free_qthread(qthread_t *t) {
-  return qt_mpool_free(generic_qthread_pool, t);
-}
-
 qt_threadqueue_t INTERNAL *qt_threadqueue_new(void) {
   qt_threadqueue_t *qe = alloc_threadqueue();
   for (int i = 0; i < qe->num_queues; i++) {
@@ -126,10 +122,13 @@ qt_threadqueue_t INTERNAL *qt_threadqueue_new(void) {
     atomic_store_explicit(
       &qe->w_inds[i].n, i % qe->num_queues, memory_order_relaxed);
   }
-  QTHREAD_COND_INIT(qe->cond);
   return qe;
 }
 
+qt_idle_t INTERNAL *qt_threadqueue_idle(qt_threadqueue_t *q) {
+  return &q->idle;
+}
+
 void INTERNAL qt_threadqueue_free(qt_threadqueue_t *qe) {
   for (int i = 0; i < qe->num_queues; i++) {
     qt_threadqueue_internal *q = qe->t + i;
@@ -156,7 +155,7 @@ void INTERNAL qt_threadqueue_free(qt_threadqueue_t *qe) {
           }
           t = node->value;
           free_tqnode(node);
-          free_qthread(t);
+          qthread_thread_free(t);
         }
       }
       assert(atomic_load_explicit(&q->head, memory_order_relaxed) == NULL);
@@ -168,7 +167,6 @@ void INTERNAL qt_threadqueue_free(qt_threadqueue_t *qe) {
            atomic_load_explicit(&q->tail, memory_order_relaxed));
     QTHREAD_TRYLOCK_DESTROY(q->qlock);
   }
-  QTHREAD_COND_DESTROY(qe->cond);
   free_threadqueue(qe);
 }
 
@@ -179,7 +177,8 @@ static void qt_threadqueue_subsystem_shutdown(void) {
 
 void INTERNAL qt_threadqueue_subsystem_init(void) {
   steal_ratio = qt_internal_get_env_num("STEAL_RATIO", 8, 0);
-  condwait_backoff = qt_internal_get_env_num("CONDWAIT_BACKOFF", 2048, 0);
+  steal_local_rounds = qt_internal_get_env_num("STEAL_LOCAL_ROUNDS", 4, 0);
+  steal_remote_chunk = qt_internal_get_env_num("STEAL_REMOTE_CHUNK", 4, 1);
   atomic_store_explicit(&finalizing, 0, memory_order_relaxed);
   generic_threadqueue_pools.queues =
     qt_mpool_create_aligned(sizeof(qt_threadqueue_t), qthread_cacheline());
@@ -239,14 +238,9 @@ static void qt_threadqueue_enqueue_tail(qt_threadqueue_t *restrict qe,
   if (atomic_load_explicit(&finalizing, memory_order_relaxed) ||
       atomic_load_explicit(&t->flags, memory_order_relaxed) &
         QTHREAD_REAL_MCCOY) {
-    QTHREAD_COND_LOCK(qe->cond);
-    QTHREAD_COND_BCAST(qe->cond);
-    QTHREAD_COND_UNLOCK(qe->cond);
-  } else if (atomic_load_explicit(&qe->numwaiters, memory_order_relaxed)) {
-    QTHREAD_COND_LOCK(qe->cond);
-    if (atomic_load_explicit(&qe->numwaiters, memory_order_relaxed))
-      QTHREAD_COND_SIGNAL(qe->cond);
-    QTHREAD_COND_UNLOCK(qe->cond);
+    qt_idle_wake_all();
+  } else {
+    qt_idle_notify_stealable(&qe->idle);
   }
 }
 
@@ -259,6 +253,7 @@ static void qt_threadqueue_enqueue_head(qt_threadqueue_t *restrict qe,
       exit(-1);
     }
     atomic_store_explicit(&mccoy, t, memory_order_relaxed);
+    qt_idle_wake_all();
     return;
   }
 
@@ -287,13 +282,61 @@ static void qt_threadqueue_enqueue_head(qt_threadqueue_t *restrict qe,
   }
   atomic_fetch_add_explicit(&q->qlength, 1ull, memory_order_relaxed);
   QTHREAD_TRYLOCK_UNLOCK(&q->qlock);
-  if (atomic_load_explicit(&qe->numwaiters, memory_order_relaxed)) {
-    QTHREAD_COND_LOCK(qe->cond);
-    if (atomic_load_explicit(&qe->numwaiters, memory_order_relaxed)) {
-      QTHREAD_COND_SIGNAL(qe->cond);
+  qt_idle_notify_stealable(&qe->idle);
+}
+
+/* New tasks only, so no mccoy or termination handling: the batch is cut into
+ * one chain per internal queue, each spliced on with a single lock hold. */
+void INTERNAL qt_threadqueue_enqueue_many(qt_threadqueue_t *restrict qe,
+                                          qthread_t *const *restrict t,
+                                          size_t n) {
+  size_t const nchains = (n < qe->num_queues) ? n : qe->num_queues;
+  size_t done = 0;
+
+  for (size_t c = 0; c < nchains; c++) {
+    size_t const len = (n - done) / (nchains - c);
+    qt_threadqueue_internal *q = myqueue(qe);
+    qt_threadqueue_node_t *first = NULL, *last = NULL;
+
+    atomic_store_explicit(
+      &mycounter(qe),
+      (atomic_load_explicit(&mycounter(qe), memory_order_relaxed) + 1) %
+        qe->num_queues,
+      memory_order_relaxed);
+    for (size_t i = done; i < done + len; i++) {
+      qt_threadqueue_node_t *node = alloc_tqnode();
+
+      assert(!(atomic_load_explicit(&t[i]->flags, memory_order_relaxed) &
+               QTHREAD_REAL_MCCOY));
+      node->value = t[i];
+      atomic_store_explicit(&node->prev, last, memory_order_relaxed);
+      if (last) {
+        atomic_store_explicit(&last->next, node, memory_order_relaxed);
+      } else {
+        first = node;
+      }
+      last = node;
+    }
+    atomic_store_explicit(&last->next, NULL, memory_order_relaxed);
+    done += len;
+
+    QTHREAD_TRYLOCK_LOCK(&q->qlock);
+    atomic_store_explicit(&first->prev,
+                          atomic_load_explicit(&q->tail, memory_order_relaxed),
+                          memory_order_relaxed);
+    atomic_store_explicit(&q->tail, last, memory_order_relaxed);
+    if (atomic_load_explicit(&q->head, memory_order_relaxed) == NULL) {
+      atomic_store_explicit(&q->head, first, memory_order_relaxed);
+    } else {
+      atomic_store_explicit(
+        &atomic_load_explicit(&first->prev, memory_order_relaxed)->next,
+        first,
+        memory_order_relaxed);
     }
-    QTHREAD_COND_UNLOCK(qe->cond);
+    atomic_fetch_add_explicit(&q->qlength, len, memory_order_relaxed);
+    QTHREAD_TRYLOCK_UNLOCK(&q->qlock);
   }
+  qt_idle_notify_stealable_many(&qe->idle, n);
 }
 
 static qt_threadqueue_node_t *
@@ -386,25 +429,111 @@ qthread_t INTERNAL *qt_threadqueue_dequeue_specific(qt_threadqueue_t *q,
 
 inline int square(int x) { return x * x; }
 
+static inline int qt_threadqueue_nonempty(qt_threadqueue_t *qe) {
+  for (size_t i = 0; i < qe->num_queues; i++) {
+    if (atomic_load_explicit(&qe->t[i].qlength, memory_order_relaxed)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* whether a worker of qe about to park could find work */
+static int qt_threadqueue_has_work(void *arg) {
+  qt_threadqueue_t *qe = arg;
+
+  if (qt_threadqueue_nonempty(qe) ||
+      atomic_load_explicit(&finalizing, memory_order_relaxed) ||
+      (qthread_worker(NULL) == 0 &&
+       atomic_load_explicit(&mccoy, memory_order_relaxed)) ||
+      qt_blocking_subsystem_pending(qthread_internal_getshep())) {
+    return 1;
+  }
+  if (steal_ratio > 0) {
+    for (int i = 0; i < qlib->nshepherds; i++) {
+      if (qt_threadqueue_nonempty(qlib->shepherds[i].ready)) { return 1; }
+    }
+  }
+  return 0;
+}
+
+/* One steal probe: our own queue's head, then the other shepherds nearest
+ * first. Shepherds on another socket are only probed once enough probes of
+ * the local ones have failed, and each fruitless probe abroad doubles the wait
+ * for the next one; a steal from there brings back a chunk of tasks. */
+static qt_threadqueue_node_t *qt_threadqueue_steal(qt_threadqueue_t *qe) {
+  qthread_shepherd_t *const my_shepherd = qthread_internal_getshep();
+  qthread_worker_t *const me = qthread_internal_getworker();
+  qt_threadqueue_node_t *node = qt_threadqueue_dequeue_head(qe);
+
+  if (node || my_shepherd == NULL || qlib->nshepherds < 2) { return node; }
+
+  qthread_shepherd_id_t *const sorted_sheplist = my_shepherd->sorted_sheplist;
+  qthread_shepherd_id_t const nvictims = qlib->nshepherds - 1;
+  qthread_shepherd_id_t const nlocal = my_shepherd->steal_local;
+  int const tiered = (me != NULL) && (steal_local_rounds > 0) &&
+                     (nlocal > 0) && (nlocal < nvictims);
+  qthread_shepherd_id_t end = nvictims;
+
+  if (tiered &&
+      (me->steal_rounds < (steal_local_rounds << me->steal_backoff))) {
+    end = nlocal;
+  }
+  for (qthread_shepherd_id_t i = 0; i < end; i++) {
+    qthread_shepherd_id_t const victim = sorted_sheplist[i];
+    qt_threadqueue_t *victim_queue = qlib->shepherds[victim].ready;
+
+    node = qt_threadqueue_dequeue_head(victim_queue);
+    if (node == NULL) { continue; }
+    if (i >= nlocal) {
+      /* keep the rest of the chunk, rather than crossing over for each */
+      uintptr_t count = 1;
+      for (; count < (uintptr_t)steal_remote_chunk; count++) {
+        qt_threadqueue_node_t *extra =
+          qt_threadqueue_dequeue_head(victim_queue);
+
+        if (extra == NULL) { break; }
+        qt_threadqueue_enqueue_tail(qe, extra->value);
+        free_tqnode(extra);
+      }
+      qt_trace(QT_TRACE_STEAL, count, victim);
+      if (tiered) { me->steal_backoff = 0; }
+    } else {
+      qt_trace(QT_TRACE_STEAL, 1, victim);
+    }
+    if (tiered) { me->steal_rounds = 0; }
+    return node;
+  }
+  if (tiered) {
+    if (end == nlocal) {
+      me->steal_rounds++;
+    } else {
+      me->steal_rounds = 0;
+      if (me->steal_backoff < QTHREAD_STEAL_MAX_BACKOFF) {
+        me->steal_backoff++;
+      }
+    }
+  }
+  return NULL;
+}
+
 // We try and dequeue locally, if that fails we should do some stealing
 qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *qe,
                                             uint_fast8_t active) {
   qt_threadqueue_node_t *node = NULL;
   qthread_t *t;
+  uint64_t idle_since = 0;
 
   for (int numwaits = 0; !node; numwaits++) {
     node = qt_threadqueue_dequeue_tail(qe);
 
     // If we've done QT_STEAL_RATIO waits on local queue, try to steal
     if (!node && steal_ratio > 0 && numwaits % steal_ratio == 0) {
-      for (int i = 0; i < qlib->nshepherds; i++) {
-        qt_threadqueue_t *victim_queue = qlib->shepherds[i].ready;
-        node = qt_threadqueue_dequeue_head(victim_queue);
-        if (node) {
-          t = node->value;
-          free_tqnode(node);
-          return t;
-        }
+      node = qt_threadqueue_steal(qe);
+      if (node) {
+        t = node->value;
+        free_tqnode(node);
+        return t;
       }
     }
 
@@ -414,15 +543,12 @@ qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *qe,
       atomic_store_explicit(&mccoy, NULL, memory_order_relaxed);
       return t;
     } else if (!node) {
-      if (numwaits > condwait_backoff &&
-          !atomic_load_explicit(&finalizing, memory_order_relaxed)) {
-        QTHREAD_COND_LOCK(qe->cond);
-        atomic_fetch_add_explicit(&qe->numwaiters, 1ull, memory_order_relaxed);
-        MACHINE_FENCE;
-        if (!atomic_load_explicit(&finalizing, memory_order_relaxed))
-          QTHREAD_COND_WAIT(qe->cond);
-        atomic_fetch_sub_explicit(&qe->numwaiters, 1ull, memory_order_relaxed);
-        QTHREAD_COND_UNLOCK(qe->cond);
+      qthread_shepherd_t *my_shepherd = qthread_internal_getshep();
+
+      if (qt_blocking_subsystem_poll(my_shepherd)) { continue; }
+      if (qt_timer_poll(qthread_internal_getworker())) { continue; }
+      if (qt_idle_round(
+            &qe->idle, &idle_since, qt_threadqueue_has_work, qe)) {
         numwaits = 0;
       } else {
         SPINLOCK_BODY();
@@ -458,4 +584,8 @@ size_t INTERNAL qt_threadqueue_policy(const enum threadqueue_policy policy) {
   }
 }
 
+#ifdef QT_THREADQUEUE_PREFIX
+QT_THREADQUEUE_OPS_DEFINE();
+#endif
+
 /* vim:set expandtab: */
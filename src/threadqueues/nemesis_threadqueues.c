@@ -11,11 +11,14 @@
 /* Internal Headers */
 #include "qt_asserts.h"
 #include "qt_envariables.h"
+#include "qt_idle.h"
+#include "qt_io.h" /* for qt_blocking_subsystem_poll() */
 #include "qt_macros.h"
 #include "qt_prefetch.h"
 #include "qt_qthread_mgmt.h" /* for qthread_thread_free() */
 #include "qt_qthread_struct.h"
 #include "qt_subsystems.h"
+#include "qt_threadqueue_ops.h"
 #include "qt_threadqueue_scheduler.h"
 #include "qt_threadqueues.h"
 #include "qt_visibility.h"
@@ -26,7 +29,7 @@
  * Note: it is NOT SAFE to use with multiple de-queuers, it is ONLY safe to use
  * with multiple enqueuers and a single de-queuer. */
 
-int num_spins_before_condwait;
+static int num_spins_before_condwait;
 #define DEFAULT_SPINCOUNT 300000
 
 typedef struct qt_threadqueue_node_s qt_threadqueue_node_t;
@@ -61,10 +64,11 @@ struct _qt_threadqueue {
   uint32_t frustration;
   QTHREAD_COND_DECL(trigger);
 #endif
+  qt_idle_t idle;
 } /* qt_threadqueue_t */;
 
 /* Memory Management */
-qt_threadqueue_pools_t generic_threadqueue_pools = {NULL, NULL};
+static qt_threadqueue_pools_t generic_threadqueue_pools = {NULL, NULL};
 #define ALLOC_THREADQUEUE()                                                    \
   (qt_threadqueue_t *)qt_mpool_alloc(generic_threadqueue_pools.queues)
 #define FREE_THREADQUEUE(t) qt_mpool_free(generic_threadqueue_pools.queues, t)
@@ -104,10 +108,15 @@ qt_threadqueue_t INTERNAL *qt_threadqueue_new(void) {
   q->frustration = 0;
   QTHREAD_COND_INIT(q->trigger);
 #endif /* ifdef QTHREAD_CONDWAIT_BLOCKING_QUEUE */
+  qt_idle_init(&q->idle);
 
   return q;
 }
 
+qt_idle_t INTERNAL *qt_threadqueue_idle(qt_threadqueue_t *q) {
+  return &q->idle;
+}
+
 static inline qt_threadqueue_node_t *
 qt_internal_NEMESIS_dequeue(NEMESIS_queue *q) {
   if (!q->shadow_head) {
@@ -210,26 +219,24 @@ qt_threadqueue_choose_dest(qthread_shepherd_t *curr_shep) {
   return dest_shep_id;
 }
 
-void INTERNAL qt_threadqueue_enqueue(qt_threadqueue_t *restrict q,
-                                     qthread_t *restrict t) {
-  qt_threadqueue_node_t *node, *prev;
-
-  assert(q);
-  assert(t);
+/* Appends the n-node chain first..last with a single swap of the tail; the
+ * chain's internal links must already be in place. */
+static inline void qt_threadqueue_enqueue_chain(qt_threadqueue_t *restrict q,
+                                                qt_threadqueue_node_t *first,
+                                                qt_threadqueue_node_t *last,
+                                                size_t n) {
+  qt_threadqueue_node_t *prev;
 
-  node = ALLOC_TQNODE();
-  assert(node != NULL);
-  node->thread = t;
-  atomic_store_explicit(&node->next, NULL, memory_order_release);
+  atomic_store_explicit(&last->next, NULL, memory_order_release);
 
-  prev = qt_internal_atomic_swap_ptr((void **)&(q->q.tail), node);
+  prev = qt_internal_atomic_swap_ptr((void **)&(q->q.tail), last);
 
   if (prev == NULL) {
-    atomic_store_explicit(&q->q.head, node, memory_order_relaxed);
+    atomic_store_explicit(&q->q.head, first, memory_order_relaxed);
   } else {
-    atomic_store_explicit(&prev->next, node, memory_order_relaxed);
+    atomic_store_explicit(&prev->next, first, memory_order_relaxed);
   }
-  atomic_fetch_add_explicit(&q->advisory_queuelen, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&q->advisory_queuelen, n, memory_order_relaxed);
 #ifdef QTHREAD_CONDWAIT_BLOCKING_QUEUE
   /* awake waiter */
   /* Yes, this needs to be here, to prevent reading frustration being hoisted
@@ -243,9 +250,48 @@ void INTERNAL qt_threadqueue_enqueue(qt_threadqueue_t *restrict q,
     }
     QTHREAD_COND_UNLOCK(q->trigger);
   }
+#else
+  qt_idle_notify(&q->idle);
 #endif /* ifdef QTHREAD_CONDWAIT_BLOCKING_QUEUE */
 }
 
+void INTERNAL qt_threadqueue_enqueue(qt_threadqueue_t *restrict q,
+                                     qthread_t *restrict t) {
+  qt_threadqueue_node_t *node;
+
+  assert(q);
+  assert(t);
+
+  node = ALLOC_TQNODE();
+  assert(node != NULL);
+  node->thread = t;
+  qt_threadqueue_enqueue_chain(q, node, node, 1);
+}
+
+void INTERNAL qt_threadqueue_enqueue_many(qt_threadqueue_t *restrict q,
+                                          qthread_t *const *restrict t,
+                                          size_t n) {
+  qt_threadqueue_node_t *first, *last;
+
+  assert(q);
+  if (n == 0) { return; }
+
+  first = last = ALLOC_TQNODE();
+  assert(first != NULL);
+  first->thread = t[0];
+  for (size_t i = 1; i < n; i++) {
+    qt_threadqueue_node_t *node = ALLOC_TQNODE();
+
+    assert(node != NULL);
+    assert(t[i]);
+    node->thread = t[i];
+    /* nobody else can see the chain yet */
+    atomic_store_explicit(&last->next, node, memory_order_relaxed);
+    last = node;
+  }
+  qt_threadqueue_enqueue_chain(q, first, last, n);
+}
+
 void INTERNAL qt_threadqueue_enqueue_yielded(qt_threadqueue_t *restrict q,
                                              qthread_t *restrict t) {
   qt_threadqueue_enqueue(q, t);
@@ -256,10 +302,22 @@ ssize_t INTERNAL qt_threadqueue_advisory_queuelen(qt_threadqueue_t *q) {
   return atomic_load_explicit(&q->advisory_queuelen, memory_order_relaxed);
 }
 
+#ifndef QTHREAD_CONDWAIT_BLOCKING_QUEUE
+static int qt_threadqueue_has_work(void *arg) {
+  qt_threadqueue_t *q = arg;
+
+  return q->q.shadow_head != NULL ||
+         atomic_load_explicit(&q->q.head, memory_order_relaxed) != NULL ||
+         qt_blocking_subsystem_pending(qthread_internal_getshep());
+}
+#endif
+
 qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *q,
                                             uint_fast8_t Q_UNUSED(active)) {
 #ifdef QTHREAD_CONDWAIT_BLOCKING_QUEUE
   int i;
+#else
+  uint64_t idle_since = 0;
 #endif /* QTHREAD_CONDWAIT_BLOCKING_QUEUE */
 
   qt_threadqueue_node_t *node = qt_internal_NEMESIS_dequeue(&q->q);
@@ -278,10 +336,21 @@ qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *q,
 
     while (q->q.shadow_head == NULL &&
            atomic_load_explicit(&q->q.head, memory_order_relaxed) == NULL) {
+      qthread_shepherd_t *my_shepherd = qthread_internal_getshep();
+
+      if (qt_blocking_subsystem_poll(my_shepherd)) { continue; }
+      if (qt_timer_poll(qthread_internal_getworker())) { continue; }
 #ifndef QTHREAD_CONDWAIT_BLOCKING_QUEUE
-      SPINLOCK_BODY();
+      if (!qt_idle_round(
+            &q->idle, &idle_since, qt_threadqueue_has_work, q)) {
+        SPINLOCK_BODY();
+      }
 #else
-      if (qthread_incr(&q->frustration, 1) > 1000) {
+      if (qt_blocking_subsystem_pending(my_shepherd) ||
+          atomic_load_explicit(&qthread_internal_getworker()->timers->armed,
+                               memory_order_relaxed)) {
+        SPINLOCK_BODY();
+      } else if (qthread_incr(&q->frustration, 1) > 1000) {
         QTHREAD_COND_LOCK(q->trigger);
         if (q->frustration > 1000) { QTHREAD_COND_WAIT(q->trigger); }
         QTHREAD_COND_UNLOCK(q->trigger);
@@ -388,4 +457,8 @@ size_t INTERNAL qt_threadqueue_policy(const enum threadqueue_policy policy) {
   }
 }
 
+#ifdef QT_THREADQUEUE_PREFIX
+QT_THREADQUEUE_OPS_DEFINE();
+#endif
+
 /* vim:set expandtab: */
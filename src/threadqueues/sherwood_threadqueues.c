@@ -13,13 +13,17 @@
 #include "qt_asserts.h"
 #include "qt_envariables.h"
 #include "qt_expect.h"
+#include "qt_idle.h"
+#include "qt_io.h" /* for qt_blocking_subsystem_poll() */
 #include "qt_prefetch.h"
 #include "qt_qthread_mgmt.h"
 #include "qt_qthread_struct.h"
 #include "qt_shepherd_innards.h"
 #include "qt_subsystems.h"
+#include "qt_threadqueue_ops.h"
 #include "qt_threadqueue_scheduler.h"
 #include "qt_threadqueues.h"
+#include "qt_trace.h"
 #include "qt_visibility.h"
 #include "qthread_innards.h" /* for qlib */
 
@@ -42,20 +46,25 @@ struct _qt_threadqueue {
                                    * tasks cannot be moved - 4/1/11 AKP
                                    */
   QTHREAD_TRYLOCK_TYPE qlock;
+  qt_idle_t idle;
 } /* qt_threadqueue_t */;
 
 static aligned_t steal_disable = 0;
 static long steal_chunksize = 0;
+static long steal_remote_chunksize = 0;
+static unsigned int steal_local_rounds = 0;
 
 // Forward declarations
 qt_threadqueue_node_t INTERNAL *
-qt_threadqueue_dequeue_steal(qt_threadqueue_t *h, qt_threadqueue_t *v);
+qt_threadqueue_dequeue_steal(qt_threadqueue_t *h,
+                             qt_threadqueue_t *v,
+                             int remote);
 
 void INTERNAL qt_threadqueue_enqueue_multiple(qt_threadqueue_t *q,
                                               qt_threadqueue_node_t *first);
 
 /* Memory Management */
-qt_threadqueue_pools_t generic_threadqueue_pools;
+static qt_threadqueue_pools_t generic_threadqueue_pools;
 #define ALLOC_THREADQUEUE()                                                    \
   (qt_threadqueue_t *)qt_mpool_alloc(generic_threadqueue_pools.queues)
 #define FREE_THREADQUEUE(t) qt_mpool_free(generic_threadqueue_pools.queues, t)
@@ -78,6 +87,9 @@ void INTERNAL qt_threadqueue_subsystem_init(void) {
   generic_threadqueue_pools.nodes =
     qt_mpool_create_aligned(sizeof(qt_threadqueue_node_t), qthread_cacheline());
   steal_chunksize = qt_internal_get_env_num("STEAL_CHUNK", 0, 0);
+  steal_remote_chunksize =
+    qt_internal_get_env_num("STEAL_REMOTE_CHUNK", 0, 0);
+  steal_local_rounds = qt_internal_get_env_num("STEAL_LOCAL_ROUNDS", 4, 0);
   qthread_internal_cleanup(qt_threadqueue_subsystem_shutdown);
 }
 
@@ -90,7 +102,7 @@ ssize_t INTERNAL qt_threadqueue_advisory_queuelen(qt_threadqueue_t *q) {
 /*****************************************/
 
 static inline qt_threadqueue_node_t *
-qthread_steal(qthread_shepherd_t *thief_shepherd);
+qthread_steal(qthread_shepherd_t *thief_shepherd, uint64_t *idle_since);
 
 qt_threadqueue_t INTERNAL *qt_threadqueue_new(void) {
   qt_threadqueue_t *q = ALLOC_THREADQUEUE();
@@ -101,14 +113,15 @@ qt_threadqueue_t INTERNAL *qt_threadqueue_new(void) {
     atomic_store_explicit(&q->qlength, 0, memory_order_relaxed);
     atomic_store_explicit(&q->qlength_stealable, 0, memory_order_relaxed);
     QTHREAD_TRYLOCK_INIT(q->qlock);
+    qt_idle_init(&q->idle);
   }
 
   return q;
 }
 
-extern qt_mpool generic_qthread_pool;
-#define ALLOC_QTHREAD() (qthread_t *)qt_mpool_alloc(generic_qthread_pool)
-#define FREE_QTHREAD(t) qt_mpool_free(generic_qthread_pool, t)
+qt_idle_t INTERNAL *qt_threadqueue_idle(qt_threadqueue_t *q) {
+  return &q->idle;
+}
 
 void INTERNAL qt_threadqueue_free(qt_threadqueue_t *q) {
   if (q->head != q->tail) {
@@ -125,7 +138,7 @@ void INTERNAL qt_threadqueue_free(qt_threadqueue_t *q) {
         }
         t = node->value;
         FREE_TQNODE(node);
-        FREE_QTHREAD(t);
+        qthread_thread_free(t);
       }
     }
     assert(q->head == NULL);
@@ -150,12 +163,13 @@ static inline int qt_threadqueue_isstealable(qthread_t *t) {
 void INTERNAL qt_threadqueue_enqueue(qt_threadqueue_t *restrict q,
                                      qthread_t *restrict t) {
   qt_threadqueue_node_t *node;
+  int const stealable = qt_threadqueue_isstealable(t);
 
   node = ALLOC_TQNODE();
   assert(node != NULL);
 
   node->value = t;
-  node->stealable = qt_threadqueue_isstealable(t);
+  node->stealable = stealable;
 
   assert(q != NULL);
   assert(t != NULL);
@@ -175,18 +189,24 @@ void INTERNAL qt_threadqueue_enqueue(qt_threadqueue_t *restrict q,
   atomic_fetch_add_explicit(
     &q->qlength_stealable, node->stealable, memory_order_relaxed);
   QTHREAD_TRYLOCK_UNLOCK(&q->qlock);
+  if (stealable) {
+    qt_idle_notify_stealable(&q->idle);
+  } else {
+    qt_idle_notify(&q->idle);
+  }
 }
 
 /* yielded threads enqueue at head */
 void INTERNAL qt_threadqueue_enqueue_yielded(qt_threadqueue_t *restrict q,
                                              qthread_t *restrict t) {
   qt_threadqueue_node_t *node;
+  int const stealable = qt_threadqueue_isstealable(t);
 
   node = ALLOC_TQNODE();
   assert(node != NULL);
 
   node->value = t;
-  node->stealable = qt_threadqueue_isstealable(t);
+  node->stealable = stealable;
 
   assert(q != NULL);
   assert(t != NULL);
@@ -207,6 +227,31 @@ void INTERNAL qt_threadqueue_enqueue_yielded(qt_threadqueue_t *restrict q,
     atomic_fetch_add_explicit(&q->qlength_stealable, 1, memory_order_relaxed);
   }
   QTHREAD_TRYLOCK_UNLOCK(&q->qlock);
+  if (stealable) {
+    qt_idle_notify_stealable(&q->idle);
+  } else {
+    qt_idle_notify(&q->idle);
+  }
+}
+
+/* whether a worker of shep about to park could find work */
+static int qt_threadqueue_has_work(void *arg) {
+  qthread_shepherd_t *shep = arg;
+
+  if (atomic_load_explicit(&shep->ready->qlength, memory_order_relaxed) ||
+      qt_blocking_subsystem_pending(shep)) {
+    return 1;
+  }
+  if (atomic_load_explicit(&shep->active, memory_order_relaxed) &&
+      !steal_disable) {
+    for (qthread_shepherd_id_t i = 0; i < qlib->nshepherds; i++) {
+      if (atomic_load_explicit(&qlib->shepherds[i].ready->qlength_stealable,
+                               memory_order_relaxed)) {
+        return 1;
+      }
+    }
+  }
+  return 0;
 }
 
 /* dequeue at tail */
@@ -215,6 +260,7 @@ qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *q,
   qthread_shepherd_t *my_shepherd = qthread_internal_getshep();
   qthread_t *t;
   qthread_worker_id_t worker_id = NO_WORKER;
+  uint64_t idle_since = 0;
 
   assert(q != NULL);
   assert(my_shepherd);
@@ -224,6 +270,8 @@ qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *q,
   while (1) {
     qt_threadqueue_node_t *node = NULL;
 
+    qt_blocking_subsystem_poll(my_shepherd);
+    qt_timer_poll(qthread_internal_getworker());
     if (q->head) {
       QTHREAD_TRYLOCK_LOCK(&q->qlock);
       node = q->tail;
@@ -263,12 +311,32 @@ qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *q,
     if ((node == NULL) && (active)) {
       if (qlib->nshepherds > 1) {
         if (!steal_disable) {
-          node = qthread_steal(my_shepherd);
+          node = qthread_steal(my_shepherd, &idle_since);
+          /* it gives up, without holding the shepherd's steal flag, once
+           * we've spun for long enough */
+          if ((node == NULL) && (NULL == q->head) &&
+              qt_idle_due(&idle_since)) {
+            qt_idle_park(
+              &q->idle, &idle_since, qt_threadqueue_has_work, my_shepherd);
+          }
         } else {
-          while (NULL == q->head) SPINLOCK_BODY();
+          while (NULL == q->head) {
+            if (!qt_idle_round(&q->idle,
+                               &idle_since,
+                               qt_threadqueue_has_work,
+                               my_shepherd)) {
+              SPINLOCK_BODY();
+            }
+          }
           continue;
         }
+      } else if (NULL == q->head) {
+        qt_idle_round(
+          &q->idle, &idle_since, qt_threadqueue_has_work, my_shepherd);
       }
+    } else if ((node == NULL) && (NULL == q->head)) {
+      qt_idle_round(
+        &q->idle, &idle_since, qt_threadqueue_has_work, my_shepherd);
     }
     if (node) {
       t = node->value;
@@ -309,6 +377,28 @@ qthread_t INTERNAL *qt_scheduler_get_thread(qt_threadqueue_t *q,
   return (t);
 }
 
+/* append the chain first..last, holding n tasks of which nstealable may be
+ * stolen, at the tail */
+static inline void qt_threadqueue_splice(qt_threadqueue_t *q,
+                                         qt_threadqueue_node_t *first,
+                                         qt_threadqueue_node_t *last,
+                                         size_t n,
+                                         size_t nstealable) {
+  QTHREAD_TRYLOCK_LOCK(&q->qlock);
+  last->next = NULL;
+  first->prev = q->tail;
+  q->tail = last;
+  if (q->head == NULL) {
+    q->head = first;
+  } else {
+    first->prev->next = first;
+  }
+  atomic_fetch_add_explicit(&q->qlength, n, memory_order_relaxed);
+  atomic_fetch_add_explicit(
+    &q->qlength_stealable, nstealable, memory_order_relaxed);
+  QTHREAD_TRYLOCK_UNLOCK(&q->qlock);
+}
+
 /* enqueue multiple (from steal) */
 void INTERNAL qt_threadqueue_enqueue_multiple(qt_threadqueue_t *q,
                                               qt_threadqueue_node_t *first) {
@@ -323,36 +413,64 @@ void INTERNAL qt_threadqueue_enqueue_multiple(qt_threadqueue_t *q,
     last = last->next;
     addCnt++;
   }
+  qt_threadqueue_splice(q, first, last, addCnt, addCnt);
+  qt_idle_notify_stealable(&q->idle);
+}
 
-  QTHREAD_TRYLOCK_LOCK(&q->qlock);
-  last->next = NULL;
-  first->prev = q->tail;
-  q->tail = last;
-  if (q->head == NULL) {
-    q->head = first;
+/* enqueue multiple (from qthread_spawn_many) */
+void INTERNAL qt_threadqueue_enqueue_many(qt_threadqueue_t *restrict q,
+                                          qthread_t *const *restrict t,
+                                          size_t n) {
+  qt_threadqueue_node_t *first = NULL, *last = NULL;
+  size_t nstealable = 0;
+
+  assert(q != NULL);
+  if (n == 0) { return; }
+
+  for (size_t i = 0; i < n; i++) {
+    qt_threadqueue_node_t *node = ALLOC_TQNODE();
+
+    assert(node != NULL);
+    assert(t[i] != NULL);
+    node->value = t[i];
+    node->stealable = qt_threadqueue_isstealable(t[i]);
+    nstealable += node->stealable;
+    node->prev = last;
+    if (last) {
+      last->next = node;
+    } else {
+      first = node;
+    }
+    last = node;
+  }
+  qt_threadqueue_splice(q, first, last, n, nstealable);
+  if (nstealable) {
+    qt_idle_notify_stealable_many(&q->idle, nstealable);
   } else {
-    first->prev->next = first;
+    qt_idle_notify(&q->idle);
   }
-  atomic_fetch_add_explicit(&q->qlength, addCnt, memory_order_relaxed);
-  atomic_fetch_add_explicit(
-    &q->qlength_stealable, addCnt, memory_order_relaxed);
-  QTHREAD_TRYLOCK_UNLOCK(&q->qlock);
 }
 
-/* dequeue stolen threads at head, skip yielded threads */
+/* dequeue stolen threads at head, skip yielded threads; a thief on another
+ * socket takes a bigger share, since it pays more per steal */
 qt_threadqueue_node_t INTERNAL *
-qt_threadqueue_dequeue_steal(qt_threadqueue_t *h, qt_threadqueue_t *v) {
+qt_threadqueue_dequeue_steal(qt_threadqueue_t *h,
+                             qt_threadqueue_t *v,
+                             int remote) {
   qt_threadqueue_node_t *node;
   qt_threadqueue_node_t *first = NULL;
   qt_threadqueue_node_t *last = NULL;
   long amtStolen = 0;
   long desired_stolen;
 
-  if (steal_chunksize == 0) {
+  if (remote && steal_remote_chunksize) {
+    desired_stolen = steal_remote_chunksize;
+  } else if (steal_chunksize == 0) {
     desired_stolen =
-      atomic_load_explicit(&v->qlength_stealable, memory_order_relaxed) / 2;
+      atomic_load_explicit(&v->qlength_stealable, memory_order_relaxed);
+    desired_stolen = remote ? desired_stolen * 3 / 4 : desired_stolen / 2;
   } else {
-    desired_stolen = steal_chunksize;
+    desired_stolen = steal_chunksize * (remote ? 2 : 1);
   }
 
   assert(h != NULL);
@@ -447,7 +565,7 @@ qt_threadqueue_dequeue_steal(qt_threadqueue_t *h, qt_threadqueue_t *v) {
  *  Returns the work stolen
  */
 static inline qt_threadqueue_node_t *
-qthread_steal(qthread_shepherd_t *thief_shepherd) {
+qthread_steal(qthread_shepherd_t *thief_shepherd, uint64_t *idle_since) {
   qt_threadqueue_node_t *stolen = NULL;
 
   assert(thief_shepherd);
@@ -478,31 +596,77 @@ qthread_steal(qthread_shepherd_t *thief_shepherd) {
   assert(sorted_sheplist);
 
   qt_threadqueue_t *myqueue = thief_shepherd->ready;
+  qthread_worker_t *const me = qthread_internal_getworker();
+
+  /* Victims are tried nearest first. When some are on another socket, only
+   * the local ones are tried until enough rounds over them have failed; then
+   * one round covers everyone, and each fruitless trip abroad doubles the
+   * wait for the next one. */
+  qthread_shepherd_id_t const nvictims = qlib->nshepherds - 1;
+  qthread_shepherd_id_t const nlocal = thief_shepherd->steal_local;
+  int const tiered = (me != NULL) && (steal_local_rounds > 0) &&
+                     (nlocal > 0) && (nlocal < nvictims);
+  qthread_shepherd_id_t end = nvictims;
+
+  if (tiered &&
+      (me->steal_rounds < (steal_local_rounds << me->steal_backoff))) {
+    end = nlocal;
+  }
 
   while (stolen == NULL) {
     qt_threadqueue_t *victim_queue = shepherds[sorted_sheplist[i]].ready;
     if (0 != atomic_load_explicit(&victim_queue->qlength_stealable,
                                   memory_order_relaxed)) {
-      stolen = qt_threadqueue_dequeue_steal(myqueue, victim_queue);
+      stolen =
+        qt_threadqueue_dequeue_steal(myqueue, victim_queue, i >= nlocal);
       if (stolen) {
         qt_threadqueue_node_t *surplus = stolen->next;
+        if (unlikely(qt_trace_enabled)) {
+          uintptr_t count = 1;
+          for (qt_threadqueue_node_t *n = surplus; n; n = n->next) { count++; }
+          qt_trace(QT_TRACE_STEAL, count, sorted_sheplist[i]);
+        }
         if (surplus) {
           stolen->next = NULL;
           surplus->prev = NULL;
           qt_threadqueue_enqueue_multiple(myqueue, surplus);
         }
+        if (tiered) {
+          me->steal_rounds = 0;
+          if (i >= nlocal) { me->steal_backoff = 0; }
+        }
         break;
       }
     }
 
+    qt_blocking_subsystem_poll(thief_shepherd);
+    qt_timer_poll(qthread_internal_getworker());
     if ((0 < atomic_load_explicit(&myqueue->qlength, memory_order_relaxed)) ||
         steal_disable) { // work at home quit steal attempt
       break;
     }
 
     i++;
-    i *= (i < qlib->nshepherds - 1);
-    if (i == 0) { sched_yield(); }
+    if (i >= end) {
+      i = 0;
+      if (tiered) {
+        if (end == nlocal) {
+          if (++me->steal_rounds >=
+              (steal_local_rounds << me->steal_backoff)) {
+            end = nvictims;
+          }
+        } else {
+          me->steal_rounds = 0;
+          if (me->steal_backoff < QTHREAD_STEAL_MAX_BACKOFF) {
+            me->steal_backoff++;
+          }
+          end = nlocal;
+        }
+      }
+      /* leave parking to the caller, so our siblings may steal meanwhile */
+      if (qt_idle_due(idle_since)) { break; }
+      sched_yield();
+    }
     SPINLOCK_BODY();
   }
   atomic_store_explicit(&thief_shepherd->stealing, 0, memory_order_relaxed);
@@ -646,4 +810,8 @@ size_t INTERNAL qt_threadqueue_policy(const enum threadqueue_policy policy) {
   }
 }
 
+#ifdef QT_THREADQUEUE_PREFIX
+QT_THREADQUEUE_OPS_DEFINE();
+#endif
+
 /* vim:set expandtab: */
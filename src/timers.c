@@ -0,0 +1,308 @@
+/* System Headers */
+#include <errno.h>
+#include <stdint.h>
+#include <string.h> /* for memset() */
+#include <time.h>   /* for nanosleep() */
+
+/* API Headers */
+#include "qthread/qthread.h"
+
+/* Internal Headers */
+#include "qt_alloc.h"
+#include "qt_asserts.h"
+#include "qt_initialized.h" // for qthread_library_initialized
+#include "qt_qthread_mgmt.h"
+#include "qt_qthread_struct.h"
+#include "qt_subsystems.h"
+#include "qt_threadqueues.h"
+#include "qt_timers.h"
+#include "qthread_innards.h" /* for qlib */
+
+#define QT_TIMER_SPAN (QT_TIMER_LEVELS * QT_TIMER_SLOT_BITS)
+
+static qt_timer_wheel_t *wheels = NULL;
+static size_t nwheels = 0;
+
+/* the first tick at or after deadline */
+static inline uint64_t qt_timer_due_tick(uint64_t deadline) {
+  return (deadline >> QT_TIMER_TICK_SHIFT) +
+         ((deadline & ((1u << QT_TIMER_TICK_SHIFT) - 1)) != 0);
+}
+
+static void qt_timer_subsystem_shutdown(void) {
+  qt_internal_aligned_free(wheels, CACHELINE_WIDTH);
+  wheels = NULL;
+  nwheels = 0;
+}
+
+void INTERNAL qt_timer_subsystem_init(void) {
+  uint64_t const now = qt_timer_now() >> QT_TIMER_TICK_SHIFT;
+
+  nwheels = qlib->nshepherds * qlib->nworkerspershep;
+  wheels = qt_internal_aligned_alloc(nwheels * sizeof(qt_timer_wheel_t),
+                                     CACHELINE_WIDTH);
+  assert(wheels);
+  memset(wheels, 0, nwheels * sizeof(qt_timer_wheel_t));
+  for (size_t i = 0; i < nwheels; i++) {
+    qt_timer_wheel_t *w = &wheels[i];
+
+    QTHREAD_FASTLOCK_INIT(w->lock);
+    atomic_init(&w->armed, 0);
+    w->tick = now;
+    w->next_tick = QT_TIMER_NEVER;
+    qlib->shepherds[i / qlib->nworkerspershep]
+      .workers[i % qlib->nworkerspershep]
+      .timers = w;
+  }
+  qthread_internal_cleanup(qt_timer_subsystem_shutdown);
+}
+
+static inline void qt_timer_push(qt_timer_t **head, qt_timer_t *t) {
+  t->prev = NULL;
+  t->next = *head;
+  if (t->next) { t->next->prev = t; }
+  *head = t;
+}
+
+/* Wheel lock held */
+static void qt_timer_remove(qt_timer_wheel_t *w, qt_timer_t *t) {
+  qt_timer_t **head =
+    (t->level == QT_TIMER_LEVELS) ? &w->far : &w->slots[t->level][t->slot];
+
+  if (t->prev) {
+    t->prev->next = t->next;
+  } else {
+    *head = t->next;
+  }
+  if (t->next) { t->next->prev = t->prev; }
+  if ((*head == NULL) && (t->level < QT_TIMER_LEVELS)) {
+    w->occupied[t->level] &= ~((uint64_t)1 << t->slot);
+  }
+}
+
+/* Wheel lock held; due must be later than the wheel's clock. The level is
+ * that of the highest group of bits in which due differs from the clock, so
+ * the timer's slot is always ahead of the clock at that level. */
+static void qt_timer_place(qt_timer_wheel_t *w, qt_timer_t *t, uint64_t due) {
+  unsigned const level =
+    (63 - (unsigned)__builtin_clzll(due ^ w->tick)) / QT_TIMER_SLOT_BITS;
+
+  assert(due > w->tick);
+  if (level >= QT_TIMER_LEVELS) {
+    t->level = QT_TIMER_LEVELS;
+    qt_timer_push(&w->far, t);
+    return;
+  }
+  t->level = (uint8_t)level;
+  t->slot = (due >> (level * QT_TIMER_SLOT_BITS)) & (QT_TIMER_SLOTS - 1);
+  qt_timer_push(&w->slots[level][t->slot], t);
+  w->occupied[level] |= (uint64_t)1 << t->slot;
+}
+
+/* Wheel lock held: puts t back in the wheel, or on *due if it is */
+static void
+qt_timer_refile(qt_timer_wheel_t *w, qt_timer_t *t, qt_timer_t **due) {
+  uint64_t const when = qt_timer_due_tick(t->deadline);
+
+  if (when > w->tick) {
+    qt_timer_place(w, t, when);
+    return;
+  }
+  atomic_store_explicit(&t->state, QT_TIMER_FIRING, memory_order_relaxed);
+  atomic_fetch_sub_explicit(&w->armed, 1, memory_order_relaxed);
+  t->next = *due;
+  *due = t;
+}
+
+/* Wheel lock held: the first tick after the clock at which a slot comes due.
+ * Everything on a level comes due before anything on the level above. */
+static uint64_t qt_timer_next_tick(qt_timer_wheel_t const *w) {
+  for (unsigned l = 0; l < QT_TIMER_LEVELS; l++) {
+    unsigned const shift = l * QT_TIMER_SLOT_BITS;
+    unsigned const cur = (w->tick >> shift) & (QT_TIMER_SLOTS - 1);
+    uint64_t const ahead = w->occupied[l] & ~(((uint64_t)2 << cur) - 1);
+
+    if (ahead) {
+      unsigned const up = shift + QT_TIMER_SLOT_BITS;
+
+      return ((w->tick >> up) << up) |
+             ((uint64_t)__builtin_ctzll(ahead) << shift);
+    }
+  }
+  if (w->far) { return ((w->tick >> QT_TIMER_SPAN) + 1) << QT_TIMER_SPAN; }
+  return QT_TIMER_NEVER;
+}
+
+/* Wheel lock held: runs the clock up to now, one slot that comes due at a
+ * time, moving the timers in each a level down (or onto *due). */
+static void
+qt_timer_advance(qt_timer_wheel_t *w, uint64_t now, qt_timer_t **due) {
+  do {
+    uint64_t const at = qt_timer_next_tick(w);
+
+    if (at > now) {
+      w->tick = now;
+      w->next_tick = at;
+      return;
+    }
+    w->tick = at;
+    if (w->far && ((at & (((uint64_t)1 << QT_TIMER_SPAN) - 1)) == 0)) {
+      qt_timer_t *t = w->far;
+
+      w->far = NULL;
+      while (t) {
+        qt_timer_t *next = t->next;
+
+        qt_timer_refile(w, t, due);
+        t = next;
+      }
+    }
+    for (int l = QT_TIMER_LEVELS - 1; l >= 0; l--) {
+      unsigned const shift = (unsigned)l * QT_TIMER_SLOT_BITS;
+      unsigned const slot = (at >> shift) & (QT_TIMER_SLOTS - 1);
+      qt_timer_t *t;
+
+      if (at & (((uint64_t)1 << shift) - 1)) { continue; }
+      t = w->slots[l][slot];
+      if (t == NULL) { continue; }
+      w->slots[l][slot] = NULL;
+      w->occupied[l] &= ~((uint64_t)1 << slot);
+      while (t) {
+        qt_timer_t *next = t->next;
+
+        qt_timer_refile(w, t, due);
+        t = next;
+      }
+    }
+  } while (1);
+}
+
+void INTERNAL qt_timer_arm(qthread_t *me,
+                           uint64_t deadline,
+                           qt_timer_unlink_f unlink,
+                           void *addr) {
+  qt_timer_wheel_t *w = qthread_internal_getworker()->timers;
+  qt_timer_t *t = &me->rdata->timer;
+  uint64_t when = qt_timer_due_tick(deadline);
+
+  assert(atomic_load_explicit(&t->state, memory_order_relaxed) ==
+         QT_TIMER_IDLE);
+  t->deadline = deadline;
+  t->wheel = w;
+  t->unlink = unlink;
+  t->addr = addr;
+  t->waiter = me;
+  QTHREAD_FASTLOCK_LOCK(&w->lock);
+  if (atomic_load_explicit(&w->armed, memory_order_relaxed) == 0) {
+    /* nothing to miss: skip the clock ahead */
+    w->tick = qt_timer_now() >> QT_TIMER_TICK_SHIFT;
+  }
+  if (when <= w->tick) { when = w->tick + 1; }
+  qt_timer_place(w, t, when);
+  atomic_fetch_add_explicit(&w->armed, 1, memory_order_relaxed);
+  atomic_store_explicit(&t->state, QT_TIMER_ARMED, memory_order_relaxed);
+  w->next_tick = qt_timer_next_tick(w);
+  QTHREAD_FASTLOCK_UNLOCK(&w->lock);
+}
+
+int INTERNAL qt_timer_disarm(qthread_t *me) {
+  qt_timer_t *t = &me->rdata->timer;
+  uint8_t state = atomic_load_explicit(&t->state, memory_order_acquire);
+
+  if (state == QT_TIMER_ARMED) {
+    qt_timer_wheel_t *w = t->wheel;
+
+    QTHREAD_FASTLOCK_LOCK(&w->lock);
+    state = atomic_load_explicit(&t->state, memory_order_relaxed);
+    if (state == QT_TIMER_ARMED) {
+      qt_timer_remove(w, t);
+      atomic_fetch_sub_explicit(&w->armed, 1, memory_order_relaxed);
+      atomic_store_explicit(&t->state, QT_TIMER_IDLE, memory_order_relaxed);
+      QTHREAD_FASTLOCK_UNLOCK(&w->lock);
+      return 0;
+    }
+    QTHREAD_FASTLOCK_UNLOCK(&w->lock);
+  }
+  /* its worker is firing it, and may yet find that we were woken first */
+  while ((state = atomic_load_explicit(&t->state, memory_order_acquire)) ==
+         QT_TIMER_FIRING) {
+    SPINLOCK_BODY();
+  }
+  atomic_store_explicit(&t->state, QT_TIMER_IDLE, memory_order_relaxed);
+  return state == QT_TIMER_FIRED;
+}
+
+static int qt_timer_fire(qthread_worker_t *me, qt_timer_t *t) {
+  qthread_t *waiter = t->waiter;
+  qthread_shepherd_t *shep = me->shepherd;
+
+  if (t->unlink && !t->unlink(t->addr, waiter)) {
+    /* whoever filled or emptied it has woken the waiter already */
+    atomic_store_explicit(&t->state, QT_TIMER_IDLE, memory_order_release);
+    return 0;
+  }
+  atomic_store_explicit(&t->state, QT_TIMER_FIRED, memory_order_release);
+  atomic_store_explicit(
+    &waiter->thread_state, QTHREAD_STATE_RUNNING, memory_order_relaxed);
+  if ((atomic_load_explicit(&waiter->flags, memory_order_relaxed) &
+       QTHREAD_UNSTEALABLE) &&
+      (waiter->rdata->shepherd_ptr != shep)) {
+    qt_threadqueue_enqueue(waiter->rdata->shepherd_ptr->ready, waiter);
+  } else {
+    qt_threadqueue_enqueue(shep->ready, waiter);
+  }
+  return 1;
+}
+
+int INTERNAL qt_timer_expire(qthread_worker_t *me) {
+  qt_timer_wheel_t *w = me->timers;
+  uint64_t const now = qt_timer_now() >> QT_TIMER_TICK_SHIFT;
+  qt_timer_t *due = NULL;
+  int woken = 0;
+
+  if (now < w->next_tick) { return 0; }
+  QTHREAD_FASTLOCK_LOCK(&w->lock);
+  qt_timer_advance(w, now, &due);
+  QTHREAD_FASTLOCK_UNLOCK(&w->lock);
+  /* the unlink functions take FEB locks, so not under the wheel's */
+  while (due) {
+    qt_timer_t *t = due;
+
+    due = t->next;
+    woken += qt_timer_fire(me, t);
+  }
+  return woken;
+}
+
+uint64_t INTERNAL qt_timer_park_ns(qthread_worker_t *me) {
+  qt_timer_wheel_t *w = me->timers;
+  uint64_t now, at;
+
+  if ((atomic_load_explicit(&w->armed, memory_order_relaxed) == 0) ||
+      (w->next_tick == QT_TIMER_NEVER)) {
+    return QT_TIMER_NEVER;
+  }
+  now = qt_timer_now();
+  at = w->next_tick << QT_TIMER_TICK_SHIFT;
+  return (at > now) ? at - now : 0;
+}
+
+int API_FUNC qthread_sleep_ns(uint64_t ns) {
+  assert(qthread_library_initialized);
+  qthread_t *me = qthread_internal_self();
+
+  if (me == NULL) {
+    struct timespec left = {(time_t)(ns / 1000000000), (long)(ns % 1000000000)};
+
+    while (nanosleep(&left, &left) == -1 && errno == EINTR) {}
+    return QTHREAD_SUCCESS;
+  }
+  qt_timer_arm(me, qt_timer_deadline(ns), NULL, NULL);
+  atomic_store_explicit(
+    &me->thread_state, QTHREAD_STATE_SLEEPING, memory_order_relaxed);
+  qthread_back_to_master(me);
+  qt_timer_disarm(me);
+  return QTHREAD_SUCCESS;
+}
+
+/* vim:set expandtab: */
@@ -1,77 +1,155 @@
-#include <stdio.h>
+/* System Headers */
+#include <errno.h>
+#include <stdatomic.h>
+#include <string.h>
 
-#include <qthread/qthread.h>
-#include <qthread/tls.h>
+/* API Headers */
+#include "qthread/qthread.h"
+#include "qthread/tls.h"
 
-struct qt_keypair_t {
-  qthread_key_t key;
-  void *value;
+/* Internal Headers */
+#include "qt_alloc.h"
+#include "qt_asserts.h"
+#include "qt_qthread_mgmt.h"
+#include "qt_qthread_struct.h"
+#include "qt_tls.h"
+#include "qt_visibility.h"
+
+/* A key is an index into every task's array of slots (rdata->tls), which
+ * starts out as the few slots inside the task's runtime data and is only
+ * allocated, and grown, when a task sets a key beyond those. Each key has a
+ * sequence number that is odd while the key exists and changes whenever it is
+ * created or deleted; a slot remembers the number its value was set under, so
+ * a value left behind by a deleted key is never seen through a later key that
+ * reuses its index. */
+typedef struct {
+  _Atomic uintptr_t seq;
   void (*destructor)(void *);
-};
-typedef struct qt_keypair_t qt_keypair_t;
-
-struct TLS {
-  int initialized;
-  int nkeys;
-  qt_keypair_t key_pair[];
-};
-typedef struct TLS TLS;
-
-int qthread_key_create(qthread_key_t *key, void (*destructor)(void *)) {
-  int size = qthread_size_tasklocal();
-  TLS *t = (TLS *)qthread_get_tasklocal(size);
-  qt_keypair_t *p;
-
-  printf("t->initialized %d\n", t->initialized);
-  p = &t->key_pair[t->nkeys];
-  p->key = *key;
-  p->value = NULL;
-  p->destructor = destructor;
-  t->nkeys++;
-  return 0;
+} qt_tls_key_t;
+
+static qt_tls_key_t qt_tls_keys[QTHREAD_KEYS_MAX];
+
+int API_FUNC qthread_key_create(qthread_key_t *key,
+                                void (*destructor)(void *)) {
+  assert(key);
+  for (qthread_key_t i = 0; i < QTHREAD_KEYS_MAX; i++) {
+    uintptr_t seq =
+      atomic_load_explicit(&qt_tls_keys[i].seq, memory_order_relaxed);
+
+    if (((seq & 1) == 0) &&
+        atomic_compare_exchange_strong_explicit(&qt_tls_keys[i].seq,
+                                                &seq,
+                                                seq + 1,
+                                                memory_order_acq_rel,
+                                                memory_order_relaxed)) {
+      /* no task can have a value for it yet, so nobody reads this early */
+      qt_tls_keys[i].destructor = destructor;
+      *key = i;
+      return QTHREAD_SUCCESS;
+    }
+  }
+  return EAGAIN;
 }
 
-int qthread_key_delete(qthread_key_t key) {
-  int i;
-  int size = qthread_size_tasklocal();
-  TLS *t = (TLS *)qthread_get_tasklocal(size);
-  qt_keypair_t *p;
-  for (i = 0; i < t->nkeys; i++) {
-    p = &t->key_pair[i];
-    if (p->key == key) {
-      p->key = 0;
-      p->destructor(p->value);
-      return 0;
+int API_FUNC qthread_key_delete(qthread_key_t key) {
+  uintptr_t seq;
+
+  if (key >= QTHREAD_KEYS_MAX) { return QTHREAD_BADARGS; }
+  seq = atomic_load_explicit(&qt_tls_keys[key].seq, memory_order_relaxed);
+  if (((seq & 1) == 0) ||
+      !atomic_compare_exchange_strong_explicit(&qt_tls_keys[key].seq,
+                                               &seq,
+                                               seq + 1,
+                                               memory_order_acq_rel,
+                                               memory_order_relaxed)) {
+    return QTHREAD_BADARGS;
+  }
+  /* as with pthread_key_delete(), the values' destructors are not run */
+  return QTHREAD_SUCCESS;
+}
+
+void API_FUNC *qthread_getspecific(qthread_key_t key) {
+  qthread_t *me = qthread_internal_self();
+  struct qthread_runtime_data_s *rdata;
+
+  if (me == NULL) { return NULL; }
+  rdata = me->rdata;
+  if ((key >= rdata->tls_size) ||
+      (rdata->tls[key].seq !=
+       atomic_load_explicit(&qt_tls_keys[key].seq, memory_order_relaxed))) {
+    return NULL;
+  }
+  return rdata->tls[key].value;
+}
+
+/* Makes room for the given key in a task's slots */
+static int qt_tls_grow(struct qthread_runtime_data_s *rdata,
+                       qthread_key_t key) {
+  unsigned int size = QT_TLS_INLINE_SLOTS;
+  qt_tls_slot_t *tls;
+
+  while (size <= key) { size *= 2; }
+  if (size == QT_TLS_INLINE_SLOTS) {
+    tls = rdata->tls_inline;
+  } else {
+    tls = MALLOC(size * sizeof(qt_tls_slot_t));
+    if (tls == NULL) { return ENOMEM; }
+    if (rdata->tls_size > 0) {
+      memcpy(tls, rdata->tls, rdata->tls_size * sizeof(qt_tls_slot_t));
     }
   }
-  return 1;
+  /* sequence number 0 never matches a key that exists */
+  memset(&tls[rdata->tls_size],
+         0,
+         (size - rdata->tls_size) * sizeof(qt_tls_slot_t));
+  qt_tls_free(rdata);
+  rdata->tls = tls;
+  rdata->tls_size = size;
+  return QTHREAD_SUCCESS;
 }
 
-void *qthread_getspecific(qthread_key_t key) {
-  int i;
-  int size = qthread_size_tasklocal();
-  TLS *t = (TLS *)qthread_get_tasklocal(size);
-  qt_keypair_t *p;
+int API_FUNC qthread_setspecific(qthread_key_t key, void const *value) {
+  qthread_t *me = qthread_internal_self();
+  struct qthread_runtime_data_s *rdata;
+  uintptr_t seq;
+
+  if (key >= QTHREAD_KEYS_MAX) { return QTHREAD_BADARGS; }
+  seq = atomic_load_explicit(&qt_tls_keys[key].seq, memory_order_relaxed);
+  if ((seq & 1) == 0) { return QTHREAD_BADARGS; }
+  if (me == NULL) { return QTHREAD_NOT_ALLOWED; }
+  rdata = me->rdata;
+  if (key >= rdata->tls_size) {
+    int const ret = qt_tls_grow(rdata, key);
 
-  for (i = 0; i < t->nkeys; i++) {
-    p = &t->key_pair[i];
-    if (p->key == key) { return p->value; }
+    if (ret != QTHREAD_SUCCESS) { return ret; }
   }
-  return NULL;
+  rdata->tls[key].seq = seq;
+  rdata->tls[key].value = (void *)value;
+  return QTHREAD_SUCCESS;
 }
 
-int qthread_setspecific(qthread_key_t key, void const *value) {
-  int i;
-  int size = qthread_size_tasklocal();
-  TLS *t = (TLS *)qthread_get_tasklocal(size);
-  qt_keypair_t *p;
-
-  for (i = 0; i < t->nkeys; i++) {
-    p = &t->key_pair[i];
-    if (p->key == key) {
-      p->value = (void *)value;
-      return 0;
+void INTERNAL qt_tls_free(struct qthread_runtime_data_s *rdata) {
+  if (rdata->tls_size > QT_TLS_INLINE_SLOTS) {
+    FREE(rdata->tls, rdata->tls_size * sizeof(qt_tls_slot_t));
+  }
+  rdata->tls = NULL;
+  rdata->tls_size = 0;
+}
+
+void INTERNAL qt_tls_destroy(struct qthread_runtime_data_s *rdata) {
+  for (qthread_key_t i = 0; i < rdata->tls_size; i++) {
+    qt_tls_slot_t *slot = &rdata->tls[i];
+    void *value = slot->value;
+
+    if ((value != NULL) &&
+        (slot->seq ==
+         atomic_load_explicit(&qt_tls_keys[i].seq, memory_order_relaxed)) &&
+        (qt_tls_keys[i].destructor != NULL)) {
+      slot->value = NULL;
+      qt_tls_keys[i].destructor(value);
     }
   }
-  return 1;
+  qt_tls_free(rdata);
 }
+
+/* vim:set expandtab: */
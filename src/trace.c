@@ -0,0 +1,262 @@
+/* System Headers */
+#include <stdio.h>  /* for fopen(), fprintf() */
+#include <stdlib.h> /* for qsort() */
+#include <string.h> /* for strlen(), memcpy() */
+
+/* API Headers */
+#include "qthread/qthread.h"
+
+/* Internal Headers */
+#include "qt_alloc.h"
+#include "qt_asserts.h"
+#include "qt_envariables.h"
+#include "qt_subsystems.h"
+#include "qt_trace.h"
+#include "qthread_innards.h" /* for qlib */
+
+/* Scheduler event tracing: when QT_TRACE names a file, every worker records
+ * what qthread_master() decides into its own ring buffer, and the rings are
+ * written out there as Chrome trace JSON (viewable in Perfetto or
+ * chrome://tracing) at qthread_finalize() or by qthread_trace_dump(). */
+
+int qt_trace_enabled = 0;
+qt_trace_ring_t *qt_trace_rings = NULL;
+
+static size_t trace_nrings = 0;
+static char *trace_filename = NULL;
+
+typedef struct {
+  qt_trace_event_t e;
+  uint32_t ring;
+} trace_item_t;
+
+/* a blocked task, waiting for its next RUN event */
+typedef struct {
+  uintptr_t task;
+  trace_item_t const *block;
+} trace_open_t;
+
+static char const *trace_stop_reason(uint32_t type) {
+  switch (type) {
+    case QT_TRACE_YIELD: return "yield";
+    case QT_TRACE_FEB_BLOCK: return "FEB wait";
+    case QT_TRACE_QUEUE_BLOCK: return "queue wait";
+    case QT_TRACE_PARENT_BLOCK: return "team wait";
+    case QT_TRACE_SYSCALL: return "syscall";
+    case QT_TRACE_MIGRATE: return "migrate";
+    case QT_TRACE_TERMINATE: return "done";
+    default: return NULL;
+  }
+}
+
+static int trace_item_cmp(void const *a, void const *b) {
+  uint64_t const ta = ((trace_item_t const *)a)->e.ts;
+  uint64_t const tb = ((trace_item_t const *)b)->e.ts;
+
+  return (ta > tb) - (ta < tb);
+}
+
+static trace_open_t *
+trace_open_find(trace_open_t *open, size_t mask, uintptr_t task, int insert) {
+  size_t i = (size_t)(task >> 4) & mask;
+
+  while (open[i].task != 0) {
+    if (open[i].task == task) { return &open[i]; }
+    i = (i + 1) & mask;
+  }
+  if (!insert) { return NULL; }
+  open[i].task = task;
+  return &open[i];
+}
+
+#define TRACE_US(ts) ((double)((ts) - base) / 1000.0)
+#define TRACE_PID(ring) ((ring) / qlib->nworkerspershep)
+#define TRACE_TID(ring) ((ring) % qlib->nworkerspershep)
+
+int API_FUNC qthread_trace_dump(char const *filename) {
+  trace_item_t *items;
+  trace_open_t *open;
+  size_t nitems = 0, open_mask = 1;
+  uint64_t base = UINT64_MAX;
+  FILE *f;
+
+  if (qt_trace_rings == NULL) { return QTHREAD_NOT_ALLOWED; }
+  if (filename == NULL) { filename = trace_filename; }
+  f = fopen(filename, "w");
+  if (f == NULL) { return QTHREAD_BADARGS; }
+
+  /* snapshot the rings; a worker that is still running may have overwritten
+   * the oldest few events while we copy them */
+  for (size_t r = 0; r < trace_nrings; r++) {
+    size_t const head =
+      atomic_load_explicit(&qt_trace_rings[r].head, memory_order_acquire);
+    nitems += (head > qt_trace_rings[r].mask) ? qt_trace_rings[r].mask + 1
+                                               : head;
+  }
+  items = qt_malloc(sizeof(trace_item_t) * (nitems + 1));
+  assert(items);
+  nitems = 0;
+  for (size_t r = 0; r < trace_nrings; r++) {
+    qt_trace_ring_t *ring = &qt_trace_rings[r];
+    size_t const head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t i = (head > ring->mask) ? head - ring->mask - 1 : 0;
+
+    for (; i < head; i++) {
+      items[nitems].e = ring->events[i & ring->mask];
+      items[nitems].ring = (uint32_t)r;
+      if (items[nitems].e.ts < base) { base = items[nitems].e.ts; }
+      nitems++;
+    }
+  }
+
+  /* shepherd 0's process_name comes first, without a separating comma */
+  fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (size_t r = 0; r < trace_nrings; r++) {
+    if (TRACE_TID(r) == 0) {
+      fprintf(f,
+              "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,"
+              "\"args\":{\"name\":\"shepherd %u\"}}",
+              (r == 0) ? "" : ",\n",
+              (unsigned)TRACE_PID(r),
+              (unsigned)TRACE_PID(r));
+    }
+    fprintf(f,
+            ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,"
+            "\"args\":{\"name\":\"worker %u\"}}",
+            (unsigned)TRACE_PID(r),
+            (unsigned)TRACE_TID(r),
+            (unsigned)TRACE_TID(r));
+  }
+
+  /* runs, steals, and migrations: each ring's events are in order */
+  for (size_t i = 0; i < nitems; i++) {
+    trace_item_t const *it = &items[i];
+    char const *why = trace_stop_reason(it->e.type);
+
+    if ((why != NULL) && (i > 0) && (items[i - 1].ring == it->ring) &&
+        (items[i - 1].e.type == QT_TRACE_RUN) &&
+        (items[i - 1].e.arg == it->e.arg)) {
+      fprintf(f,
+              ",\n{\"name\":\"task\",\"ph\":\"X\",\"pid\":%u,\"tid\":%u,"
+              "\"ts\":%.3f,\"dur\":%.3f,"
+              "\"args\":{\"task\":\"%p\",\"until\":\"%s\"}}",
+              (unsigned)TRACE_PID(it->ring),
+              (unsigned)TRACE_TID(it->ring),
+              TRACE_US(items[i - 1].e.ts),
+              (double)(it->e.ts - items[i - 1].e.ts) / 1000.0,
+              (void *)it->e.arg,
+              why);
+    }
+    if (it->e.type == QT_TRACE_STEAL || it->e.type == QT_TRACE_MIGRATE) {
+      fprintf(f,
+              ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%u,"
+              "\"tid\":%u,\"ts\":%.3f,\"args\":{\"%s\":%lu,\"%s\":%u}}",
+              (it->e.type == QT_TRACE_STEAL) ? "steal" : "migrate",
+              (unsigned)TRACE_PID(it->ring),
+              (unsigned)TRACE_TID(it->ring),
+              TRACE_US(it->e.ts),
+              (it->e.type == QT_TRACE_STEAL) ? "tasks" : "task",
+              (unsigned long)it->e.arg,
+              (it->e.type == QT_TRACE_STEAL) ? "victim" : "to",
+              (unsigned)it->e.aux);
+    }
+  }
+
+  /* blocked spans: from a task's FEB/queue/team/syscall wait to its next run,
+   * which may be on any worker */
+  qsort(items, nitems, sizeof(trace_item_t), trace_item_cmp);
+  while (open_mask < 2 * nitems) { open_mask <<= 1; }
+  open = qt_calloc(open_mask, sizeof(trace_open_t));
+  assert(open);
+  open_mask--;
+  for (size_t i = 0; i < nitems; i++) {
+    trace_item_t const *it = &items[i];
+    trace_open_t *o;
+
+    switch (it->e.type) {
+      case QT_TRACE_FEB_BLOCK:
+      case QT_TRACE_QUEUE_BLOCK:
+      case QT_TRACE_PARENT_BLOCK:
+      case QT_TRACE_SYSCALL:
+        trace_open_find(open, open_mask, it->e.arg, 1)->block = it;
+        break;
+      case QT_TRACE_RUN:
+        o = trace_open_find(open, open_mask, it->e.arg, 0);
+        if (o && o->block) {
+          char const *why = trace_stop_reason(o->block->e.type);
+          unsigned const pid = (unsigned)TRACE_PID(o->block->ring);
+          unsigned const tid = (unsigned)TRACE_TID(o->block->ring);
+
+          fprintf(f,
+                  ",\n{\"name\":\"%s\",\"cat\":\"blocked\",\"ph\":\"b\","
+                  "\"id\":\"%p\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f}",
+                  why,
+                  (void *)it->e.arg,
+                  pid,
+                  tid,
+                  TRACE_US(o->block->e.ts));
+          fprintf(f,
+                  ",\n{\"name\":\"%s\",\"cat\":\"blocked\",\"ph\":\"e\","
+                  "\"id\":\"%p\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f}",
+                  why,
+                  (void *)it->e.arg,
+                  pid,
+                  tid,
+                  TRACE_US(it->e.ts));
+          o->block = NULL;
+        }
+        break;
+      default: break;
+    }
+  }
+  fprintf(f, "\n]}\n");
+  fclose(f);
+  qt_free(open);
+  qt_free(items);
+  return QTHREAD_SUCCESS;
+}
+
+static void qt_trace_subsystem_shutdown(void) {
+  qt_trace_enabled = 0;
+  if (qthread_trace_dump(NULL) != QTHREAD_SUCCESS) {
+    fprintf(stderr, "qthreads: could not write trace to %s\n", trace_filename);
+  }
+  for (size_t r = 0; r < trace_nrings; r++) {
+    qt_free(qt_trace_rings[r].events);
+  }
+  qt_internal_aligned_free(qt_trace_rings, CACHELINE_WIDTH);
+  qt_trace_rings = NULL;
+  qt_free(trace_filename);
+  trace_filename = NULL;
+}
+
+void INTERNAL qt_trace_subsystem_init(void) {
+  char const *filename = qt_internal_get_env_str("TRACE", NULL);
+  size_t events;
+
+  if ((filename == NULL) || (*filename == 0)) { return; }
+  events = qt_internal_get_env_num("TRACE_EVENTS", 1 << 16, 1 << 16);
+  /* round up to a power of two */
+  {
+    size_t e = 1;
+    while (e < events) { e <<= 1; }
+    events = e;
+  }
+  trace_filename = qt_malloc(strlen(filename) + 1);
+  assert(trace_filename);
+  memcpy(trace_filename, filename, strlen(filename) + 1);
+  trace_nrings = qlib->nshepherds * qlib->nworkerspershep;
+  qt_trace_rings = qt_internal_aligned_alloc(
+    sizeof(qt_trace_ring_t) * trace_nrings, CACHELINE_WIDTH);
+  assert(qt_trace_rings);
+  for (size_t r = 0; r < trace_nrings; r++) {
+    qt_trace_rings[r].events = qt_malloc(sizeof(qt_trace_event_t) * events);
+    assert(qt_trace_rings[r].events);
+    qt_trace_rings[r].mask = events - 1;
+    atomic_init(&qt_trace_rings[r].head, 0);
+  }
+  qt_trace_enabled = 1;
+  qthread_internal_cleanup(qt_trace_subsystem_shutdown);
+}
+
+/* vim:set expandtab: */
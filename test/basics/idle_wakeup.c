@@ -0,0 +1,74 @@
+#include "argparsing.h"
+#include "qthread/qthread.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define ROUNDS 20
+
+static aligned_t x;
+static aligned_t done;
+static aligned_t forked[ROUNDS];
+
+static aligned_t waiter(void *arg) {
+  aligned_t sum = 0, v;
+
+  for (int i = 0; i < ROUNDS; i++) {
+    qthread_readFE(&v, &x);
+    sum += v;
+  }
+  return sum;
+}
+
+static aligned_t child(void *arg) { return (aligned_t)(uintptr_t)arg; }
+
+/* Everything is idle for long enough that every worker parks before each
+ * wake-up: both filling an FEB and forking from outside the runtime have to
+ * get a parked worker going again. */
+static void *external_thread(void *junk) {
+  for (int i = 0; i < ROUNDS; i++) {
+    usleep(2000);
+    qthread_writeEF_const(&x, 1);
+    usleep(2000);
+    qthread_fork(child, (void *)(uintptr_t)i, &forked[i]);
+  }
+  qthread_writeEF_const(&done, 1);
+  return NULL;
+}
+
+int setenv(char const *name, char const *value, int overwrite);
+
+int main(int argc, char *argv[]) {
+  pthread_t external;
+  aligned_t ret;
+
+  setenv("QT_IDLE_PARK", "1", 1);
+  setenv("QT_IDLE_SPIN", "1", 1);
+  test_check(qthread_initialize() == 0);
+  CHECK_VERBOSE();
+  iprintf("%i shepherds, %i workers\n",
+          qthread_num_shepherds(),
+          qthread_num_workers());
+
+  qthread_empty(&x);
+  qthread_empty(&done);
+  qthread_fork(waiter, NULL, &ret);
+  pthread_create(&external, NULL, external_thread, NULL);
+  qthread_readFF(NULL, &ret);
+  test_check(ret == ROUNDS);
+  /* FEB operations from outside the runtime are carried out by qthreads, so
+   * wait for the external thread without tying up this worker */
+  qthread_readFF(NULL, &done);
+  pthread_join(external, NULL);
+  for (int i = 0; i < ROUNDS; i++) {
+    aligned_t v;
+    qthread_readFF(&v, &forked[i]);
+    test_check(v == (aligned_t)i);
+  }
+  iprintf("success\n");
+
+  return 0;
+}
+
+/* vim:set expandtab */
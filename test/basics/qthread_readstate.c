@@ -71,6 +71,7 @@ int main(int argc, char *argv[]) {
   TEST_OPTION(CURRENT_UNIQUE_WORKER, ==, 0); // maybe this will change someday
   TEST_OPTION(CURRENT_TEAM, ==, QTHREAD_DEFAULT_TEAM_ID);
   TEST_OPTION(PARENT_TEAM, ==, QTHREAD_NON_TEAM_ID);
+  TEST_OPTION(STACK_PEAK, ==, 0); // main runs on the pthread stack
 
   return EXIT_SUCCESS;
 }
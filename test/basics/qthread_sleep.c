@@ -0,0 +1,145 @@
+#include "argparsing.h"
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MS 1000000ull
+#define SLEEPERS 256
+#define RACERS 64
+#define SLACK 1e-6 /* for the resolution of qtimer */
+
+static aligned_t slept_ok = 0;
+static aligned_t racers_woken = 0;
+static aligned_t racers_timed_out = 0;
+static aligned_t feb;
+static syncvar_t sv = SYNCVAR_EMPTY_INITIALIZER;
+
+static aligned_t sleeper(void *arg) {
+  uint64_t const ns = (uintptr_t)arg;
+  qtimer_t t = qtimer_create();
+
+  qtimer_start(t);
+  test_check(qthread_sleep_ns(ns) == QTHREAD_SUCCESS);
+  qtimer_stop(t);
+  if (qtimer_secs(t) + SLACK >= ns * 1e-9) { qthread_incr(&slept_ok, 1); }
+  qtimer_destroy(t);
+  return 0;
+}
+
+static aligned_t late_filler(void *arg) {
+  qthread_sleep_ns(5 * MS);
+  qthread_writeF_const(&feb, (aligned_t)(uintptr_t)arg);
+  return 0;
+}
+
+static aligned_t late_syncvar_filler(void *arg) {
+  qthread_sleep_ns(5 * MS);
+  qthread_syncvar_writeF_const(&sv, (uint64_t)(uintptr_t)arg);
+  return 0;
+}
+
+/* waits for feb with a deadline close to when it is filled */
+static aligned_t racer(void *arg) {
+  aligned_t v = 0;
+  int const ret = qthread_readFF_timed(&v, &feb, 2 * MS);
+
+  if (ret == QTHREAD_SUCCESS) {
+    test_check(v == 7);
+    qthread_incr(&racers_woken, 1);
+  } else {
+    test_check(ret == QTHREAD_TIMEOUT);
+    test_check(v == 0);
+    qthread_incr(&racers_timed_out, 1);
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  aligned_t rets[SLEEPERS];
+  aligned_t v, done;
+  uint64_t u;
+  qtimer_t t = qtimer_create();
+
+  test_check(qthread_initialize() == 0);
+  CHECK_VERBOSE();
+
+  /* a plain sleep takes at least as long as asked for */
+  qtimer_start(t);
+  test_check(qthread_sleep_ns(20 * MS) == QTHREAD_SUCCESS);
+  qtimer_stop(t);
+  iprintf("slept for %f secs\n", qtimer_secs(t));
+  test_check(qtimer_secs(t) + SLACK >= 0.020);
+
+  /* many sleepers at once, due at different times, all wake */
+  for (int i = 0; i < SLEEPERS; i++) {
+    qthread_fork(sleeper, (void *)(uintptr_t)((i % 16 + 1) * MS), &rets[i]);
+  }
+  for (int i = 0; i < SLEEPERS; i++) { qthread_readFF(NULL, &rets[i]); }
+  test_check(slept_ok == SLEEPERS);
+
+  /* a timed read of an empty FEB times out, and leaves it as it was */
+  qthread_empty(&feb);
+  v = 12345;
+  qtimer_start(t);
+  test_check(qthread_readFF_timed(&v, &feb, 10 * MS) == QTHREAD_TIMEOUT);
+  qtimer_stop(t);
+  test_check(qtimer_secs(t) + SLACK >= 0.010);
+  test_check(v == 12345);
+  test_check(qthread_readFE_timed(&v, &feb, MS) == QTHREAD_TIMEOUT);
+  test_check(qthread_feb_status(&feb) == 0);
+  test_check(v == 12345);
+
+  /* ...and one that is filled in time gets the value */
+  qthread_fork(late_filler, (void *)42, &done);
+  test_check(qthread_readFF_timed(&v, &feb, 10000 * MS) == QTHREAD_SUCCESS);
+  test_check(v == 42);
+  qthread_readFF(NULL, &done);
+
+  /* writeEF on a full FEB times out without writing */
+  test_check(qthread_feb_status(&feb) == 1);
+  v = 99;
+  test_check(qthread_writeEF_timed(&feb, &v, MS) == QTHREAD_TIMEOUT);
+  test_check(qthread_feb_status(&feb) == 1);
+  test_check(qthread_readFE_timed(&v, &feb, MS) == QTHREAD_SUCCESS);
+  test_check(v == 42);
+  v = 43;
+  test_check(qthread_writeEF_timed(&feb, &v, MS) == QTHREAD_SUCCESS);
+  test_check(qthread_readFF_timed(&v, &feb, MS) == QTHREAD_SUCCESS);
+  test_check(v == 43);
+
+  /* waiters whose deadlines race a fill either time out or get the value */
+  qthread_empty(&feb);
+  for (int i = 0; i < RACERS; i++) { qthread_fork(racer, NULL, &rets[i]); }
+  qthread_sleep_ns(2 * MS);
+  qthread_writeF_const(&feb, 7);
+  for (int i = 0; i < RACERS; i++) { qthread_readFF(NULL, &rets[i]); }
+  iprintf("%lu racers woken, %lu timed out\n",
+          (unsigned long)racers_woken,
+          (unsigned long)racers_timed_out);
+  test_check(racers_woken + racers_timed_out == RACERS);
+  test_check(qthread_feb_status(&feb) == 1);
+
+  /* the same for syncvars */
+  test_check(qthread_syncvar_readFF_timed(&u, &sv, MS) == QTHREAD_TIMEOUT);
+  test_check(qthread_syncvar_readFE_timed(&u, &sv, MS) == QTHREAD_TIMEOUT);
+  test_check(qthread_syncvar_status(&sv) == 0);
+  qthread_fork(late_syncvar_filler, (void *)17, &done);
+  test_check(qthread_syncvar_readFF_timed(&u, &sv, 10000 * MS) ==
+             QTHREAD_SUCCESS);
+  test_check(u == 17);
+  qthread_readFF(NULL, &done);
+  u = 18;
+  test_check(qthread_syncvar_writeEF_timed(&sv, &u, MS) == QTHREAD_TIMEOUT);
+  test_check(qthread_syncvar_readFE_timed(&u, &sv, MS) == QTHREAD_SUCCESS);
+  test_check(u == 17);
+  u = 19;
+  test_check(qthread_syncvar_writeEF_timed(&sv, &u, MS) == QTHREAD_SUCCESS);
+  test_check(qthread_syncvar_readFF(&u, &sv) == QTHREAD_SUCCESS);
+  test_check(u == 19);
+
+  qtimer_destroy(t);
+  return 0;
+}
+
+/* vim:set expandtab */
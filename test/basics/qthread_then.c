@@ -0,0 +1,79 @@
+#include "argparsing.h"
+#include <qthread/qthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHAIN 10000
+#define FANIN 16
+
+static aligned_t chain[CHAIN + 1];
+static aligned_t leaves[FANIN];
+
+static aligned_t seed(void *arg) { return 1; }
+
+/* arg is the predecessor's return location, which is full by now */
+static aligned_t plus_one(void *arg) { return *(aligned_t *)arg + 1; }
+
+static aligned_t leaf(void *arg) {
+  qthread_yield();
+  return (aligned_t)(uintptr_t)arg;
+}
+
+static aligned_t sum_leaves(void *arg) {
+  aligned_t sum = 0;
+
+  for (int i = 0; i < FANIN; i++) { sum += leaves[i]; }
+  return sum;
+}
+
+int main(int argc, char *argv[]) {
+  aligned_t *leafp[FANIN];
+  aligned_t v, ret;
+
+  test_check(qthread_initialize() == 0);
+  CHECK_VERBOSE();
+
+  /* a long chain: each continuation empties its result as it is spawned,
+   * so the next one can be attached to it right away */
+  test_check(qthread_fork(seed, NULL, &chain[0]) == QTHREAD_SUCCESS);
+  for (int i = 0; i < CHAIN; i++) {
+    test_check(qthread_then(&chain[i], plus_one, &chain[i], &chain[i + 1]) ==
+               QTHREAD_SUCCESS);
+  }
+  qthread_readFF(&ret, &chain[CHAIN]);
+  iprintf("chain of %i continuations returned %lu\n", CHAIN, (unsigned long)ret);
+  test_check(ret == CHAIN + 1);
+
+  /* a continuation on something that is written later */
+  qthread_empty(&v);
+  test_check(qthread_then(&v, plus_one, &v, &ret) == QTHREAD_SUCCESS);
+  qthread_writeF_const(&v, 41);
+  qthread_readFF(NULL, &ret);
+  test_check(ret == 42);
+
+  /* ...and on something that is already full */
+  test_check(qthread_then(&v, plus_one, &v, &ret) == QTHREAD_SUCCESS);
+  qthread_readFF(NULL, &ret);
+  test_check(ret == 42);
+
+  /* fan-in */
+  for (int i = 0; i < FANIN; i++) {
+    leafp[i] = &leaves[i];
+    test_check(qthread_fork(leaf, (void *)(uintptr_t)(i + 1), &leaves[i]) ==
+               QTHREAD_SUCCESS);
+  }
+  test_check(qthread_when_all(leafp, FANIN, sum_leaves, NULL, &ret) ==
+             QTHREAD_SUCCESS);
+  qthread_readFF(NULL, &ret);
+  iprintf("when_all of %i tasks returned %lu\n", FANIN, (unsigned long)ret);
+  test_check(ret == FANIN * (FANIN + 1) / 2);
+
+  /* with nothing to wait for, it is just a fork */
+  test_check(qthread_when_all(NULL, 0, seed, NULL, &ret) == QTHREAD_SUCCESS);
+  qthread_readFF(NULL, &ret);
+  test_check(ret == 1);
+
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -48,8 +48,14 @@ static aligned_t visit(void *arg_) {
     qt_sinc_submit(arg->sinc, NULL);
   } else {
     /* I'm a leaf node. */
-    my_value_t value = 1;
-    qt_sinc_submit(arg->sinc, &value);
+    if (qthread_id() & 1) {
+      my_value_t value = 1;
+      qt_sinc_submit(arg->sinc, &value);
+    } else {
+      /* the same, by way of this worker's own value */
+      *(my_value_t *)qt_sinc_tmpdata(arg->sinc) += 1;
+      qt_sinc_submit(arg->sinc, NULL);
+    }
   }
 
   return 0;
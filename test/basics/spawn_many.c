@@ -0,0 +1,109 @@
+#include "argparsing.h"
+#include <qthread/qthread.h>
+#include <qthread/sinc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define COUNT 1000
+
+static aligned_t counter;
+
+static aligned_t double_it(void *arg) { return *(aligned_t *)arg * 2; }
+
+static aligned_t count_it(void *arg) {
+  test_check(arg == &counter);
+  qthread_incr(&counter, 1);
+  return 0;
+}
+
+static aligned_t where_am_i(void *arg) { return qthread_shep(); }
+
+static void add(void *tgt, void const *src) {
+  *(aligned_t *)tgt += *(aligned_t const *)src;
+}
+
+int main(int argc, char *argv[]) {
+  aligned_t args[COUNT];
+  aligned_t rets[COUNT];
+  syncvar_t svrets[COUNT];
+  qthread_shepherd_id_t target;
+
+  test_check(qthread_initialize() == 0);
+  target = qthread_num_shepherds() - 1;
+  CHECK_VERBOSE();
+  iprintf("%i shepherds, %i workers\n",
+          qthread_num_shepherds(),
+          qthread_num_workers());
+
+  /* copied arguments, aligned_t returns */
+  for (int i = 0; i < COUNT; i++) { args[i] = i; }
+  test_check(qthread_spawn_many(double_it,
+                                args,
+                                sizeof(aligned_t),
+                                rets,
+                                COUNT,
+                                NO_SHEPHERD,
+                                0) == QTHREAD_SUCCESS);
+  for (int i = 0; i < COUNT; i++) {
+    aligned_t v;
+    qthread_readFF(&v, &rets[i]);
+    test_check(v == (aligned_t)(2 * i));
+  }
+  iprintf("copied arguments: ok\n");
+
+  /* a shared argument and no return values, spread over the shepherds */
+  test_check(qthread_spawn_many(count_it,
+                                &counter,
+                                0,
+                                NULL,
+                                COUNT,
+                                NO_SHEPHERD,
+                                QTHREAD_SPAWN_SPREAD | QTHREAD_SPAWN_SIMPLE) ==
+             QTHREAD_SUCCESS);
+  while (qthread_incr(&counter, 0) != COUNT) { qthread_yield(); }
+  iprintf("spread: ok\n");
+
+  /* syncvar returns on a given shepherd */
+  for (int i = 0; i < COUNT; i++) { svrets[i] = SYNCVAR_EMPTY_INITIALIZER; }
+  test_check(qthread_spawn_many(where_am_i,
+                                NULL,
+                                0,
+                                svrets,
+                                COUNT,
+                                target,
+                                QTHREAD_SPAWN_RET_SYNCVAR_T) ==
+             QTHREAD_SUCCESS);
+  for (int i = 0; i < COUNT; i++) {
+    uint64_t v;
+    qthread_syncvar_readFF(&v, &svrets[i]);
+    test_check(v == target);
+  }
+  iprintf("targeted: ok\n");
+
+  /* every return value reduced into one sinc */
+  {
+    aligned_t const zero = 0;
+    aligned_t sum;
+    qt_sinc_t *sinc = qt_sinc_create(sizeof(aligned_t), &zero, add, COUNT);
+
+    test_check(qthread_spawn_many(double_it,
+                                  args,
+                                  sizeof(aligned_t),
+                                  sinc,
+                                  COUNT,
+                                  NO_SHEPHERD,
+                                  QTHREAD_SPAWN_RET_SINC) == QTHREAD_SUCCESS);
+    qt_sinc_wait(sinc, &sum);
+    test_check(sum == (aligned_t)COUNT * (COUNT - 1));
+    qt_sinc_destroy(sinc);
+  }
+  iprintf("sinc: ok\n");
+
+  /* nothing to do */
+  test_check(qthread_spawn_many(double_it, NULL, 0, NULL, 0, NO_SHEPHERD, 0) ==
+             QTHREAD_SUCCESS);
+
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -0,0 +1,96 @@
+#include "argparsing.h"
+#include <qthread/qt_syscalls.h>
+#include <qthread/qthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define BLOCK_SIZE 64u
+#define NUM_BLOCKS 128u
+
+static int fd;
+static int pipefds[2];
+
+static aligned_t block_writer(void *arg) {
+  unsigned block = (unsigned)(uintptr_t)arg;
+  char buf[BLOCK_SIZE];
+  ssize_t ret;
+
+  memset(buf, 'a' + (block % 26), BLOCK_SIZE);
+  ret = qt_pwrite(fd, buf, BLOCK_SIZE, (off_t)block * BLOCK_SIZE);
+  test_check(ret == BLOCK_SIZE);
+  return 0;
+}
+
+static aligned_t block_reader(void *arg) {
+  unsigned block = (unsigned)(uintptr_t)arg;
+  char buf[BLOCK_SIZE];
+  ssize_t ret;
+
+  ret = qt_pread(fd, buf, BLOCK_SIZE, (off_t)block * BLOCK_SIZE);
+  test_check(ret == BLOCK_SIZE);
+  for (unsigned i = 0; i < BLOCK_SIZE; i++) {
+    test_check(buf[i] == 'a' + (char)(block % 26));
+  }
+  return 0;
+}
+
+static aligned_t pipe_reader(void *arg) {
+  char buf[6];
+  ssize_t ret;
+
+  memset(buf, 0, sizeof(buf));
+  /* blocks until pipe_writer gets its turn */
+  ret = qt_read(pipefds[0], buf, 5);
+  iprintf("read '%s' from pipe\n", buf);
+  test_check(ret == 5);
+  test_check(strcmp(buf, "hello") == 0);
+  return 0;
+}
+
+static aligned_t pipe_writer(void *arg) {
+  ssize_t ret = qt_write(pipefds[1], "hello", 5);
+  test_check(ret == 5);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  char filename[] = "test_qthread_syscall_io.XXXXXX";
+  aligned_t rets[NUM_BLOCKS];
+  aligned_t pr, pw;
+
+  test_check(qthread_initialize() == 0);
+  CHECK_VERBOSE();
+
+  fd = mkstemp(filename);
+  if (fd < 0) { perror("mkstemp failed"); }
+  test_check(fd >= 0);
+  test_check(pipe(pipefds) == 0);
+
+  for (unsigned i = 0; i < NUM_BLOCKS; i++) {
+    qthread_fork(block_writer, (void *)(uintptr_t)i, &rets[i]);
+  }
+  for (unsigned i = 0; i < NUM_BLOCKS; i++) { qthread_readFF(NULL, &rets[i]); }
+  iprintf("wrote %u blocks\n", NUM_BLOCKS);
+
+  for (unsigned i = 0; i < NUM_BLOCKS; i++) {
+    qthread_fork(block_reader, (void *)(uintptr_t)i, &rets[i]);
+  }
+  for (unsigned i = 0; i < NUM_BLOCKS; i++) { qthread_readFF(NULL, &rets[i]); }
+  iprintf("read back %u blocks\n", NUM_BLOCKS);
+
+  qthread_fork(pipe_reader, NULL, &pr);
+  qthread_fork(pipe_writer, NULL, &pw);
+  qthread_readFF(NULL, &pw);
+  qthread_readFF(NULL, &pr);
+
+  close(pipefds[0]);
+  close(pipefds[1]);
+  close(fd);
+  unlink(filename);
+
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -0,0 +1,78 @@
+#include "argparsing.h"
+#include <qthread/qthread.h>
+#include <qthread/tls.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NTASKS 100
+#define NKEYS 40 /* more than fit in a task's inline slots */
+
+static qthread_key_t keys[NKEYS];
+static aligned_t destroyed;
+
+static void destructor(void *value) {
+  test_check(value != NULL);
+  qthread_incr(&destroyed, 1);
+}
+
+static aligned_t use_keys(void *arg) {
+  uintptr_t const me = (uintptr_t)arg;
+
+  for (int i = 0; i < NKEYS; i++) {
+    test_check(qthread_getspecific(keys[i]) == NULL);
+  }
+  for (int i = 0; i < NKEYS; i++) {
+    test_check(qthread_setspecific(keys[i], (void *)(me * NKEYS + i + 1)) ==
+               QTHREAD_SUCCESS);
+  }
+  qthread_yield();
+  for (int i = 0; i < NKEYS; i++) {
+    test_check(qthread_getspecific(keys[i]) == (void *)(me * NKEYS + i + 1));
+  }
+  /* NULL values are not destroyed */
+  test_check(qthread_setspecific(keys[0], NULL) == QTHREAD_SUCCESS);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  aligned_t rets[NTASKS];
+  qthread_key_t reused;
+
+  test_check(qthread_initialize() == 0);
+  CHECK_VERBOSE();
+
+  for (int i = 0; i < NKEYS; i++) {
+    test_check(qthread_key_create(&keys[i], destructor) == QTHREAD_SUCCESS);
+    for (int j = 0; j < i; j++) { test_check(keys[i] != keys[j]); }
+  }
+  iprintf("created %i keys\n", NKEYS);
+
+  for (uintptr_t i = 0; i < NTASKS; i++) {
+    qthread_fork(use_keys, (void *)i, &rets[i]);
+  }
+  for (int i = 0; i < NTASKS; i++) { qthread_readFF(NULL, &rets[i]); }
+
+  /* destructors run once a task's resources are released, which may be a
+   * little after its return value has been written */
+  while (qthread_incr(&destroyed, 0) < NTASKS * (NKEYS - 1)) {
+    qthread_yield();
+  }
+  test_check(destroyed == NTASKS * (NKEYS - 1));
+  iprintf("ran %lu destructors\n", (unsigned long)destroyed);
+
+  /* the main task has values too, and a deleted key's values are gone even
+   * if its index is reused */
+  test_check(qthread_setspecific(keys[1], &destroyed) == QTHREAD_SUCCESS);
+  test_check(qthread_getspecific(keys[1]) == &destroyed);
+  test_check(qthread_key_delete(keys[1]) == QTHREAD_SUCCESS);
+  test_check(qthread_key_delete(keys[1]) != QTHREAD_SUCCESS);
+  test_check(qthread_setspecific(keys[1], &destroyed) != QTHREAD_SUCCESS);
+  test_check(qthread_key_create(&reused, NULL) == QTHREAD_SUCCESS);
+  test_check(reused == keys[1]);
+  test_check(qthread_getspecific(reused) == NULL);
+  iprintf("deleted and reused a key\n");
+
+  return 0;
+}
+
+/* vim:set expandtab */
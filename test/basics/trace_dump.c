@@ -0,0 +1,64 @@
+#include "argparsing.h"
+#include <qthread/qthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static aligned_t x;
+
+static aligned_t reader(void *arg) {
+  aligned_t v;
+
+  qthread_readFF(&v, &x);
+  return v;
+}
+
+int setenv(char const *name, char const *value, int overwrite);
+
+int main(int argc, char *argv[]) {
+  char path[] = "/tmp/qt_trace_dump_XXXXXX";
+  char buf[1 << 16];
+  aligned_t ret;
+  size_t len;
+  FILE *f;
+  int fd;
+
+  CHECK_VERBOSE();
+  test_check(qthread_trace_dump(path) == QTHREAD_NOT_ALLOWED);
+  fd = mkstemp(path);
+  test_check(fd >= 0);
+  close(fd);
+  setenv("QT_TRACE", path, 1);
+  setenv("QT_TRACE_EVENTS", "200", 1);
+  setenv("QT_NUM_SHEPHERDS", "1", 1);
+  setenv("QT_NUM_WORKERS_PER_SHEPHERD", "1", 1);
+  test_check(qthread_initialize() == 0);
+
+  /* the reader blocks on x until we fill it */
+  qthread_empty(&x);
+  qthread_fork(reader, NULL, &ret);
+  qthread_yield();
+  qthread_writeEF_const(&x, 7);
+  qthread_readFF(NULL, &ret);
+  test_check(ret == 7);
+
+  test_check(qthread_trace_dump(path) == QTHREAD_SUCCESS);
+  f = fopen(path, "r");
+  test_check(f != NULL);
+  len = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[len] = 0;
+  iprintf("%s", buf);
+  test_check(strncmp(buf, "{\"displayTimeUnit\"", 18) == 0);
+  test_check(strstr(buf, "\"ph\":\"X\"") != NULL);
+  test_check(strstr(buf, "\"FEB wait\",\"cat\":\"blocked\",\"ph\":\"b\"") !=
+             NULL);
+  test_check(strcmp(buf + len - 3, "]}\n") == 0);
+
+  qthread_finalize();
+  unlink(path);
+  return 0;
+}
+
+/* vim:set expandtab */
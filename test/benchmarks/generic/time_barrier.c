@@ -0,0 +1,79 @@
+#include "argparsing.h"
+#include <assert.h>
+#include <qthread/barrier.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures qt_barrier latency, for whichever implementation the library was
+// built with (QTHREADS_BARRIER): groups of 1, 2, 4, ... tasks, up to the
+// number of workers and then on to OVERSUBSCRIBE times as many, spread over
+// the shepherds, each enter the same barrier EPISODES times in a row with
+// nothing in between, so that the time per episode is the barrier's own.
+
+static size_t EPISODES = 10000;
+static size_t OVERSUBSCRIBE = 4;
+
+static qt_barrier_t *barrier;
+
+static aligned_t participant(void *arg) {
+  size_t const id = (uintptr_t)arg;
+
+  for (size_t e = 0; e < EPISODES; e++) { qt_barrier_enter_id(barrier, id); }
+  return 0;
+}
+
+static double run_episodes(size_t participants) {
+  qtimer_t timer = qtimer_create();
+  aligned_t *rets = malloc(participants * sizeof(aligned_t));
+  qthread_shepherd_id_t const sheps = qthread_num_shepherds();
+  double secs;
+
+  assert(rets);
+  barrier = qt_barrier_create(participants, REGION_BARRIER);
+  assert(barrier);
+  qtimer_start(timer);
+  for (size_t i = 1; i < participants; i++) {
+    qthread_fork_to(participant,
+                    (void *)(uintptr_t)i,
+                    &rets[i],
+                    (qthread_shepherd_id_t)(i % sheps));
+  }
+  participant((void *)(uintptr_t)0);
+  for (size_t i = 1; i < participants; i++) { qthread_readFF(NULL, &rets[i]); }
+  qtimer_stop(timer);
+  secs = qtimer_secs(timer);
+  qt_barrier_destroy(barrier);
+  qtimer_destroy(timer);
+  free(rets);
+  return secs;
+}
+
+int main(int argc, char *argv[]) {
+  size_t workers;
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(EPISODES, "EPISODES");
+  NUMARG(OVERSUBSCRIBE, "OVERSUBSCRIBE");
+  workers = qthread_num_workers();
+  printf("%u shepherds, %zu workers, %zu episodes\n",
+         (unsigned)qthread_num_shepherds(),
+         workers,
+         EPISODES);
+
+  /* once untimed, so that nobody pays for filling the qthread pools */
+  run_episodes(workers);
+  for (size_t p = 1; p <= OVERSUBSCRIBE * workers; p *= 2) {
+    double const secs = run_episodes(p);
+
+    printf("\t%4zu tasks: %f secs, %9.1f ns/episode\n",
+           p,
+           secs,
+           secs * 1e9 / EPISODES);
+  }
+  return 0;
+}
+
+/* vim:set expandtab */
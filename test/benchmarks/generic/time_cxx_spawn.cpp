@@ -0,0 +1,190 @@
+#include "argparsing.h"
+#include <assert.h>
+#include <qthread/qloop.hpp>
+#include <qthread/qthread.hpp>
+#include <qthread/qtimer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <functional>
+#include <new>
+#include <vector>
+
+// Compares qthread::spawn() with the C API it sits on, for TASKS tasks that
+// each add up three captured values: qthread_fork() with arguments kept by
+// the caller, qthread_fork_copyargs(), and what C++ callers did before,
+// allocating a std::function and passing it through qthread_fork(). It also
+// counts the heap allocations that each one makes, and compares
+// qthread::parallel_for() over a vector with qt_loop_balance().
+
+static size_t TASKS = 1000000;
+static size_t ELEMENTS = 1 << 24;
+
+static std::atomic<size_t> allocations(0);
+
+void *operator new(size_t size) {
+  void *p = malloc(size);
+
+  allocations++;
+  if (p == NULL) { throw std::bad_alloc(); }
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+struct three {
+  aligned_t a, b, c;
+};
+
+static aligned_t add_three(void *arg) {
+  three const *t = (three const *)arg;
+
+  return t->a + t->b + t->c;
+}
+
+static aligned_t call_function(void *arg) {
+  std::function<aligned_t()> *f = (std::function<aligned_t()> *)arg;
+  aligned_t const r = (*f)();
+
+  delete f;
+  return r;
+}
+
+static void report(char const *name, qtimer_t timer, size_t allocs) {
+  printf("\t%-28s %f secs, %7.1f ns/task, %.2f allocations/task\n",
+         name,
+         qtimer_secs(timer),
+         qtimer_secs(timer) * 1e9 / TASKS,
+         (double)allocs / TASKS);
+}
+
+static aligned_t check(aligned_t const *rets) {
+  aligned_t sum = 0;
+
+  for (size_t i = 0; i < TASKS; i++) { sum += rets[i]; }
+  return sum;
+}
+
+static void scale(size_t const startat, size_t const stopat, void *arg) {
+  double *v = (double *)arg;
+
+  for (size_t i = startat; i < stopat; i++) { v[i] = v[i] * 1.5 + 1; }
+}
+
+int main(int argc, char *argv[]) {
+  qtimer_t timer = qtimer_create();
+  aligned_t *rets;
+  three *args;
+  aligned_t expect = 0;
+  size_t allocs;
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(TASKS, "TASKS");
+  NUMARG(ELEMENTS, "ELEMENTS");
+  printf("%u shepherds, %u workers, %zu tasks\n",
+         (unsigned)qthread_num_shepherds(),
+         (unsigned)qthread_num_workers(),
+         TASKS);
+
+  rets = (aligned_t *)malloc(TASKS * sizeof(aligned_t));
+  args = (three *)malloc(TASKS * sizeof(three));
+  assert(rets && args);
+  for (size_t i = 0; i < TASKS; i++) {
+    args[i].a = i;
+    args[i].b = 2 * i;
+    args[i].c = 3;
+    expect += 3 * i + 3;
+  }
+
+  /* once untimed, so that nobody pays for filling the qthread pools */
+  for (size_t i = 0; i < TASKS; i++) {
+    qthread_fork(add_three, &args[i], &rets[i]);
+  }
+  for (size_t i = 0; i < TASKS; i++) { qthread_readFF(NULL, &rets[i]); }
+
+  allocs = allocations;
+  qtimer_start(timer);
+  for (size_t i = 0; i < TASKS; i++) {
+    qthread_fork(add_three, &args[i], &rets[i]);
+  }
+  for (size_t i = 0; i < TASKS; i++) { qthread_readFF(NULL, &rets[i]); }
+  qtimer_stop(timer);
+  assert(check(rets) == expect);
+  report("qthread_fork", timer, allocations - allocs);
+
+  allocs = allocations;
+  qtimer_start(timer);
+  for (size_t i = 0; i < TASKS; i++) {
+    three const t = {i, 2 * i, 3};
+    qthread_fork_copyargs(add_three, &t, sizeof(t), &rets[i]);
+  }
+  for (size_t i = 0; i < TASKS; i++) { qthread_readFF(NULL, &rets[i]); }
+  qtimer_stop(timer);
+  assert(check(rets) == expect);
+  report("qthread_fork_copyargs", timer, allocations - allocs);
+
+  allocs = allocations;
+  qtimer_start(timer);
+  for (size_t i = 0; i < TASKS; i++) {
+    aligned_t const a = i, b = 2 * i, c = 3;
+    std::vector<char> pad(0); // what a capture by value might hold
+    qthread_fork(call_function,
+                 new std::function<aligned_t()>([a, b, c, pad] {
+                   return a + b + c + pad.size();
+                 }),
+                 &rets[i]);
+  }
+  for (size_t i = 0; i < TASKS; i++) { qthread_readFF(NULL, &rets[i]); }
+  qtimer_stop(timer);
+  assert(check(rets) == expect);
+  report("new std::function + fork", timer, allocations - allocs);
+
+  {
+    std::vector<qthread::future<aligned_t>> futures;
+
+    futures.reserve(TASKS);
+    allocs = allocations;
+    qtimer_start(timer);
+    for (size_t i = 0; i < TASKS; i++) {
+      aligned_t const a = i, b = 2 * i, c = 3;
+      std::vector<char> pad(0);
+      futures.push_back(qthread::spawn(
+        [a, b, c, pad] { return a + b + c + (aligned_t)pad.size(); }));
+    }
+    for (size_t i = 0; i < TASKS; i++) { rets[i] = futures[i].get(); }
+    qtimer_stop(timer);
+    assert(check(rets) == expect);
+    report("qthread::spawn", timer, allocations - allocs);
+  }
+
+  {
+    std::vector<double> v(ELEMENTS, 1.0);
+
+    qtimer_start(timer);
+    qt_loop_balance(0, ELEMENTS, scale, v.data());
+    qtimer_stop(timer);
+    printf("\t%-28s %f secs for %zu elements\n",
+           "qt_loop_balance",
+           qtimer_secs(timer),
+           ELEMENTS);
+    qtimer_start(timer);
+    qthread::parallel_for(
+      v.begin(), v.end(), [](double &x) { x = x * 1.5 + 1; });
+    qtimer_stop(timer);
+    printf("\t%-28s %f secs for %zu elements\n",
+           "qthread::parallel_for",
+           qtimer_secs(timer),
+           ELEMENTS);
+  }
+
+  free(rets);
+  free(args);
+  qtimer_destroy(timer);
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -9,6 +9,7 @@
 size_t TEST_SELECTION = 0xffffffff;
 size_t ITERATIONS = 100000;
 size_t MAXPARALLELISM = 256;
+size_t NUMADDRS = 1 << 16;
 aligned_t incrementme = 0;
 aligned_t *increments = NULL;
 
@@ -65,6 +66,22 @@ balanced_noncomp_readFF(size_t const startat, size_t const stopat, void *arg) {
   for (i = startat; i < stopat; i++) { qthread_readFF(NULL, &myinc); }
 }
 
+static void balanced_highcard_readFE_writeEF(size_t const startat,
+                                             size_t const stopat,
+                                             void *arg) {
+  size_t i;
+  aligned_t *addrs = (aligned_t *)arg;
+
+  for (i = startat; i < stopat; i++) {
+    aligned_t *addr = addrs + (i % NUMADDRS);
+    aligned_t tmp;
+
+    qthread_readFF(NULL, addr);
+    qthread_readFE(&tmp, addr);
+    qthread_writeEF_const(addr, tmp + 1);
+  }
+}
+
 static aligned_t justreturn(void *arg) { return 7; }
 
 static char *human_readable_rate(double rate) {
@@ -98,6 +115,7 @@ int main(int argc, char *argv[]) {
   NUMARG(ITERATIONS, "ITERATIONS");
   NUMARG(MAXPARALLELISM, "MAXPARALLELISM");
   NUMARG(TEST_SELECTION, "TEST_SELECTION");
+  NUMARG(NUMADDRS, "NUMADDRS");
   workers = qthread_num_workers();
   printf("%u threads...\n", workers);
   rets = malloc(sizeof(aligned_t) * MAXPARALLELISM);
@@ -336,6 +354,34 @@ int main(int argc, char *argv[]) {
            human_readable_rate(rate));
   }
 
+  if (TEST_SELECTION & (1 << 8)) {
+    /* HIGH CARDINALITY: many addresses, each rarely touched at the same time
+     * by more than one worker, so no one ever waits */
+    aligned_t *addrs = calloc(NUMADDRS, sizeof(aligned_t));
+    size_t const ops = ITERATIONS * MAXPARALLELISM * 3;
+    printf("\tBalanced high-cardinality readFF/FE/EF: ");
+    fflush(stdout);
+    assert(addrs);
+    /* prime it */
+    qt_loop_balance(
+      0, ITERATIONS * MAXPARALLELISM, balanced_highcard_readFE_writeEF, addrs);
+    /* time it */
+    qtimer_start(timer);
+    qt_loop_balance(
+      0, ITERATIONS * MAXPARALLELISM, balanced_highcard_readFE_writeEF, addrs);
+    qtimer_stop(timer);
+    free(addrs);
+
+    printf("%10g secs (%u-threads %u addrs %u ops)\n",
+           qtimer_secs(timer),
+           workers,
+           (unsigned)NUMADDRS,
+           (unsigned)ops);
+    iprintf("\t + average FEB op time: %26g secs\n",
+            qtimer_secs(timer) / ops);
+    printf("\t = FEB op throughput: %28f ops/sec\n", ops / qtimer_secs(timer));
+  }
+
   qtimer_destroy(timer);
   free(rets);
 
@@ -0,0 +1,165 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "argparsing.h"
+#include <assert.h>
+#include <qthread/qpool.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+// Measures how much of the memory the internal pools hand out is local to the
+// NUMA node of the task that asked for it, when objects are routinely freed on
+// another shepherd than the one that allocated them (as happens to task
+// structures, FEB records, and queue nodes in thread-ring and UTS style
+// workloads). Every round, each shepherd allocates and touches a batch of
+// objects, then passes them to the next shepherd over, which frees them.
+//
+// Run it with a shepherd per NUMA node or finer, e.g.
+//   QT_SHEPHERD_BOUNDARY=node ./time_mpool_numa
+// and compare against QT_MPOOL_NUMA=no. Without hwloc memory affinity the
+// pools are not NUMA-aware and both runs should look the same.
+
+static size_t ROUNDS = 200;
+static size_t BATCH = 4096;
+static size_t OBJSIZE = 64;
+
+static uintptr_t page_mask;
+static qpool *pool;
+static void ***slots;
+static aligned_t local_objs, remote_objs, unknown_objs;
+
+/* the NUMA node of the calling thread and of the page under each pointer */
+static int my_numa_node(void) {
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu, node;
+
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0) { return (int)node; }
+#endif
+  return -1;
+}
+
+static int page_numa_nodes(size_t n, void **pages, int *status) {
+#if defined(__linux__) && defined(SYS_move_pages)
+  /* with no target nodes, move_pages() only reports where pages are */
+  return (int)syscall(SYS_move_pages, 0, n, pages, NULL, status, 0);
+#else
+  return -1;
+#endif
+}
+
+static aligned_t alloc_batch(void *arg) {
+  void **mine = slots[(uintptr_t)arg];
+  int *status = malloc(BATCH * sizeof(int));
+  void **pages = malloc(BATCH * sizeof(void *));
+  int here;
+  aligned_t local = 0, remote = 0;
+
+  assert(status && pages);
+  for (size_t i = 0; i < BATCH; i++) {
+    mine[i] = qpool_alloc(pool);
+    assert(mine[i]);
+    memset(mine[i], 0x5a, OBJSIZE);
+    pages[i] = (void *)((uintptr_t)mine[i] & page_mask);
+  }
+  here = my_numa_node();
+  if ((here >= 0) && (page_numa_nodes(BATCH, pages, status) == 0)) {
+    for (size_t i = 0; i < BATCH; i++) {
+      if (status[i] == here) {
+        local++;
+      } else if (status[i] >= 0) {
+        remote++;
+      }
+    }
+    qthread_incr(&local_objs, local);
+    qthread_incr(&remote_objs, remote);
+    qthread_incr(&unknown_objs, BATCH - local - remote);
+  } else {
+    qthread_incr(&unknown_objs, BATCH);
+  }
+  free(pages);
+  free(status);
+  return 0;
+}
+
+static aligned_t free_batch(void *arg) {
+  void **theirs = slots[(uintptr_t)arg];
+
+  for (size_t i = 0; i < BATCH; i++) { qpool_free(pool, theirs[i]); }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  qtimer_t timer = qtimer_create();
+  qthread_shepherd_id_t nsheps;
+  aligned_t *rets;
+  double total;
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(ROUNDS, "ROUNDS");
+  NUMARG(BATCH, "BATCH");
+  NUMARG(OBJSIZE, "OBJSIZE");
+  nsheps = qthread_num_shepherds();
+  printf("%u shepherds, %u workers, %zu rounds of %zu %zu-byte objects\n",
+         (unsigned)nsheps,
+         (unsigned)qthread_num_workers(),
+         ROUNDS,
+         BATCH,
+         OBJSIZE);
+
+  page_mask = ~(uintptr_t)(sysconf(_SC_PAGESIZE) - 1);
+  pool = qpool_create(OBJSIZE);
+  slots = malloc(nsheps * sizeof(void **));
+  rets = malloc(nsheps * sizeof(aligned_t));
+  assert(pool && slots && rets);
+  for (qthread_shepherd_id_t s = 0; s < nsheps; s++) {
+    slots[s] = malloc(BATCH * sizeof(void *));
+    assert(slots[s]);
+  }
+
+  qtimer_start(timer);
+  for (size_t r = 0; r < ROUNDS; r++) {
+    for (qthread_shepherd_id_t s = 0; s < nsheps; s++) {
+      qthread_fork_to(alloc_batch, (void *)(uintptr_t)s, &rets[s], s);
+    }
+    for (qthread_shepherd_id_t s = 0; s < nsheps; s++) {
+      qthread_readFF(NULL, &rets[s]);
+    }
+    /* shepherd s frees what shepherd s+1 allocated */
+    for (qthread_shepherd_id_t s = 0; s < nsheps; s++) {
+      qthread_fork_to(
+        free_batch, (void *)(uintptr_t)((s + 1) % nsheps), &rets[s], s);
+    }
+    for (qthread_shepherd_id_t s = 0; s < nsheps; s++) {
+      qthread_readFF(NULL, &rets[s]);
+    }
+  }
+  qtimer_stop(timer);
+  total = qtimer_secs(timer);
+
+  printf("\ttime: %f secs, %f allocs+frees/sec\n",
+         total,
+         (double)(ROUNDS * nsheps * BATCH) / total);
+  printf("\tlocal objects: %lu (%.1f%%), remote: %lu (%.1f%%), unknown: %lu\n",
+         (unsigned long)local_objs,
+         100.0 * local_objs / (ROUNDS * nsheps * BATCH),
+         (unsigned long)remote_objs,
+         100.0 * remote_objs / (ROUNDS * nsheps * BATCH),
+         (unsigned long)unknown_objs);
+
+  for (qthread_shepherd_id_t s = 0; s < nsheps; s++) { free(slots[s]); }
+  free(slots);
+  free(rets);
+  qpool_destroy(pool);
+  qtimer_destroy(timer);
+  return 0;
+}
+
+/* vim:set expandtab */
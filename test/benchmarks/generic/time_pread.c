@@ -0,0 +1,104 @@
+#include "argparsing.h"
+#include <assert.h> /* for assert() */
+#include <fcntl.h>  /* for open() */
+#include <qthread/qt_syscalls.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <stdio.h>  /* for printf() */
+#include <stdlib.h> /* for strtol() */
+#include <unistd.h> /* for pwrite(), close(), unlink() */
+
+/* Many qthreads issuing qt_pread() against one local file at once. Run it
+ * twice, with QT_IO_URING=1 (the default) and QT_IO_URING=0, to compare the
+ * io_uring engine against the proxy-thread pool. */
+
+size_t CONCURRENCY = 4096;
+size_t ITERATIONS = 16;
+size_t BLOCKSIZE = 4096;
+size_t NUMBLOCKS = 1024;
+
+static int fd = -1;
+static aligned_t errors = 0;
+
+static aligned_t reader(void *arg) {
+  size_t id = (size_t)(uintptr_t)arg;
+  char *buf = malloc(BLOCKSIZE);
+
+  assert(buf);
+  for (size_t i = 0; i < ITERATIONS; i++) {
+    size_t block = (id * ITERATIONS + i) % NUMBLOCKS;
+    ssize_t ret = qt_pread(fd, buf, BLOCKSIZE, (off_t)(block * BLOCKSIZE));
+    if ((ret != (ssize_t)BLOCKSIZE) || (buf[0] != (char)block)) {
+      qthread_incr(&errors, 1);
+    }
+  }
+  free(buf);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  char filename[] = "time_pread.XXXXXX";
+  qtimer_t timer = qtimer_create();
+  aligned_t *rets;
+  char *block;
+  double secs;
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+
+  CHECK_VERBOSE();
+  NUMARG(CONCURRENCY, "CONCURRENCY");
+  NUMARG(ITERATIONS, "ITERATIONS");
+  NUMARG(BLOCKSIZE, "BLOCKSIZE");
+  NUMARG(NUMBLOCKS, "NUMBLOCKS");
+  assert(BLOCKSIZE > 0 && NUMBLOCKS > 0);
+
+  /* setup: NUMBLOCKS blocks, each filled with its own index */
+  fd = mkstemp(filename);
+  assert(fd >= 0);
+  block = malloc(BLOCKSIZE);
+  assert(block);
+  for (size_t i = 0; i < NUMBLOCKS; i++) {
+    memset(block, (char)i, BLOCKSIZE);
+    if (pwrite(fd, block, BLOCKSIZE, (off_t)(i * BLOCKSIZE)) !=
+        (ssize_t)BLOCKSIZE) {
+      perror("pwrite");
+      abort();
+    }
+  }
+  free(block);
+  fsync(fd);
+  rets = malloc(sizeof(aligned_t) * CONCURRENCY);
+  assert(rets);
+
+  printf("%u workers, %lu concurrent readers...\n",
+         (unsigned)qthread_num_workers(),
+         (unsigned long)CONCURRENCY);
+  qtimer_start(timer);
+  for (size_t i = 0; i < CONCURRENCY; i++) {
+    qthread_fork(reader, (void *)(uintptr_t)i, &rets[i]);
+  }
+  for (size_t i = 0; i < CONCURRENCY; i++) { qthread_readFF(NULL, &rets[i]); }
+  qtimer_stop(timer);
+  secs = qtimer_secs(timer);
+
+  printf("\tqt_pread: %25g secs (%lu reads of %lu bytes)\n",
+         secs,
+         (unsigned long)(CONCURRENCY * ITERATIONS),
+         (unsigned long)BLOCKSIZE);
+  printf("\t = read throughput: %15f reads/sec\n",
+         (CONCURRENCY * ITERATIONS) / secs);
+  printf("\t = data throughput: %15g bytes/sec\n",
+         (CONCURRENCY * ITERATIONS * BLOCKSIZE) / secs);
+  if (errors) {
+    printf("\t!! %lu short or corrupt reads\n", (unsigned long)errors);
+  }
+
+  free(rets);
+  qtimer_destroy(timer);
+  close(fd);
+  unlink(filename);
+
+  return errors != 0;
+}
+
+/* vim:set expandtab */
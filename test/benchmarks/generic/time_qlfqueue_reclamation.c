@@ -0,0 +1,82 @@
+#include "argparsing.h"
+#include <assert.h>
+#include <qthread/qlfqueue.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures qlfqueue throughput with every worker enqueueing and dequeueing
+// at once, with each of the ways it can keep dequeued nodes from being freed
+// too early (QT_LFQUEUE_RECLAMATION): hazard pointers, which every operation
+// must publish and recheck and which someone must scan every so often, and
+// epochs, which an operation only announces once. Each worker runs one task
+// that does OPS pairs of an enqueue and a dequeue on a shared queue, after
+// PREFILL elements have gone in so that dequeues seldom find it empty.
+
+static size_t OPS = 1 << 20;
+static size_t PREFILL = 1 << 10;
+
+static qlfqueue_t *q;
+
+static aligned_t worker(void *arg) {
+  for (size_t i = 0; i < OPS; i++) {
+    qlfqueue_enqueue(q, (void *)(uintptr_t)(i + 1));
+    if (qlfqueue_dequeue(q) == NULL) { qthread_yield(); }
+  }
+  return 0;
+}
+
+static void run(char const *scheme, qtimer_t timer) {
+  size_t workers;
+  aligned_t *rets;
+
+  setenv("QT_LFQUEUE_RECLAMATION", scheme, 1);
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+  workers = qthread_num_workers();
+  rets = malloc(workers * sizeof(aligned_t));
+  assert(rets);
+  q = qlfqueue_create();
+  assert(q);
+  for (size_t i = 0; i < PREFILL; i++) {
+    qlfqueue_enqueue(q, (void *)(uintptr_t)(i + 1));
+  }
+
+  qtimer_start(timer);
+  for (size_t w = 0; w < workers; w++) {
+    qthread_fork_to(worker,
+                    NULL,
+                    &rets[w],
+                    (qthread_shepherd_id_t)(w % qthread_num_shepherds()));
+  }
+  for (size_t w = 0; w < workers; w++) { qthread_readFF(NULL, &rets[w]); }
+  qtimer_stop(timer);
+
+  printf("\t%-8s %u workers %f secs, %7.1f ns/op, %.0f ops/sec\n",
+         scheme,
+         (unsigned)workers,
+         qtimer_secs(timer),
+         qtimer_secs(timer) * 1e9 / (2 * OPS * workers),
+         2 * OPS * workers / qtimer_secs(timer));
+
+  while (qlfqueue_dequeue(q) != NULL) {}
+  qlfqueue_destroy(q);
+  free(rets);
+  qthread_finalize();
+}
+
+int main(int argc, char *argv[]) {
+  qtimer_t timer = qtimer_create();
+
+  CHECK_VERBOSE();
+  NUMARG(OPS, "OPS");
+  NUMARG(PREFILL, "PREFILL");
+
+  run("hazard", timer);
+  run("epoch", timer);
+
+  qtimer_destroy(timer);
+  return 0;
+}
+
+/* vim:set expandtab */
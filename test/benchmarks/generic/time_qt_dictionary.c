@@ -0,0 +1,125 @@
+#include "argparsing.h"
+#include <assert.h>
+#include <qthread/dictionary.h>
+#include <qthread/hash.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures qt_dictionary throughput, for whichever backend the library was
+// built with (QTHREADS_DICT_TYPE). The table is first filled with KEYS keys
+// (which is timed too, since it includes growing the table), and then groups
+// of 1, 2, 4, ... tasks, up to twice the number of workers, each do OPS
+// operations on random keys, for several mixes of reads and writes. Half of
+// the writes replace an entry's value and half delete a key and put it back,
+// so the size of the table stays the same; reads look for a key from twice
+// the range that was inserted, so about half of them miss.
+
+static size_t KEYS = 1 << 20;
+static size_t OPS = 1 << 20;
+
+static qt_dictionary *dict;
+
+static int key_equals(void *a, void *b) { return a == b; }
+
+static int key_hash(void *k) { return (int)qt_hash64((uint64_t)(uintptr_t)k); }
+
+static inline uint64_t next_rand(uint64_t *state) {
+  uint64_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  return *state = x;
+}
+
+static aligned_t fill(void *arg) {
+  uintptr_t const first = (uintptr_t)arg;
+
+  for (uintptr_t k = first; k <= KEYS; k += qthread_num_workers()) {
+    qt_dictionary_put(dict, (void *)k, (void *)k);
+  }
+  return 0;
+}
+
+static unsigned write_percent;
+
+static aligned_t mix(void *arg) {
+  uint64_t state = (uintptr_t)arg * 0x9E3779B97F4A7C15ull + 1;
+  aligned_t found = 0;
+
+  for (size_t i = 0; i < OPS; i++) {
+    uint64_t const r = next_rand(&state);
+    uintptr_t const k = (uintptr_t)(r >> 32) % KEYS + 1;
+
+    if ((r & 0xffff) % 100 < write_percent) {
+      if (r & 0x10000) {
+        qt_dictionary_put(dict, (void *)k, (void *)(k + 1));
+      } else if (qt_dictionary_delete(dict, (void *)k) != NULL) {
+        qt_dictionary_put_if_absent(dict, (void *)k, (void *)k);
+      }
+    } else {
+      found +=
+        (qt_dictionary_get(dict, (void *)((uintptr_t)(r >> 32) % (KEYS * 2) +
+                                          1)) != NULL);
+    }
+  }
+  return found;
+}
+
+static double run_tasks(qthread_f f, size_t ntasks) {
+  qtimer_t timer = qtimer_create();
+  aligned_t *rets = malloc(ntasks * sizeof(aligned_t));
+  double secs;
+
+  assert(rets);
+  qtimer_start(timer);
+  for (size_t i = 0; i < ntasks; i++) {
+    qthread_fork(f, (void *)(uintptr_t)(i + 1), &rets[i]);
+  }
+  for (size_t i = 0; i < ntasks; i++) { qthread_readFF(NULL, &rets[i]); }
+  qtimer_stop(timer);
+  secs = qtimer_secs(timer);
+  qtimer_destroy(timer);
+  free(rets);
+  return secs;
+}
+
+int main(int argc, char *argv[]) {
+  static unsigned const mixes[] = {0, 10, 50};
+  double secs;
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(KEYS, "KEYS");
+  NUMARG(OPS, "OPS");
+  printf("%u shepherds, %u workers, %zu keys, %zu operations per task\n",
+         (unsigned)qthread_num_shepherds(),
+         (unsigned)qthread_num_workers(),
+         KEYS,
+         OPS);
+
+  dict = qt_dictionary_create(key_equals, key_hash, NULL);
+  assert(dict);
+  secs = run_tasks(fill, qthread_num_workers());
+  printf("\tfill:       %f secs, %.2f Mops/s\n", secs, KEYS / secs / 1e6);
+  if (verbose) { qt_dictionary_printbuckets(dict); }
+
+  for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+    write_percent = mixes[m];
+    printf("\t%u%% reads, %u%% writes\n", 100 - write_percent, write_percent);
+    for (size_t tasks = 1; tasks <= 2 * qthread_num_workers(); tasks *= 2) {
+      secs = run_tasks(mix, tasks);
+      printf("\t\t%3zu tasks: %f secs, %.2f Mops/s\n",
+             tasks,
+             secs,
+             tasks * OPS / secs / 1e6);
+    }
+  }
+
+  qt_dictionary_destroy(dict);
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -28,6 +28,20 @@ static void sumrand(size_t const startat, size_t const stopat, void *arg_) {
   }
 }
 
+/* like sumrand, but the first eighth of the iterations cost 64 times more */
+static void sumskew(size_t const startat, size_t const stopat, void *arg_) {
+  size_t tmp, tmp2;
+  qthread_incr(&threads, stopat - startat);
+  for (size_t i = startat; i < stopat; ++i) {
+    tmp = randlen[i];
+    tmp2 = (i < numincrs / 8) ? tmp * 64 : tmp;
+    while (tmp2 > 0) {
+      tmp += qtimer_fastrand();
+      tmp2--;
+    }
+  }
+}
+
 static void sum(size_t const startat, size_t const stopat, void *arg_) {
   qthread_incr(&threads, stopat - startat);
 }
@@ -106,7 +120,7 @@ int main(int argc, char *argv[]) {
 
   qt_loop(0, numincrs, sum, NULL);
 
-  run_args_t pure_args[8] = {
+  run_args_t pure_args[9] = {
     {qt_loop_dc, sum, "solo pure TPI", "donecount"},
     {qt_loop_aligned, sum, "solo pure TPI", "aligned"},
     {qt_loop_sv, sum, "solo pure TPI", "syncvar"},
@@ -115,9 +129,10 @@ int main(int argc, char *argv[]) {
     {qt_loop_balance_aligned, sum, "solo pure balanced", "aligned"},
     {qt_loop_balance_sv, sum, "solo pure balanced", "syncvar"},
     {qt_loop_balance_sinc, sum, "solo pure balanced", "sinc"},
+    {qt_loop_adaptive, sum, "solo pure adaptive", "sinc"},
   };
 
-  for (int i = 0; i < 8; i++) {
+  for (int i = 0; i < 9; i++) {
     qthread_fork(run_iterations, &pure_args[i], &ret);
     qthread_readFE(NULL, &ret);
   }
@@ -134,7 +149,7 @@ int main(int argc, char *argv[]) {
 
   qt_loop(0, numincrs, sum, NULL);
 
-  run_args_t team_pure_args[8] = {
+  run_args_t team_pure_args[9] = {
     {qt_loop_dc, sum, "team pure TPI", "donecount"},
     {qt_loop_aligned, sum, "team pure TPI", "aligned"},
     {qt_loop_sv, sum, "team pure TPI", "syncvar"},
@@ -143,9 +158,10 @@ int main(int argc, char *argv[]) {
     {qt_loop_balance_aligned, sum, "team pure balanced", "aligned"},
     {qt_loop_balance_sv, sum, "team pure balanced", "syncvar"},
     {qt_loop_balance_sinc, sum, "team pure balanced", "sinc"},
+    {qt_loop_adaptive, sum, "team pure adaptive", "sinc"},
   };
 
-  for (int i = 0; i < 8; i++) {
+  for (int i = 0; i < 9; i++) {
     qthread_fork_new_team(run_iterations, &team_pure_args[i], &ret);
     qthread_readFE(NULL, &ret);
   }
@@ -161,7 +177,7 @@ int main(int argc, char *argv[]) {
            "iters");
   }
 
-  run_args_t rand_args[8] = {
+  run_args_t rand_args[9] = {
     {qt_loop_dc, sumrand, "solo rand TPI", "donecount"},
     {qt_loop_aligned, sumrand, "solo rand TPI", "aligned"},
     {qt_loop_sv, sumrand, "solo rand TPI", "syncvar"},
@@ -170,9 +186,10 @@ int main(int argc, char *argv[]) {
     {qt_loop_balance_aligned, sumrand, "solo rand balanced", "aligned"},
     {qt_loop_balance_sv, sumrand, "solo rand balanced", "syncvar"},
     {qt_loop_balance_sinc, sumrand, "solo rand balanced", "sinc"},
+    {qt_loop_adaptive, sumrand, "solo rand adaptive", "sinc"},
   };
 
-  for (int i = 0; i < 8; i++) {
+  for (int i = 0; i < 9; i++) {
     qthread_fork(run_iterations, &rand_args[i], &ret);
     qthread_readFE(NULL, &ret);
   }
@@ -188,7 +205,7 @@ int main(int argc, char *argv[]) {
            "iters");
   }
 
-  run_args_t team_rand_args[8] = {
+  run_args_t team_rand_args[9] = {
     {qt_loop_dc, sumrand, "team rand TPI", "donecount"},
     {qt_loop_aligned, sumrand, "team rand TPI", "aligned"},
     {qt_loop_sv, sumrand, "team rand TPI", "syncvar"},
@@ -197,13 +214,38 @@ int main(int argc, char *argv[]) {
     {qt_loop_balance_aligned, sumrand, "team rand balanced", "aligned"},
     {qt_loop_balance_sv, sumrand, "team rand balanced", "syncvar"},
     {qt_loop_balance_sinc, sumrand, "team rand balanced", "sinc"},
+    {qt_loop_adaptive, sumrand, "team rand adaptive", "sinc"},
   };
 
-  for (int i = 0; i < 8; i++) {
+  for (int i = 0; i < 9; i++) {
     qthread_fork_new_team(run_iterations, &team_rand_args[i], &ret);
     qthread_readFE(NULL, &ret);
   }
 
+  if (print_headers) {
+    printf("\n");
+    printf("Increment with Skewed Rand\n");
+    printf("%-4s %-4s %-23s %-9s %8s time\n",
+           "sheps",
+           "workers",
+           "grouping work looptype",
+           "sync",
+           "iters");
+  }
+
+  run_args_t skew_args[5] = {
+    {qt_loop_dc, sumskew, "solo skew TPI", "donecount"},
+    {qt_loop_sinc, sumskew, "solo skew TPI", "sinc"},
+    {qt_loop_balance_dc, sumskew, "solo skew balanced", "donecount"},
+    {qt_loop_balance_sinc, sumskew, "solo skew balanced", "sinc"},
+    {qt_loop_adaptive, sumskew, "solo skew adaptive", "sinc"},
+  };
+
+  for (int i = 0; i < 5; i++) {
+    qthread_fork(run_iterations, &skew_args[i], &ret);
+    qthread_readFE(NULL, &ret);
+  }
+
   qtimer_destroy(timer);
   return 0;
 }
@@ -0,0 +1,142 @@
+#include "argparsing.h"
+#include <assert.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <qthread/sinc.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures a sinc, for whichever implementation the library was built with
+// (QTHREADS_SINC), in the three ways the tests in test/basics use one:
+//  - fan-in:  the main task expects TASKS participants at once and spawns
+//             them, and each submits a value, as qt_loop_sinc() does;
+//  - nested:  a binary tree of DEPTH levels of tasks sharing one sinc, in
+//             which every task expects its two children before spawning them
+//             and then submits a value, as time_uts_sinc does, so that the
+//             expects come from every worker;
+//  - reuse:   ROUNDS rounds of a reset, a submit for each worker and a wait,
+//             all from the main task, which is mostly the cost of draining
+//             the sinc and collating the values.
+// Each is run with and without values (an aligned_t sum).
+
+static size_t TASKS = 1 << 20;
+static size_t DEPTH = 20;
+static size_t ROUNDS = 1 << 16;
+
+static qt_sinc_t sinc;
+static int with_values;
+
+static void add(void *tgt, void const *src) {
+  *(aligned_t *)tgt += *(aligned_t const *)src;
+}
+
+static void submit_one(void) {
+  aligned_t const one = 1;
+
+  qt_sinc_submit(&sinc, with_values ? &one : NULL);
+}
+
+static aligned_t fan_in_task(void *arg) {
+  submit_one();
+  return 0;
+}
+
+static aligned_t nested_task(void *arg) {
+  uintptr_t const depth = (uintptr_t)arg;
+
+  if (depth > 1) {
+    qt_sinc_expect(&sinc, 2);
+    qthread_fork(nested_task, (void *)(depth - 1), NULL);
+    qthread_fork(nested_task, (void *)(depth - 1), NULL);
+  }
+  submit_one();
+  return 0;
+}
+
+static void init(size_t expect) {
+  aligned_t const zero = 0;
+
+  if (with_values) {
+    qt_sinc_init(&sinc, sizeof(aligned_t), &zero, add, expect);
+  } else {
+    qt_sinc_init(&sinc, 0, NULL, NULL, expect);
+  }
+}
+
+static void check(aligned_t expect) {
+  aligned_t result = 0;
+
+  qt_sinc_wait(&sinc, with_values ? &result : NULL);
+  assert(!with_values || result == expect);
+  (void)expect;
+  (void)result;
+}
+
+static void report(char const *name, qtimer_t timer, size_t ops) {
+  printf("\t%-8s %-12s %f secs, %7.1f ns/submit\n",
+         name,
+         with_values ? "with values" : "no values",
+         qtimer_secs(timer),
+         qtimer_secs(timer) * 1e9 / ops);
+}
+
+int main(int argc, char *argv[]) {
+  qtimer_t timer = qtimer_create();
+  size_t workers;
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(TASKS, "TASKS");
+  NUMARG(DEPTH, "DEPTH");
+  NUMARG(ROUNDS, "ROUNDS");
+  workers = qthread_num_workers();
+  printf("%u shepherds, %u workers\n",
+         (unsigned)qthread_num_shepherds(),
+         (unsigned)workers);
+
+  for (with_values = 0; with_values < 2; with_values++) {
+    size_t const nested = ((size_t)1 << DEPTH) - 1;
+
+    /* once untimed, so that nobody pays for filling the qthread pools */
+    init(TASKS);
+    for (size_t i = 0; i < TASKS; i++) {
+      qthread_fork(fan_in_task, NULL, NULL);
+    }
+    check(TASKS);
+    qt_sinc_fini(&sinc);
+
+    init(TASKS);
+    qtimer_start(timer);
+    for (size_t i = 0; i < TASKS; i++) {
+      qthread_fork(fan_in_task, NULL, NULL);
+    }
+    check(TASKS);
+    qtimer_stop(timer);
+    qt_sinc_fini(&sinc);
+    report("fan-in", timer, TASKS);
+
+    init(1);
+    qtimer_start(timer);
+    qthread_fork(nested_task, (void *)(uintptr_t)DEPTH, NULL);
+    check(nested);
+    qtimer_stop(timer);
+    qt_sinc_fini(&sinc);
+    report("nested", timer, nested);
+
+    init(0);
+    qtimer_start(timer);
+    for (size_t r = 0; r < ROUNDS; r++) {
+      qt_sinc_reset(&sinc, workers);
+      for (size_t w = 0; w < workers; w++) { submit_one(); }
+      check(workers);
+    }
+    qtimer_stop(timer);
+    qt_sinc_fini(&sinc);
+    report("reuse", timer, ROUNDS * workers);
+  }
+
+  qtimer_destroy(timer);
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -0,0 +1,91 @@
+#include "argparsing.h"
+#include <assert.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Builds a dependency graph of LEVELS levels of WIDTH tasks, where each task
+// sums the results of two tasks of the level before it, in two ways: with
+// qthread_when_all(), which spawns each task once its inputs are full, and
+// with tasks that are all forked up front and block in qthread_readFF() on
+// their inputs. The blocked tasks each hold a stack until their inputs are
+// ready; the continuations hold nothing but a qthread struct.
+
+static size_t LEVELS = 1000;
+static size_t WIDTH = 64;
+
+static aligned_t *results;
+
+static aligned_t one(void *arg) { return 1; }
+
+static aligned_t sum2(void *arg) {
+  size_t const i = (uintptr_t)arg;
+  size_t const prev = i - WIDTH + ((i % WIDTH) == 0 ? 0 : -1);
+
+  return (results[prev] + results[i - WIDTH]) & 0xffff;
+}
+
+static aligned_t sum2_blocking(void *arg) {
+  size_t const i = (uintptr_t)arg;
+  size_t const prev = i - WIDTH + ((i % WIDTH) == 0 ? 0 : -1);
+
+  qthread_readFF(NULL, &results[prev]);
+  qthread_readFF(NULL, &results[i - WIDTH]);
+  return (results[prev] + results[i - WIDTH]) & 0xffff;
+}
+
+static double graph(int blocking) {
+  qtimer_t timer = qtimer_create();
+  double secs;
+
+  qtimer_start(timer);
+  for (size_t i = 0; i < WIDTH; i++) { qthread_fork(one, NULL, &results[i]); }
+  for (size_t i = WIDTH; i < LEVELS * WIDTH; i++) {
+    if (blocking) {
+      qthread_fork(sum2_blocking, (void *)(uintptr_t)i, &results[i]);
+    } else {
+      size_t const prev = i - WIDTH + ((i % WIDTH) == 0 ? 0 : -1);
+      aligned_t *inputs[2] = {&results[prev], &results[i - WIDTH]};
+
+      qthread_when_all(inputs, 2, sum2, (void *)(uintptr_t)i, &results[i]);
+    }
+  }
+  for (size_t i = (LEVELS - 1) * WIDTH; i < LEVELS * WIDTH; i++) {
+    qthread_readFF(NULL, &results[i]);
+  }
+  qtimer_stop(timer);
+  secs = qtimer_secs(timer);
+  qtimer_destroy(timer);
+  return secs;
+}
+
+int main(int argc, char *argv[]) {
+  double secs;
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(LEVELS, "LEVELS");
+  NUMARG(WIDTH, "WIDTH");
+  printf("%u shepherds, %u workers, %zu levels of %zu tasks\n",
+         (unsigned)qthread_num_shepherds(),
+         (unsigned)qthread_num_workers(),
+         LEVELS,
+         WIDTH);
+  results = malloc(LEVELS * WIDTH * sizeof(aligned_t));
+  assert(results);
+
+  secs = graph(0);
+  printf("\tqthread_when_all: %f secs, %.2f us per task\n",
+         secs,
+         secs * 1e6 / (LEVELS * WIDTH));
+  secs = graph(1);
+  printf("\tqthread_readFF:   %f secs, %.2f us per task\n",
+         secs,
+         secs * 1e6 / (LEVELS * WIDTH));
+
+  free(results);
+  return 0;
+}
+
+/* vim:set expandtab */
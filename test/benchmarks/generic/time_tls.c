@@ -0,0 +1,129 @@
+#include "argparsing.h"
+#include <assert.h>
+#include <pthread.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <qthread/tls.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Compares task-specific data (qthread_getspecific()/qthread_setspecific())
+// with pthread TLS keys, as seen by a library that looks up its per-task
+// context on every call. Each task does ITERATIONS get/set pairs on one key;
+// the "far" key is created after enough others that it lives outside the
+// slots kept in the task itself. (pthread values belong to the worker, not to
+// the task, so they cannot stand in for task-specific data; they are only the
+// speed to match.) The last test spawns tasks that set a key with a
+// destructor, to show what the destructors cost at task exit.
+
+static size_t ITERATIONS = 1000000;
+static size_t TASKS = 64;
+
+static qthread_key_t near_key, far_key, dtor_key;
+static pthread_key_t pkey;
+static aligned_t destroyed;
+
+static aligned_t qt_near(void *arg) {
+  for (uintptr_t i = 0; i < ITERATIONS; i++) {
+    uintptr_t v = (uintptr_t)qthread_getspecific(near_key);
+    qthread_setspecific(near_key, (void *)(v + i));
+  }
+  return 0;
+}
+
+static aligned_t qt_far(void *arg) {
+  for (uintptr_t i = 0; i < ITERATIONS; i++) {
+    uintptr_t v = (uintptr_t)qthread_getspecific(far_key);
+    qthread_setspecific(far_key, (void *)(v + i));
+  }
+  return 0;
+}
+
+static aligned_t pt(void *arg) {
+  for (uintptr_t i = 0; i < ITERATIONS; i++) {
+    uintptr_t v = (uintptr_t)pthread_getspecific(pkey);
+    pthread_setspecific(pkey, (void *)(v + i));
+  }
+  return 0;
+}
+
+static void dtor(void *value) { qthread_incr(&destroyed, 1); }
+
+static aligned_t set_once(void *arg) {
+  qthread_setspecific(dtor_key, arg);
+  return 0;
+}
+
+static aligned_t nothing(void *arg) { return 0; }
+
+static double run_tasks(qthread_f f, size_t ntasks) {
+  qtimer_t timer = qtimer_create();
+  aligned_t *rets = malloc(ntasks * sizeof(aligned_t));
+  double secs;
+
+  assert(rets);
+  qtimer_start(timer);
+  for (size_t i = 0; i < ntasks; i++) {
+    qthread_fork(f, (void *)(uintptr_t)(i + 1), &rets[i]);
+  }
+  for (size_t i = 0; i < ntasks; i++) { qthread_readFF(NULL, &rets[i]); }
+  qtimer_stop(timer);
+  secs = qtimer_secs(timer);
+  qtimer_destroy(timer);
+  free(rets);
+  return secs;
+}
+
+int main(int argc, char *argv[]) {
+  qthread_key_t filler[8];
+  double secs;
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(ITERATIONS, "ITERATIONS");
+  NUMARG(TASKS, "TASKS");
+  printf("%u shepherds, %u workers, %zu tasks of %zu get/set pairs\n",
+         (unsigned)qthread_num_shepherds(),
+         (unsigned)qthread_num_workers(),
+         TASKS,
+         ITERATIONS);
+
+  assert(qthread_key_create(&near_key, NULL) == QTHREAD_SUCCESS);
+  for (int i = 0; i < 8; i++) {
+    assert(qthread_key_create(&filler[i], NULL) == QTHREAD_SUCCESS);
+  }
+  assert(qthread_key_create(&far_key, NULL) == QTHREAD_SUCCESS);
+  assert(qthread_key_create(&dtor_key, dtor) == QTHREAD_SUCCESS);
+  assert(pthread_key_create(&pkey, NULL) == 0);
+
+  secs = run_tasks(qt_near, TASKS);
+  printf("\tqthread key:         %f secs, %.2f ns per get+set\n",
+         secs,
+         secs * 1e9 / (TASKS * ITERATIONS));
+  secs = run_tasks(qt_far, TASKS);
+  printf("\tqthread key (far):   %f secs, %.2f ns per get+set\n",
+         secs,
+         secs * 1e9 / (TASKS * ITERATIONS));
+  secs = run_tasks(pt, TASKS);
+  printf("\tpthread key:         %f secs, %.2f ns per get+set\n",
+         secs,
+         secs * 1e9 / (TASKS * ITERATIONS));
+
+  secs = run_tasks(nothing, TASKS * 1000);
+  printf("\tempty tasks:         %f secs, %.2f ns per task\n",
+         secs,
+         secs * 1e9 / (TASKS * 1000));
+  secs = run_tasks(set_once, TASKS * 1000);
+  printf("\ttasks w/ destructor: %f secs, %.2f ns per task\n",
+         secs,
+         secs * 1e9 / (TASKS * 1000));
+
+  for (int i = 0; i < 8; i++) { qthread_key_delete(filler[i]); }
+  qthread_key_delete(near_key);
+  qthread_key_delete(far_key);
+  qthread_key_delete(dtor_key);
+  pthread_key_delete(pkey);
+  return 0;
+}
+
+/* vim:set expandtab */
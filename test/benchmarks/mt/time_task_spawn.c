@@ -4,6 +4,7 @@
 #include <qthread/qthread.h>
 #include <qthread/qtimer.h>
 #include <stdio.h>
+#include <string.h>
 
 static aligned_t donecount = 0;
 
@@ -14,6 +15,9 @@ static void par_null_task(size_t start, size_t stop, void *args_) {}
 int main(int argc, char *argv[]) {
   uint64_t count = 1048576;
   int par_fork = 0;
+  int spawn_many = 0;
+  size_t arg_size = 0; /* bytes of argument each task gets a copy of */
+  char args[4096];
 
   qtimer_t timer;
   double total_time = 0.0;
@@ -22,7 +26,11 @@ int main(int argc, char *argv[]) {
 
   NUMARG(count, "MT_COUNT");
   NUMARG(par_fork, "MT_PAR_FORK");
+  NUMARG(spawn_many, "MT_SPAWN_MANY");
+  NUMARG(arg_size, "MT_ARG_SIZE");
   assert(0 != count);
+  assert(arg_size <= sizeof(args));
+  memset(args, 0, sizeof(args));
 
   assert(qthread_initialize() == 0);
 
@@ -32,10 +40,21 @@ int main(int argc, char *argv[]) {
     qtimer_start(timer);
 
     qt_loop(0, count, par_null_task, NULL);
+  } else if (spawn_many) {
+    qtimer_start(timer);
+
+    qthread_spawn_many(null_task, NULL, 0, NULL, count, NO_SHEPHERD, 0);
+    do { qthread_yield(); } while (donecount != count);
   } else {
     qtimer_start(timer);
 
-    for (uint64_t i = 0; i < count; i++) qthread_fork(null_task, NULL, NULL);
+    if (arg_size) {
+      for (uint64_t i = 0; i < count; i++) {
+        qthread_fork_copyargs(null_task, args, arg_size, NULL);
+      }
+    } else {
+      for (uint64_t i = 0; i < count; i++) qthread_fork(null_task, NULL, NULL);
+    }
     do { qthread_yield(); } while (donecount != count);
   }
 
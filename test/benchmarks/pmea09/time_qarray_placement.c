@@ -0,0 +1,119 @@
+#include "argparsing.h"
+#include <assert.h>
+#include <qthread/qarray.h>
+#include <qthread/qthread.h>
+#include <qthread/qtimer.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Measures what it costs to create a large qarray of doubles, now that its
+// segments are placed on their shepherds' nodes as it is created, and how fast
+// qarray_iter_loop() then streams through it and reads it at random, with each
+// kind of page QT_QARRAY_HUGEPAGES can ask for. Random reads touch a new page
+// almost every time, so they show what huge pages save in TLB misses. Each
+// time is the mean of ITERATIONS runs.
+
+size_t ITERATIONS = 10;
+size_t ELEMENT_COUNT = 1 << 24; /* 128MB of doubles */
+
+static void
+assign_loop(size_t const startat, size_t const stopat, qarray *qa, void *arg) {
+  double *ptr = (double *)qarray_elem_nomigrate(qa, startat);
+  size_t const max = stopat - startat;
+
+  for (size_t i = 0; i < max; i++) { ptr[i] = (double)(startat + i); }
+}
+
+static void random_loop(size_t const startat,
+                        size_t const stopat,
+                        qarray *qa,
+                        void *arg,
+                        void *ret) {
+  size_t const count = qa->count;
+  double sum = 0.0;
+
+  for (size_t i = startat; i < stopat; i++) {
+    /* a cheap scramble of i, good enough to defeat the prefetcher */
+    size_t const j = (size_t)((i * 0x9E3779B97F4A7C15ull) >> 17) % count;
+
+    sum += *(double *)qarray_elem_nomigrate(qa, j);
+  }
+  *(double *)ret = sum;
+}
+
+static void sum_acc(void *a, void const *b) {
+  *(double *)a += *(double const *)b;
+}
+
+int main(int argc, char *argv[]) {
+  qtimer_t timer = qtimer_create();
+  distribution_t const disttypes[] = {
+    FIXED_HASH, FIXED_FIELDS, ALL_LOCAL, DIST_STRIPES};
+  char const *const distnames[] = {
+    "FIXED_HASH", "FIXED_FIELDS", "ALL_LOCAL", "DIST_STRIPES"};
+  char const *const pagetypes[] = {"no", "transparent", "explicit"};
+
+  assert(qthread_initialize() == QTHREAD_SUCCESS);
+
+  verbose = 1;
+  NUMARG(ITERATIONS, "ITERATIONS");
+  NUMARG(ELEMENT_COUNT, "TEST_ELEMENT_COUNT");
+
+  printf("Using %i shepherds\n", (int)qthread_num_shepherds());
+  printf("Arrays of %lu doubles...\n", (unsigned long)ELEMENT_COUNT);
+  printf("%-13s %-12s %10s %10s %10s %10s\n",
+         "",
+         "huge pages",
+         "seg bytes",
+         "create",
+         "stream",
+         "random");
+
+  for (size_t d = 0; d < sizeof(disttypes) / sizeof(disttypes[0]); d++) {
+    for (size_t p = 0; p < sizeof(pagetypes) / sizeof(pagetypes[0]); p++) {
+      double create, stream = 0.0, rand = 0.0, sum;
+      qarray *a;
+
+      setenv("QT_QARRAY_HUGEPAGES", pagetypes[p], 1);
+      qtimer_start(timer);
+      a = qarray_create_configured(
+        ELEMENT_COUNT, sizeof(double), disttypes[d], 1, 0);
+      qtimer_stop(timer);
+      assert(a != NULL);
+      create = qtimer_secs(timer);
+
+      for (size_t j = 0; j < ITERATIONS; j++) {
+        qtimer_start(timer);
+        qarray_iter_loop(a, 0, ELEMENT_COUNT, assign_loop, NULL);
+        qtimer_stop(timer);
+        stream += qtimer_secs(timer);
+      }
+      for (size_t j = 0; j < ITERATIONS; j++) {
+        qtimer_start(timer);
+        qarray_iter_loopaccum(a,
+                              0,
+                              ELEMENT_COUNT,
+                              random_loop,
+                              NULL,
+                              &sum,
+                              sizeof(double),
+                              sum_acc);
+        qtimer_stop(timer);
+        rand += qtimer_secs(timer);
+      }
+      printf("%-13s %-12s %10lu %10f %10f %10f\n",
+             distnames[d],
+             pagetypes[p],
+             (unsigned long)a->segment_bytes,
+             create,
+             stream / ITERATIONS,
+             rand / ITERATIONS);
+      qarray_destroy(a);
+    }
+  }
+
+  qtimer_destroy(timer);
+  return 0;
+}
+
+/* vim:set expandtab */
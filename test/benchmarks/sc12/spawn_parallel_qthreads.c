@@ -25,6 +25,16 @@ static void par_spawn(size_t start, size_t stop, void *args_) {
   }
 }
 
+static void par_spawn_many(size_t start, size_t stop, void *args_) {
+  qthread_spawn_many(null_task,
+                     NULL,
+                     0,
+                     NULL,
+                     stop - start,
+                     NO_SHEPHERD,
+                     QTHREAD_SPAWN_SIMPLE);
+}
+
 int main(int argc, char *argv[]) {
   uint64_t count = 1048576;
   uint64_t loop_style = 1;
@@ -89,6 +99,12 @@ int main(int argc, char *argv[]) {
       qt_loop_simple(0, count, par_null_task, NULL);
       qtimer_stop(timer);
       break;
+    case 9:
+      qtimer_start(timer);
+      qt_loop_balance(0, count, par_spawn_many, NULL);
+      while (donecount != count) { qthread_yield(); }
+      qtimer_stop(timer);
+      break;
   }
 
   total_time = qtimer_secs(timer);
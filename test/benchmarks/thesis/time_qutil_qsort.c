@@ -1,151 +1,174 @@
 #include <assert.h>
-#include <float.h>  /* for DBL_EPSILON (according to C89) */
-#include <limits.h> /* for INT_MIN & friends (according to C89) */
-#include <math.h>   /* for fabs() */
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/mman.h>
-
-#include <sys/time.h> /* for gettimeofday() */
-#include <time.h>     /* for gettimeofday() */
+#include <string.h>
 
 #include "argparsing.h"
 #include <qthread/qtimer.h>
 #include <qthread/qutil.h>
 
+// Compares every sort in qutil, and libc's qsort(), on arrays of aligned_ts
+// or (with TEST_USING_DOUBLES) doubles, of sizes from TEST_MIN_LEN up to
+// TEST_LEN in steps of ten times, with keys drawn from several distributions.
+// Each is the best of TEST_ITERATIONS runs, on a fresh copy of the same array.
+// Two of the sorts are only timed up to TEST_SLOW_MAX elements.
+// qutil_mergesort() merges in place by shifting, so it is quadratic.
+// The qutil quicksorts go quadratic, and use a lot of memory, on inputs with
+// few distinct keys.
+
 static int dcmp(void const *a, void const *b) {
-  return (int)(*(double *)a - *(double *)b);
+  double const x = *(double const *)a;
+  double const y = *(double const *)b;
+
+  return (x > y) - (x < y);
 }
 
 static int acmp(void const *a, void const *b) {
-  return (*(aligned_t *)a - *(aligned_t *)b);
+  aligned_t const x = *(aligned_t const *)a;
+  aligned_t const y = *(aligned_t const *)b;
+
+  return (x > y) - (x < y);
 }
 
-static char const *human_readable(size_t bytes) {
-  static char str[50];
-  char const *suffix;
-  double partial;
-  if (bytes >= (1 << 30)) {
-    partial = (double)bytes / (double)(1 << 30);
-    suffix = "GB";
-  } else if (bytes >= (1 << 20)) {
-    partial = (double)bytes / (double)(1 << 20);
-    suffix = "MB";
-  } else if (bytes >= (1 << 10)) {
-    partial = (double)bytes / (double)(1 << 10);
-    suffix = "KB";
-  } else {
-    partial = bytes;
-    suffix = " bytes";
+static void libc_dsort(double *array, size_t len) {
+  qsort(array, len, sizeof(double), dcmp);
+}
+
+static void libc_asort(aligned_t *array, size_t len) {
+  qsort(array, len, sizeof(aligned_t), acmp);
+}
+
+static struct {
+  char const *name;
+  void (*dsort)(double *, size_t);
+  void (*asort)(aligned_t *, size_t);
+} const sorts[] = {
+  {"libc qsort", libc_dsort, libc_asort},
+  {"qsort", qutil_qsort, qutil_aligned_qsort},
+  {"mergesort", qutil_mergesort, NULL},
+  {"radixsort", qutil_radixsort, qutil_aligned_radixsort},
+  {"samplesort", qutil_samplesort, qutil_aligned_samplesort},
+};
+
+#define NSORTS (sizeof(sorts) / sizeof(sorts[0]))
+
+static char const *const dists[] = {
+  "uniform", "sorted", "reversed", "few unique", "normal"};
+#define FEW_UNIQUE 3
+
+#define NDISTS (sizeof(dists) / sizeof(dists[0]))
+
+static double uniform(void) { return random() / ((double)RAND_MAX + 1); }
+
+static void generate(int dist, size_t len, double *d_array, aligned_t *ui) {
+  for (size_t i = 0; i < len; i++) {
+    double v;
+
+    switch (dist) {
+      default:
+      case 0: v = uniform() * (double)(1ull << 62); break;
+      case 1: v = (double)i * 1000; break;
+      case 2: v = (double)(len - i) * 1000; break;
+      case FEW_UNIQUE: v = (double)(random() % 16); break;
+      case 4: /* about normal, with a mean of 0 and a deviation of 1e6 */
+        v = 0;
+        for (int j = 0; j < 12; j++) { v += uniform(); }
+        v = (v - 6) * 1e6;
+        break;
+    }
+    if (d_array) { d_array[i] = v; }
+    if (ui) { ui[i] = (aligned_t)(v < 0 ? -v : v); }
   }
-  snprintf(str, 50, "%0.1f%s", partial, suffix);
-  return str;
 }
 
 int main(int argc, char *argv[]) {
-  aligned_t *ui_array, *ui_array2;
-  double *d_array, *d_array2;
   size_t len = 1000000;
-  qtimer_t timer = qtimer_create();
-  double cumulative_time_qutil = 0.0;
-  double cumulative_time_libc = 0.0;
-  int using_doubles = 0;
+  size_t min_len = 1000;
+  size_t slow_max = 10000;
   unsigned long iterations = 10;
+  int using_doubles = 0;
+  qtimer_t timer = qtimer_create();
+  double *d_array = NULL, *d_array2 = NULL;
+  aligned_t *ui_array = NULL, *ui_array2 = NULL;
 
   qthread_initialize();
 
   CHECK_VERBOSE();
   printf("%i threads\n", (int)qthread_num_workers());
   NUMARG(len, "TEST_LEN");
+  NUMARG(min_len, "TEST_MIN_LEN");
+  NUMARG(slow_max, "TEST_SLOW_MAX");
   NUMARG(iterations, "TEST_ITERATIONS");
   NUMARG(using_doubles, "TEST_USING_DOUBLES");
   printf("using %s\n", using_doubles ? "doubles" : "aligned_ts");
+  if (min_len > len) { min_len = len; }
 
   if (using_doubles) {
-    d_array = calloc(len, sizeof(double));
-    printf("array is %s\n", human_readable(len * sizeof(double)));
-    assert(d_array);
-    // madvise(d_array,len*sizeof(double), MADV_SEQUENTIAL);
-    for (unsigned int i = 0; i < len; i++) {
-      d_array[i] = ((double)random()) / ((double)RAND_MAX) + random();
-    }
-    d_array2 = calloc(len, sizeof(double));
-    assert(d_array2);
-    // madvise(d_array2,len*sizeof(double), MADV_RANDOM);
-    iprintf("double array generated...\n");
-    for (unsigned int i = 0; i < iterations; i++) {
-      memcpy(d_array2, d_array, len * sizeof(double));
-      qtimer_start(timer);
-      qutil_qsort(d_array2, len);
-      qtimer_stop(timer);
-      cumulative_time_qutil += qtimer_secs(timer);
-      iprintf("\t%u: sorting %lu doubles with qutil took: %f seconds\n",
-              i,
-              (unsigned long)len,
-              qtimer_secs(timer));
-    }
-    cumulative_time_qutil /= (double)iterations;
-    printf("sorting %lu doubles with qutil took: %f seconds (avg)\n",
-           (unsigned long)len,
-           cumulative_time_qutil);
-    for (unsigned int i = 0; i < iterations; i++) {
-      memcpy(d_array2, d_array, len * sizeof(double));
-      qtimer_start(timer);
-      qsort(d_array2, len, sizeof(double), dcmp);
-      qtimer_stop(timer);
-      cumulative_time_libc += qtimer_secs(timer);
-      iprintf("\t%u: sorting %lu doubles with libc took: %f seconds\n",
-              i,
-              (unsigned long)len,
-              qtimer_secs(timer));
-    }
-    cumulative_time_libc /= (double)iterations;
-    printf("sorting %lu doubles with libc took: %f seconds\n",
-           (unsigned long)len,
-           cumulative_time_libc);
-    free(d_array);
-    free(d_array2);
+    d_array = malloc(len * sizeof(double));
+    d_array2 = malloc(len * sizeof(double));
+    assert(d_array && d_array2);
   } else {
-    ui_array = calloc(len, sizeof(aligned_t));
-    printf("array is %s\n", human_readable(len * sizeof(aligned_t)));
-    for (unsigned int i = 0; i < len; i++) { ui_array[i] = random(); }
-    ui_array2 = calloc(len, sizeof(aligned_t));
-    iprintf("ui_array generated...\n");
-    for (int i = 0; i < iterations; i++) {
-      memcpy(ui_array2, ui_array, len * sizeof(aligned_t));
-      qtimer_start(timer);
-      qutil_aligned_qsort(ui_array2, len);
-      qtimer_stop(timer);
-      cumulative_time_qutil += qtimer_secs(timer);
-    }
-    cumulative_time_qutil /= (double)iterations;
-    printf("sorting %lu aligned_ts with qutil took: %f seconds\n",
-           (unsigned long)len,
-           cumulative_time_qutil);
-    for (int i = 0; i < iterations; i++) {
-      memcpy(ui_array2, ui_array, len * sizeof(aligned_t));
-      qtimer_start(timer);
-      qsort(ui_array2, len, sizeof(double), acmp);
-      qtimer_stop(timer);
-      cumulative_time_libc += qtimer_secs(timer);
-    }
-    cumulative_time_libc /= (double)iterations;
-    printf("sorting %lu aligned_ts with libc took: %f seconds (avg)\n",
-           (unsigned long)len,
-           cumulative_time_libc);
-    free(ui_array);
-    free(ui_array2);
+    ui_array = malloc(len * sizeof(aligned_t));
+    ui_array2 = malloc(len * sizeof(aligned_t));
+    assert(ui_array && ui_array2);
   }
-  if (cumulative_time_qutil < cumulative_time_libc) {
-    printf("qutil with %lu threads provides a %0.2fx speedup.\n",
-           (unsigned long)qthread_num_shepherds(),
-           cumulative_time_libc / cumulative_time_qutil);
-  } else {
-    printf("qutil with %lu threads provides a %0.2fx slowdown.\n",
-           (unsigned long)qthread_num_shepherds(),
-           cumulative_time_libc / cumulative_time_qutil);
+
+  printf("%-10s %11s", "", "elements");
+  for (size_t s = 0; s < NSORTS; s++) { printf(" %11s", sorts[s].name); }
+  printf("  (seconds, best of %lu)\n", iterations);
+  for (int dist = 0; dist < (int)NDISTS; dist++) {
+    for (size_t n = min_len; n <= len; n *= 10) {
+      generate(dist, n, d_array, ui_array);
+      printf("%-10s %11lu", dists[dist], (unsigned long)n);
+      for (size_t s = 0; s < NSORTS; s++) {
+        int const slow =
+          (sorts[s].dsort == qutil_mergesort) ||
+          ((sorts[s].dsort == qutil_qsort) && (dist == FEW_UNIQUE));
+        double best = -1;
+
+        if ((using_doubles ? (void *)sorts[s].dsort
+                           : (void *)sorts[s].asort) == NULL ||
+            (slow && (n > slow_max))) {
+          printf(" %11s", "-");
+          continue;
+        }
+        for (unsigned long i = 0; i < iterations; i++) {
+          if (using_doubles) {
+            memcpy(d_array2, d_array, n * sizeof(double));
+            qtimer_start(timer);
+            sorts[s].dsort(d_array2, n);
+            qtimer_stop(timer);
+          } else {
+            memcpy(ui_array2, ui_array, n * sizeof(aligned_t));
+            qtimer_start(timer);
+            sorts[s].asort(ui_array2, n);
+            qtimer_stop(timer);
+          }
+          if ((best < 0) || (qtimer_secs(timer) < best)) {
+            best = qtimer_secs(timer);
+          }
+        }
+        for (size_t i = 1; i < n; i++) {
+          if (using_doubles ? (d_array2[i - 1] > d_array2[i])
+                            : (ui_array2[i - 1] > ui_array2[i])) {
+            fprintf(stderr,
+                    "%s: out of order at %lu\n",
+                    sorts[s].name,
+                    (unsigned long)i);
+            abort();
+          }
+        }
+        printf(" %11.6f", best);
+        fflush(stdout);
+      }
+      printf("\n");
+    }
   }
 
+  free(d_array);
+  free(d_array2);
+  free(ui_array);
+  free(ui_array2);
   qtimer_destroy(timer);
 
   return 0;
@@ -22,6 +22,20 @@ static aligned_t barrier_thread(void *arg) {
   return 0;
 }
 
+static aligned_t entered = 0;
+
+static aligned_t resized_thread(void *arg) {
+  void **args = (void **)arg;
+  qt_barrier_t *b = (qt_barrier_t *)args[0];
+  size_t const n = (uintptr_t)args[2];
+
+  qthread_incr(&entered, 1);
+  qt_barrier_enter_id(b, (uintptr_t)args[1]);
+  /* nobody gets out until everyone is in */
+  test_check(entered >= n);
+  return 0;
+}
+
 int main(int argc, char *argv[]) {
   size_t threads = 1000, i;
   aligned_t *rets;
@@ -88,6 +102,28 @@ int main(int argc, char *argv[]) {
   iprintf("Average barrier time: %f secs\n", total_time / iterations);
   iprintf("Min barrier time:     %f secs\n", min_time);
 
+  /* the same barrier, shrunk, and then grown past its original size */
+  free(rets);
+  rets = (aligned_t *)malloc(2 * threads * sizeof(aligned_t));
+  test_check(rets);
+  for (int s = 0; s < 2; s++) {
+    size_t const n = (s == 0) ? threads / 2 + 1 : 2 * threads;
+
+    iprintf("resizing the barrier to %zu threads\n", n);
+    qt_barrier_resize(wait_on_me, n);
+    for (iter = 0; iter < 3; ++iter) {
+      entered = 1;
+      for (i = 1; i < n; ++i) {
+        void *args[3] = {wait_on_me, (void *)(uintptr_t)i, (void *)n};
+        qthread_spawn(
+          resized_thread, args, sizeof(args), rets + i, 0, NULL, i, 0);
+      }
+      qt_barrier_enter_id(wait_on_me, 0);
+      test_check(entered == n);
+      for (i = 1; i < n; ++i) { qthread_readFF(NULL, rets + i); }
+    }
+  }
+
   iprintf("Destroying barrier...\n");
   qt_barrier_destroy(wait_on_me);
   qtimer_destroy(t);
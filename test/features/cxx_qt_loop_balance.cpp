@@ -30,6 +30,11 @@ void test_func() {
   qt_loop_balance(0, 100, test_struct(3, answer));
   //    qt_loop_balance_future(0, 100, test_struct(3, answer));
 
+  for (int i = 0; i < 100; ++i) { test_check(answer[i] == 3 * i); }
+  for (int i = 0; i < 100; ++i) answer[i] = 0;
+  qt_loop_adaptive(0, 100, test_struct(5, answer));
+  for (int i = 0; i < 100; ++i) { test_check(answer[i] == 5 * i); }
+
   iprintf("\nanswer:");
   for (int i = 0; i < 100; ++i) {
     iprintf("%6d", answer[i]);
@@ -0,0 +1,154 @@
+#include <qthread/qloop.hpp>
+#include <qthread/qthread.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "argparsing.h"
+
+/* counts how often it is copied, moved and destroyed */
+struct counted {
+  static std::atomic<int> copies, moves, alive;
+
+  counted() { alive++; }
+
+  counted(counted const &) {
+    copies++;
+    alive++;
+  }
+
+  counted(counted &&) noexcept {
+    moves++;
+    alive++;
+  }
+
+  ~counted() { alive--; }
+
+  int operator()() const { return 42; }
+};
+
+std::atomic<int> counted::copies(0), counted::moves(0), counted::alive(0);
+
+/* can only be moved */
+struct owner {
+  std::unique_ptr<int> p;
+
+  int operator()() const { return *p * 6; }
+};
+
+static long fib(long n) {
+  if (n < 2) { return n; }
+  qthread::future<long> left = qthread::spawn([n] { return fib(n - 1); });
+  long const right = fib(n - 2);
+  return left.get() + right;
+}
+
+int main(int argc, char **argv) {
+  test_check(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+
+  /* results in the return word, in the future, and none at all */
+  {
+    int x = 20;
+    qthread::future<int> f = qthread::spawn([x] { return x + 1; });
+    test_check(f.valid());
+    test_check(f.get() == 21);
+    test_check(!f.valid());
+
+    qthread::future<std::string> s =
+      qthread::spawn([] { return std::string(100, 'q'); });
+    test_check(s.get() == std::string(100, 'q'));
+
+    aligned_t ran = 0;
+    qthread::future<void> v = qthread::spawn([&ran] { ran = 1; });
+    v.get();
+    test_check(ran == 1);
+    iprintf("int, string and void results\n");
+  }
+
+  /* the callable is moved into the task, not copied, and destroyed there */
+  {
+    qthread::future<int> f = qthread::spawn(counted());
+    test_check(f.get() == 42);
+    test_check(counted::copies == 0);
+    test_check(counted::moves == 1);
+    test_check(counted::alive == 0);
+
+    counted c;
+    qthread::future<int> g = qthread::spawn(c);
+    test_check(g.get() == 42);
+    test_check(counted::copies == 1);
+    test_check(counted::alive == 1);
+    iprintf("callables are moved, or copied from lvalues\n");
+  }
+
+  /* move-only captures, and futures that are moved or never waited for */
+  {
+    std::unique_ptr<int> p(new int(7));
+    qthread::future<int> f = qthread::spawn(owner{std::move(p)});
+    qthread::future<int> g(std::move(f));
+    test_check(!f.valid());
+    test_check(g.get() == 42);
+
+    std::vector<qthread::future<long>> many;
+    for (long i = 0; i < 100; i++) {
+      many.push_back(qthread::spawn([i] { return i * i; }));
+    }
+    long sum = 0;
+    for (auto &m : many) { sum += m.get(); }
+    test_check(sum == 328350);
+
+    std::atomic<int> done(0);
+    {
+      qthread::future<void> unwaited = qthread::spawn([&done] { done++; });
+    }
+    test_check(done == 1);
+    iprintf("moved and unwaited futures\n");
+  }
+
+  /* nested spawns, and captures bigger than the usual argument copy */
+  {
+    test_check(fib(20) == 6765);
+
+    struct {
+      char pad[4096];
+    } big;
+    big.pad[4095] = 9;
+    qthread::future<int> f = qthread::spawn([big] { return (int)big.pad[4095]; });
+    test_check(f.get() == 9);
+    iprintf("nested spawns and big captures\n");
+  }
+
+  /* loops over iterator and index ranges */
+  {
+    std::vector<long> v(10000);
+    qthread::parallel_for(
+      (size_t)0, v.size(), [&v](size_t i) { v[i] = (long)i + 1; });
+    qthread::parallel_for(v.begin(), v.end(), [](long &x) { x *= 2; });
+    for (size_t i = 0; i < v.size(); i++) {
+      test_check(v[i] == 2 * ((long)i + 1));
+    }
+
+    long const total = qthread::parallel_reduce(
+      v.begin(), v.end(), 5L, [](long a, long b) { return a + b; });
+    test_check(total == 5 + 10000L * 10001);
+    long const squares = qthread::parallel_reduce(
+      0,
+      100,
+      0L,
+      [](long a, long b) { return a + b; },
+      [](int i) { return (long)i * i; });
+    test_check(squares == 328350);
+    test_check(qthread::parallel_reduce(
+                 v.begin(), v.begin(), 3L, [](long a, long b) {
+                   return a + b;
+                 }) == 3);
+    iprintf("parallel_for and parallel_reduce\n");
+  }
+
+  return 0;
+}
+
+/* vim:set expandtab: */
@@ -0,0 +1,74 @@
+#include <qthread/qthread.hpp>
+
+#include "argparsing.h"
+
+/* can see whether tasks are queued on the syncvar */
+class probed_syncvar : public syncvar {
+public:
+  int has_waiters() const {
+    syncvar_t v;
+
+    v.u.w = __atomic_load_n(&the_syncvar_t.u.w, __ATOMIC_ACQUIRE);
+    return (v.u.s.lock == 0) && (v.u.s.state & 1);
+  }
+};
+
+static probed_syncvar sv;
+
+static aligned_t reader(void *arg) { return (aligned_t)sv.readFF(); }
+
+static aligned_t taker(void *arg) { return (aligned_t)sv.readFE(); }
+
+static void wait_for_waiters(void) {
+  while (!sv.has_waiters()) { qthread_yield(); }
+}
+
+int main(int argc, char **argv) {
+  aligned_t ret1, ret2;
+
+  test_check(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+
+  /* without waiters, read() and write() see and set the value as it is */
+  sv.empty();
+  sv.write(7);
+  test_check(sv.read() == 7);
+  test_check(sv.status() == 0);
+
+  /* with a blocked reader, they see and set the value, not the bookkeeping,
+   * and leave the reader blocked */
+  qthread_fork(reader, NULL, &ret1);
+  wait_for_waiters();
+  test_check(sv.read() == 7);
+  sv.write(9);
+  test_check(sv.read() == 9);
+  test_check(sv.has_waiters());
+  test_check(sv.status() == 0);
+  iprintf("read() and write() with a blocked reader\n");
+
+  /* the reader wakes up with what write() stored */
+  sv.fill();
+  qthread_readFF(NULL, &ret1);
+  test_check(ret1 == 9);
+  test_check(sv.read() == 9);
+
+  /* the same with two blocked takers, one of which the fill releases */
+  sv.empty();
+  qthread_fork(taker, NULL, &ret1);
+  qthread_fork(taker, NULL, &ret2);
+  wait_for_waiters();
+  sv.write(11);
+  test_check(sv.read() == 11);
+  sv.fill();
+  test_check(sv.writeEF(12) == QTHREAD_SUCCESS);
+  qthread_readFF(NULL, &ret1);
+  qthread_readFF(NULL, &ret2);
+  test_check((ret1 == 11 && ret2 == 12) || (ret1 == 12 && ret2 == 11));
+  test_check(sv.status() == 0);
+  test_check(!sv.has_waiters());
+  iprintf("read() and write() with blocked takers\n");
+
+  return 0;
+}
+
+/* vim:set expandtab */
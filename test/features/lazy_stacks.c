@@ -0,0 +1,90 @@
+#include "argparsing.h"
+#include <qthread/qthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEEP_BYTES (256 * 1024)
+
+static aligned_t num_tasks = 1000;
+static aligned_t release = 0;
+static aligned_t blocked = 0;
+static aligned_t all_blocked = 0;
+
+static aligned_t shallow(void *arg) {
+  size_t peak = qthread_readstate(STACK_PEAK);
+
+  iprintf("shallow peak = %zu\n", peak);
+  test_check(peak > 0);
+  test_check(peak < 64 * 1024);
+  return 0;
+}
+
+static aligned_t deep(void *arg) {
+  char volatile buf[DEEP_BYTES];
+  size_t peak;
+
+  memset((char *)buf, 1, sizeof(buf));
+  peak = qthread_readstate(STACK_PEAK);
+  iprintf("deep peak = %zu\n", peak);
+  test_check(peak >= DEEP_BYTES);
+  test_check(peak <= qthread_readstate(STACK_SIZE));
+  return buf[DEEP_BYTES / 2];
+}
+
+static aligned_t waiter(void *arg) {
+  if (qthread_incr(&blocked, 1) + 1 == num_tasks) {
+    qthread_fill(&all_blocked);
+  }
+  qthread_readFF(NULL, &release);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  aligned_t ret;
+  aligned_t *rets;
+
+  /* reserve far more stack than anything here will touch */
+  setenv("QT_LAZY_STACKS", "1", 1);
+  setenv("QT_STACK_SIZE", "1048576", 1);
+  test_check(qthread_initialize() == 0);
+  CHECK_VERBOSE();
+  NUMARG(num_tasks, "NUM_TASKS");
+  test_check(qthread_readstate(STACK_SIZE) >= 1048576 - 4096);
+
+  /* the main task runs on the pthread stack, not a qthread stack */
+  test_check(qthread_readstate(STACK_PEAK) == 0);
+
+  qthread_fork(shallow, NULL, &ret);
+  qthread_readFF(NULL, &ret);
+  qthread_fork(deep, NULL, &ret);
+  qthread_readFF(NULL, &ret);
+  test_check(ret == 1);
+
+  /* lots of simultaneously blocked tasks, each holding a 1MB reservation */
+  rets = malloc(num_tasks * sizeof(aligned_t));
+  test_check(rets);
+  qthread_empty(&release);
+  qthread_empty(&all_blocked);
+  for (aligned_t i = 0; i < num_tasks; i++) {
+    qthread_fork(waiter, NULL, &rets[i]);
+  }
+  qthread_readFF(NULL, &all_blocked);
+  iprintf("%lu tasks blocked\n", (unsigned long)num_tasks);
+  qthread_fill(&release);
+  for (aligned_t i = 0; i < num_tasks; i++) { qthread_readFF(NULL, &rets[i]); }
+  free(rets);
+
+  /* recycled stacks still work */
+  qthread_fork(deep, NULL, &ret);
+  qthread_readFF(NULL, &ret);
+  test_check(ret == 1);
+
+  /* and what the last task used of one does not count for the next */
+  qthread_fork(shallow, NULL, &ret);
+  qthread_readFF(NULL, &ret);
+
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -0,0 +1,68 @@
+#include "argparsing.h"
+#include <qthread/qloop.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static size_t numiters = 10000;
+static aligned_t *visits;
+static aligned_t chunks = 0;
+
+/* the first eighth of the iterations are much more expensive than the rest */
+static aligned_t work(size_t i) {
+  aligned_t x = i;
+  size_t const reps = (i < numiters / 8) ? 2000 : 10;
+
+  for (size_t r = 0; r < reps; r++) { x = x * 1103515245 + 12345; }
+  return x;
+}
+
+static void visit(size_t const startat, size_t const stopat, void *arg) {
+  test_check(arg == &numiters);
+  qthread_incr(&chunks, 1);
+  for (size_t i = startat; i < stopat; i++) {
+    (void)work(i);
+    qthread_incr(&visits[i], 1);
+  }
+}
+
+static void
+sum(size_t const startat, size_t const stopat, void *arg, void *ret) {
+  aligned_t total = 0;
+
+  for (size_t i = startat; i < stopat; i++) { total += i + 1; }
+  *(aligned_t *)ret = total;
+}
+
+int main(int argc, char *argv[]) {
+  aligned_t total = 0;
+
+  test_check(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(numiters, "NUM_ITERS");
+  iprintf("%i shepherds\n", qthread_num_shepherds());
+  iprintf("%i threads\n", qthread_num_workers());
+
+  visits = calloc(numiters, sizeof(aligned_t));
+  test_check(visits != NULL);
+  qt_loop_adaptive(0, numiters, visit, &numiters);
+  for (size_t i = 0; i < numiters; i++) { test_check(visits[i] == 1); }
+  iprintf("%lu iterations in %lu chunks\n",
+          (unsigned long)numiters,
+          (unsigned long)chunks);
+  free(visits);
+
+  qt_loopaccum_adaptive(
+    0, numiters, sizeof(aligned_t), &total, sum, NULL, qt_uint_add_acc);
+  iprintf("sum is %lu\n", (unsigned long)total);
+  test_check(total == numiters * (numiters + 1) / 2);
+
+  /* empty loops do nothing, and leave the result alone */
+  qt_loop_adaptive(5, 5, visit, &numiters);
+  qt_loopaccum_adaptive(
+    5, 5, sizeof(aligned_t), &total, sum, NULL, qt_uint_add_acc);
+  test_check(total == numiters * (numiters + 1) / 2);
+
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -0,0 +1,164 @@
+#include <math.h> /* for INFINITY */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "argparsing.h"
+#include <qthread/qutil.h>
+
+static int acmp(void const *a, void const *b) {
+  aligned_t const x = *(aligned_t const *)a;
+  aligned_t const y = *(aligned_t const *)b;
+
+  return (x > y) - (x < y);
+}
+
+static int dcmp(void const *a, void const *b) {
+  double const x = *(double const *)a;
+  double const y = *(double const *)b;
+
+  return (x > y) - (x < y);
+}
+
+static aligned_t rand_aligned(void) {
+  return (aligned_t)(((uint64_t)random() << 33) ^ ((uint64_t)random() << 11) ^
+                     (uint64_t)random());
+}
+
+/* sorts a copy of orig with sort, and checks it against qsort() */
+static void check_aligned(char const *name,
+                          void (*sort)(aligned_t *, size_t),
+                          aligned_t const *orig,
+                          size_t len) {
+  aligned_t *a = (aligned_t *)malloc(len * sizeof(aligned_t) + 1);
+  aligned_t *b = (aligned_t *)malloc(len * sizeof(aligned_t) + 1);
+
+  memcpy(a, orig, len * sizeof(aligned_t));
+  memcpy(b, orig, len * sizeof(aligned_t));
+  sort(a, len);
+  qsort(b, len, sizeof(aligned_t), acmp);
+  for (size_t i = 0; i < len; i++) {
+    if (a[i] != b[i]) {
+      fprintf(stderr,
+              "%s: %lu elements, wrong at %lu: %lu != %lu\n",
+              name,
+              (unsigned long)len,
+              (unsigned long)i,
+              (unsigned long)a[i],
+              (unsigned long)b[i]);
+      abort();
+    }
+  }
+  free(a);
+  free(b);
+}
+
+static void check_double(char const *name,
+                         void (*sort)(double *, size_t),
+                         double const *orig,
+                         size_t len) {
+  double *a = (double *)malloc(len * sizeof(double) + 1);
+  double *b = (double *)malloc(len * sizeof(double) + 1);
+
+  memcpy(a, orig, len * sizeof(double));
+  memcpy(b, orig, len * sizeof(double));
+  sort(a, len);
+  qsort(b, len, sizeof(double), dcmp);
+  for (size_t i = 0; i < len; i++) {
+    if (a[i] != b[i]) {
+      fprintf(stderr,
+              "%s: %lu elements, wrong at %lu: %f != %f\n",
+              name,
+              (unsigned long)len,
+              (unsigned long)i,
+              a[i],
+              b[i]);
+      abort();
+    }
+  }
+  free(a);
+  free(b);
+}
+
+int main(int argc, char *argv[]) {
+  size_t len = 300000;
+  size_t const sizes[] = {0, 1, 2, 31, 33, 1000, 40000};
+  aligned_t *ui_array, *values;
+  double *d_array;
+
+  test_check(qthread_initialize() == QTHREAD_SUCCESS);
+  CHECK_VERBOSE();
+  NUMARG(len, "TEST_LEN");
+
+  ui_array = (aligned_t *)malloc(len * sizeof(aligned_t));
+  d_array = (double *)malloc(len * sizeof(double));
+  values = (aligned_t *)malloc(len * sizeof(aligned_t));
+  for (size_t s = 0; s <= sizeof(sizes) / sizeof(sizes[0]); s++) {
+    size_t const n = (s < sizeof(sizes) / sizeof(sizes[0])) ? sizes[s] : len;
+
+    if (n > len) { continue; }
+    iprintf("%lu elements\n", (unsigned long)n);
+
+    /* keys with every bit in use, then ones in only a few bytes */
+    for (size_t i = 0; i < n; i++) { ui_array[i] = rand_aligned(); }
+    check_aligned("radixsort", qutil_aligned_radixsort, ui_array, n);
+    check_aligned("samplesort", qutil_aligned_samplesort, ui_array, n);
+    for (size_t i = 0; i < n; i++) { ui_array[i] = random() % 1000; }
+    check_aligned("radixsort", qutil_aligned_radixsort, ui_array, n);
+    check_aligned("samplesort", qutil_aligned_samplesort, ui_array, n);
+    for (size_t i = 0; i < n; i++) { ui_array[i] = 42; }
+    check_aligned("samplesort", qutil_aligned_samplesort, ui_array, n);
+
+    /* doubles of both signs, with zeros and infinities */
+    for (size_t i = 0; i < n; i++) {
+      d_array[i] = (random() / (double)RAND_MAX - 0.5) * 1e6;
+      switch (random() % 64) {
+        case 0: d_array[i] = 0.0; break;
+        case 1: d_array[i] = INFINITY; break;
+        case 2: d_array[i] = -INFINITY; break;
+        case 3: d_array[i] = -1.0 / (i + 1); break;
+      }
+    }
+    check_double("radixsort", qutil_radixsort, d_array, n);
+    check_double("samplesort", qutil_samplesort, d_array, n);
+
+    /* the values go with their keys, and keep their order among equal ones */
+    for (size_t i = 0; i < n; i++) {
+      ui_array[i] = random() % 100;
+      d_array[i] = (double)ui_array[i] - 50;
+      values[i] = i;
+    }
+    {
+      aligned_t *keys = (aligned_t *)malloc(n * sizeof(aligned_t) + 1);
+
+      memcpy(keys, ui_array, n * sizeof(aligned_t));
+      qutil_aligned_radixsort_kv(keys, values, n);
+      for (size_t i = 0; i < n; i++) {
+        test_check(keys[i] == ui_array[values[i]]);
+        if (i > 0) {
+          test_check(keys[i - 1] <= keys[i]);
+          if (keys[i - 1] == keys[i]) { test_check(values[i - 1] < values[i]); }
+        }
+      }
+      for (size_t i = 0; i < n; i++) { values[i] = i; }
+      qutil_radixsort_kv(d_array, values, n);
+      for (size_t i = 0; i < n; i++) {
+        test_check(d_array[i] == (double)ui_array[values[i]] - 50);
+        if (i > 0) {
+          test_check(d_array[i - 1] <= d_array[i]);
+          if (d_array[i - 1] == d_array[i]) {
+            test_check(values[i - 1] < values[i]);
+          }
+        }
+      }
+      free(keys);
+    }
+  }
+  free(ui_array);
+  free(d_array);
+  free(values);
+
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -0,0 +1,102 @@
+#include "argparsing.h"
+#include <qthread/qthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Races a writeF, a readFE and a readFF on each of a set of full words. The
+ * writeF may land before or after the readFE, but either way it must be
+ * seen: if the word ends up empty, the readFE read what the writeF wrote,
+ * and if it ends up full, it holds what the writeF wrote. The readFF must
+ * see one of the two values the word ever held. */
+
+static uint64_t iterations = 2000;
+static uint64_t words = 0;
+
+static aligned_t *x;
+static aligned_t *got_fe;
+static aligned_t *got_ff;
+
+static aligned_t writer(void *arg) {
+  size_t const j = (size_t)(uintptr_t)arg;
+
+  qthread_writeF_const(&x[j], 2 * j + 2);
+  return 0;
+}
+
+static aligned_t fe_reader(void *arg) {
+  size_t const j = (size_t)(uintptr_t)arg;
+
+  qthread_readFE(&got_fe[j], &x[j]);
+  return 0;
+}
+
+static aligned_t ff_reader(void *arg) {
+  size_t const j = (size_t)(uintptr_t)arg;
+
+  qthread_readFF(&got_ff[j], &x[j]);
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  aligned_t *rets;
+  uint64_t full_ends = 0;
+
+  test_check(qthread_initialize() == 0);
+  words = qthread_num_shepherds() * 16;
+
+  CHECK_VERBOSE();
+  NUMARG(iterations, "ITERATIONS");
+  NUMARG(words, "WORDS");
+
+  x = calloc(words, sizeof(aligned_t));
+  got_fe = calloc(words, sizeof(aligned_t));
+  got_ff = calloc(words, sizeof(aligned_t));
+  rets = calloc(3 * words, sizeof(aligned_t));
+  test_check(x && got_fe && got_ff && rets);
+
+  for (uint64_t i = 0; i < iterations; i++) {
+    for (size_t j = 0; j < words; j++) {
+      qthread_writeF_const(&x[j], 2 * j + 1);
+      got_fe[j] = got_ff[j] = 0;
+    }
+    for (size_t j = 0; j < words; j++) {
+      void *const arg = (void *)(uintptr_t)j;
+
+      qthread_fork(fe_reader, arg, &rets[3 * j]);
+      qthread_fork(writer, arg, &rets[3 * j + 1]);
+      qthread_fork(ff_reader, arg, &rets[3 * j + 2]);
+    }
+    for (size_t j = 0; j < words; j++) {
+      aligned_t const r0 = 2 * j + 1, r1 = 2 * j + 2;
+
+      qthread_readFF(NULL, &rets[3 * j]);
+      qthread_readFF(NULL, &rets[3 * j + 1]);
+      if (qthread_feb_status(&x[j])) {
+        /* the readFE went first */
+        test_check(got_fe[j] == r0);
+        test_check(x[j] == r1);
+        full_ends++;
+      } else {
+        /* the writeF went first */
+        test_check(got_fe[j] == r1);
+        test_check(x[j] == r1);
+        /* let the readFF finish */
+        qthread_fill(&x[j]);
+      }
+      qthread_readFF(NULL, &rets[3 * j + 2]);
+      test_check(got_ff[j] == r0 || got_ff[j] == r1);
+    }
+  }
+  iprintf("%lu of %lu races ended full\n",
+          (unsigned long)full_ends,
+          (unsigned long)(iterations * words));
+
+  free(rets);
+  free(got_ff);
+  free(got_fe);
+  free(x);
+
+  return 0;
+}
+
+/* vim:set expandtab */
@@ -0,0 +1,68 @@
+#include <qthread/qloop.h>
+#include <qthread/qthread.h>
+#include <stdio.h>
+
+#include "argparsing.h"
+
+static uint64_t count;
+static qthread_qlock_t lock;
+
+static void task_1(size_t start, size_t stop, void *args_) {
+  qthread_qlock_lock(&lock);
+  count++;
+  qthread_qlock_unlock(&lock);
+}
+
+/* holds the lock across a yield, so that the others have to park */
+static void task_2(size_t start, size_t stop, void *args_) {
+  uint64_t c;
+
+  qthread_qlock_lock(&lock);
+  c = count;
+  qthread_yield();
+  count = c + 1;
+  qthread_qlock_unlock(&lock);
+}
+
+static void task_3(size_t start, size_t stop, void *args_) {
+  while (qthread_qlock_trylock(&lock) != QTHREAD_SUCCESS) { qthread_yield(); }
+  count++;
+  qthread_qlock_unlock(&lock);
+}
+
+int main(int argc, char *argv[]) {
+  uint64_t iters = 10000l;
+  test_check(qthread_initialize() == 0);
+  CHECK_VERBOSE();
+  NUMARG(iters, "ITERS");
+
+  test_check(qthread_qlock_init(&lock) == QTHREAD_SUCCESS);
+
+  /* trylock fails only while someone holds it */
+  test_check(qthread_qlock_trylock(&lock) == QTHREAD_SUCCESS);
+  test_check(qthread_qlock_trylock(&lock) == QTHREAD_OPFAIL);
+  test_check(qthread_qlock_unlock(&lock) == QTHREAD_SUCCESS);
+  test_check(qthread_qlock_trylock(&lock) == QTHREAD_SUCCESS);
+  test_check(qthread_qlock_unlock(&lock) == QTHREAD_SUCCESS);
+
+  /* Simple lock acquire and release */
+  count = 0;
+  qt_loop(0, iters, task_1, NULL);
+  test_check(iters == count);
+
+  /* Waiters that park */
+  count = 0;
+  qt_loop(0, iters, task_2, NULL);
+  test_check(iters == count);
+
+  /* Trylock against lock */
+  count = 0;
+  qt_loop(0, iters / 2, task_1, NULL);
+  qt_loop(0, iters / 2, task_3, NULL);
+  test_check(iters / 2 * 2 == count);
+
+  test_check(qthread_qlock_destroy(&lock) == QTHREAD_SUCCESS);
+  iprintf("%lu lock/unlock pairs\n", (unsigned long)count);
+
+  return 0;
+}